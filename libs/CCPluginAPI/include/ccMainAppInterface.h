@@ -101,6 +101,17 @@ public:
 	**/
 	virtual void removeFromDB(ccHObject* obj, bool autoDelete = true) = 0;
 
+	//! Starts a batch of modifications of the main db tree
+	/** Until the batch is ended (see endDBBatch), the entities added with addToDB
+		are inserted in the db tree all at once, and the refresh of their properties
+		is postponed. To be used when many entities are added or removed in a row.
+		Batches can be nested.
+	**/
+	virtual void beginDBBatch() {}
+
+	//! Ends a batch of modifications of the main db tree (see beginDBBatch)
+	virtual void endDBBatch() {}
+
 	//! Backup "context" for an object
 	/** Used with removeObjectTemporarilyFromDBTree/putObjectBackIntoDBTree.
 	**/
@@ -0,0 +1,96 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//Local
+#include "qCC_db.h"
+
+//Qt
+#include <QString>
+#include <QTime>
+
+//system
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//! Lock-free multi-producer / single-consumer ring buffer of log messages
+/** Any number of threads can push messages concurrently without ever taking a lock
+	(each slot carries a sequence number telling whether it is free or filled).
+	Only one thread should pop messages (typically a writer thread).
+	The capacity is fixed: when the buffer is full, push() fails immediately.
+**/
+class QCC_DB_LIB_API ccLogRingBuffer
+{
+public:
+
+	//! Log message
+	struct Message
+	{
+		QString text;	//!< Message text
+		int level = 0;	//!< Message level (see ccLog::MessageLevelFlags)
+		QTime time;		//!< Time at which the message was emitted
+	};
+
+	//! Default capacity (number of messages)
+	static constexpr size_t DefaultCapacity = 8192;
+
+	//! Constructor
+	/** \param capacity buffer capacity (rounded up to the next power of 2)
+	**/
+	explicit ccLogRingBuffer(size_t capacity = DefaultCapacity);
+
+	//! Destructor
+	~ccLogRingBuffer();
+
+	//! Returns the capacity
+	inline size_t capacity() const { return m_mask + 1; }
+
+	//! Pushes a message (thread-safe, lock-free)
+	/** \return false if the buffer is full
+	**/
+	bool push(const QString& text, int level, const QTime& time);
+
+	//! Pops the oldest message (single consumer only)
+	/** \return false if the buffer is empty
+	**/
+	bool pop(Message& message);
+
+	//! Returns whether the buffer is (approximately) empty
+	bool empty() const;
+
+protected:
+
+	//! Buffer slot
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		Message message;
+	};
+
+	//! Slots
+	std::unique_ptr<Slot[]> m_slots;
+	//! Capacity - 1 (the capacity is a power of 2)
+	size_t m_mask;
+
+	//! Next write position (shared by the producers)
+	alignas(64) std::atomic<size_t> m_writePos;
+	//! Next read position (consumer only)
+	alignas(64) std::atomic<size_t> m_readPos;
+};
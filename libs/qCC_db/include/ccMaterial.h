@@ -108,6 +108,7 @@ public:
 
 	//! Loads texture from file (and set it if successful)
 	/** If the filename is not already in DB, the corresponding file will be loaded.
+		The image is decoded asynchronously (the first call to getTexture may wait for it).
 		\return whether the file could be loaded (or is already in DB) or not
 	**/
 	bool loadAndSetTexture(const QString& absoluteFilename);
@@ -115,6 +116,15 @@ public:
 	//! Returns the texture (if any)
 	const QImage getTexture() const;
 
+	//! Returns a downsampled version of the texture (if any)
+	/** Level n corresponds to 1/2^n of the full resolution (level 0 = full resolution).
+		The downsampled images are cached.
+	**/
+	QImage getTextureLevel(unsigned level) const;
+
+	//! Returns the texture size (without waiting for the image to be loaded, if possible)
+	QSize getTextureSize() const;
+
 	//! Returns the texture ID (if any)
 	GLuint getTextureID() const;
 
@@ -129,6 +139,19 @@ public:
 	//! Adds a texture to the global texture DB
 	static void AddTexture(QImage image, const QString& absoluteFilename);
 
+	//! Sets the texture cache budget (in bytes)
+	/** When the total size of the textures in memory exceeds this budget, the least
+		recently used textures loaded from files are evicted (they will be reloaded
+		on demand).
+	**/
+	static void SetTextureCacheBudget(qint64 bytes);
+
+	//! Returns the texture cache budget (in bytes)
+	static qint64 TextureCacheBudget();
+
+	//! Returns the current size of the textures in memory (in bytes)
+	static qint64 TextureCacheSize();
+
 	//! Release all texture objects
 	/** Should be called BEFORE the global shared context is destroyed.
 	**/
@@ -23,133 +23,134 @@
 #include <QFileSystemWatcher>
 #include <QFileInfo>
 #include <QImage>
+#include <QMutex>
 #include <QOpenGLTexture>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
 
 //! Smart texture database
+/** Textures loaded from files are decoded asynchronously (in parallel, see loadTexture)
+	and can be evicted from memory (least recently used first) when the total size of the
+	cached images exceeds a given budget. They are then transparently reloaded on demand.
+	Textures set directly from memory (see addTexture) are never evicted.
+	Downsampled versions of the textures (mip levels) can also be cached.
+**/
 class ccMaterialDB : public QObject
 {
 	Q_OBJECT
 
 public:
 
-	ccMaterialDB()
-		: m_initialized(false)
-	{}
+	//! Default cache budget (in bytes)
+	static constexpr qint64 DefaultBudget = (static_cast<qint64>(1) << 31); //2 Gb
 
-	void init()
-	{
-		if (!m_initialized)
-		{
-			connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ccMaterialDB::onFileChanged);
-			m_initialized = true;
-		}
-	}
-
-	void onFileChanged(const QString& filename)
-	{
-		if (!m_textures.contains(filename))
-		{
-			assert(false);
-			m_watcher.removePath(filename);
-			return;
-		}
-		
-		if (QFileInfo(filename).exists()) //make sure the image still exists
-		{
-			ccLog::Warning(tr("File '%1' has been updated").arg(filename));
-			QImage image;
-			if (image.load(filename))
-			{
-				//update the texture
-				m_textures[filename].image = image;
-				openGLTextures.remove(filename);
-			}
-			else
-			{
-				ccLog::Warning(tr("Failed to load the new version of the file"));
-			}
-		}
-		else
-		{
-			ccLog::Warning(tr("File '%1' has been deleted or renamed").arg(filename));
-		}
-	}
-
-	inline bool hasTexture(const QString& filename) const
-	{
-		return m_textures.contains(filename);
-	}
+	//! Default constructor
+	ccMaterialDB();
 
-	inline QImage getTexture(const QString& filename) const
-	{
-		return m_textures.contains(filename) ? m_textures[filename].image : QImage();
-	}
+	//! Destructor
+	~ccMaterialDB() override;
 
-	void addTexture(const QString& filename, const QImage& image)
-	{
-		if (!m_initialized)
-			init();
-
-		if (m_textures.contains(filename))
-		{
-			++m_textures[filename].counter;
-		}
-		else
-		{
-			m_textures[filename].image = image;
-			m_textures[filename].counter = 1;
-			m_watcher.addPath(filename);
-		}
-	}
-
-	void increaseTextureCounter(const QString& filename)
-	{
-		if (m_textures.contains(filename))
-		{
-			assert(m_textures[filename].counter >= 1);
-			++m_textures[filename].counter;
-		}
-		else
-		{
-			assert(false);
-		}
-	}
-
-	void releaseTexture(const QString& filename)
-	{
-		if (m_textures.contains(filename))
-		{
-			if (m_textures[filename].counter > 1)
-			{
-				--m_textures[filename].counter;
-			}
-			else
-			{
-				removeTexture(filename);
-			}
-		}
-	}
-
-	void removeTexture(const QString& filename)
-	{
-		m_textures.remove(filename);
-		m_watcher.removePath(filename);
+	void init();
+
+	void onFileChanged(const QString& filename);
+
+	//! Returns whether a texture is referenced in the DB
+	bool hasTexture(const QString& filename) const;
+
+	//! Returns whether a texture is referenced in the DB and can be used
+	bool hasValidTexture(const QString& filename) const;
+
+	//! Returns the (full resolution) image of a texture
+	/** Waits for the image if it is being loaded, or reloads it if it has been evicted.
+	**/
+	QImage getTexture(const QString& filename);
+
+	//! Returns a downsampled version of a texture (level n = 1/2^n of the full resolution)
+	QImage getTextureLevel(const QString& filename, unsigned level);
+
+	//! Returns the size of a texture (without waiting for the image to be loaded, if possible)
+	QSize getTextureSize(const QString& filename) const;
 
-		assert(QOpenGLContext::currentContext());
-		openGLTextures.remove(filename);
-	}
+	//! Adds a texture (from memory)
+	void addTexture(const QString& filename, const QImage& image);
+
+	//! Adds a texture from a file
+	/** Only the file header is read. The image is decoded in a background thread
+		if the budget allows it, or on the first access otherwise.
+		\param filename image file
+		\param mirrored whether the image should be mirrored (see ccMaterial::setTexture)
+		\return false if the file can't be read
+	**/
+	bool loadTexture(const QString& filename, bool mirrored);
+
+	void increaseTextureCounter(const QString& filename);
+
+	void releaseTexture(const QString& filename);
+
+	void removeTexture(const QString& filename);
+
+	//! Sets the cache budget (in bytes)
+	void setBudget(qint64 bytes);
+	//! Returns the cache budget (in bytes)
+	inline qint64 budget() const { return m_budget; }
+	//! Returns the current size of the cached images (in bytes)
+	qint64 cachedBytes() const;
 
 	QMap<QString, QSharedPointer<QOpenGLTexture> > openGLTextures;
 
-protected:
+protected: //methods
+
+	struct TextureInfo;
+
+	//! Returns the size of an image (in bytes)
+	static inline qint64 ImageBytes(const QImage& image) { return static_cast<qint64>(image.bytesPerLine()) * image.height(); }
+
+	//! Starts loading the image of a texture (the mutex must be locked)
+	void startLoading(const QString& filename, TextureInfo& info);
+
+	//! Called by the loading threads
+	void onImageLoaded(const QString& filename, quint64 loadID, QImage image);
+
+	//! Evicts the least recently used images until the budget is respected (the mutex must be locked)
+	void evict(const QString& filenameToKeep);
+
+	//! Drops the cached images of a texture (the mutex must be locked)
+	void dropImages(TextureInfo& info, bool dropFullImage);
+
+protected: //members
 
 	struct TextureInfo
 	{
-		QImage image;
-		unsigned counter = 0;
+		QImage image;			//!< Full resolution image (null if not loaded yet or evicted)
+		QVector<QImage> levels;	//!< Downsampled images (levels[n-1] = level n)
+		QSize size;				//!< Full resolution size (known before the image is loaded)
+		qint64 bytes = 0;		//!< Size of the cached images (in bytes)
+		unsigned counter = 0;	//!< Number of materials using this texture
+		unsigned waiters = 0;	//!< Number of threads waiting for the image (it can't be evicted meanwhile)
+		bool onDisk = false;	//!< Whether the image can be reloaded from its file
+		bool mirrored = false;	//!< Whether the image is mirrored after loading
+		bool pending = false;	//!< Whether the image is being loaded
+		bool failed = false;	//!< Whether the image failed to load
+		quint64 loadID = 0;		//!< Current loading request
+		quint64 lastAccess = 0;	//!< Last access stamp (for LRU eviction)
 	};
 
+	class Loader;
+
 	bool m_initialized;
 	QFileSystemWatcher m_watcher;
 	QMap<QString, TextureInfo> m_textures;
+
+	//! Mutex (the images are loaded by other threads)
+	mutable QMutex m_mutex;
+	//! Signaled each time an image is loaded
+	QWaitCondition m_imageLoaded;
+	//! Loading threads
+	QThreadPool m_loaders;
+
+	qint64 m_budget;
+	qint64 m_cachedBytes;
+	quint64 m_accessCounter;
+	quint64 m_loadCounter;
 };
@@ -29,6 +29,7 @@
 #include "ccColorScale.h"
 #include "ccNormalVectors.h"
 #include "ccWaveform.h"
+#include "ccWaveformPager.h"
 
 //Qt
 #include <QOpenGLBuffer>
@@ -123,9 +124,26 @@ public: //clone, copy, etc.
 	**/
 	ccPointCloud* partialClone(const CCCoreLib::ReferenceCloud* selection, int* warnings = nullptr, bool withChildEntities = true) const;
 
+	//! Splits this cloud in several parts (one per key)
+	/** Each point is assigned to a part by its key: a value in [0 ; partCount[, or a negative
+		value to discard the point. The keys are histogrammed, the offsets of each part are
+		computed by prefix sum, and all the attributes (points, colors, normals, scalar fields
+		and waveforms) are scattered in a single (parallel) pass. The points keep their original
+		order in each part. This is much faster than calling partialClone once per part.
+		Note: the scan grids and the child entities are not transferred.
+		\param[in]  keys		one key per point
+		\param[in]  partCount	number of parts
+		\param[out] parts		one cloud per key (nullptr if no point has this key)
+		\param[out] warnings	[optional] to determine if warnings (CLONE_WARNINGS) occurred during the process
+		\return success
+	**/
+	bool partition(const std::vector<int>& keys, unsigned partCount, std::vector<ccPointCloud*>& parts, int* warnings = nullptr) const;
+
 	//! Clones this entity
 	/** All the main features of the entity are cloned, except from the octree and
 		the points visibility information.
+		\warning Only the colors and normals tables are shared with the clone (see detachColors).
+		The points and the scalar fields are always duplicated.
 		\param destCloud [optional] the destination cloud can be provided here
 		\param ignoreChildren [optional] whether to ignore the cloud's children or not (in which case they will be cloned as well)
 		\return a copy of this entity
@@ -162,6 +180,14 @@ public: //features deletion/clearing
 
 	//! Notify a modification of color / scalar field display parameters or contents
 	inline void colorsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_COLORS; }
+	//! Notify a modification of the colors of a range of points
+	/** Only the corresponding parts of the VBOs will be reloaded (if the colors are displayed).
+		Meant for small and frequent modifications (e.g. interactive tools). The colors table
+		should have been detached first (see detachColors).
+		\param firstIndex index of the first modified point
+		\param lastIndex index of the last modified point + 1
+	**/
+	void colorsHaveChanged(unsigned firstIndex, unsigned lastIndex);
 	//! Notify a modification of normals display parameters or contents
 	inline void normalsHaveChanged() { m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS; decompressNormals();}
 	//! Notify a modification of points display parameters or contents
@@ -430,15 +456,51 @@ public: //waveform (e.g. from airborne scanners)
 	//! Gives access to the associated FWF data container (const version)
 	const SharedFWFDataContainer& fwfData() const { return m_fwfData; }
 
+	//! Gives access to the associated FWF pager (out-of-core FWF data)
+	/** If set, the FWF data is not loaded in memory but paged in on demand
+		from its source file(s). The in-memory container (see fwfData) is then empty.
+	**/
+	ccSharedWaveformPager& fwfPager() { return m_fwfPager; }
+	//! Gives access to the associated FWF pager (const version)
+	const ccSharedWaveformPager& fwfPager() const { return m_fwfPager; }
+
+	//! Returns whether the FWF data is paged from file(s) or not
+	inline bool fwfDataIsPaged() const { return m_fwfPager && !m_fwfPager->empty(); }
+
+	//! Returns the size of the FWF data (in memory or paged)
+	uint64_t fwfDataSize() const;
+
+	//! Writes the whole FWF data (in memory or paged) to a device
+	/** Paged data is streamed chunk by chunk.
+	**/
+	bool writeFWFData(QIODevice& out) const;
+
 	//! Compresses the associated FWF data container
 	/** As the container is shared, the compressed version will be potentially added to the memory
 		resulting in a decrease of the available memory...
+		\warning Paged FWF data is not compressed (it doesn't consume memory)
 	**/
 	bool compressFWFData();
 
 	//! Computes the maximum amplitude of all associated waveforms
 	bool computeFWFAmplitude(double& minVal, double& maxVal, ccProgressDialog* pDlg = nullptr) const;
 
+	//! Per-point waveform features
+	enum FWF_FEATURE
+	{
+		FWF_PEAK_AMPLITUDE	= 1, //!< Maximum (real) sample value
+		FWF_ECHO_WIDTH		= 2, //!< Full width at half maximum of the main peak (in ns)
+		FWF_INTEGRAL		= 4, //!< Integral of the signal above its minimum value (in V.ns)
+	};
+
+	//! Computes per-point waveform features as scalar fields
+	/** The waveforms are decoded by blocks, and the features are computed in parallel.
+		\param features combination of FWF_FEATURE flags
+		\param pDlg optional progress dialog
+		\return the number of computed features (scalar fields)
+	**/
+	int computeFWFFeatures(unsigned features, ccProgressDialog* pDlg = nullptr);
+
 	//! Clears all associated FWF data
 	void clearFWFData();
 
@@ -773,11 +835,31 @@ public: //other methods
 	int addScalarField(ccScalarField* sf);
 
 	//! Returns pointer on RGBA colors table
+	/** \warning The table may be shared with other clouds (see detachColors).
+	**/
 	RGBAColorsTableType* rgbaColors() const { return m_rgbaColors; }
 
 	//! Returns pointer on compressed normals indexes table
+	/** \warning The table may be shared with other clouds (see detachNormals).
+	**/
 	NormsIndexesTableType* normals() const { return m_normals; }
 
+	//! Makes sure the colors table is not shared with another cloud (copy-on-write)
+	/** Clones share the colors and normals tables of their source cloud, until one of
+		them is modified. Only these two tables are shared: the points and the scalar
+		fields are always duplicated. The methods of this class take care of it, but this method must
+		be called before modifying the table returned by rgbaColors() directly, and before
+		modifying the colors concurrently (e.g. in a parallel loop).
+		\return false if not enough memory
+	**/
+	bool detachColors();
+
+	//! Makes sure the normals table is not shared with another cloud (copy-on-write)
+	/** See detachColors.
+		\return false if not enough memory
+	**/
+	bool detachNormals();
+
 	//! Crops the cloud inside (or outside) a 2D polyline
 	/** \warning Always returns a selection (potentially empty) if successful.
 		\param poly cropping polyline
@@ -905,7 +987,15 @@ protected: // VBO
 			UPDATE_POINTS = 1,
 			UPDATE_COLORS = 2,
 			UPDATE_NORMALS = 4,
-			UPDATE_ALL = UPDATE_POINTS | UPDATE_COLORS | UPDATE_NORMALS
+			UPDATE_ALL = UPDATE_POINTS | UPDATE_COLORS | UPDATE_NORMALS,
+			UPDATE_COLOR_RANGES = 8 //only the ranges of modified colors (see colorRanges)
+		};
+
+		//! Range of modified elements in a chunk (relatively to the chunk start, 'last' excluded)
+		struct Range
+		{
+			unsigned first = 0;
+			unsigned last = 0;
 		};
 
 		vboSet()
@@ -925,6 +1015,8 @@ protected: // VBO
 		bool hasNormals;
 		size_t totalMemSizeBytes;
 		int updateFlags;
+		//! Ranges of modified colors (per chunk)
+		std::vector<Range> colorRanges;
 
 		//! Current state
 		STATES state;
@@ -978,6 +1070,9 @@ protected: //waveform (e.g. from airborne scanners)
 	//! Waveforms raw data storage
 	SharedFWFDataContainer m_fwfData;
 
+	//! Waveforms raw data storage (out-of-core version)
+	ccSharedWaveformPager m_fwfPager;
+
 protected: //Normals drawing
 	bool m_normalsDrawnAsLines;
 
@@ -0,0 +1,137 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//Local
+#include "qCC_db.h"
+
+//CCCoreLib
+#include <CCGeom.h>
+
+//system
+#include <cstddef>
+#include <vector>
+
+class ccGenericPointCloud;
+class ccPolyline;
+
+//! Batch 2D polygon classifier
+/** Classifies points against a (potentially large) set of 2D polygons, e.g. parcels
+	or building footprints loaded from a shapefile. The polygons are stored in global
+	coordinates and indexed by a (static) R-tree built over their bounding boxes. The
+	points of a cloud are classified in parallel: only the polygons whose bounding box
+	contains a point are tested.
+	The polygons are projected in the plane orthogonal to the 'ortho' dimension (e.g.
+	XY if the ortho dimension is Z). Each polygon is considered on its own (holes are
+	not handled).
+**/
+class QCC_DB_LIB_API ccPolygonClassifier
+{
+public:
+
+	//! Default constructor
+	/** \param orthoDim dimension orthogonal to the polygons plane (0 = X, 1 = Y, 2 = Z)
+	**/
+	explicit ccPolygonClassifier(unsigned char orthoDim = 2);
+
+	//! Returns the dimension orthogonal to the polygons plane
+	inline unsigned char orthoDim() const { return m_orthoDim; }
+
+	//! Adds a polygon
+	/** The vertices are converted to global coordinates. The polyline is considered as closed.
+		\warning the spatial index must be (re)built afterwards (see buildIndex)
+		\return false if the polyline has less than 3 vertices or if there's not enough memory
+	**/
+	bool addPolygon(const ccPolyline* polyline);
+
+	//! Adds a polygon (2D vertices, in global coordinates)
+	/** \warning the spatial index must be (re)built afterwards (see buildIndex)
+		\return false if the polygon has less than 3 vertices or if there's not enough memory
+	**/
+	bool addPolygon(const std::vector<CCVector2d>& vertices);
+
+	//! Returns the number of polygons
+	inline size_t polygonCount() const { return m_polygons.size(); }
+
+	//! Builds the spatial index (R-tree)
+	/** Must be called once all the polygons have been added.
+	**/
+	bool buildIndex();
+
+	//! Returns the index of the first polygon containing a 2D point (in global coordinates)
+	/** \return the polygon index or -1 if no polygon contains the point
+	**/
+	int locate(const CCVector2d& P) const;
+
+	//! Classifies all the points of a cloud (in parallel)
+	/** \param cloud input cloud (its points are converted to global coordinates)
+		\param[out] polygonIndexes for each point, the index of the first polygon containing it (or -1)
+		\return success
+	**/
+	bool classify(const ccGenericPointCloud* cloud, std::vector<int>& polygonIndexes) const;
+
+protected: //methods
+
+	//! Returns whether a point lies inside a given polygon
+	bool isInside(const CCVector2d& P, unsigned polygonIndex) const;
+
+protected: //members
+
+	//! 2D bounding box
+	struct Box
+	{
+		CCVector2d minCorner;
+		CCVector2d maxCorner;
+
+		inline bool contains(const CCVector2d& P) const
+		{
+			return	P.x >= minCorner.x && P.x <= maxCorner.x
+				&&	P.y >= minCorner.y && P.y <= maxCorner.y;
+		}
+	};
+
+	//! Polygon
+	struct Polygon
+	{
+		std::vector<CCVector2d> vertices;
+		Box box;
+	};
+
+	//! R-tree node
+	struct Node
+	{
+		Box box;
+		//! Index of the first child (node index, or position in m_leafPolygons for leaves)
+		unsigned firstChild;
+		//! Number of children
+		unsigned childCount;
+		//! Whether the node is a leaf (its children are polygons)
+		bool leaf;
+	};
+
+	//! Dimension orthogonal to the polygons plane
+	unsigned char m_orthoDim;
+	//! Polygons
+	std::vector<Polygon> m_polygons;
+	//! R-tree nodes (the root is the last one)
+	std::vector<Node> m_nodes;
+	//! Polygon indexes (grouped by leaf)
+	std::vector<unsigned> m_leafPolygons;
+	//! Whether the spatial index is up to date
+	bool m_indexIsValid;
+};
@@ -288,3 +288,77 @@ struct QCC_DB_LIB_API ccRasterGrid
 	//! Whether the grid is valid/up-to-date
 	bool valid;
 };
+
+//! Tiling of a (virtual) raster grid
+/** Allows to compute a huge raster grid tile by tile, without ever holding all its cells
+	in memory. The points of the cloud are sorted by tile once (counting sort), then each
+	tile is filled with its own points only (see fillTile).
+	Tiles are ordered row by row, starting from the lower left one.
+	\warning As each tile is computed independently, interpolating the empty cells
+	(Delaunay, Kriging) is not supported.
+**/
+struct QCC_DB_LIB_API ccRasterGridTiling
+{
+	//! Default constructor
+	ccRasterGridTiling();
+
+	//! Sorts the points of a cloud by tile
+	/** Points falling outside of the grid are ignored.
+		\param cloud input cloud
+		\param Z projection dimension
+		\param gridWidth (virtual) grid width
+		\param gridHeight (virtual) grid height
+		\param gridStep grid step
+		\param gridMinCorner (virtual) grid min corner (see ccRasterGrid::init)
+		\param tileSize tile size (in cells)
+		\return success
+	**/
+	bool init(	ccPointCloud* cloud,
+				unsigned char Z,
+				unsigned gridWidth,
+				unsigned gridHeight,
+				double gridStep,
+				const CCVector3d& gridMinCorner,
+				unsigned tileSize);
+
+	//! Returns the number of tiles
+	inline unsigned tileCount() const { return tileCountX * tileCountY; }
+
+	//! Returns the extents of a given tile (in cells of the virtual grid)
+	void getTileExtents(unsigned tileIndex, unsigned& i0, unsigned& j0, unsigned& w, unsigned& h) const;
+
+	//! Returns the number of points falling in a given tile
+	inline unsigned tilePointCount(unsigned tileIndex) const { return tileFirstIndex[tileIndex + 1] - tileFirstIndex[tileIndex]; }
+
+	//! Initializes and fills a grid with the points of a given tile
+	/** See ccRasterGrid::fillWith. Empty tiles are initialized but not filled.
+	**/
+	bool fillTile(	unsigned tileIndex,
+					ccRasterGrid& tileGrid,
+					ccRasterGrid::ProjectionType projectionType,
+					ccRasterGrid::ProjectionType sfProjectionType = ccRasterGrid::INVALID_PROJECTION_TYPE,
+					int zStdDevSfIndex = -1) const;
+
+	//! Associated cloud
+	ccPointCloud* cloud;
+	//! Projection dimension
+	unsigned char Z;
+	//! Number of columns of the (virtual) grid
+	unsigned gridWidth;
+	//! Number of rows of the (virtual) grid
+	unsigned gridHeight;
+	//! Grid step
+	double gridStep;
+	//! Min corner of the (virtual) grid
+	CCVector3d gridMinCorner;
+	//! Tile size (in cells)
+	unsigned tileSize;
+	//! Number of tiles along X
+	unsigned tileCountX;
+	//! Number of tiles along Y
+	unsigned tileCountY;
+	//! Position of the first point of each tile in 'pointIndexes' (tile count + 1 values)
+	std::vector<unsigned> tileFirstIndex;
+	//! Indexes of the points (sorted by tile)
+	std::vector<unsigned> pointIndexes;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//Local
+#include "ccBBox.h"
+#include "ccColorTypes.h"
+#include "ccViewportParameters.h"
+
+//Qt
+#include <QImage>
+
+class ccHObject;
+
+//! CPU-only (software) renderer
+/** Renders the visible clouds and meshes of a scene without any OpenGL context
+	(e.g. on headless computation nodes). Points are drawn as square splats and
+	triangles are rasterized with a depth buffer. The image is split in tiles: the
+	primitives of each entity are first binned per tile, then the tiles are rasterized
+	in parallel (each tile by a single thread, without any lock).
+	The colors follow the display state of each entity (active scalar field and its
+	color scale, RGB colors or temporary color), and an EDL-like shading (see the qEDL
+	plugin) can be applied on the result.
+	\warning Textures, labels, 2D/3D symbols and other display-only entities are ignored.
+**/
+class QCC_DB_LIB_API ccSoftwareRenderer
+{
+public:
+
+	//! Rendering parameters
+	struct Parameters
+	{
+		//! Image width (in pixels)
+		int width = 1024;
+		//! Image height (in pixels)
+		int height = 768;
+		//! Viewport (camera) parameters
+		ccViewportParameters viewport;
+		//! Background color
+		ccColor::Rgbub backgroundColor = ccColor::defaultBkgColor;
+		//! Point size (in pixels, or 0 to use the viewport default point size)
+		int pointSize = 0;
+		//! Whether to apply the EDL-like shading
+		bool edl = true;
+		//! EDL strength (same meaning as the qEDL 'exponential scale')
+		float edlStrength = 100.0f;
+		//! Tile size (in pixels)
+		int tileSize = 64;
+	};
+
+	//! Renders a scene
+	/** \param scene scene root (the entity itself and all its children are rendered, if visible)
+		\param params rendering parameters
+		\param image output image
+		\return success
+	**/
+	static bool Render(ccHObject* scene, const Parameters& params, QImage& image);
+
+	//! Returns the bounding-box of the visible and enabled entities of a scene
+	static ccBBox ComputeVisibleBB(ccHObject* scene);
+
+	//! Updates the viewport parameters so that a given box is entirely visible
+	/** Same behavior as ccGLWindowInterface::updateConstellationCenterAndZoom
+		(the viewing direction is kept).
+	**/
+	static void FitViewport(ccViewportParameters& viewport, const ccBBox& box, int width, int height);
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//Local
+#include "qCC_db.h"
+
+//Qt
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+//system
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+
+class QIODevice;
+
+//! Out-of-core storage for Full WaveForm data
+/** The waveform samples are left in their source file(s) (LAS file, WDP file, BIN file, etc.)
+	and are paged in on demand, by fixed size pages kept in a LRU cache.
+	The data is addressed by 'logical' offsets, exactly as if it was stored in a single
+	in-memory container (see ccPointCloud::FWFDataContainer). Several file segments can
+	be concatenated (e.g. when merging clouds).
+**/
+class QCC_DB_LIB_API ccWaveformPager
+{
+public:
+
+	//! Page (shared, read-only)
+	using Page = QSharedPointer<const std::vector<uint8_t>>;
+
+	//! Default page size (in bytes)
+	static constexpr uint32_t DefaultPageSize = (1 << 22); //4 Mb
+	//! Default cache size (in bytes)
+	static constexpr uint64_t DefaultCacheSize = (static_cast<uint64_t>(1) << 29); //512 Mb
+
+	//! File segment
+	struct Segment
+	{
+		QString filename;		//!< Source file
+		uint64_t fileOffset;	//!< Position of the first byte of data in the file
+		uint64_t size;			//!< Size of the data (in bytes)
+	};
+
+	//! Default constructor
+	ccWaveformPager(uint64_t cacheSize = DefaultCacheSize, uint32_t pageSize = DefaultPageSize);
+
+	//! Constructor with a first segment
+	ccWaveformPager(const QString& filename, uint64_t fileOffset, uint64_t size, uint64_t cacheSize = DefaultCacheSize, uint32_t pageSize = DefaultPageSize);
+
+	//! Destructor
+	virtual ~ccWaveformPager() = default;
+
+	//! Appends a file segment
+	/** The segment data will start at the current (logical) size of the storage.
+		\return success (the file must exist and be large enough)
+	**/
+	bool addSegment(const QString& filename, uint64_t fileOffset, uint64_t size);
+
+	//! Appends all the segments of another pager
+	bool append(const ccWaveformPager& other);
+
+	//! Returns the segments
+	inline const std::vector<Segment>& segments() const { return m_segments; }
+
+	//! Returns whether the storage relies on a given file or not
+	bool usesFile(const QString& filename) const;
+
+	//! Returns the (logical) size of the stored data
+	inline uint64_t size() const { return m_size; }
+
+	//! Returns whether the storage is empty
+	inline bool empty() const { return m_size == 0; }
+
+	//! Returns the page containing a given (logical) byte range
+	/** The page is loaded from the source file if necessary.
+		\param offset logical offset of the first byte
+		\param byteCount number of bytes
+		\param[out] pageOffset logical offset of the first byte of the returned page
+		\return the page (or a null pointer if an error occurred)
+	**/
+	Page fetch(uint64_t offset, uint32_t byteCount, uint64_t& pageOffset) const;
+
+	//! Reads a (logical) byte range directly (without using the cache)
+	bool read(uint64_t offset, uint64_t byteCount, uint8_t* dest) const;
+
+	//! Streams a (logical) byte range to a device
+	/** The data is copied by chunks of the page size.
+	**/
+	bool copyTo(QIODevice& out, uint64_t offset, uint64_t byteCount) const;
+
+	//! Sets the maximum cache size (in bytes)
+	void setCacheSize(uint64_t bytes);
+	//! Returns the maximum cache size (in bytes)
+	inline uint64_t cacheSize() const { return m_cacheSize; }
+	//! Returns the current amount of cached data (in bytes)
+	uint64_t cachedBytes() const;
+
+	//! Releases all the cached pages
+	void clearCache();
+
+	//! Sets the size above which FWF data should be paged instead of loaded in memory
+	static void SetInMemoryThreshold(uint64_t bytes);
+	//! Returns the size above which FWF data should be paged instead of loaded in memory
+	static uint64_t InMemoryThreshold();
+
+protected: //methods
+
+	//! Reads a range without locking the mutex
+	bool readUnsafe(uint64_t offset, uint64_t byteCount, uint8_t* dest) const;
+
+	//! Returns the (opened) file associated to a given segment
+	QFile* segmentFile(size_t segmentIndex) const;
+
+protected: //members
+
+	//! Cache entry
+	struct CacheEntry
+	{
+		Page page;
+		std::list<uint64_t>::iterator lruIt;
+	};
+
+	//! Segments
+	std::vector<Segment> m_segments;
+	//! Opened files (one per segment)
+	mutable std::vector<std::unique_ptr<QFile>> m_files;
+	//! Logical size
+	uint64_t m_size;
+
+	//! Page size
+	uint32_t m_pageSize;
+	//! Maximum cache size
+	uint64_t m_cacheSize;
+	//! Current cache size
+	mutable uint64_t m_cachedBytes;
+	//! Cached pages (by page index)
+	mutable QHash<uint64_t, CacheEntry> m_cache;
+	//! LRU list of page indexes (most recently used first)
+	mutable std::list<uint64_t> m_lru;
+
+	//! Mutex (for concurrent accesses)
+	mutable QMutex m_mutex;
+};
+
+//! Shared pager
+using ccSharedWaveformPager = QSharedPointer<ccWaveformPager>;
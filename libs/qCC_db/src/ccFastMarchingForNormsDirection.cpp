@@ -377,6 +377,12 @@ int ccFastMarchingForNormsDirection::OrientNormals(ccPointCloud* cloud,
 		assert(false);
 		return 0;
 	}
+	//the normals are modified directly (they must not be shared with another cloud)
+	if (!cloud->detachNormals())
+	{
+		ccLog::Warning("[orientNormalsWithFM] Not enough memory to duplicate the shared normals");
+		return 0;
+	}
 	NormsIndexesTableType* theNorms = cloud->normals();
 
 	unsigned numberOfPoints = cloud->size();
@@ -32,9 +32,9 @@
  *** Globals ***
  ***************/
 
-//buffer for formatted string generation
+//buffer for formatted string generation (one per thread, as messages can be logged concurrently)
 static const size_t s_bufferMaxSize = 4096;
-static char s_buffer[s_bufferMaxSize];
+static thread_local char s_buffer[s_bufferMaxSize];
 
 //! Message
 struct Message
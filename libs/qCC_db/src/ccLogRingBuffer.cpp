@@ -0,0 +1,107 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "ccLogRingBuffer.h"
+
+//system
+#include <cassert>
+
+ccLogRingBuffer::ccLogRingBuffer(size_t capacity/*=DefaultCapacity*/)
+	: m_mask(0)
+	, m_writePos(0)
+	, m_readPos(0)
+{
+	size_t powerOf2 = 2;
+	while (powerOf2 < capacity)
+	{
+		powerOf2 <<= 1;
+	}
+	m_mask = powerOf2 - 1;
+
+	m_slots.reset(new Slot[powerOf2]);
+	for (size_t i = 0; i < powerOf2; ++i)
+	{
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+ccLogRingBuffer::~ccLogRingBuffer() = default;
+
+bool ccLogRingBuffer::push(const QString& text, int level, const QTime& time)
+{
+	size_t pos = m_writePos.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+
+	while (true)
+	{
+		slot = &m_slots[pos & m_mask];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0)
+		{
+			//the slot is free: try to reserve it
+			if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+			//otherwise 'pos' has been updated with the current write position
+		}
+		else if (diff < 0)
+		{
+			//the slot hasn't been consumed yet: the buffer is full
+			return false;
+		}
+		else
+		{
+			//another producer took this slot
+			pos = m_writePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	//the slot is now ours
+	slot->message.text = text;
+	slot->message.level = level;
+	slot->message.time = time;
+	slot->sequence.store(pos + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool ccLogRingBuffer::pop(Message& message)
+{
+	size_t pos = m_readPos.load(std::memory_order_relaxed);
+	Slot& slot = m_slots[pos & m_mask];
+	size_t sequence = slot.sequence.load(std::memory_order_acquire);
+	if (sequence != pos + 1)
+	{
+		//not filled yet
+		return false;
+	}
+
+	message = std::move(slot.message);
+	slot.message.text.clear(); //the moved-from string may hold the previous content of the output message
+	slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+	m_readPos.store(pos + 1, std::memory_order_relaxed);
+
+	return true;
+}
+
+bool ccLogRingBuffer::empty() const
+{
+	size_t pos = m_readPos.load(std::memory_order_relaxed);
+	return m_slots[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
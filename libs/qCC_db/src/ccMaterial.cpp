@@ -23,6 +23,7 @@
 #include "ccMaterialDB.h"
 
 //Qt
+#include <QOpenGLFunctions>
 #include <QUuid>
 
 //Textures DB
@@ -130,17 +131,13 @@ bool ccMaterial::loadAndSetTexture(const QString& absoluteFilename)
 	}
 	else
 	{
-		//otherwise, we try to load the corresponding file
-		QImage image(absoluteFilename);
-		if (image.isNull())
+		//otherwise, we register the corresponding file (the image will be decoded asynchronously)
+		if (!s_materialDB.loadTexture(absoluteFilename, true))
 		{
 			ccLog::Warning(QString("[ccMaterial::loadAndSetTexture] Failed to load image '%1'").arg(absoluteFilename));
 			return false;
 		}
-		else
-		{
-			setTexture(image, absoluteFilename, true);
-		}
+		m_textureFilename = absoluteFilename;
 	}
 
 	return true;
@@ -162,7 +159,7 @@ void ccMaterial::setTexture(QImage image, QString absoluteFilename/*=QString()*/
 		if (s_materialDB.hasTexture(absoluteFilename))
 		{
 			//check that the size is compatible at least
-			if (s_materialDB.getTexture(absoluteFilename).size() != image.size())
+			if (s_materialDB.getTextureSize(absoluteFilename) != image.size())
 			{
 				assert(false); //shouldn't happen anymore
 				ccLog::Warning(QString("[ccMaterial] A texture with the same name (%1) but with a different size has already been loaded!").arg(absoluteFilename));
@@ -184,28 +181,59 @@ const QImage ccMaterial::getTexture() const
 	return s_materialDB.getTexture(m_textureFilename);
 }
 
+QImage ccMaterial::getTextureLevel(unsigned level) const
+{
+	return s_materialDB.getTextureLevel(m_textureFilename, level);
+}
+
+QSize ccMaterial::getTextureSize() const
+{
+	return s_materialDB.getTextureSize(m_textureFilename);
+}
+
 GLuint ccMaterial::getTextureID() const
 {
-	if (QOpenGLContext::currentContext())
+	QOpenGLContext* context = QOpenGLContext::currentContext();
+	if (context)
 	{
-		const QImage image = getTexture();
-		if (image.isNull())
-		{
-			return 0;
-		}
-		QSharedPointer<QOpenGLTexture> tex;
-		if (s_materialDB.openGLTextures.contains(m_textureFilename))
-		{
-			tex = s_materialDB.openGLTextures[m_textureFilename];
-		}
+		//the texture may already be on the GPU (in which case we don't need the image)
+		QSharedPointer<QOpenGLTexture> tex = s_materialDB.openGLTextures.value(m_textureFilename);
 
 		if (!tex)
 		{
+			QSize size = getTextureSize();
+			if (size.isEmpty())
+			{
+				return 0;
+			}
+
+			//we use a downsampled level if the texture is too big for the GPU
+			GLint maxTextureSize = 0;
+			context->functions()->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+			unsigned level = 0;
+			while (maxTextureSize > 0 && std::max(size.width() >> level, size.height() >> level) > maxTextureSize)
+			{
+				++level;
+			}
+
+			const QImage image = getTextureLevel(level);
+			if (image.isNull())
+			{
+				return 0;
+			}
+			if (level != 0)
+			{
+				ccLog::Warning(QString("[ccMaterial] Texture '%1' is too big for the GPU (%2 x %3): a downsampled version will be displayed (%4 x %5)").arg(m_textureFilename).arg(size.width()).arg(size.height()).arg(image.width()).arg(image.height()));
+			}
+
+			bool useMipMaps = (		m_texMinificationFilter != QOpenGLTexture::Nearest
+								&&	m_texMinificationFilter != QOpenGLTexture::Linear );
+
 			tex = QSharedPointer<QOpenGLTexture>::create(QOpenGLTexture::Target2D);
 			tex->setAutoMipMapGenerationEnabled(false);
 			tex->setMinMagFilters(m_texMinificationFilter, m_texMagnificationFilter);
 			tex->setFormat(QOpenGLTexture::RGB8_UNorm);
-			tex->setData(getTexture(), QOpenGLTexture::DontGenerateMipMaps);
+			tex->setData(image, useMipMaps ? QOpenGLTexture::GenerateMipMaps : QOpenGLTexture::DontGenerateMipMaps);
 			tex->create();
 			s_materialDB.openGLTextures[m_textureFilename] = tex;
 		}
@@ -219,7 +247,7 @@ GLuint ccMaterial::getTextureID() const
 
 bool ccMaterial::hasTexture() const
 {
-	return m_textureFilename.isEmpty() ? false : s_materialDB.hasTexture(m_textureFilename) && !s_materialDB.getTexture(m_textureFilename).isNull();
+	return m_textureFilename.isEmpty() ? false : s_materialDB.hasValidTexture(m_textureFilename);
 }
 
 void ccMaterial::MakeLightsNeutral(const QOpenGLContext* context)
@@ -267,6 +295,21 @@ void ccMaterial::AddTexture(QImage image, const QString& absoluteFilename)
 	s_materialDB.addTexture(absoluteFilename, image);
 }
 
+void ccMaterial::SetTextureCacheBudget(qint64 bytes)
+{
+	s_materialDB.setBudget(bytes);
+}
+
+qint64 ccMaterial::TextureCacheBudget()
+{
+	return s_materialDB.budget();
+}
+
+qint64 ccMaterial::TextureCacheSize()
+{
+	return s_materialDB.cachedBytes();
+}
+
 void ccMaterial::ReleaseTextures()
 {
 	if (!QOpenGLContext::currentContext())
@@ -0,0 +1,475 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccMaterialDB.h"
+
+//Qt
+#include <QImageReader>
+#include <QOpenGLContext>
+#include <QRunnable>
+
+//system
+#include <algorithm>
+#include <cassert>
+
+//! Loads (and decodes) an image file in a background thread
+class ccMaterialDB::Loader : public QRunnable
+{
+public:
+
+	Loader(ccMaterialDB* db, const QString& filename, quint64 loadID, bool mirrored)
+		: m_db(db)
+		, m_filename(filename)
+		, m_loadID(loadID)
+		, m_mirrored(mirrored)
+	{}
+
+	void run() override
+	{
+		QImage image(m_filename);
+		if (m_mirrored && !image.isNull())
+		{
+			image = image.mirrored();
+		}
+		m_db->onImageLoaded(m_filename, m_loadID, image);
+	}
+
+protected:
+
+	ccMaterialDB* m_db;
+	QString m_filename;
+	quint64 m_loadID;
+	bool m_mirrored;
+};
+
+ccMaterialDB::ccMaterialDB()
+	: m_initialized(false)
+	, m_budget(DefaultBudget)
+	, m_cachedBytes(0)
+	, m_accessCounter(0)
+	, m_loadCounter(0)
+{
+}
+
+ccMaterialDB::~ccMaterialDB()
+{
+	//make sure no loading thread is still running
+	m_loaders.clear();
+	m_loaders.waitForDone();
+}
+
+void ccMaterialDB::init()
+{
+	if (!m_initialized)
+	{
+		connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ccMaterialDB::onFileChanged);
+		m_initialized = true;
+	}
+}
+
+void ccMaterialDB::onFileChanged(const QString& filename)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it == m_textures.end())
+	{
+		assert(false);
+		m_watcher.removePath(filename);
+		return;
+	}
+
+	if (QFileInfo(filename).exists()) //make sure the image still exists
+	{
+		ccLog::Warning(tr("File '%1' has been updated").arg(filename));
+		TextureInfo& info = it.value();
+		if (info.onDisk)
+		{
+			//reload the new version (any pending request will be ignored)
+			dropImages(info, true);
+			info.pending = false;
+			info.failed = false;
+			info.size = QImageReader(filename).size();
+			startLoading(filename, info);
+			openGLTextures.remove(filename);
+		}
+		else
+		{
+			QImage image;
+			if (image.load(filename))
+			{
+				//update the texture
+				dropImages(info, true);
+				info.image = image;
+				info.size = image.size();
+				info.bytes = ImageBytes(image);
+				m_cachedBytes += info.bytes;
+				openGLTextures.remove(filename);
+			}
+			else
+			{
+				ccLog::Warning(tr("Failed to load the new version of the file"));
+			}
+		}
+	}
+	else
+	{
+		ccLog::Warning(tr("File '%1' has been deleted or renamed").arg(filename));
+	}
+}
+
+bool ccMaterialDB::hasTexture(const QString& filename) const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_textures.contains(filename);
+}
+
+bool ccMaterialDB::hasValidTexture(const QString& filename) const
+{
+	QMutexLocker locker(&m_mutex);
+	auto it = m_textures.find(filename);
+	if (it == m_textures.end())
+	{
+		return false;
+	}
+
+	return !it->failed && (!it->image.isNull() || (it->onDisk && it->size.isValid()));
+}
+
+QImage ccMaterialDB::getTexture(const QString& filename)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it == m_textures.end())
+	{
+		return QImage();
+	}
+
+	//the texture can't be evicted while we are waiting for it
+	++it->waiters;
+
+	while (it->image.isNull() && it->onDisk && !it->failed)
+	{
+		if (!it->pending)
+		{
+			//not loaded yet or evicted
+			startLoading(filename, it.value());
+		}
+
+		m_imageLoaded.wait(&m_mutex);
+
+		//the texture may have been removed in the meantime
+		it = m_textures.find(filename);
+		if (it == m_textures.end())
+		{
+			return QImage();
+		}
+	}
+
+	assert(it->waiters != 0);
+	--it->waiters;
+
+	it->lastAccess = ++m_accessCounter;
+	return it->image;
+}
+
+QImage ccMaterialDB::getTextureLevel(const QString& filename, unsigned level)
+{
+	if (level == 0)
+	{
+		return getTexture(filename);
+	}
+
+	{
+		QMutexLocker locker(&m_mutex);
+		auto it = m_textures.find(filename);
+		if (it == m_textures.end())
+		{
+			return QImage();
+		}
+		if (static_cast<int>(level) <= it->levels.size() && !it->levels[level - 1].isNull())
+		{
+			it->lastAccess = ++m_accessCounter;
+			return it->levels[level - 1];
+		}
+	}
+
+	QImage image = getTexture(filename);
+	if (image.isNull())
+	{
+		return QImage();
+	}
+
+	QImage levelImage = image.scaled(	std::max(1, image.width() >> level),
+										std::max(1, image.height() >> level),
+										Qt::IgnoreAspectRatio,
+										Qt::SmoothTransformation );
+
+	QMutexLocker locker(&m_mutex);
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		if (it->levels.size() < static_cast<int>(level))
+		{
+			it->levels.resize(level);
+		}
+		if (it->levels[level - 1].isNull())
+		{
+			it->levels[level - 1] = levelImage;
+			qint64 levelBytes = ImageBytes(levelImage);
+			it->bytes += levelBytes;
+			m_cachedBytes += levelBytes;
+		}
+		it->lastAccess = ++m_accessCounter;
+		evict(filename);
+	}
+
+	return levelImage;
+}
+
+QSize ccMaterialDB::getTextureSize(const QString& filename) const
+{
+	QMutexLocker locker(&m_mutex);
+	auto it = m_textures.find(filename);
+	if (it == m_textures.end())
+	{
+		return QSize();
+	}
+
+	return it->image.isNull() ? it->size : it->image.size();
+}
+
+void ccMaterialDB::addTexture(const QString& filename, const QImage& image)
+{
+	if (!m_initialized)
+		init();
+
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		++it->counter;
+	}
+	else
+	{
+		TextureInfo& info = m_textures[filename];
+		info.image = image;
+		info.size = image.size();
+		info.bytes = ImageBytes(image);
+		info.counter = 1;
+		info.lastAccess = ++m_accessCounter;
+		m_cachedBytes += info.bytes;
+		m_watcher.addPath(filename);
+
+		evict(filename);
+	}
+}
+
+bool ccMaterialDB::loadTexture(const QString& filename, bool mirrored)
+{
+	if (!m_initialized)
+		init();
+
+	//we only read the header of the file for now
+	QImageReader reader(filename);
+	if (!reader.canRead())
+	{
+		return false;
+	}
+
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		++it->counter;
+		return true;
+	}
+
+	TextureInfo& info = m_textures[filename];
+	info.size = reader.size();
+	info.counter = 1;
+	info.onDisk = true;
+	info.mirrored = mirrored;
+	info.lastAccess = ++m_accessCounter;
+	m_watcher.addPath(filename);
+
+	//we start decoding the image right away if the budget allows it
+	qint64 expectedBytes = (info.size.isValid() ? static_cast<qint64>(info.size.width()) * info.size.height() * 4 : 0);
+	if (m_cachedBytes + expectedBytes <= m_budget)
+	{
+		startLoading(filename, info);
+	}
+
+	return true;
+}
+
+void ccMaterialDB::increaseTextureCounter(const QString& filename)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		assert(it->counter >= 1);
+		++it->counter;
+	}
+	else
+	{
+		assert(false);
+	}
+}
+
+void ccMaterialDB::releaseTexture(const QString& filename)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		if (it->counter > 1)
+		{
+			--it->counter;
+			return;
+		}
+	}
+	else
+	{
+		return;
+	}
+
+	locker.unlock();
+	removeTexture(filename);
+}
+
+void ccMaterialDB::removeTexture(const QString& filename)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it != m_textures.end())
+	{
+		m_cachedBytes -= it->bytes;
+		m_textures.erase(it);
+		m_imageLoaded.wakeAll(); //in case someone was waiting for this image
+	}
+	m_watcher.removePath(filename);
+
+	assert(QOpenGLContext::currentContext());
+	openGLTextures.remove(filename);
+}
+
+void ccMaterialDB::setBudget(qint64 bytes)
+{
+	QMutexLocker locker(&m_mutex);
+	m_budget = bytes;
+	evict(QString());
+}
+
+qint64 ccMaterialDB::cachedBytes() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_cachedBytes;
+}
+
+void ccMaterialDB::startLoading(const QString& filename, TextureInfo& info)
+{
+	assert(info.onDisk && !info.pending);
+	info.pending = true;
+	info.loadID = ++m_loadCounter;
+	m_loaders.start(new Loader(this, filename, info.loadID, info.mirrored));
+}
+
+void ccMaterialDB::onImageLoaded(const QString& filename, quint64 loadID, QImage image)
+{
+	QMutexLocker locker(&m_mutex);
+
+	auto it = m_textures.find(filename);
+	if (it == m_textures.end() || it->loadID != loadID || !it->pending)
+	{
+		//the texture has been removed or updated in the meantime
+		return;
+	}
+
+	it->pending = false;
+	if (image.isNull())
+	{
+		ccLog::Warning(QString("[ccMaterialDB] Failed to load image '%1'").arg(filename));
+		it->failed = true;
+	}
+	else
+	{
+		it->image = image;
+		it->size = image.size();
+		qint64 imageBytes = ImageBytes(image);
+		it->bytes += imageBytes;
+		m_cachedBytes += imageBytes;
+		evict(filename);
+	}
+
+	m_imageLoaded.wakeAll();
+}
+
+void ccMaterialDB::dropImages(TextureInfo& info, bool dropFullImage)
+{
+	for (const QImage& levelImage : info.levels)
+	{
+		qint64 levelBytes = ImageBytes(levelImage);
+		info.bytes -= levelBytes;
+		m_cachedBytes -= levelBytes;
+	}
+	info.levels.clear();
+
+	if (dropFullImage && !info.image.isNull())
+	{
+		qint64 imageBytes = ImageBytes(info.image);
+		info.bytes -= imageBytes;
+		m_cachedBytes -= imageBytes;
+		info.image = QImage();
+	}
+}
+
+void ccMaterialDB::evict(const QString& filenameToKeep)
+{
+	while (m_cachedBytes > m_budget)
+	{
+		//look for the least recently used texture that can be (partially) evicted
+		TextureInfo* lru = nullptr;
+		for (auto it = m_textures.begin(); it != m_textures.end(); ++it)
+		{
+			if (it.key() == filenameToKeep || it->pending || it->waiters != 0)
+			{
+				continue;
+			}
+			bool canBeEvicted = (!it->levels.empty() || (it->onDisk && !it->image.isNull()));
+			if (canBeEvicted && (!lru || it->lastAccess < lru->lastAccess))
+			{
+				lru = &it.value();
+			}
+		}
+
+		if (!lru)
+		{
+			//nothing else can be evicted
+			break;
+		}
+
+		dropImages(*lru, lru->onDisk);
+	}
+}
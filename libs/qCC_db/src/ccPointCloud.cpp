@@ -51,9 +51,16 @@
 #include <QSettings>
 
 //system
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <queue>
 
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 static const char s_deviationSFName[] = "Deviation";
 
 // 'Draw normals' shader program
@@ -367,6 +374,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCCoreLib::ReferenceCloud* select
 					}
 					//we will use the same FWF data container
 					result->fwfData() = fwfData();
+					result->fwfPager() = fwfPager();
 				}
 				catch (const std::bad_alloc&)
 				{
@@ -510,6 +518,331 @@ ccPointCloud* ccPointCloud::partialClone(const CCCoreLib::ReferenceCloud* select
 	return result;
 }
 
+bool ccPointCloud::partition(const std::vector<int>& keys, unsigned partCount, std::vector<ccPointCloud*>& parts, int* warnings/*=nullptr*/) const
+{
+	if (warnings)
+	{
+		*warnings = 0;
+	}
+	parts.clear();
+
+	unsigned pointCount = size();
+	if (keys.size() != pointCount || partCount == 0)
+	{
+		ccLog::Error("[ccPointCloud::partition] Invalid parameters");
+		return false;
+	}
+
+	//we process the points by blocks (at most 64 blocks, so that the per-block histograms remain small)
+	static const unsigned MinBlockSize = (1 << 16);
+	unsigned blockSize = std::max(MinBlockSize, pointCount / 64 + 1);
+	int blockCount = static_cast<int>((static_cast<size_t>(pointCount) + blockSize - 1) / blockSize);
+
+	std::vector<unsigned> blockOffsets; //per block and per part
+	std::vector<unsigned> partSizes;
+	try
+	{
+		blockOffsets.resize(static_cast<size_t>(blockCount) * partCount, 0);
+		partSizes.resize(partCount, 0);
+		parts.resize(partCount, nullptr);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::partition] Not enough memory");
+		parts.clear();
+		return false;
+	}
+
+	//1st pass: histogram of the keys (per block)
+	int invalidKeyCount = 0;
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:invalidKeyCount)
+#endif
+	for (int b = 0; b < blockCount; ++b)
+	{
+		unsigned* histogram = blockOffsets.data() + static_cast<size_t>(b) * partCount;
+		unsigned start = static_cast<unsigned>(b) * blockSize;
+		unsigned stop = std::min(start + blockSize, pointCount);
+		for (unsigned i = start; i < stop; ++i)
+		{
+			int key = keys[i];
+			if (key < 0)
+			{
+				//discarded point
+				continue;
+			}
+			if (static_cast<unsigned>(key) < partCount)
+			{
+				++histogram[key];
+			}
+			else
+			{
+				++invalidKeyCount;
+			}
+		}
+	}
+
+	if (invalidKeyCount != 0)
+	{
+		ccLog::Error(QString("[ccPointCloud::partition] %1 key(s) are out of range").arg(invalidKeyCount));
+		parts.clear();
+		return false;
+	}
+
+	//prefix sum: the offset of each block inside each part
+	for (unsigned p = 0; p < partCount; ++p)
+	{
+		unsigned offset = 0;
+		for (int b = 0; b < blockCount; ++b)
+		{
+			unsigned& blockOffset = blockOffsets[static_cast<size_t>(b) * partCount + p];
+			unsigned count = blockOffset;
+			blockOffset = offset;
+			offset += count;
+		}
+		partSizes[p] = offset;
+	}
+
+	//create the output clouds
+	bool copyColors = hasColors();
+	bool copyNormals = hasNormals();
+	bool copyFWF = hasFWF();
+	for (unsigned p = 0; p < partCount; ++p)
+	{
+		if (partSizes[p] == 0)
+		{
+			continue;
+		}
+
+		ccPointCloud* part = new ccPointCloud(getName() + QString(".part_%1").arg(p));
+		parts[p] = part;
+
+		//visibility
+		part->setVisible(isVisible());
+		part->setDisplay(getDisplay());
+		part->setEnabled(isEnabled());
+
+		//other parameters
+		part->importParametersFrom(this);
+
+		if (!part->resize(partSizes[p]))
+		{
+			ccLog::Error("[ccPointCloud::partition] Not enough memory!");
+			for (ccPointCloud* pc : parts)
+			{
+				delete pc;
+			}
+			parts.clear();
+			return false;
+		}
+
+		if (copyColors && !part->resizeTheRGBTable(false))
+		{
+			ccLog::Warning("[ccPointCloud::partition] Not enough memory to copy RGB colors!");
+			copyColors = false;
+			if (warnings)
+				*warnings |= WRN_OUT_OF_MEM_FOR_COLORS;
+		}
+		if (copyNormals && !part->resizeTheNormsTable())
+		{
+			ccLog::Warning("[ccPointCloud::partition] Not enough memory to copy normals!");
+			copyNormals = false;
+			if (warnings)
+				*warnings |= WRN_OUT_OF_MEM_FOR_NORMALS;
+		}
+		if (copyFWF && !part->resizeTheFWFTable())
+		{
+			ccLog::Warning("[ccPointCloud::partition] Not enough memory to copy waveform signals!");
+			copyFWF = false;
+			if (warnings)
+				*warnings |= WRN_OUT_OF_MEM_FOR_FWF;
+		}
+	}
+
+	//scalar fields
+	std::vector<const ccScalarField*> sourceSFs;
+	std::vector< std::vector<ccScalarField*> > partSFs; //per part
+	try
+	{
+		partSFs.resize(partCount);
+
+		for (unsigned k = 0; k < getNumberOfScalarFields(); ++k)
+		{
+			const ccScalarField* sf = static_cast<ccScalarField*>(getScalarField(k));
+			assert(sf);
+
+			bool success = true;
+			for (unsigned p = 0; p < partCount; ++p)
+			{
+				ccPointCloud* part = parts[p];
+				if (!part)
+				{
+					continue;
+				}
+
+				//we create a new scalar field with same name
+				int sfIdx = part->addScalarField(sf->getName());
+				if (sfIdx < 0)
+				{
+					success = false;
+					break;
+				}
+				ccScalarField* partSF = static_cast<ccScalarField*>(part->getScalarField(sfIdx));
+				partSFs[p].push_back(partSF);
+				if (!partSF->resizeSafe(partSizes[p]))
+				{
+					success = false;
+					break;
+				}
+				partSF->setOffset(sf->getOffset());
+			}
+
+			if (success)
+			{
+				sourceSFs.push_back(sf);
+			}
+			else
+			{
+				//if we don't have enough memory, we cancel the SF creation (for all parts)
+				for (unsigned p = 0; p < partCount; ++p)
+				{
+					ccPointCloud* part = parts[p];
+					if (part && partSFs[p].size() > sourceSFs.size())
+					{
+						partSFs[p].pop_back();
+						part->deleteScalarField(part->getScalarFieldIndexByName(sf->getName()));
+					}
+				}
+				ccLog::Warning(QString("[ccPointCloud::partition] Not enough memory to copy scalar field '%1'!").arg(QString::fromStdString(sf->getName())));
+				if (warnings)
+					*warnings |= WRN_OUT_OF_MEM_FOR_SFS;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::partition] Not enough memory");
+		for (ccPointCloud* pc : parts)
+		{
+			delete pc;
+		}
+		parts.clear();
+		return false;
+	}
+
+	//2nd pass: scatter all the attributes (each block writes in its own ranges)
+	size_t sfCount = sourceSFs.size();
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int b = 0; b < blockCount; ++b)
+	{
+		unsigned* cursors = blockOffsets.data() + static_cast<size_t>(b) * partCount;
+		unsigned start = static_cast<unsigned>(b) * blockSize;
+		unsigned stop = std::min(start + blockSize, pointCount);
+		for (unsigned i = start; i < stop; ++i)
+		{
+			int key = keys[i];
+			if (key < 0)
+			{
+				continue;
+			}
+
+			ccPointCloud* part = parts[key];
+			unsigned pos = cursors[key]++;
+
+			part->m_points[pos] = m_points[i];
+			if (copyColors)
+			{
+				(*part->m_rgbaColors)[pos] = (*m_rgbaColors)[i];
+			}
+			if (copyNormals)
+			{
+				(*part->m_normals)[pos] = (*m_normals)[i];
+			}
+			if (copyFWF)
+			{
+				part->m_fwfWaveforms[pos] = m_fwfWaveforms[i];
+			}
+			for (size_t k = 0; k < sfCount; ++k)
+			{
+				partSFs[key][k]->setValue(pos, sourceSFs[k]->getValue(i));
+			}
+		}
+	}
+
+	//finish the output clouds
+	const ccScalarField* displayedSF = getCurrentDisplayedScalarField();
+	for (unsigned p = 0; p < partCount; ++p)
+	{
+		ccPointCloud* part = parts[p];
+		if (!part)
+		{
+			continue;
+		}
+
+		part->invalidateBoundingBox();
+
+		if (copyColors)
+		{
+			part->showColors(colorsShown());
+		}
+		else
+		{
+			part->unallocateColors();
+		}
+
+		if (copyNormals)
+		{
+			part->showNormals(normalsShown());
+		}
+		else
+		{
+			part->unallocateNorms();
+		}
+
+		if (copyFWF)
+		{
+			//copy only the necessary descriptors
+			for (const ccWaveform& w : part->m_fwfWaveforms)
+			{
+				if (!part->fwfDescriptors().contains(w.descriptorID()))
+				{
+					part->fwfDescriptors().insert(w.descriptorID(), m_fwfDescriptors[w.descriptorID()]);
+				}
+			}
+			//we will use the same FWF data container
+			part->fwfData() = fwfData();
+			part->fwfPager() = fwfPager();
+		}
+		else
+		{
+			part->clearFWFData();
+		}
+
+		for (size_t k = 0; k < sfCount; ++k)
+		{
+			ccScalarField* partSF = partSFs[p][k];
+			partSF->computeMinAndMax();
+			//copy display parameters
+			partSF->importParametersFrom(sourceSFs[k]);
+		}
+		if (sfCount != 0)
+		{
+			//we display the same scalar field as the source (if we managed to copy it!)
+			if (displayedSF)
+			{
+				int sfIdx = part->getScalarFieldIndexByName(displayedSF->getName());
+				part->setCurrentDisplayedScalarField(sfIdx >= 0 ? sfIdx : static_cast<int>(sfCount) - 1);
+			}
+			//copy visibility
+			part->showSF(sfShown());
+		}
+	}
+
+	return true;
+}
+
 ccPointCloud::~ccPointCloud()
 {
 	clear();
@@ -645,7 +978,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		//merge display parameters
 		showColors(colorsShown() || addedCloud->colorsShown());
 
-		if (hasColors())
+		if (hasColors() && detachColors())
 		{
 			m_rgbaColors->resize(pointCountBefore); // just in case
 		}
@@ -664,8 +997,19 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 			//if this cloud hadn't any color before
 			if (!hasColors())
 			{
-				//we try to reserve a new array
-				if (reserveTheRGBTable())
+				//if this cloud was empty, we simply share the colors of the added cloud (copy-on-write)
+				if (pointCountBefore == 0 && addedCloud->m_rgbaColors->currentSize() == addedPoints)
+				{
+					if (m_rgbaColors)
+					{
+						m_rgbaColors->release();
+					}
+					m_rgbaColors = addedCloud->m_rgbaColors;
+					m_rgbaColors->link();
+					colorsHaveChanged();
+				}
+				//otherwise we try to reserve a new array
+				else if (reserveTheRGBTable())
 				{
 					for (unsigned i = 0; i < pointCountBefore; i++)
 					{
@@ -710,8 +1054,13 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 			//if this cloud hasn't any normal
 			if (!hasNormals())
 			{
-				//we try to reserve a new array
-				if (reserveTheNormsTable())
+				//if this cloud was empty, we simply share the normals of the added cloud (copy-on-write)
+				if (pointCountBefore == 0 && addedCloud->m_normals->currentSize() == addedPoints)
+				{
+					setNormsTable(addedCloud->m_normals);
+				}
+				//otherwise we try to reserve a new array
+				else if (reserveTheNormsTable())
 				{
 					for (unsigned i = 0; i < pointCountBefore; i++)
 					{
@@ -764,6 +1113,7 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 					}
 					//we will simply use the other cloud FWF data container
 					fwfData() = addedCloud->fwfData();
+					fwfPager() = addedCloud->fwfPager();
 				}
 				else
 				{
@@ -771,6 +1121,29 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 					ccLog::Warning("[ccPointCloud::fusion] Not enough memory: failed to allocate waveforms!");
 				}
 			}
+			else if (fwfDataIsPaged() || addedCloud->fwfDataIsPaged())
+			{
+				if (!fwfDataIsPaged() || !addedCloud->fwfDataIsPaged())
+				{
+					success = false;
+					ccLog::Warning("[ccPointCloud::fusion] Can't merge paged and in-memory waveform data!");
+				}
+				else if (fwfPager() != addedCloud->fwfPager())
+				{
+					//we simply concatenate the file segments
+					ccSharedWaveformPager mergedPager(new ccWaveformPager(m_fwfPager->cacheSize()));
+					if (mergedPager->append(*m_fwfPager) && mergedPager->append(*addedCloud->fwfPager()))
+					{
+						fwfDataOffset = m_fwfPager->size();
+						fwfPager() = mergedPager;
+					}
+					else
+					{
+						success = false;
+						ccLog::Warning("[ccPointCloud::fusion] Failed to merge paged waveform data!");
+					}
+				}
+			}
 			else if (fwfData() != addedCloud->fwfData())
 			{
 				//we need to merge the two FWF data containers!
@@ -1184,6 +1557,11 @@ bool ccPointCloud::reserveTheRGBTable()
 		m_rgbaColors = new RGBAColorsTableType();
 		m_rgbaColors->link();
 	}
+	else if (m_rgbaColors->capacity() < m_points.capacity() && !detachColors())
+	{
+		ccLog::Error("[ccPointCloud::reserveTheRGBTable] Not enough memory!");
+		return false;
+	}
 
 	if (!m_rgbaColors->reserveSafe(m_points.capacity()))
 	{
@@ -1211,6 +1589,11 @@ bool ccPointCloud::resizeTheRGBTable(bool fillWithWhite/*=false*/)
 		m_rgbaColors = new RGBAColorsTableType();
 		m_rgbaColors->link();
 	}
+	else if (!detachColors())
+	{
+		ccLog::Error("[ccPointCloud::resizeTheRGBTable] Not enough memory!");
+		return false;
+	}
 
 	static const ccColor::Rgba s_white(ccColor::MAX, ccColor::MAX, ccColor::MAX, ccColor::MAX);
 	if (!m_rgbaColors->resizeSafe(m_points.size(), fillWithWhite, &s_white))
@@ -1239,6 +1622,11 @@ bool ccPointCloud::reserveTheNormsTable()
 		m_normals = new NormsIndexesTableType();
 		m_normals->link();
 	}
+	else if (m_normals->capacity() < m_points.capacity() && !detachNormals())
+	{
+		ccLog::Error("[ccPointCloud::reserveTheNormsTable] Not enough memory!");
+		return false;
+	}
 
 	if (!m_normals->reserveSafe(m_points.capacity()))
 	{
@@ -1267,6 +1655,11 @@ bool ccPointCloud::resizeTheNormsTable()
 		m_normals = new NormsIndexesTableType();
 		m_normals->link();
 	}
+	else if (!detachNormals())
+	{
+		ccLog::Error("[ccPointCloud::resizeTheNormsTable] Not enough memory!");
+		return false;
+	}
 
 	static const CompressedNormType s_normZero = 0;
 	if (!m_normals->resizeSafe(m_points.size(), true, &s_normZero))
@@ -1286,6 +1679,12 @@ bool ccPointCloud::resizeTheNormsTable()
 
 bool ccPointCloud::compressFWFData()
 {
+	if (fwfDataIsPaged())
+	{
+		//paged data doesn't consume memory
+		return true;
+	}
+
 	if (!m_fwfData || m_fwfData->empty())
 	{
 		return false;
@@ -1294,9 +1693,10 @@ bool ccPointCloud::compressFWFData()
 	try
 	{
 		size_t initialCount = m_fwfData->size();
-		std::vector<size_t> usedIndexes;
-		usedIndexes.resize(initialCount, 0);
 
+		//gather the used byte ranges (sorted by offset)
+		std::vector<std::pair<uint64_t, uint64_t>> ranges;
+		ranges.reserve(m_fwfWaveforms.size());
 		for (const ccWaveform& w : m_fwfWaveforms)
 		{
 			if (w.byteCount() == 0)
@@ -1304,23 +1704,33 @@ bool ccPointCloud::compressFWFData()
 				assert(false);
 				continue;
 			}
-
-			size_t start = w.dataOffset();
-			size_t end = w.dataOffset() + w.byteCount();
-			for (size_t i = start; i < end; ++i)
-			{
-				usedIndexes[i] = 1;
-			}
+			ranges.emplace_back(w.dataOffset(), w.dataOffset() + w.byteCount());
 		}
+		std::sort(ranges.begin(), ranges.end());
 
+		//merge the overlapping ranges (and compute the new offset of each merged range)
+		std::vector<std::pair<uint64_t, uint64_t>> mergedRanges;
+		std::vector<uint64_t> newOffsets;
 		size_t newIndex = 0;
-		for (size_t& index : usedIndexes)
+		for (const auto& r : ranges)
 		{
-			if (index != 0)
+			if (!mergedRanges.empty() && r.first <= mergedRanges.back().second)
 			{
-				index = ++newIndex; //we need to start at 1 (as 0 means 'not used')
+				if (r.second > mergedRanges.back().second)
+				{
+					newIndex += (r.second - mergedRanges.back().second);
+					mergedRanges.back().second = r.second;
+				}
+			}
+			else
+			{
+				mergedRanges.push_back(r);
+				newOffsets.push_back(newIndex);
+				newIndex += (r.second - r.first);
 			}
 		}
+		ranges.clear();
+		ranges.shrink_to_fit();
 
 		if (newIndex >= initialCount)
 		{
@@ -1329,24 +1739,23 @@ bool ccPointCloud::compressFWFData()
 			return true;
 		}
 
-		//now create the new container
+		//now create the new container (streaming copy of the used ranges)
 		FWFDataContainer* newContainer = new FWFDataContainer;
 		newContainer->reserve(newIndex);
 
-		for (size_t i = 0; i < initialCount; ++i)
+		for (const auto& r : mergedRanges)
 		{
-			if (usedIndexes[i])
-			{
-				newContainer->push_back(m_fwfData->at(i));
-			}
+			newContainer->insert(newContainer->end(), m_fwfData->begin() + r.first, m_fwfData->begin() + r.second);
 		}
 
 		//and don't forget to update the waveform descriptors!
 		for (ccWaveform& w : m_fwfWaveforms)
 		{
 			uint64_t offset = w.dataOffset();
-			assert(usedIndexes[offset] != 0);
-			w.setDataOffset(usedIndexes[offset] - 1);
+			auto it = std::upper_bound(mergedRanges.begin(), mergedRanges.end(), std::make_pair(offset, std::numeric_limits<uint64_t>::max()));
+			assert(it != mergedRanges.begin());
+			size_t rangeIndex = static_cast<size_t>(it - mergedRanges.begin()) - 1;
+			w.setDataOffset(newOffsets[rangeIndex] + (offset - mergedRanges[rangeIndex].first));
 		}
 		m_fwfData = SharedFWFDataContainer(newContainer);
 
@@ -1361,6 +1770,30 @@ bool ccPointCloud::compressFWFData()
 	return true;
 }
 
+uint64_t ccPointCloud::fwfDataSize() const
+{
+	if (fwfDataIsPaged())
+	{
+		return m_fwfPager->size();
+	}
+
+	return (m_fwfData ? static_cast<uint64_t>(m_fwfData->size()) : 0);
+}
+
+bool ccPointCloud::writeFWFData(QIODevice& out) const
+{
+	if (fwfDataIsPaged())
+	{
+		return m_fwfPager->copyTo(out, 0, m_fwfPager->size());
+	}
+	else if (m_fwfData && !m_fwfData->empty())
+	{
+		return (out.write(reinterpret_cast<const char*>(m_fwfData->data()), m_fwfData->size()) >= 0);
+	}
+
+	return true;
+}
+
 bool ccPointCloud::reserveTheFWFTable()
 {
 	if (m_points.capacity() == 0)
@@ -1384,8 +1817,7 @@ bool ccPointCloud::reserveTheFWFTable()
 
 bool ccPointCloud::hasFWF() const
 {
-	return		m_fwfData
-			&&	!m_fwfData->empty()
+	return		((m_fwfData && !m_fwfData->empty()) || fwfDataIsPaged())
 			&&	!m_fwfWaveforms.empty();
 }
 
@@ -1397,8 +1829,23 @@ ccWaveformProxy ccPointCloud::waveformProxy(unsigned index) const
 	if (index < m_fwfWaveforms.size())
 	{
 		const ccWaveform& w = m_fwfWaveforms[index];
+		//paged data
+		if (fwfDataIsPaged() && w.dataOffset() + w.byteCount() <= m_fwfPager->size())
+		{
+			if (m_fwfDescriptors.contains(w.descriptorID()))
+			{
+				WaveformDescriptor& d = const_cast<ccPointCloud*>(this)->m_fwfDescriptors[w.descriptorID()]; //see below
+				uint64_t pageOffset = 0;
+				ccWaveformPager::Page page = m_fwfPager->fetch(w.dataOffset(), w.byteCount(), pageOffset);
+				return ccWaveformProxy(w, d, page, pageOffset);
+			}
+			else
+			{
+				return ccWaveformProxy(w, invalidD, nullptr);
+			}
+		}
 		//check data consistency
-		if (m_fwfData && w.dataOffset() + w.byteCount() <= m_fwfData->size())
+		else if (m_fwfData && w.dataOffset() + w.byteCount() <= m_fwfData->size())
 		{
 			if (m_fwfDescriptors.contains(w.descriptorID()))
 			{
@@ -1578,6 +2025,10 @@ const CCVector3* ccPointCloud::getNormal(unsigned pointIndex) const
 void ccPointCloud::setPointColor(unsigned pointIndex, const ccColor::Rgba& col)
 {
 	assert(m_rgbaColors && pointIndex < m_rgbaColors->currentSize());
+	if (!detachColors())
+	{
+		return;
+	}
 
 	m_rgbaColors->setValue(pointIndex, col);
 
@@ -1588,6 +2039,10 @@ void ccPointCloud::setPointColor(unsigned pointIndex, const ccColor::Rgba& col)
 void ccPointCloud::setPointNormalIndex(unsigned pointIndex, CompressedNormType norm)
 {
 	assert(m_normals && pointIndex < m_normals->currentSize());
+	if (!detachNormals())
+	{
+		return;
+	}
 
 	m_normals->setValue(pointIndex, norm);
 
@@ -1630,6 +2085,10 @@ void ccPointCloud::invalidateBoundingBox()
 void ccPointCloud::addColor(const ccColor::Rgba& C)
 {
 	assert(m_rgbaColors && m_rgbaColors->isAllocated());
+	if (!detachColors())
+	{
+		return;
+	}
 	m_rgbaColors->emplace_back(C);
 
 	//We must update the VBOs
@@ -1644,12 +2103,20 @@ void ccPointCloud::addNorm(const CCVector3& N)
 void ccPointCloud::addNormIndex(CompressedNormType index)
 {
 	assert(m_normals && m_normals->isAllocated());
+	if (!detachNormals())
+	{
+		return;
+	}
 	m_normals->addElement(index);
 }
 
 void ccPointCloud::addNormAtIndex(const PointCoordinateType* N, unsigned index)
 {
 	assert(m_normals && m_normals->isAllocated());
+	if (!detachNormals())
+	{
+		return;
+	}
 	//we get the real normal vector corresponding to current index
 	CCVector3 P(ccNormalVectors::GetNormal(m_normals->getValue(index)));
 	//we add the provided vector (N)
@@ -1697,7 +2164,7 @@ bool ccPointCloud::convertNormalToRGB()
 
 bool ccPointCloud::convertRGBToGreyScale()
 {
-	if (!hasColors())
+	if (!hasColors() || !detachColors())
 	{
 		return false;
 	}
@@ -1770,6 +2237,45 @@ void ccPointCloud::setNormsTable(NormsIndexesTableType* norms)
 	normalsHaveChanged();
 }
 
+//! Replaces a shared array by a copy (copy-on-write)
+template <class ArrayType> static bool DetachArray(ArrayType*& array)
+{
+	if (!array || array->getLinkCount() < 2)
+	{
+		//not shared
+		return true;
+	}
+
+	ArrayType* copy = array->clone();
+	if (!copy || !copy->reserveSafe(array->capacity()))
+	{
+		ccLog::Warning("[ccPointCloud] Not enough memory to duplicate a shared array");
+		if (copy)
+		{
+			copy->release();
+		}
+		return false;
+	}
+	copy->link();
+
+	array->release();
+	array = copy;
+
+	return true;
+}
+
+bool ccPointCloud::detachColors()
+{
+	//(the content doesn't change, no need to update the VBOs)
+	return DetachArray(m_rgbaColors);
+}
+
+bool ccPointCloud::detachNormals()
+{
+	//(the content doesn't change, no need to update the VBOs)
+	return DetachArray(m_normals);
+}
+
 bool ccPointCloud::colorize(float r, float g, float b, float a/*=1.0f*/)
 {
 	assert(r >= 0.0f && r <= 1.0f);
@@ -1779,6 +2285,9 @@ bool ccPointCloud::colorize(float r, float g, float b, float a/*=1.0f*/)
 
 	if (hasColors())
 	{
+		if (!detachColors())
+			return false;
+
 		assert(m_rgbaColors);
 		for (unsigned i = 0; i < m_rgbaColors->currentSize(); i++)
 		{
@@ -2104,6 +2613,13 @@ bool ccPointCloud::applyFilterToRGB(PointCoordinateType sigma,
 		return false;
 	}
 
+	//the colors are modified concurrently: they must not be shared anymore
+	if (!detachColors())
+	{
+		ccLog::Warning("[ccPointCloud::applyFilterToRGB] Not enough memory");
+		return false;
+	}
+
 	if ((sigmaSF > 0) && (nullptr == getCurrentOutScalarField()))
 	{
 		ccLog::Warning("[ccPointCloud::applyFilterToRGB] A non-zero scalar field variance was set without an active 'input' scalar-field");
@@ -2170,10 +2686,16 @@ bool ccPointCloud::setRGBColorByBanding(unsigned char dim, double freq)
 		return false;
 	}
 
-	//allocate colors if necessary
+	//allocate colors if necessary (or make sure they are not shared)
 	if (!hasColors())
+	{
 		if (!resizeTheRGBTable(false))
 			return false;
+	}
+	else if (!detachColors())
+	{
+		return false;
+	}
 
 	enableTempColor(false);
 	assert(m_rgbaColors);
@@ -2208,10 +2730,16 @@ bool ccPointCloud::setRGBColorByHeight(unsigned char heightDim, ccColorScale::Sh
 		return false;
 	}
 
-	//allocate colors if necessary
+	//allocate colors if necessary (or make sure they are not shared)
 	if (!hasColors())
+	{
 		if (!resizeTheRGBTable(false))
 			return false;
+	}
+	else if (!detachColors())
+	{
+		return false;
+	}
 
 	enableTempColor(false);
 	assert(m_rgbaColors);
@@ -2247,10 +2775,16 @@ bool ccPointCloud::setColor(const ccColor::Rgba& col)
 {
 	enableTempColor(false);
 
-	//allocate colors if necessary
+	//allocate colors if necessary (or make sure they are not shared)
 	if (!hasColors())
+	{
 		if (!reserveTheRGBTable())
 			return false;
+	}
+	else if (!detachColors())
+	{
+		return false;
+	}
 
 	assert(m_rgbaColors);
 	m_rgbaColors->resize(size()); // reserve might have set a capacity larger than the cloud size!
@@ -2296,7 +2830,12 @@ void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 		trans.apply(*point(i));
 	}
 
-	//we must also take care of the normals!
+	//we must also take care of the normals! (they must not be shared anymore)
+	if (hasNormals() && !detachNormals())
+	{
+		ccLog::Warning("[ccPointCloud::applyRigidTransformation] Not enough memory to transform the normals (they will be removed)");
+		unallocateNorms();
+	}
 	if (hasNormals())
 	{
 		bool recoded = false;
@@ -2432,7 +2971,12 @@ void ccPointCloud::scale(PointCoordinateType fx, PointCoordinateType fy, PointCo
 	if (hasNormals())
 	{
 		//only if one of the scale coefficients is negative
-		if (fx < 0 || fy < 0 || fz < 0)
+		if ((fx < 0 || fy < 0 || fz < 0) && !detachNormals())
+		{
+			ccLog::Warning("[ccPointCloud::scale] Not enough memory to update the normals (they will be removed)");
+			unallocateNorms();
+		}
+		else if (fx < 0 || fy < 0 || fz < 0)
 		{
 			PointCoordinateType signX = (fx < 0 ? -CCCoreLib::PC_ONE : CCCoreLib::PC_ONE);
 			PointCoordinateType signY = (fy < 0 ? -CCCoreLib::PC_ONE : CCCoreLib::PC_ONE);
@@ -2557,7 +3101,7 @@ void ccPointCloud::scale(PointCoordinateType fx, PointCoordinateType fy, PointCo
 
 void ccPointCloud::invertNormals()
 {
-	if (hasNormals())
+	if (hasNormals() && detachNormals())
 	{
 		for (CompressedNormType& n : *m_normals)
 		{
@@ -2576,6 +3120,15 @@ void ccPointCloud::swapPoints(unsigned firstIndex, unsigned secondIndex)
 	if (firstIndex == secondIndex)
 		return;
 
+	//the colors and normals must be detached before anything is swapped
+	//(otherwise they would be misaligned with the points)
+	if (	(hasColors() && !detachColors())
+		||	(hasNormals() && !detachNormals()) )
+	{
+		ccLog::Warning("[ccPointCloud::swapPoints] Not enough memory to detach the colors or normals (points not swapped)");
+		return;
+	}
+
 	//points + associated SF values
 	BaseClass::swapPoints(firstIndex, secondIndex);
 
@@ -4021,6 +4574,11 @@ bool ccPointCloud::convertCurrentScalarFieldToColors(bool mixWithExistingColor/*
 	}
 	else //mix with existing colors
 	{
+		if (!detachColors())
+		{
+			return false;
+		}
+
 		for (unsigned i = 0; i < count; i++)
 		{
 			const ccColor::Rgb* col = getPointScalarValueColor(i);
@@ -4831,12 +5389,12 @@ bool ccPointCloud::toFile_MeOnly(QFile& out, short dataVersion) const
 			}
 
 			//eventually save the data
-			uint64_t dataSize = static_cast<uint64_t>(m_fwfData ? m_fwfData->size() : 0);
+			uint64_t dataSize = fwfDataSize();
 			if (out.write((const char*)&dataSize, 8) < 0)
 			{
 				return WriteError();
 			}
-			if (m_fwfData && out.write((const char*)m_fwfData->data(), dataSize) < 0)
+			if (!writeFWFData(out))
 			{
 				return WriteError();
 			}
@@ -5126,7 +5684,21 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags, Load
 			{
 				return ReadError();
 			}
-			if (dataSize != 0)
+			if (dataSize > ccWaveformPager::InMemoryThreshold())
+			{
+				//too big: we keep the data in the BIN file and page it in on demand
+				qint64 dataPos = in.pos();
+				ccSharedWaveformPager pager(new ccWaveformPager);
+				if (!pager->addSegment(in.fileName(), static_cast<uint64_t>(dataPos), dataSize) || !in.seek(dataPos + static_cast<qint64>(dataSize)))
+				{
+					m_fwfWaveforms.clear();
+					m_fwfDescriptors.clear();
+					return ReadError();
+				}
+				m_fwfPager = pager;
+				ccLog::Print(QString("[BIN] Cloud '%1': FWF data (%2 Mb) will be paged from the file").arg(getName()).arg(dataSize / static_cast<double>(1 << 20), 0, 'f', 1));
+			}
+			else if (dataSize != 0)
 			{
 				FWFDataContainer* container = new FWFDataContainer;
 				try
@@ -5668,6 +6240,21 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 						currentVBO->write(currentVBO->rgbShift, ccChunk::Start(*m_rgbaColors, chunkIndex), sizeof(ColorCompType) * chunkSize * 4);
 					}
 				}
+				//load the modified colors only
+				else if (	(chunkUpdateFlags & vboSet::UPDATE_COLOR_RANGES)
+						&&	glParams.showColors
+						&&	!glParams.showSF
+						&&	chunkIndex < m_vboManager.colorRanges.size() )
+				{
+					const vboSet::Range& range = m_vboManager.colorRanges[chunkIndex];
+					if (range.first < range.last)
+					{
+						assert(static_cast<int>(range.last) <= chunkSize);
+						currentVBO->write(	currentVBO->rgbShift + static_cast<int>(sizeof(ColorCompType) * 4 * range.first),
+											ccChunk::Start(*m_rgbaColors, chunkIndex) + range.first,
+											static_cast<int>(sizeof(ColorCompType) * 4 * (range.last - range.first)) );
+					}
+				}
 #ifndef DONT_LOAD_NORMALS_IN_VBOS
 				//load normals
 				if (glParams.showNorms && (chunkUpdateFlags & UPDATE_NORMALS))
@@ -5743,10 +6330,68 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 
 	m_vboManager.state = vboSet::INITIALIZED;
 	m_vboManager.updateFlags = 0;
+	m_vboManager.colorRanges.clear();
 
 	return true;
 }
 
+void ccPointCloud::colorsHaveChanged(unsigned firstIndex, unsigned lastIndex)
+{
+	assert(firstIndex <= lastIndex && lastIndex <= size());
+	if (firstIndex >= lastIndex)
+	{
+		//nothing to do
+		return;
+	}
+
+	size_t firstChunk = (firstIndex >> ccChunk::SIZE_POWER);
+	size_t lastChunk = ((lastIndex - 1) >> ccChunk::SIZE_POWER);
+
+	if (	m_vboManager.state != vboSet::INITIALIZED
+		||	(m_vboManager.updateFlags & vboSet::UPDATE_COLORS)
+		||	lastChunk >= m_vboManager.vbos.size() )
+	{
+		//all the colors will have to be (re)loaded anyway
+		colorsHaveChanged();
+		return;
+	}
+
+	if (m_vboManager.colorRanges.size() < m_vboManager.vbos.size())
+	{
+		try
+		{
+			m_vboManager.colorRanges.resize(m_vboManager.vbos.size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: we'll reload all the colors
+			colorsHaveChanged();
+			return;
+		}
+	}
+
+	for (size_t chunkIndex = firstChunk; chunkIndex <= lastChunk; ++chunkIndex)
+	{
+		size_t chunkStart = ccChunk::StartPos(chunkIndex);
+		unsigned first = static_cast<unsigned>(std::max<size_t>(firstIndex, chunkStart) - chunkStart);
+		unsigned last = static_cast<unsigned>(std::min<size_t>(lastIndex, chunkStart + ccChunk::SIZE) - chunkStart);
+
+		vboSet::Range& range = m_vboManager.colorRanges[chunkIndex];
+		if (range.first < range.last)
+		{
+			range.first = std::min(range.first, first);
+			range.last = std::max(range.last, last);
+		}
+		else
+		{
+			range.first = first;
+			range.last = last;
+		}
+	}
+
+	m_vboManager.updateFlags |= vboSet::UPDATE_COLOR_RANGES;
+}
+
 int ccPointCloud::VBO::init(int count, bool withColors, bool withNormals, bool* reallocated/*=nullptr*/)
 {
 	//required memory
@@ -5839,6 +6484,7 @@ void ccPointCloud::releaseVBOs()
 	m_vboManager.colorIsSF = false;
 	m_vboManager.sourceSF = nullptr;
 	m_vboManager.totalMemSizeBytes = 0;
+	m_vboManager.colorRanges.clear();
 	m_vboManager.state = vboSet::NEW;
 }
 
@@ -6492,6 +7138,55 @@ void ccPointCloud::clearFWFData()
 	m_fwfDescriptors.clear();
 }
 
+//! Decodes the waveforms of a cloud by blocks
+/** \param cloud point cloud
+	\param nProgress optional progress notification (one step per block)
+	\param func function called on each decoded block: func(firstIndex, proxies, samples, offsets)
+	\return success
+**/
+template <typename Func> static bool DecodeFWFByBlocks(const ccPointCloud& cloud, CCCoreLib::NormalizedProgress* nProgress, Func func)
+{
+	static const unsigned BlockSize = (1 << 16);
+
+	std::vector<ccWaveformProxy> proxies;
+	std::vector<float> samples;
+	std::vector<size_t> offsets;
+	try
+	{
+		proxies.reserve(std::min(BlockSize, cloud.size()));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned firstIndex = 0; firstIndex < cloud.size(); firstIndex += BlockSize)
+	{
+		unsigned lastIndex = std::min(firstIndex + BlockSize, cloud.size());
+
+		proxies.clear();
+		for (unsigned i = firstIndex; i < lastIndex; ++i)
+		{
+			proxies.push_back(cloud.waveformProxy(i));
+		}
+
+		if (!ccWaveformProxy::DecodeBatch(proxies, samples, offsets))
+		{
+			ccLog::Warning("[ccPointCloud] Not enough memory to decode the waveforms");
+			return false;
+		}
+
+		func(firstIndex, proxies, samples, offsets);
+
+		if (nProgress && !nProgress->oneStep())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool ccPointCloud::computeFWFAmplitude(double& minVal, double& maxVal, ccProgressDialog* pDlg/*=nullptr*/) const
 {
 	minVal = maxVal = 0;
@@ -6502,7 +7197,8 @@ bool ccPointCloud::computeFWFAmplitude(double& minVal, double& maxVal, ccProgres
 	}
 
 	//progress dialog
-	CCCoreLib::NormalizedProgress nProgress(pDlg, static_cast<unsigned>(m_fwfWaveforms.size()));
+	unsigned blockCount = (size() >> 16) + 1;
+	CCCoreLib::NormalizedProgress nProgress(pDlg, blockCount);
 	if (pDlg)
 	{
 		pDlg->setWindowTitle(QObject::tr("FWF amplitude"));
@@ -6513,43 +7209,184 @@ bool ccPointCloud::computeFWFAmplitude(double& minVal, double& maxVal, ccProgres
 
 	//for all waveforms
 	bool firstTest = true;
-	for (unsigned i = 0; i < size(); ++i)
-	{
-		if (pDlg && !nProgress.oneStep())
+	float minValf = 0.0f;
+	float maxValf = 0.0f;
+	bool success = DecodeFWFByBlocks(*this, pDlg ? &nProgress : nullptr, [&](unsigned, const std::vector<ccWaveformProxy>&, const std::vector<float>& samples, const std::vector<size_t>&)
 		{
-			return false;
-		}
+			if (samples.empty())
+			{
+				return;
+			}
 
-		ccWaveformProxy proxy = waveformProxy(i);
-		if (!proxy.isValid())
-		{
-			continue;
-		}
+			if (firstTest)
+			{
+				minValf = maxValf = samples.front();
+				firstTest = false;
+			}
+
+			for (float s : samples)
+			{
+				minValf = std::min(minValf, s);
+				maxValf = std::max(maxValf, s);
+			}
+		});
+
+	minVal = minValf;
+	maxVal = maxValf;
+
+	return success && !firstTest;
+}
 
-		double wMinVal = 0.0;
-		double wMaxVal = 0.0;
-		proxy.getRange(wMinVal, wMaxVal);
+int ccPointCloud::computeFWFFeatures(unsigned features, ccProgressDialog* pDlg/*=nullptr*/)
+{
+	if (!hasFWF() || size() != m_fwfWaveforms.size())
+	{
+		ccLog::Warning("[ccPointCloud::computeFWFFeatures] Cloud has no (valid) waveform data");
+		return 0;
+	}
 
-		if (firstTest)
+	//prepare the output scalar fields
+	static const std::pair<FWF_FEATURE, const char*> s_features[] { { FWF_PEAK_AMPLITUDE, "FWF peak amplitude" },
+																	{ FWF_ECHO_WIDTH,     "FWF echo width (ns)" },
+																	{ FWF_INTEGRAL,       "FWF integral" } };
+	CCCoreLib::ScalarField* sfs[3] { nullptr, nullptr, nullptr };
+	int lastSFIndex = -1;
+	for (size_t k = 0; k < 3; ++k)
+	{
+		if ((features & s_features[k].first) == 0)
 		{
-			minVal = wMinVal;
-			maxVal = wMaxVal;
-			firstTest = false;
+			continue;
 		}
-		else
+
+		int sfIdx = getScalarFieldIndexByName(s_features[k].second);
+		if (sfIdx < 0)
 		{
-			if (wMaxVal > maxVal)
+			sfIdx = addScalarField(s_features[k].second);
+			if (sfIdx < 0)
 			{
-				maxVal = wMaxVal;
+				ccLog::Warning("[ccPointCloud::computeFWFFeatures] Not enough memory");
+				return 0;
 			}
-			if (wMinVal < minVal)
+		}
+		sfs[k] = getScalarField(sfIdx);
+		lastSFIndex = sfIdx;
+	}
+	if (lastSFIndex < 0)
+	{
+		//nothing to do
+		return 0;
+	}
+
+	//progress dialog
+	unsigned blockCount = (size() >> 16) + 1;
+	CCCoreLib::NormalizedProgress nProgress(pDlg, blockCount);
+	if (pDlg)
+	{
+		pDlg->setWindowTitle(QObject::tr("FWF features"));
+		pDlg->setLabelText(QObject::tr("Computing waveform features\nPoints: ") + QString::number(size()));
+		pDlg->show();
+		QCoreApplication::processEvents();
+	}
+
+	bool success = DecodeFWFByBlocks(*this, pDlg ? &nProgress : nullptr, [&](unsigned firstIndex, const std::vector<ccWaveformProxy>& proxies, const std::vector<float>& samples, const std::vector<size_t>& offsets)
+		{
+			int proxyCount = static_cast<int>(proxies.size());
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic, 256)
+#endif
+			for (int i = 0; i < proxyCount; ++i)
 			{
-				minVal = wMinVal;
+				unsigned pointIndex = firstIndex + static_cast<unsigned>(i);
+				size_t n = offsets[i + 1] - offsets[i];
+				if (n == 0)
+				{
+					//invalid or empty waveform
+					for (size_t k = 0; k < 3; ++k)
+					{
+						if (sfs[k])
+							sfs[k]->setValue(pointIndex, CCCoreLib::NAN_VALUE);
+					}
+					continue;
+				}
+				const float* v = samples.data() + offsets[i];
+
+				//peak and baseline (= minimum value)
+				size_t peakIndex = 0;
+				float baseline = v[0];
+				for (size_t j = 1; j < n; ++j)
+				{
+					if (v[j] > v[peakIndex])
+						peakIndex = j;
+					if (v[j] < baseline)
+						baseline = v[j];
+				}
+				float peak = v[peakIndex];
+				double dt_ns = proxies[i].descriptor().samplingRate_ps / 1000.0;
+
+				if (sfs[0])
+				{
+					sfs[0]->setValue(pointIndex, peak);
+				}
+
+				if (sfs[1])
+				{
+					//full width at half maximum (of the main peak)
+					float halfMax = baseline + (peak - baseline) / 2;
+					double left = static_cast<double>(peakIndex);
+					for (size_t j = peakIndex; j > 0; --j)
+					{
+						if (v[j - 1] < halfMax)
+						{
+							left = (j - 1) + (halfMax - v[j - 1]) / static_cast<double>(v[j] - v[j - 1]);
+							break;
+						}
+						left = static_cast<double>(j - 1);
+					}
+					double right = static_cast<double>(peakIndex);
+					for (size_t j = peakIndex + 1; j < n; ++j)
+					{
+						if (v[j] < halfMax)
+						{
+							right = (j - 1) + (v[j - 1] - halfMax) / static_cast<double>(v[j - 1] - v[j]);
+							break;
+						}
+						right = static_cast<double>(j);
+					}
+					sfs[1]->setValue(pointIndex, static_cast<ScalarType>((right - left) * dt_ns));
+				}
+
+				if (sfs[2])
+				{
+					//integral above the baseline
+					double sum = 0.0;
+					for (size_t j = 0; j < n; ++j)
+					{
+						sum += v[j] - baseline;
+					}
+					sfs[2]->setValue(pointIndex, static_cast<ScalarType>(sum * dt_ns));
+				}
 			}
+		});
+
+	int featureCount = 0;
+	for (size_t k = 0; k < 3; ++k)
+	{
+		if (sfs[k])
+		{
+			sfs[k]->computeMinAndMax();
+			++featureCount;
 		}
 	}
 
-	return !firstTest;
+	if (!success)
+	{
+		ccLog::Warning("[ccPointCloud::computeFWFFeatures] Process failed or cancelled by the user");
+	}
+
+	setCurrentDisplayedScalarField(lastSFIndex);
+	showSF(true);
+
+	return (success ? featureCount : 0);
 }
 
 bool ccPointCloud::enhanceRGBWithIntensitySF(int sfIdx, bool useCustomIntensityRange/*=false*/, double minI/*=0.0*/, double maxI/*=1.0*/)
@@ -6562,6 +7399,12 @@ bool ccPointCloud::enhanceRGBWithIntensitySF(int sfIdx, bool useCustomIntensityR
 		return false;
 	}
 
+	if (!detachColors())
+	{
+		ccLog::Warning("[ccPointCloud::enhanceRGBWithIntensitySF] Not enough memory");
+		return false;
+	}
+
 	//apply Broovey transform to each point (color)
 	if (!useCustomIntensityRange)
 	{
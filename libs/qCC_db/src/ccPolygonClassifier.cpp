@@ -0,0 +1,352 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "ccPolygonClassifier.h"
+
+//Local
+#include "ccGenericPointCloud.h"
+#include "ccLog.h"
+#include "ccPolyline.h"
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+//! Maximum number of children per R-tree node
+static const unsigned s_nodeCapacity = 16;
+//! Maximum depth of the traversal stack (enough for 16^8 polygons)
+static const unsigned s_maxStackSize = 8 * (s_nodeCapacity - 1) + 1;
+
+//! Sorts items with the Sort-Tile-Recursive method (so that consecutive groups of 's_nodeCapacity' items are spatially coherent)
+template <class GetCenter> static void SortTileRecursive(std::vector<unsigned>::iterator begin, std::vector<unsigned>::iterator end, GetCenter getCenter)
+{
+	size_t count = static_cast<size_t>(end - begin);
+	if (count <= s_nodeCapacity)
+	{
+		return;
+	}
+
+	size_t nodeCount = (count + s_nodeCapacity - 1) / s_nodeCapacity;
+	size_t sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+	size_t sliceSize = sliceCount * s_nodeCapacity;
+
+	//sort by X
+	std::sort(begin, end, [&](unsigned a, unsigned b) { return getCenter(a).x < getCenter(b).x; });
+
+	//then sort each vertical slice by Y
+	for (size_t start = 0; start < count; start += sliceSize)
+	{
+		size_t stop = std::min(start + sliceSize, count);
+		std::sort(begin + start, begin + stop, [&](unsigned a, unsigned b) { return getCenter(a).y < getCenter(b).y; });
+	}
+}
+
+ccPolygonClassifier::ccPolygonClassifier(unsigned char orthoDim/*=2*/)
+	: m_orthoDim(std::min<unsigned char>(orthoDim, 2))
+	, m_indexIsValid(false)
+{
+	assert(orthoDim < 3);
+}
+
+bool ccPolygonClassifier::addPolygon(const ccPolyline* polyline)
+{
+	if (!polyline || polyline->size() < 3)
+	{
+		return false;
+	}
+
+	const unsigned char X = ((m_orthoDim + 1) % 3);
+	const unsigned char Y = ((X + 1) % 3);
+
+	std::vector<CCVector2d> vertices;
+	try
+	{
+		vertices.reserve(polyline->size());
+		for (unsigned i = 0; i < polyline->size(); ++i)
+		{
+			CCVector3d P = polyline->toGlobal3d(*polyline->getPoint(i));
+			vertices.emplace_back(P.u[X], P.u[Y]);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPolygonClassifier] Not enough memory");
+		return false;
+	}
+
+	return addPolygon(vertices);
+}
+
+bool ccPolygonClassifier::addPolygon(const std::vector<CCVector2d>& vertices)
+{
+	if (vertices.size() < 3)
+	{
+		return false;
+	}
+
+	Polygon polygon;
+	try
+	{
+		polygon.vertices = vertices;
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPolygonClassifier] Not enough memory");
+		return false;
+	}
+
+	polygon.box.minCorner = polygon.box.maxCorner = vertices.front();
+	for (const CCVector2d& P : vertices)
+	{
+		polygon.box.minCorner.x = std::min(polygon.box.minCorner.x, P.x);
+		polygon.box.minCorner.y = std::min(polygon.box.minCorner.y, P.y);
+		polygon.box.maxCorner.x = std::max(polygon.box.maxCorner.x, P.x);
+		polygon.box.maxCorner.y = std::max(polygon.box.maxCorner.y, P.y);
+	}
+
+	try
+	{
+		m_polygons.push_back(std::move(polygon));
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPolygonClassifier] Not enough memory");
+		return false;
+	}
+
+	m_indexIsValid = false;
+	return true;
+}
+
+bool ccPolygonClassifier::buildIndex()
+{
+	m_nodes.clear();
+	m_leafPolygons.clear();
+	m_indexIsValid = false;
+
+	if (m_polygons.empty())
+	{
+		return false;
+	}
+
+	try
+	{
+		//leaves
+		m_leafPolygons.resize(m_polygons.size());
+		for (size_t i = 0; i < m_polygons.size(); ++i)
+		{
+			m_leafPolygons[i] = static_cast<unsigned>(i);
+		}
+		SortTileRecursive(m_leafPolygons.begin(), m_leafPolygons.end(), [&](unsigned i)
+		{
+			const Box& box = m_polygons[i].box;
+			return (box.minCorner + box.maxCorner) / 2;
+		});
+
+		for (size_t start = 0; start < m_leafPolygons.size(); start += s_nodeCapacity)
+		{
+			size_t stop = std::min(start + s_nodeCapacity, m_leafPolygons.size());
+			Node node;
+			node.box = m_polygons[m_leafPolygons[start]].box;
+			for (size_t i = start + 1; i < stop; ++i)
+			{
+				const Box& box = m_polygons[m_leafPolygons[i]].box;
+				node.box.minCorner.x = std::min(node.box.minCorner.x, box.minCorner.x);
+				node.box.minCorner.y = std::min(node.box.minCorner.y, box.minCorner.y);
+				node.box.maxCorner.x = std::max(node.box.maxCorner.x, box.maxCorner.x);
+				node.box.maxCorner.y = std::max(node.box.maxCorner.y, box.maxCorner.y);
+			}
+			node.firstChild = static_cast<unsigned>(start);
+			node.childCount = static_cast<unsigned>(stop - start);
+			node.leaf = true;
+			m_nodes.push_back(node);
+		}
+
+		//upper levels (the nodes of each level are stored contiguously)
+		size_t levelStart = 0;
+		size_t levelStop = m_nodes.size();
+		while (levelStop - levelStart > 1)
+		{
+			//sort the nodes of the current level
+			std::vector<unsigned> order(levelStop - levelStart);
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				order[i] = static_cast<unsigned>(levelStart + i);
+			}
+			SortTileRecursive(order.begin(), order.end(), [&](unsigned i)
+			{
+				const Box& box = m_nodes[i].box;
+				return (box.minCorner + box.maxCorner) / 2;
+			});
+			std::vector<Node> sortedNodes;
+			sortedNodes.reserve(order.size());
+			for (unsigned i : order)
+			{
+				sortedNodes.push_back(m_nodes[i]);
+			}
+			std::copy(sortedNodes.begin(), sortedNodes.end(), m_nodes.begin() + levelStart);
+
+			//create the parent nodes
+			for (size_t start = levelStart; start < levelStop; start += s_nodeCapacity)
+			{
+				size_t stop = std::min(start + s_nodeCapacity, levelStop);
+				Node node;
+				node.box = m_nodes[start].box;
+				for (size_t i = start + 1; i < stop; ++i)
+				{
+					const Box& box = m_nodes[i].box;
+					node.box.minCorner.x = std::min(node.box.minCorner.x, box.minCorner.x);
+					node.box.minCorner.y = std::min(node.box.minCorner.y, box.minCorner.y);
+					node.box.maxCorner.x = std::max(node.box.maxCorner.x, box.maxCorner.x);
+					node.box.maxCorner.y = std::max(node.box.maxCorner.y, box.maxCorner.y);
+				}
+				node.firstChild = static_cast<unsigned>(start);
+				node.childCount = static_cast<unsigned>(stop - start);
+				node.leaf = false;
+				m_nodes.push_back(node);
+			}
+
+			levelStart = levelStop;
+			levelStop = m_nodes.size();
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPolygonClassifier] Not enough memory to build the spatial index");
+		m_nodes.clear();
+		m_leafPolygons.clear();
+		return false;
+	}
+
+	m_indexIsValid = true;
+	return true;
+}
+
+bool ccPolygonClassifier::isInside(const CCVector2d& P, unsigned polygonIndex) const
+{
+	//crossing number test
+	const std::vector<CCVector2d>& vertices = m_polygons[polygonIndex].vertices;
+	bool inside = false;
+	for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+	{
+		const CCVector2d& A = vertices[i];
+		const CCVector2d& B = vertices[j];
+		if ((A.y > P.y) != (B.y > P.y))
+		{
+			double x = A.x + (P.y - A.y) * (B.x - A.x) / (B.y - A.y);
+			if (P.x < x)
+			{
+				inside = !inside;
+			}
+		}
+	}
+
+	return inside;
+}
+
+int ccPolygonClassifier::locate(const CCVector2d& P) const
+{
+	if (!m_indexIsValid)
+	{
+		assert(false);
+		return -1;
+	}
+
+	unsigned stack[s_maxStackSize];
+	unsigned stackSize = 0;
+	stack[stackSize++] = static_cast<unsigned>(m_nodes.size() - 1); //root
+
+	unsigned bestIndex = std::numeric_limits<unsigned>::max();
+	while (stackSize != 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (!node.box.contains(P))
+		{
+			continue;
+		}
+
+		if (node.leaf)
+		{
+			for (unsigned i = 0; i < node.childCount; ++i)
+			{
+				unsigned polygonIndex = m_leafPolygons[node.firstChild + i];
+				//we look for the first polygon (smallest index) containing the point
+				if (polygonIndex < bestIndex && m_polygons[polygonIndex].box.contains(P) && isInside(P, polygonIndex))
+				{
+					bestIndex = polygonIndex;
+				}
+			}
+		}
+		else
+		{
+			assert(stackSize + node.childCount <= s_maxStackSize);
+			for (unsigned i = 0; i < node.childCount; ++i)
+			{
+				stack[stackSize++] = node.firstChild + i;
+			}
+		}
+	}
+
+	return (bestIndex != std::numeric_limits<unsigned>::max() ? static_cast<int>(bestIndex) : -1);
+}
+
+bool ccPolygonClassifier::classify(const ccGenericPointCloud* cloud, std::vector<int>& polygonIndexes) const
+{
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+	if (!m_indexIsValid)
+	{
+		ccLog::Warning("[ccPolygonClassifier] The spatial index must be built first");
+		return false;
+	}
+
+	int pointCount = static_cast<int>(cloud->size());
+	try
+	{
+		polygonIndexes.resize(pointCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccPolygonClassifier] Not enough memory");
+		return false;
+	}
+
+	const unsigned char X = ((m_orthoDim + 1) % 3);
+	const unsigned char Y = ((X + 1) % 3);
+
+	//the points are processed by blocks (dynamic scheduling, as the polygons density may vary a lot)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 4096)
+#endif
+	for (int i = 0; i < pointCount; ++i)
+	{
+		CCVector3d P = cloud->toGlobal3d(*cloud->getPoint(static_cast<unsigned>(i)));
+		polygonIndexes[i] = locate(CCVector2d(P.u[X], P.u[Y]));
+	}
+
+	return true;
+}
@@ -20,6 +20,7 @@
 //CCCoreLib
 #include <Delaunay2dMesh.h>
 #include <ParallelSort.h>
+#include <ReferenceCloud.h>
 
 //qCC_db
 #include "ccGenericPointCloud.h"
@@ -34,6 +35,11 @@
 //System
 #include <cassert>
 
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 //default field names
 struct DefaultFieldNames : public QMap<ccRasterGrid::ExportableFields, QString>
 {
@@ -1995,3 +2001,213 @@ ccPointCloud* ccRasterGrid::convertToCloud(	bool exportHeightStats,
 
 	return cloudGrid;
 }
+
+ccRasterGridTiling::ccRasterGridTiling()
+	: cloud(nullptr)
+	, Z(2)
+	, gridWidth(0)
+	, gridHeight(0)
+	, gridStep(0.0)
+	, gridMinCorner(0, 0, 0)
+	, tileSize(0)
+	, tileCountX(0)
+	, tileCountY(0)
+{}
+
+bool ccRasterGridTiling::init(	ccPointCloud* inputCloud,
+								unsigned char projDim,
+								unsigned w,
+								unsigned h,
+								double step,
+								const CCVector3d& minCorner,
+								unsigned size)
+{
+	if (!inputCloud || projDim > 2 || w == 0 || h == 0 || step <= 0 || size == 0)
+	{
+		assert(false);
+		ccLog::Warning("[ccRasterGridTiling::init] Invalid input");
+		return false;
+	}
+
+	cloud = inputCloud;
+	Z = projDim;
+	gridWidth = w;
+	gridHeight = h;
+	gridStep = step;
+	gridMinCorner = minCorner;
+	tileSize = size;
+	tileCountX = (w + size - 1) / size;
+	tileCountY = (h + size - 1) / size;
+
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	const unsigned InvalidTile = std::numeric_limits<unsigned>::max();
+	unsigned pointCount = cloud->size();
+
+	std::vector<unsigned> pointTiles;
+	try
+	{
+		pointTiles.resize(pointCount);
+		tileFirstIndex.assign(static_cast<size_t>(tileCount()) + 1, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccRasterGridTiling::init] Not enough memory");
+		return false;
+	}
+
+	//tile of each point (same rounding as ccRasterGrid::computeCellPos)
+	int count = static_cast<int>(pointCount);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int n = 0; n < count; ++n)
+	{
+		const CCVector3* P = cloud->getPoint(static_cast<unsigned>(n));
+		int i = static_cast<int>((P->u[X] - gridMinCorner.u[X]) / gridStep + 0.5);
+		int j = static_cast<int>((P->u[Y] - gridMinCorner.u[Y]) / gridStep + 0.5);
+		if (i < 0 || i >= static_cast<int>(gridWidth) || j < 0 || j >= static_cast<int>(gridHeight))
+		{
+			pointTiles[n] = InvalidTile;
+		}
+		else
+		{
+			pointTiles[n] = (static_cast<unsigned>(j) / tileSize) * tileCountX + static_cast<unsigned>(i) / tileSize;
+		}
+	}
+
+	//counting sort
+	for (unsigned tileIndex : pointTiles)
+	{
+		if (tileIndex != InvalidTile)
+		{
+			++tileFirstIndex[tileIndex + 1];
+		}
+	}
+	for (size_t t = 1; t < tileFirstIndex.size(); ++t)
+	{
+		tileFirstIndex[t] += tileFirstIndex[t - 1];
+	}
+
+	try
+	{
+		pointIndexes.resize(tileFirstIndex.back());
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccRasterGridTiling::init] Not enough memory");
+		tileFirstIndex.clear();
+		return false;
+	}
+
+	{
+		std::vector<unsigned> tilePos(tileFirstIndex.begin(), tileFirstIndex.end() - 1);
+		for (unsigned n = 0; n < pointCount; ++n)
+		{
+			if (pointTiles[n] != InvalidTile)
+			{
+				pointIndexes[tilePos[pointTiles[n]]++] = n;
+			}
+		}
+	}
+
+	return true;
+}
+
+void ccRasterGridTiling::getTileExtents(unsigned tileIndex, unsigned& i0, unsigned& j0, unsigned& w, unsigned& h) const
+{
+	assert(tileIndex < tileCount());
+	i0 = (tileIndex % tileCountX) * tileSize;
+	j0 = (tileIndex / tileCountX) * tileSize;
+	w = std::min(tileSize, gridWidth - i0);
+	h = std::min(tileSize, gridHeight - j0);
+}
+
+bool ccRasterGridTiling::fillTile(	unsigned tileIndex,
+									ccRasterGrid& tileGrid,
+									ccRasterGrid::ProjectionType projectionType,
+									ccRasterGrid::ProjectionType sfProjectionType/*=ccRasterGrid::INVALID_PROJECTION_TYPE*/,
+									int zStdDevSfIndex/*=-1*/) const
+{
+	if (!cloud || tileIndex >= tileCount() || tileFirstIndex.size() != static_cast<size_t>(tileCount()) + 1)
+	{
+		assert(false);
+		return false;
+	}
+
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	unsigned i0 = 0;
+	unsigned j0 = 0;
+	unsigned w = 0;
+	unsigned h = 0;
+	getTileExtents(tileIndex, i0, j0, w, h);
+
+	CCVector3d tileMinCorner = gridMinCorner;
+	tileMinCorner.u[X] += i0 * gridStep;
+	tileMinCorner.u[Y] += j0 * gridStep;
+
+	if (!tileGrid.init(w, h, gridStep, tileMinCorner))
+	{
+		ccLog::Warning("[ccRasterGridTiling::fillTile] Not enough memory");
+		return false;
+	}
+
+	unsigned pointCount = tilePointCount(tileIndex);
+	if (pointCount == 0)
+	{
+		//empty tile: we only allocate the (empty) scalar fields, as fillWith would do
+		if (sfProjectionType != ccRasterGrid::INVALID_PROJECTION_TYPE && cloud->hasScalarFields())
+		{
+			try
+			{
+				tileGrid.scalarFields.resize(cloud->getNumberOfScalarFields());
+				for (ccRasterGrid::SF& sf : tileGrid.scalarFields)
+				{
+					sf.resize(static_cast<size_t>(w) * h, std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN());
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				tileGrid.scalarFields.resize(0);
+				ccLog::Warning("[ccRasterGridTiling::fillTile] Not enough memory");
+				return false;
+			}
+		}
+		tileGrid.hasColors = cloud->hasColors();
+		tileGrid.updateNonEmptyCellCount();
+		tileGrid.updateCellStats();
+		tileGrid.setValid(true);
+		return true;
+	}
+
+	//extract the points of the tile
+	CCCoreLib::ReferenceCloud tilePoints(cloud);
+	if (!tilePoints.reserve(pointCount))
+	{
+		ccLog::Warning("[ccRasterGridTiling::fillTile] Not enough memory");
+		return false;
+	}
+	for (unsigned n = tileFirstIndex[tileIndex]; n < tileFirstIndex[tileIndex + 1]; ++n)
+	{
+		tilePoints.addPointIndex(pointIndexes[n]);
+	}
+
+	QScopedPointer<ccPointCloud> tileCloud(cloud->partialClone(&tilePoints, nullptr, false));
+	if (!tileCloud)
+	{
+		ccLog::Warning("[ccRasterGridTiling::fillTile] Not enough memory");
+		return false;
+	}
+
+	return tileGrid.fillWith(	tileCloud.data(),
+								Z,
+								projectionType,
+								ccRasterGrid::InterpolationType::NONE,
+								nullptr,
+								sfProjectionType,
+								nullptr,
+								zStdDevSfIndex);
+}
@@ -0,0 +1,820 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "ccSoftwareRenderer.h"
+
+//Local
+#include "ccGenericMesh.h"
+#include "ccGenericPointCloud.h"
+#include "ccHObjectCaster.h"
+#include "ccLog.h"
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+namespace
+{
+	//! Projection of 3D points to the image
+	struct Camera
+	{
+		ccGLMatrixd viewMat;
+		bool perspective = false;
+		double xMaxRatio = 1.0; //perspective: half width / depth, orthographic: half width
+		double yMaxRatio = 1.0;
+		double zNear = 0.0;
+		int width = 0;
+		int height = 0;
+
+		//! Projects a point (already transformed by the entity matrix)
+		/** \return false if the point is behind the camera
+		**/
+		inline bool project(const CCVector3d& P, float& x, float& y, float& depth) const
+		{
+			CCVector3d Q = viewMat * P;
+			double d = -Q.z; //the camera looks toward -Z
+			double xn = 0.0;
+			double yn = 0.0;
+			if (perspective)
+			{
+				if (d <= zNear)
+				{
+					return false;
+				}
+				xn = Q.x / (d * xMaxRatio);
+				yn = Q.y / (d * yMaxRatio);
+			}
+			else
+			{
+				xn = Q.x / xMaxRatio;
+				yn = Q.y / yMaxRatio;
+			}
+
+			x = static_cast<float>((xn + 1.0) * 0.5 * width);
+			y = static_cast<float>((1.0 - yn) * 0.5 * height);
+			depth = static_cast<float>(d);
+			return std::isfinite(depth);
+		}
+	};
+
+	//! Frame buffer (the tiles are simply regions of the full buffers)
+	struct FrameBuffer
+	{
+		int width = 0;
+		int height = 0;
+		int tileSize = 64;
+		int tileCountX = 0;
+		int tileCountY = 0;
+		std::vector<float> depth;
+		std::vector<uint32_t> color;
+
+		inline int tileCount() const { return tileCountX * tileCountY; }
+	};
+
+	//! Projected point
+	struct Splat
+	{
+		float x;
+		float y;
+		float depth;
+		uint32_t rgb;
+	};
+
+	//! Projected triangle
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float invDepth[3];
+		float rgb[3][3];
+	};
+
+	inline uint32_t PackRGB(const ccColor::Rgb& col)
+	{
+		return (static_cast<uint32_t>(col.r) << 16) | (static_cast<uint32_t>(col.g) << 8) | static_cast<uint32_t>(col.b);
+	}
+
+	//! Returns whether an entity should be rendered
+	bool IsDisplayed(const ccHObject* entity)
+	{
+		return entity->isVisible() && entity->isBranchEnabled();
+	}
+
+	//! Returns the complete transformation (entity 'GL' transformation + view) of an entity
+	Camera EntityCamera(const Camera& camera, const ccHObject* entity)
+	{
+		Camera entityCamera = camera;
+		if (entity->isGLTransEnabled())
+		{
+			entityCamera.viewMat = camera.viewMat * ccGLMatrixd(entity->getGLTransformation().data());
+		}
+		return entityCamera;
+	}
+
+	//! Bins primitives by tile with a counting sort
+	/** 'getTileRange' must return the range of tiles covered by a primitive (false if none).
+	**/
+	template <typename GetTileRange> bool BinByTile(	size_t primitiveCount,
+														const FrameBuffer& fb,
+														GetTileRange getTileRange,
+														std::vector<unsigned>& tileFirst,
+														std::vector<unsigned>& binned )
+	{
+		try
+		{
+			tileFirst.assign(static_cast<size_t>(fb.tileCount()) + 1, 0);
+
+			int tx0 = 0;
+			int tx1 = 0;
+			int ty0 = 0;
+			int ty1 = 0;
+			for (size_t i = 0; i < primitiveCount; ++i)
+			{
+				if (getTileRange(i, tx0, tx1, ty0, ty1))
+				{
+					for (int ty = ty0; ty <= ty1; ++ty)
+						for (int tx = tx0; tx <= tx1; ++tx)
+							++tileFirst[ty * fb.tileCountX + tx + 1];
+				}
+			}
+			for (size_t t = 1; t < tileFirst.size(); ++t)
+			{
+				tileFirst[t] += tileFirst[t - 1];
+			}
+
+			binned.resize(tileFirst.back());
+			std::vector<unsigned> tilePos(tileFirst.begin(), tileFirst.end() - 1);
+			for (size_t i = 0; i < primitiveCount; ++i)
+			{
+				if (getTileRange(i, tx0, tx1, ty0, ty1))
+				{
+					for (int ty = ty0; ty <= ty1; ++ty)
+						for (int tx = tx0; tx <= tx1; ++tx)
+							binned[tilePos[ty * fb.tileCountX + tx]++] = static_cast<unsigned>(i);
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Computes the color of a vertex/point
+	/** \return false if the point is hidden
+	**/
+	inline bool GetPointColor(const ccGenericPointCloud* cloud, unsigned index, bool showSF, bool showColors, const ccColor::Rgb& defaultColor, ccColor::Rgb& color)
+	{
+		if (showSF)
+		{
+			const ccColor::Rgb* sfColor = cloud->getPointScalarValueColor(index);
+			if (!sfColor)
+			{
+				return false; //hidden value
+			}
+			color = *sfColor;
+		}
+		else if (showColors)
+		{
+			const ccColor::Rgba& rgba = cloud->getPointColor(index);
+			color = ccColor::Rgb(rgba.r, rgba.g, rgba.b);
+		}
+		else
+		{
+			color = defaultColor;
+		}
+		return true;
+	}
+
+	bool RenderCloud(ccGenericPointCloud* cloud, const Camera& sceneCamera, int pointSize, FrameBuffer& fb)
+	{
+		unsigned pointCount = cloud->size();
+		if (pointCount == 0)
+		{
+			return true;
+		}
+
+		Camera camera = EntityCamera(sceneCamera, cloud);
+
+		bool showSF = cloud->hasDisplayedScalarField() && cloud->sfShown();
+		bool showColors = !showSF && cloud->hasColors() && cloud->colorsShown();
+		ccColor::Rgb defaultColor = (cloud->isColorOverridden() ? ccColor::Rgb(cloud->getTempColor().r, cloud->getTempColor().g, cloud->getTempColor().b) : ccColor::whiteRGB);
+		const ccGenericPointCloud::VisibilityTableType* visTable = (cloud->isVisibilityTableInstantiated() ? &cloud->getTheVisibilityArray() : nullptr);
+
+		std::vector<Splat> splats;
+		try
+		{
+			splats.resize(pointCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+			return false;
+		}
+
+		//projection (in parallel)
+		const float invalidDepth = std::numeric_limits<float>::quiet_NaN();
+		int count = static_cast<int>(pointCount);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < count; ++i)
+		{
+			Splat& s = splats[i];
+			s.depth = invalidDepth;
+
+			if (visTable && visTable->at(i) != CCCoreLib::POINT_VISIBLE)
+			{
+				continue;
+			}
+
+			ccColor::Rgb col;
+			if (!GetPointColor(cloud, static_cast<unsigned>(i), showSF, showColors, defaultColor, col))
+			{
+				continue;
+			}
+
+			const CCVector3* P = cloud->getPoint(static_cast<unsigned>(i));
+			float depth = 0.0f;
+			if (camera.project(CCVector3d::fromArray(P->u), s.x, s.y, depth))
+			{
+				s.depth = depth;
+				s.rgb = PackRGB(col);
+			}
+		}
+
+		//binning
+		int halfSize = (pointSize - 1) / 2;
+		auto splatRect = [&](const Splat& s, int& px0, int& py0) -> bool
+		{
+			if (std::isnan(s.depth))
+			{
+				return false;
+			}
+			px0 = static_cast<int>(std::floor(s.x)) - halfSize;
+			py0 = static_cast<int>(std::floor(s.y)) - halfSize;
+			return (px0 + pointSize > 0 && py0 + pointSize > 0 && px0 < fb.width && py0 < fb.height);
+		};
+		auto getTileRange = [&](size_t i, int& tx0, int& tx1, int& ty0, int& ty1) -> bool
+		{
+			int px0 = 0;
+			int py0 = 0;
+			if (!splatRect(splats[i], px0, py0))
+			{
+				return false;
+			}
+			tx0 = std::max(px0, 0) / fb.tileSize;
+			ty0 = std::max(py0, 0) / fb.tileSize;
+			tx1 = std::min(px0 + pointSize - 1, fb.width - 1) / fb.tileSize;
+			ty1 = std::min(py0 + pointSize - 1, fb.height - 1) / fb.tileSize;
+			return true;
+		};
+
+		std::vector<unsigned> tileFirst;
+		std::vector<unsigned> binned;
+		if (!BinByTile(splats.size(), fb, getTileRange, tileFirst, binned))
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+			return false;
+		}
+
+		//rasterization (one tile per thread)
+		int tileCount = fb.tileCount();
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int t = 0; t < tileCount; ++t)
+		{
+			int tileX0 = (t % fb.tileCountX) * fb.tileSize;
+			int tileY0 = (t / fb.tileCountX) * fb.tileSize;
+			int tileX1 = std::min(tileX0 + fb.tileSize, fb.width);
+			int tileY1 = std::min(tileY0 + fb.tileSize, fb.height);
+
+			for (unsigned k = tileFirst[t]; k < tileFirst[t + 1]; ++k)
+			{
+				const Splat& s = splats[binned[k]];
+				int px0 = 0;
+				int py0 = 0;
+				splatRect(s, px0, py0);
+
+				int x0 = std::max(px0, tileX0);
+				int x1 = std::min(px0 + pointSize, tileX1);
+				int y0 = std::max(py0, tileY0);
+				int y1 = std::min(py0 + pointSize, tileY1);
+				for (int y = y0; y < y1; ++y)
+				{
+					float* depthRow = fb.depth.data() + static_cast<size_t>(y) * fb.width;
+					uint32_t* colorRow = fb.color.data() + static_cast<size_t>(y) * fb.width;
+					for (int x = x0; x < x1; ++x)
+					{
+						bool closer = (s.depth < depthRow[x]);
+						depthRow[x] = closer ? s.depth : depthRow[x];
+						colorRow[x] = closer ? s.rgb : colorRow[x];
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool RenderMesh(ccGenericMesh* mesh, const Camera& sceneCamera, FrameBuffer& fb)
+	{
+		ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+		unsigned triCount = mesh->size();
+		if (!vertices || vertices->size() == 0 || triCount == 0)
+		{
+			return true;
+		}
+
+		Camera camera = EntityCamera(sceneCamera, mesh);
+
+		bool showSF = mesh->hasDisplayedScalarField() && mesh->sfShown();
+		bool showColors = !showSF && mesh->hasColors() && mesh->colorsShown();
+		ccColor::Rgb defaultColor = (mesh->isColorOverridden()	? ccColor::Rgb(mesh->getTempColor().r, mesh->getTempColor().g, mesh->getTempColor().b)
+																: ccColor::Rgb(	static_cast<ColorCompType>(ccColor::defaultMeshFrontDiff.r * ccColor::MAX),
+																				static_cast<ColorCompType>(ccColor::defaultMeshFrontDiff.g * ccColor::MAX),
+																				static_cast<ColorCompType>(ccColor::defaultMeshFrontDiff.b * ccColor::MAX) ));
+
+		//project the vertices
+		unsigned vertCount = vertices->size();
+		std::vector<Splat> projVertices;
+		std::vector<ScreenTriangle> triangles;
+		try
+		{
+			projVertices.resize(vertCount);
+			triangles.resize(triCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+			return false;
+		}
+
+		const float invalidDepth = std::numeric_limits<float>::quiet_NaN();
+		int count = static_cast<int>(vertCount);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < count; ++i)
+		{
+			Splat& v = projVertices[i];
+			v.depth = invalidDepth;
+
+			ccColor::Rgb col;
+			if (!GetPointColor(vertices, static_cast<unsigned>(i), showSF, showColors, defaultColor, col))
+			{
+				continue;
+			}
+
+			const CCVector3* P = vertices->getPoint(static_cast<unsigned>(i));
+			float depth = 0.0f;
+			if (camera.project(CCVector3d::fromArray(P->u), v.x, v.y, depth))
+			{
+				v.depth = depth;
+				v.rgb = PackRGB(col);
+			}
+		}
+
+		//setup the triangles (with a simple 'headlight' Lambertian shading)
+		count = static_cast<int>(triCount);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < count; ++i)
+		{
+			ScreenTriangle& tri = triangles[i];
+			tri.invDepth[0] = invalidDepth;
+
+			const CCCoreLib::VerticesIndexes* tsi = mesh->getTriangleVertIndexes(static_cast<unsigned>(i));
+			const Splat* v[3] { &projVertices[tsi->i1], &projVertices[tsi->i2], &projVertices[tsi->i3] };
+			if (std::isnan(v[0]->depth) || std::isnan(v[1]->depth) || std::isnan(v[2]->depth))
+			{
+				//hidden or clipped triangle
+				continue;
+			}
+
+			//normal in the camera coordinate system
+			CCVector3d A = camera.viewMat * CCVector3d::fromArray(vertices->getPoint(tsi->i1)->u);
+			CCVector3d B = camera.viewMat * CCVector3d::fromArray(vertices->getPoint(tsi->i2)->u);
+			CCVector3d C = camera.viewMat * CCVector3d::fromArray(vertices->getPoint(tsi->i3)->u);
+			CCVector3d N = (B - A).cross(C - A);
+			double normN = N.norm();
+			//the light comes from the camera (toward -Z in the camera CS), both faces are lit
+			double lambert = (normN > 0 ? std::abs(N.z) / normN : 0.0);
+			if (camera.perspective)
+			{
+				CCVector3d G = (A + B + C) / 3.0;
+				double normG = G.norm();
+				lambert = (normN > 0 && normG > 0 ? std::abs(N.dot(G)) / (normN * normG) : 0.0);
+			}
+			float shade = static_cast<float>(0.25 + 0.75 * lambert);
+
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				tri.x[k] = v[k]->x;
+				tri.y[k] = v[k]->y;
+				tri.invDepth[k] = 1.0f / v[k]->depth;
+				tri.rgb[k][0] = shade * ((v[k]->rgb >> 16) & 0xFF);
+				tri.rgb[k][1] = shade * ((v[k]->rgb >> 8) & 0xFF);
+				tri.rgb[k][2] = shade * (v[k]->rgb & 0xFF);
+			}
+		}
+		projVertices.clear();
+		projVertices.shrink_to_fit();
+
+		//binning
+		auto getTileRange = [&](size_t i, int& tx0, int& tx1, int& ty0, int& ty1) -> bool
+		{
+			const ScreenTriangle& tri = triangles[i];
+			if (std::isnan(tri.invDepth[0]))
+			{
+				return false;
+			}
+			float xMin = std::min(std::min(tri.x[0], tri.x[1]), tri.x[2]);
+			float xMax = std::max(std::max(tri.x[0], tri.x[1]), tri.x[2]);
+			float yMin = std::min(std::min(tri.y[0], tri.y[1]), tri.y[2]);
+			float yMax = std::max(std::max(tri.y[0], tri.y[1]), tri.y[2]);
+			if (xMax < 0 || yMax < 0 || xMin >= fb.width || yMin >= fb.height)
+			{
+				return false;
+			}
+			tx0 = static_cast<int>(std::max(xMin, 0.0f)) / fb.tileSize;
+			ty0 = static_cast<int>(std::max(yMin, 0.0f)) / fb.tileSize;
+			tx1 = static_cast<int>(std::min(xMax, static_cast<float>(fb.width - 1))) / fb.tileSize;
+			ty1 = static_cast<int>(std::min(yMax, static_cast<float>(fb.height - 1))) / fb.tileSize;
+			return true;
+		};
+
+		std::vector<unsigned> tileFirst;
+		std::vector<unsigned> binned;
+		if (!BinByTile(triangles.size(), fb, getTileRange, tileFirst, binned))
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+			return false;
+		}
+
+		//rasterization (one tile per thread)
+		int tileCount = fb.tileCount();
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int t = 0; t < tileCount; ++t)
+		{
+			int tileX0 = (t % fb.tileCountX) * fb.tileSize;
+			int tileY0 = (t / fb.tileCountX) * fb.tileSize;
+			int tileX1 = std::min(tileX0 + fb.tileSize, fb.width);
+			int tileY1 = std::min(tileY0 + fb.tileSize, fb.height);
+
+			for (unsigned k = tileFirst[t]; k < tileFirst[t + 1]; ++k)
+			{
+				const ScreenTriangle& tri = triangles[binned[k]];
+
+				float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+				if (area == 0.0f)
+				{
+					continue;
+				}
+				float invArea = 1.0f / area;
+
+				int x0 = std::max(tileX0, static_cast<int>(std::floor(std::min(std::min(tri.x[0], tri.x[1]), tri.x[2]))));
+				int x1 = std::min(tileX1, static_cast<int>(std::ceil(std::max(std::max(tri.x[0], tri.x[1]), tri.x[2]))) + 1);
+				int y0 = std::max(tileY0, static_cast<int>(std::floor(std::min(std::min(tri.y[0], tri.y[1]), tri.y[2]))));
+				int y1 = std::min(tileY1, static_cast<int>(std::ceil(std::max(std::max(tri.y[0], tri.y[1]), tri.y[2]))) + 1);
+
+				for (int y = y0; y < y1; ++y)
+				{
+					float py = y + 0.5f;
+					float* depthRow = fb.depth.data() + static_cast<size_t>(y) * fb.width;
+					uint32_t* colorRow = fb.color.data() + static_cast<size_t>(y) * fb.width;
+					for (int x = x0; x < x1; ++x)
+					{
+						float px = x + 0.5f;
+						//barycentric coordinates (edge functions)
+						float b0 = ((tri.x[1] - px) * (tri.y[2] - py) - (tri.y[1] - py) * (tri.x[2] - px)) * invArea;
+						float b1 = ((tri.x[2] - px) * (tri.y[0] - py) - (tri.y[2] - py) * (tri.x[0] - px)) * invArea;
+						float b2 = 1.0f - b0 - b1;
+						if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+						{
+							continue;
+						}
+
+						//the inverse of the depth is linear in screen space
+						float depth = 1.0f / (b0 * tri.invDepth[0] + b1 * tri.invDepth[1] + b2 * tri.invDepth[2]);
+						if (depth < depthRow[x])
+						{
+							depthRow[x] = depth;
+							uint32_t r = static_cast<uint32_t>(b0 * tri.rgb[0][0] + b1 * tri.rgb[1][0] + b2 * tri.rgb[2][0]);
+							uint32_t g = static_cast<uint32_t>(b0 * tri.rgb[0][1] + b1 * tri.rgb[1][1] + b2 * tri.rgb[2][1]);
+							uint32_t b = static_cast<uint32_t>(b0 * tri.rgb[0][2] + b1 * tri.rgb[1][2] + b2 * tri.rgb[2][2]);
+							colorRow[x] = (std::min(r, 255u) << 16) | (std::min(g, 255u) << 8) | std::min(b, 255u);
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//! EDL-like shading (single scale version of the qEDL 'edl_shade' shader)
+	void ApplyEDL(FrameBuffer& fb, float strength, bool perspective)
+	{
+		//depth range
+		float zMin = std::numeric_limits<float>::infinity();
+		float zMax = -std::numeric_limits<float>::infinity();
+		for (float d : fb.depth)
+		{
+			if (std::isfinite(d))
+			{
+				zMin = std::min(zMin, d);
+				zMax = std::max(zMax, d);
+			}
+		}
+		if (!(zMin < zMax))
+		{
+			return;
+		}
+
+		//normalized 'height' (1 = closest, 0 = background) as in the shader
+		std::vector<float> heights;
+		try
+		{
+			heights.resize(fb.depth.size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory to apply the EDL shading");
+			return;
+		}
+		float invRange = 1.0f / (zMax - zMin);
+		for (size_t i = 0; i < fb.depth.size(); ++i)
+		{
+			float d = fb.depth[i];
+			heights[i] = (std::isfinite(d) ? std::min(1.0f, std::max(0.0f, 1.0f - (d - zMin) * invRange)) : 0.0f);
+		}
+
+		//8 neighbors
+		const double neighborDist = (perspective ? 3.0 : 1.2);
+		int neighbors[8][2];
+		for (int c = 0; c < 8; ++c)
+		{
+			neighbors[c][0] = static_cast<int>(std::lround(neighborDist * std::cos(c * M_PI / 4.0)));
+			neighbors[c][1] = static_cast<int>(std::lround(neighborDist * std::sin(c * M_PI / 4.0)));
+		}
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int y = 0; y < fb.height; ++y)
+		{
+			for (int x = 0; x < fb.width; ++x)
+			{
+				size_t index = static_cast<size_t>(y) * fb.width + x;
+				float h = heights[index];
+				if (h <= 0.001f)
+				{
+					continue;
+				}
+
+				float sum = 0.0f;
+				for (int c = 0; c < 8; ++c)
+				{
+					int nx = x + neighbors[c][0];
+					int ny = y + neighbors[c][1];
+					float hn = (nx >= 0 && ny >= 0 && nx < fb.width && ny < fb.height ? heights[static_cast<size_t>(ny) * fb.width + nx] : 0.0f);
+					sum += std::max(0.0f, hn - h);
+				}
+
+				float f = std::exp(-strength * sum);
+				uint32_t rgb = fb.color[index];
+				uint32_t r = static_cast<uint32_t>(f * ((rgb >> 16) & 0xFF));
+				uint32_t g = static_cast<uint32_t>(f * ((rgb >> 8) & 0xFF));
+				uint32_t b = static_cast<uint32_t>(f * (rgb & 0xFF));
+				fb.color[index] = (r << 16) | (g << 8) | b;
+			}
+		}
+	}
+
+	void CollectEntities(ccHObject* scene, std::vector<ccGenericPointCloud*>& clouds, std::vector<ccGenericMesh*>& meshes)
+	{
+		ccHObject::Container entities;
+		entities.push_back(scene);
+		scene->filterChildren(entities, true, CC_TYPES::POINT_CLOUD, false);
+		scene->filterChildren(entities, true, CC_TYPES::MESH, false);
+
+		for (ccHObject* entity : entities)
+		{
+			if (!IsDisplayed(entity))
+			{
+				continue;
+			}
+			if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
+			{
+				ccGenericPointCloud* cloud = ccHObjectCaster::ToGenericPointCloud(entity);
+				//the vertices of a mesh are only rendered if they are explicitly displayed
+				if (cloud && std::find(clouds.begin(), clouds.end(), cloud) == clouds.end())
+				{
+					clouds.push_back(cloud);
+				}
+			}
+			else if (entity->isKindOf(CC_TYPES::MESH))
+			{
+				ccGenericMesh* mesh = ccHObjectCaster::ToGenericMesh(entity);
+				if (mesh && std::find(meshes.begin(), meshes.end(), mesh) == meshes.end())
+				{
+					meshes.push_back(mesh);
+				}
+			}
+		}
+	}
+}
+
+ccBBox ccSoftwareRenderer::ComputeVisibleBB(ccHObject* scene)
+{
+	ccBBox box;
+	if (!scene)
+	{
+		return box;
+	}
+
+	std::vector<ccGenericPointCloud*> clouds;
+	std::vector<ccGenericMesh*> meshes;
+	CollectEntities(scene, clouds, meshes);
+
+	for (ccGenericPointCloud* cloud : clouds)
+	{
+		box += cloud->getDisplayBB_recursive(false);
+	}
+	for (ccGenericMesh* mesh : meshes)
+	{
+		box += mesh->getDisplayBB_recursive(false);
+	}
+
+	return box;
+}
+
+void ccSoftwareRenderer::FitViewport(ccViewportParameters& viewport, const ccBBox& box, int width, int height)
+{
+	if (!box.isValid() || width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	double bbDiag = box.getDiagNormd();
+	if (CCCoreLib::LessThanEpsilon(bbDiag))
+	{
+		bbDiag = 1.0;
+	}
+
+	//we set the pivot point on the box center
+	CCVector3d P = box.getCenter();
+	viewport.setPivotPoint(P, false);
+
+	//compute the right distance for the camera to see the whole bounding-box
+	double targetWidth = bbDiag;
+	if (height < width)
+	{
+		targetWidth *= static_cast<double>(width) / height;
+	}
+	double focalDistance = targetWidth / viewport.computeDistanceToWidthRatio();
+
+	//set the camera position
+	CCVector3d v(0, 0, focalDistance);
+	if (!viewport.objectCenteredView)
+	{
+		viewport.viewMat.transposed().applyRotation(v);
+	}
+	viewport.setCameraCenter(P + v, false);
+	viewport.setFocalDistance(focalDistance);
+}
+
+bool ccSoftwareRenderer::Render(ccHObject* scene, const Parameters& params, QImage& image)
+{
+	if (!scene || params.width <= 0 || params.height <= 0 || params.tileSize <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	std::vector<ccGenericPointCloud*> clouds;
+	std::vector<ccGenericMesh*> meshes;
+	CollectEntities(scene, clouds, meshes);
+
+	//camera
+	const ccViewportParameters& viewport = params.viewport;
+	Camera camera;
+	{
+		camera.width = params.width;
+		camera.height = params.height;
+		camera.perspective = viewport.perspectiveView;
+		camera.viewMat = viewport.computeViewMatrix();
+
+		//same aspect ratio handling as ccGLWindowInterface
+		double scale = static_cast<double>(params.width) / (params.height * viewport.cameraAspectRatio);
+		if (scale < 1.0)
+		{
+			ccGLMatrixd scaleMat;
+			scaleMat.toIdentity();
+			scaleMat.data()[0] = scale;
+			scaleMat.data()[5] = scale;
+			camera.viewMat = scaleMat * camera.viewMat;
+		}
+
+		double ar = static_cast<double>(params.height) / params.width;
+		double halfWidthRatio = viewport.computeDistanceToHalfWidthRatio();
+		if (camera.perspective)
+		{
+			camera.xMaxRatio = halfWidthRatio;
+			camera.zNear = std::max(viewport.zNearCoef * std::abs(viewport.getFocalDistance()), 1.0e-6);
+		}
+		else
+		{
+			camera.xMaxRatio = std::abs(viewport.getFocalDistance()) * halfWidthRatio;
+		}
+		camera.yMaxRatio = camera.xMaxRatio * ar;
+	}
+
+	//frame buffer
+	FrameBuffer fb;
+	fb.width = params.width;
+	fb.height = params.height;
+	fb.tileSize = params.tileSize;
+	fb.tileCountX = (params.width + params.tileSize - 1) / params.tileSize;
+	fb.tileCountY = (params.height + params.tileSize - 1) / params.tileSize;
+	try
+	{
+		size_t pixelCount = static_cast<size_t>(params.width) * params.height;
+		fb.depth.resize(pixelCount, std::numeric_limits<float>::infinity());
+		fb.color.resize(pixelCount, PackRGB(ccColor::Rgb(params.backgroundColor.r, params.backgroundColor.g, params.backgroundColor.b)));
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+		return false;
+	}
+
+	int pointSize = (params.pointSize > 0 ? params.pointSize : std::max(1, static_cast<int>(viewport.defaultPointSize)));
+	for (ccGenericPointCloud* cloud : clouds)
+	{
+		if (!RenderCloud(cloud, camera, pointSize, fb))
+		{
+			return false;
+		}
+	}
+	for (ccGenericMesh* mesh : meshes)
+	{
+		if (!RenderMesh(mesh, camera, fb))
+		{
+			return false;
+		}
+	}
+
+	if (params.edl)
+	{
+		ApplyEDL(fb, params.edlStrength, camera.perspective);
+	}
+
+	image = QImage(params.width, params.height, QImage::Format_RGB32);
+	if (image.isNull())
+	{
+		ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+		return false;
+	}
+	for (int y = 0; y < params.height; ++y)
+	{
+		QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+		const uint32_t* colorRow = fb.color.data() + static_cast<size_t>(y) * params.width;
+		for (int x = 0; x < params.width; ++x)
+		{
+			line[x] = 0xFF000000 | colorRow[x];
+		}
+	}
+
+	return true;
+}
@@ -5,6 +5,14 @@
 #include <QFile>
 #include <QTextStream>
 
+//system
+#include <cstring>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 WaveformDescriptor::WaveformDescriptor()
 	: numberOfSamples(0)
 	, samplingRate_ps(0)
@@ -100,11 +108,9 @@ uint32_t ccWaveform::getRawSample(uint32_t i, const WaveformDescriptor& descript
 
 	case 24:
 	{
-		uint32_t v = *reinterpret_cast<const uint32_t*>(_data + 3 * i);
-		//'hide' the 4th byte
-		static const uint32_t Byte4Mask = 0x0FFF;
-		v &= Byte4Mask;
-		return v;
+		//DGM: we can't read 4 bytes at once (we could read past the end of the buffer)
+		const uint8_t* v = _data + 3 * i;
+		return static_cast<uint32_t>(v[0]) | (static_cast<uint32_t>(v[1]) << 8) | (static_cast<uint32_t>(v[2]) << 16);
 	}
 
 	case 32:
@@ -127,8 +133,8 @@ uint32_t ccWaveform::getRawSample(uint32_t i, const WaveformDescriptor& descript
 		uint32_t value = _data[lastByteIndex];
 		{
 			//number of bits used in the current byte
-			uint32_t r = ((lastByteIndex + 1) % 8);
-			if (r != 0)
+			uint32_t r = ((lastBitIndex & 7) + 1);
+			if (r != 8)
 			{
 				//we keep only the used bits
 				value &= ((1 << r) - 1);
@@ -187,6 +193,127 @@ bool ccWaveform::decodeSamples(std::vector<double>& values, const WaveformDescri
 	return true;
 }
 
+bool ccWaveform::decodeSamples(float* values, const WaveformDescriptor& descriptor, const uint8_t* dataStorage) const
+{
+	if (!values || !dataStorage)
+	{
+		assert(false);
+		return false;
+	}
+
+	const uint8_t* _data = data(dataStorage);
+	const float gain = static_cast<float>(descriptor.digitizerGain);
+	const float offset = static_cast<float>(descriptor.digitizerOffset);
+
+	//number of samples actually stored in the packet
+	uint32_t count = descriptor.numberOfSamples;
+	if (descriptor.bitsPerSample != 0)
+	{
+		uint64_t storedCount = (static_cast<uint64_t>(m_byteCount) * 8) / descriptor.bitsPerSample;
+		if (storedCount < count)
+		{
+			//missing samples are considered as null (raw) values
+			for (uint32_t i = static_cast<uint32_t>(storedCount); i < count; ++i)
+			{
+				values[i] = offset;
+			}
+			count = static_cast<uint32_t>(storedCount);
+		}
+	}
+
+	switch (descriptor.bitsPerSample)
+	{
+	case 8:
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			values[i] = gain * _data[i] + offset;
+		}
+	}
+	break;
+
+	case 12:
+	{
+		//2 samples are packed in 3 bytes
+		uint32_t pairCount = (count >> 1);
+		for (uint32_t k = 0; k < pairCount; ++k)
+		{
+			const uint8_t* b = _data + 3 * k;
+			uint32_t s0 = static_cast<uint32_t>(b[0]) | ((static_cast<uint32_t>(b[1]) & 0x0F) << 8);
+			uint32_t s1 = (static_cast<uint32_t>(b[1]) >> 4) | (static_cast<uint32_t>(b[2]) << 4);
+			values[2 * k] = gain * s0 + offset;
+			values[2 * k + 1] = gain * s1 + offset;
+		}
+		if (count & 1)
+		{
+			values[count - 1] = gain * getRawSample(count - 1, descriptor, dataStorage) + offset;
+		}
+	}
+	break;
+
+	case 16:
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint16_t v;
+			memcpy(&v, _data + 2 * i, 2); //the data is not necessarily aligned
+			values[i] = gain * v + offset;
+		}
+	}
+	break;
+
+	default:
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			values[i] = gain * getRawSample(i, descriptor, dataStorage) + offset;
+		}
+	}
+	break;
+	}
+
+	return true;
+}
+
+bool ccWaveformProxy::DecodeBatch(const std::vector<ccWaveformProxy>& proxies, std::vector<float>& samples, std::vector<size_t>& offsets)
+{
+	try
+	{
+		offsets.resize(proxies.size() + 1);
+		size_t totalCount = 0;
+		for (size_t i = 0; i < proxies.size(); ++i)
+		{
+			offsets[i] = totalCount;
+			if (proxies[i].isValid())
+			{
+				totalCount += proxies[i].numberOfSamples();
+			}
+		}
+		offsets.back() = totalCount;
+
+		samples.resize(totalCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	int proxyCount = static_cast<int>(proxies.size());
+#if defined(_OPENMP)
+	#pragma omp parallel for schedule(dynamic, 256)
+#endif
+	for (int i = 0; i < proxyCount; ++i)
+	{
+		if (offsets[i + 1] != offsets[i])
+		{
+			proxies[i].decodeSamples(samples.data() + offsets[i]);
+		}
+	}
+
+	return true;
+}
+
 bool ccWaveform::toASCII(const QString& filename, const WaveformDescriptor& descriptor, const uint8_t* dataStorage) const
 {
 	if (descriptor.numberOfSamples == 0)
@@ -0,0 +1,303 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "ccWaveformPager.h"
+
+//Local
+#include "ccLog.h"
+
+//Qt
+#include <QFileInfo>
+#include <QIODevice>
+
+//system
+#include <algorithm>
+#include <cassert>
+
+//! Size above which FWF data is paged instead of being loaded in memory
+static uint64_t s_inMemoryThreshold = (static_cast<uint64_t>(1) << 31); //2 Gb
+
+void ccWaveformPager::SetInMemoryThreshold(uint64_t bytes)
+{
+	s_inMemoryThreshold = bytes;
+}
+
+uint64_t ccWaveformPager::InMemoryThreshold()
+{
+	return s_inMemoryThreshold;
+}
+
+ccWaveformPager::ccWaveformPager(uint64_t cacheSize/*=DefaultCacheSize*/, uint32_t pageSize/*=DefaultPageSize*/)
+	: m_size(0)
+	, m_pageSize(std::max<uint32_t>(pageSize, 1024))
+	, m_cacheSize(cacheSize)
+	, m_cachedBytes(0)
+{
+}
+
+ccWaveformPager::ccWaveformPager(const QString& filename, uint64_t fileOffset, uint64_t size, uint64_t cacheSize/*=DefaultCacheSize*/, uint32_t pageSize/*=DefaultPageSize*/)
+	: ccWaveformPager(cacheSize, pageSize)
+{
+	addSegment(filename, fileOffset, size);
+}
+
+bool ccWaveformPager::addSegment(const QString& filename, uint64_t fileOffset, uint64_t size)
+{
+	QFileInfo fi(filename);
+	if (!fi.exists() || static_cast<uint64_t>(fi.size()) < fileOffset + size)
+	{
+		ccLog::Warning(QString("[ccWaveformPager] File '%1' is missing or too small").arg(filename));
+		return false;
+	}
+
+	QMutexLocker locker(&m_mutex);
+
+	try
+	{
+		m_segments.push_back({ fi.absoluteFilePath(), fileOffset, size });
+		m_files.emplace_back();
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccWaveformPager] Not enough memory");
+		return false;
+	}
+	m_size += size;
+
+	return true;
+}
+
+bool ccWaveformPager::append(const ccWaveformPager& other)
+{
+	for (const Segment& s : other.segments())
+	{
+		if (!addSegment(s.filename, s.fileOffset, s.size))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ccWaveformPager::usesFile(const QString& filename) const
+{
+	QString absFilename = QFileInfo(filename).absoluteFilePath();
+	for (const Segment& s : m_segments)
+	{
+		if (s.filename == absFilename)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+QFile* ccWaveformPager::segmentFile(size_t segmentIndex) const
+{
+	assert(segmentIndex < m_files.size());
+	std::unique_ptr<QFile>& file = m_files[segmentIndex];
+	if (!file)
+	{
+		file.reset(new QFile(m_segments[segmentIndex].filename));
+		if (!file->open(QFile::ReadOnly))
+		{
+			ccLog::Warning(QString("[ccWaveformPager] Failed to open file '%1': %2").arg(file->fileName(), file->errorString()));
+			file.reset();
+			return nullptr;
+		}
+	}
+
+	return file.get();
+}
+
+bool ccWaveformPager::readUnsafe(uint64_t offset, uint64_t byteCount, uint8_t* dest) const
+{
+	if (offset + byteCount > m_size)
+	{
+		assert(false);
+		return false;
+	}
+
+	uint64_t segmentStart = 0;
+	for (size_t i = 0; i < m_segments.size() && byteCount != 0; ++i)
+	{
+		const Segment& s = m_segments[i];
+		uint64_t segmentEnd = segmentStart + s.size;
+		if (offset < segmentEnd)
+		{
+			uint64_t localOffset = offset - segmentStart;
+			uint64_t count = std::min(byteCount, s.size - localOffset);
+
+			QFile* file = segmentFile(i);
+			if (!file || !file->seek(static_cast<qint64>(s.fileOffset + localOffset)))
+			{
+				return false;
+			}
+			if (file->read(reinterpret_cast<char*>(dest), static_cast<qint64>(count)) != static_cast<qint64>(count))
+			{
+				ccLog::Warning(QString("[ccWaveformPager] Failed to read file '%1'").arg(s.filename));
+				return false;
+			}
+
+			dest += count;
+			offset += count;
+			byteCount -= count;
+		}
+		segmentStart = segmentEnd;
+	}
+
+	return (byteCount == 0);
+}
+
+bool ccWaveformPager::read(uint64_t offset, uint64_t byteCount, uint8_t* dest) const
+{
+	QMutexLocker locker(&m_mutex);
+	return readUnsafe(offset, byteCount, dest);
+}
+
+ccWaveformPager::Page ccWaveformPager::fetch(uint64_t offset, uint32_t byteCount, uint64_t& pageOffset) const
+{
+	if (offset + byteCount > m_size)
+	{
+		assert(false);
+		return {};
+	}
+
+	uint64_t pageIndex = offset / m_pageSize;
+	uint64_t lastPageIndex = (offset + std::max<uint32_t>(byteCount, 1) - 1) / m_pageSize;
+
+	QMutexLocker locker(&m_mutex);
+
+	if (pageIndex != lastPageIndex)
+	{
+		//the range straddles two pages: we read it directly (no caching)
+		try
+		{
+			std::vector<uint8_t>* data = new std::vector<uint8_t>(byteCount);
+			Page page(data);
+			if (!readUnsafe(offset, byteCount, data->data()))
+			{
+				return {};
+			}
+			pageOffset = offset;
+			return page;
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccWaveformPager] Not enough memory");
+			return {};
+		}
+	}
+
+	pageOffset = pageIndex * m_pageSize;
+
+	auto it = m_cache.find(pageIndex);
+	if (it != m_cache.end())
+	{
+		//move the page at the front of the LRU list
+		m_lru.splice(m_lru.begin(), m_lru, it->lruIt);
+		return it->page;
+	}
+
+	//load the page
+	Page page;
+	try
+	{
+		uint64_t count = std::min<uint64_t>(m_pageSize, m_size - pageOffset);
+		std::vector<uint8_t>* data = new std::vector<uint8_t>(count);
+		page = Page(data);
+		if (!readUnsafe(pageOffset, count, data->data()))
+		{
+			return {};
+		}
+
+		m_lru.push_front(pageIndex);
+		m_cache.insert(pageIndex, { page, m_lru.begin() });
+		m_cachedBytes += count;
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccWaveformPager] Not enough memory");
+		return {};
+	}
+
+	//evict the least recently used pages (they may still be referenced by proxies)
+	while (m_cachedBytes > m_cacheSize && m_lru.size() > 1)
+	{
+		uint64_t lruIndex = m_lru.back();
+		m_lru.pop_back();
+		auto lruIt = m_cache.find(lruIndex);
+		assert(lruIt != m_cache.end());
+		m_cachedBytes -= lruIt->page->size();
+		m_cache.erase(lruIt);
+	}
+
+	return page;
+}
+
+bool ccWaveformPager::copyTo(QIODevice& out, uint64_t offset, uint64_t byteCount) const
+{
+	std::vector<uint8_t> buffer;
+	try
+	{
+		buffer.resize(static_cast<size_t>(std::min<uint64_t>(m_pageSize, byteCount)));
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccWaveformPager] Not enough memory");
+		return false;
+	}
+
+	while (byteCount != 0)
+	{
+		uint64_t count = std::min<uint64_t>(buffer.size(), byteCount);
+		if (!read(offset, count, buffer.data()))
+		{
+			return false;
+		}
+		if (out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(count)) < 0)
+		{
+			return false;
+		}
+		offset += count;
+		byteCount -= count;
+	}
+
+	return true;
+}
+
+void ccWaveformPager::setCacheSize(uint64_t bytes)
+{
+	QMutexLocker locker(&m_mutex);
+	m_cacheSize = bytes;
+}
+
+uint64_t ccWaveformPager::cachedBytes() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_cachedBytes;
+}
+
+void ccWaveformPager::clearCache()
+{
+	QMutexLocker locker(&m_mutex);
+	m_cache.clear();
+	m_lru.clear();
+	m_cachedBytes = 0;
+}
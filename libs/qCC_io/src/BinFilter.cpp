@@ -160,6 +160,25 @@ CC_FILE_ERROR BinFilter::saveToFile(ccHObject* root, const QString& filename, co
 	if (!root || filename.isNull())
 		return CC_FERR_BAD_ARGUMENT;
 
+	//we can't overwrite a file from which some FWF data is paged
+	{
+		ccHObject::Container clouds;
+		root->filterChildren(clouds, true, CC_TYPES::POINT_CLOUD, true);
+		if (root->isA(CC_TYPES::POINT_CLOUD))
+		{
+			clouds.push_back(root);
+		}
+		for (ccHObject* entity : clouds)
+		{
+			ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
+			if (cloud->fwfDataIsPaged() && cloud->fwfPager()->usesFile(filename))
+			{
+				ccLog::Error(QObject::tr("Cloud '%1' waveform data is read from this file: save to another file").arg(cloud->getName()));
+				return CC_FERR_WRITING;
+			}
+		}
+	}
+
 	QFile out(filename);
 	if (!out.open(QIODevice::WriteOnly))
 		return CC_FERR_WRITING;
@@ -1952,8 +1952,8 @@ CC_FILE_ERROR PlyFilter::loadFile(const QString& filename, const QString& inputT
 					ccMaterial::Shared material(new ccMaterial(textureFileName));
 					if (material->loadAndSetTexture(textureFilePath))
 					{
-						const QImage texture = material->getTexture();
-						ccLog::Print(QString("[PLY][Texture] Successfully loaded texture '%1' (%2x%3 pixels)").arg(textureFileName).arg(texture.width()).arg(texture.height()));
+						const QSize textureSize = material->getTextureSize();
+						ccLog::Print(QString("[PLY][Texture] Successfully loaded texture '%1' (%2x%3 pixels)").arg(textureFileName).arg(textureSize.width()).arg(textureSize.height()));
 						material->setDiffuse(ccColor::bright);
 						material->setSpecular(ccColor::darker);
 						material->setAmbient(ccColor::darker);
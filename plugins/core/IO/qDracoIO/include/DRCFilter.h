@@ -31,6 +31,28 @@ public:
 
 	bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const override;
 	CC_FILE_ERROR saveToFile(ccHObject* entity, const QString& filename, const SaveParameters& parameters) override;
+
+	//! Loads a tiled DRC container (*.drct)
+	/** Tiles are decoded concurrently. If a crop box is provided, only the tiles
+		intersecting it are decoded (the box is expressed in global coordinates).
+	**/
+	static CC_FILE_ERROR LoadTiledFile(	const QString& filename,
+										ccHObject& container,
+										LoadParameters& parameters,
+										const CCVector3d* cropMin = nullptr,
+										const CCVector3d* cropMax = nullptr);
+
+	//! Sets the crop box used when loading tiled files with this filter (global coordinates)
+	/** See LoadTiledFile (the box is ignored for standard DRC files).
+	**/
+	void setCropBox(const CCVector3d& minCorner, const CCVector3d& maxCorner);
+
+protected:
+
+	//! Whether a crop box is set
+	bool m_crop;
+	//! Crop box (global coordinates)
+	CCVector3d m_cropMin, m_cropMax;
 };
 
 #endif //CC_DRC_FILTER_HEADER
@@ -0,0 +1,88 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccCommandLineInterface.h"
+
+//Local
+#include "DRCFilter.h"
+
+static const char COMMAND_LOAD_CROPPED_DRC[] = "DRC_CROP";
+
+//! Loads the tiles of a tiled DRC file (*.drct) that intersect a box
+/** Syntax: -DRC_CROP xmin ymin zmin xmax ymax zmax [-GLOBAL_SHIFT ...] filename
+	(the box is expressed in global coordinates)
+**/
+struct CommandLoadCroppedDRC : public ccCommandLineInterface::Command
+{
+	CommandLoadCroppedDRC() : ccCommandLineInterface::Command("Load cropped DRC", COMMAND_LOAD_CROPPED_DRC) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[LOADING CROPPED DRC]");
+
+		//crop box
+		double bounds[6];
+		for (int i = 0; i < 6; ++i)
+		{
+			if (cmd.arguments().empty())
+			{
+				return cmd.error(QString("Missing parameter: crop box (xmin ymin zmin xmax ymax zmax) after \"-%1\"").arg(COMMAND_LOAD_CROPPED_DRC));
+			}
+
+			bool ok = false;
+			bounds[i] = cmd.arguments().takeFirst().toDouble(&ok);
+			if (!ok)
+			{
+				return cmd.error(QString("Invalid crop box after \"-%1\" (6 numbers expected: xmin ymin zmin xmax ymax zmax)").arg(COMMAND_LOAD_CROPPED_DRC));
+			}
+		}
+		CCVector3d cropMin(bounds[0], bounds[1], bounds[2]);
+		CCVector3d cropMax(bounds[3], bounds[4], bounds[5]);
+		if (cropMin.x > cropMax.x || cropMin.y > cropMax.y || cropMin.z > cropMax.z)
+		{
+			return cmd.error("Invalid crop box (min > max)");
+		}
+
+		ccCommandLineInterface::GlobalShiftOptions globalShiftOptions;
+		if (cmd.nextCommandIsGlobalShift())
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			if (!cmd.processGlobalShiftCommand(globalShiftOptions))
+			{
+				//error message already issued
+				return false;
+			}
+		}
+
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: filename after \"-%1\"").arg(COMMAND_LOAD_CROPPED_DRC));
+		}
+		QString filename(cmd.arguments().takeFirst());
+
+		//dedicated filter instance (with the crop box)
+		DRCFilter* drcFilter = new DRCFilter;
+		drcFilter->setCropBox(cropMin, cropMax);
+		FileIOFilter::Shared filter(drcFilter);
+
+		return cmd.importFile(filename, globalShiftOptions, filter);
+	}
+};
@@ -19,6 +19,7 @@
 #include "../include/SaveDracoFileDlg.h"
 
 //qCC_db
+#include <ccHObjectCaster.h>
 #include <ccLog.h>
 #include <ccPointCloud.h>
 #include <ccScalarField.h>
@@ -26,6 +27,11 @@
 
 //CCCoreLib
 #include <CCPlatform.h>
+#include <ReferenceCloud.h>
+
+//Qt
+#include <QDataStream>
+#include <QFileInfo>
 
 //draco
 #include <draco/compression/decode.h>
@@ -33,17 +39,79 @@
 #include <draco/mesh/mesh.h>
 #include <draco/point_cloud/point_cloud.h>
 
+//system
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+//! Tiled DRC container signature
+static const char s_tiledSignature[8] = { 'C', 'C', 'D', 'R', 'C', 'T', 'I', 'L' };
+//! Tiled DRC container version
+static const quint32 s_tiledVersion = 1;
+//! Target number of elements (points or triangles) per tile (when the tile size is automatic)
+static const unsigned s_targetElementsPerTile = (1 << 20);
+//! Maximum number of cells of the tiling grid
+static const quint64 s_maxTileGridCells = (1 << 16);
+//! Maximum size of an encoded tile (in bytes, the tiles are read and written in one go)
+static const size_t s_maxTileBytes = static_cast<size_t>(std::numeric_limits<int>::max());
+
+//! Tile of a tiled DRC container
+/** The container starts with a header (signature, version, geometry type, whether the
+	coordinates are global, and the number of tiles), followed by the index of the tiles
+	(see below) and by the tiles themselves (standard Draco buffers).
+**/
+struct DracoTile
+{
+	//! Bounding box (global coordinates)
+	CCVector3d minCorner, maxCorner;
+	//! Number of points (or vertices)
+	quint32 pointCount = 0;
+	//! Number of faces (meshes only)
+	quint32 faceCount = 0;
+	//! Position of the encoded tile in the file
+	quint64 offset = 0;
+	//! Size of the encoded tile (in bytes)
+	quint64 size = 0;
+};
+
+//! Size of the tiled DRC container header (in bytes)
+static const quint64 s_tiledHeaderSize = sizeof(s_tiledSignature) + 4 + 1 + 1 + 4;
+//! Size of an entry of the tiled DRC container index (in bytes)
+static const quint64 s_tiledIndexEntrySize = 6 * 8 + 4 + 4 + 8 + 8;
+
+static bool IsTiledFile(const QString& filename)
+{
+	return (QFileInfo(filename).suffix().compare("drct", Qt::CaseInsensitive) == 0);
+}
+
 DRCFilter::DRCFilter()
     : FileIOFilter( {
                     "_Draco DRC Filter",
                     12.0f,	// priority
-                    QStringList{ "drc" },
+                    QStringList{ "drc", "drct" },
                     "drc",
-                    QStringList{ "DRC cloud or mesh (*.drc)" },
-                    QStringList{ "DRC cloud or mesh (*.drc)" },
+                    QStringList{ "DRC cloud or mesh (*.drc)", "Tiled DRC cloud or mesh (*.drct)" },
+                    QStringList{ "DRC cloud or mesh (*.drc)", "Tiled DRC cloud or mesh (*.drct)" },
                     Import | Export
                     } )
+	, m_crop(false)
+	, m_cropMin(0, 0, 0)
+	, m_cropMax(0, 0, 0)
+{
+}
+
+void DRCFilter::setCropBox(const CCVector3d& minCorner, const CCVector3d& maxCorner)
 {
+	m_crop = true;
+	m_cropMin = minCorner;
+	m_cropMax = maxCorner;
 }
 
 bool DRCFilter::canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const
@@ -58,9 +126,10 @@ bool DRCFilter::canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) con
 	return false;
 }
 
-static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::PointCloud& dracoCloud)
+//! Converts a cloud (or a subset of it if 'indexes' is not null) to a Draco cloud
+static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::PointCloud& dracoCloud, const std::vector<unsigned>* indexes = nullptr)
 {
-	unsigned pointCount = ccCloud.size();
+	unsigned pointCount = (indexes ? static_cast<unsigned>(indexes->size()) : ccCloud.size());
 	dracoCloud.set_num_points(pointCount);
 
 	draco::DataType dt = draco::DT_FLOAT32;
@@ -86,14 +155,14 @@ static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::P
 		{
 			for (draco::PointIndex::ValueType i = 0; i < pointCount; ++i)
 			{
-				pointAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPoint(i)->u);
+				pointAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPoint(indexes ? (*indexes)[i] : i)->u);
 			}
 		}
 		else //draco::DT_FLOAT64
 		{
 			for (draco::PointIndex::ValueType i = 0; i < pointCount; ++i)
 			{
-				CCVector3 Plocal = *(ccCloud.getPoint(i));
+				CCVector3 Plocal = *(ccCloud.getPoint(indexes ? (*indexes)[i] : i));
 				pointAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.toGlobal3d(Plocal).u);
 			}
 		}
@@ -111,7 +180,7 @@ static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::P
 		{
 			for (draco::PointIndex::ValueType i = 0; i < pointCount; ++i)
 			{
-				normalAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPointNormal(i).u);
+				normalAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPointNormal(indexes ? (*indexes)[i] : i).u);
 			}
 		}
 		else
@@ -132,7 +201,7 @@ static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::P
 		{
 			for (draco::PointIndex::ValueType i = 0; i < pointCount; ++i)
 			{
-				colorAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPointColor(i).rgba);
+				colorAttribute->SetAttributeValue(draco::AttributeValueIndex(i), ccCloud.getPointColor(indexes ? (*indexes)[i] : i).rgba);
 			}
 		}
 		else
@@ -144,16 +213,6 @@ static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::P
 	// create generic attribute (if any)
 	if (ccCloud.hasScalarFields())
 	{
-		if (ccCloud.isA(CC_TYPES::POINT_CLOUD))
-		{
-			const ccPointCloud& cc = static_cast<const ccPointCloud&>(ccCloud);
-			// DGM: it seems DRACO supports only one "Generic" field
-			if (cc.getNumberOfScalarFields() > 1)
-			{
-				ccLog::Warning("[DRACO] Cloud %1 has multiple scalar fields, however, only one can be saved (the active one by default)");
-			}
-		}
-
 		draco::GeometryAttribute ga;
 		ga.Init(draco::GeometryAttribute::GENERIC, nullptr, 1, draco::DT_FLOAT32, false, DataTypeLength(draco::DT_FLOAT32), 0);
 		const int sfAttributeID = dracoCloud.AddAttribute(ga, true, pointCount);
@@ -163,7 +222,7 @@ static CC_FILE_ERROR CCCloudToDraco(const ccGenericPointCloud& ccCloud, draco::P
 		{
 			for (draco::PointIndex::ValueType i = 0; i < pointCount; ++i)
 			{
-				float sfValue = ccCloud.getPointScalarValue(i);
+				float sfValue = ccCloud.getPointScalarValue(indexes ? (*indexes)[i] : i);
 				sfAttribute->SetAttributeValue(draco::AttributeValueIndex(i), &sfValue);
 			}
 		}
@@ -269,6 +328,379 @@ static CC_FILE_ERROR CCMeshToDraco(ccGenericMesh& ccMesh, draco::Mesh& dracoMesh
 	return CC_FERR_NO_ERROR;
 }
 
+//! Draco quantization parameters
+struct DracoQuantization
+{
+	int coords = 11;
+	int texCoords = 10;
+	int normals = 8;
+	int sf = 8;
+};
+
+static void InitEncoder(draco::Encoder& encoder, const DracoQuantization& quantization)
+{
+	encoder.SetSpeedOptions(0, 0);
+	encoder.SetAttributeQuantization(draco::GeometryAttribute::POSITION, quantization.coords);
+	encoder.SetAttributeQuantization(draco::GeometryAttribute::TEX_COORD, quantization.texCoords);
+	encoder.SetAttributeQuantization(draco::GeometryAttribute::NORMAL, quantization.normals);
+	encoder.SetAttributeQuantization(draco::GeometryAttribute::GENERIC, quantization.sf);
+}
+
+//! Computes the dimensions of the tiling grid
+static quint64 TileGridDimensions(const CCVector3d& extents, double tileSize, unsigned gridDim[3])
+{
+	quint64 cellCount = 1;
+	for (unsigned d = 0; d < 3; ++d)
+	{
+		double dim = std::ceil(extents.u[d] / tileSize);
+		gridDim[d] = (dim > 1.0 ? static_cast<unsigned>(std::min(dim, static_cast<double>(s_maxTileGridCells))) : 1);
+		cellCount *= gridDim[d];
+	}
+	return cellCount;
+}
+
+//! Returns a tile size so that each tile contains roughly s_targetElementsPerTile elements (for a uniform density)
+static double AutoTileSize(const CCVector3d& extents, unsigned elementCount)
+{
+	double tileSize = std::max(std::max(extents.x, extents.y), extents.z);
+	if (tileSize <= 0)
+	{
+		return 1.0;
+	}
+
+	quint64 targetTileCount = std::min<quint64>(elementCount / s_targetElementsPerTile + 1, s_maxTileGridCells);
+	unsigned gridDim[3];
+	while (TileGridDimensions(extents, tileSize, gridDim) < targetTileCount)
+	{
+		tileSize /= 2;
+	}
+
+	return tileSize;
+}
+
+//! Encodes a tile of a cloud or a mesh
+/** For meshes, the tile contains the triangles whose barycenter lies inside it, and all their vertices
+	(the vertices shared by several tiles are duplicated). Their original index is stored in an additional
+	generic attribute, so that they can be merged when loading.
+**/
+static CC_FILE_ERROR EncodeTile(const ccGenericPointCloud& cloud,
+								ccGenericMesh* mesh,
+								const std::vector<unsigned>& elements,
+								const DracoQuantization& quantization,
+								DracoTile& tile,
+								draco::EncoderBuffer& buffer)
+{
+	draco::Encoder encoder;
+	InitEncoder(encoder, quantization);
+
+	std::vector<unsigned> pointIndexes;
+	if (mesh)
+	{
+		unsigned faceCount = static_cast<unsigned>(elements.size());
+
+		draco::Mesh dracoMesh;
+		dracoMesh.SetNumFaces(faceCount);
+
+		// save triangles (with local vertex indexes)
+		std::unordered_map<unsigned, unsigned> localIndexes;
+		for (unsigned i = 0; i < faceCount; ++i)
+		{
+			const CCCoreLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(elements[i]);
+			draco::Mesh::Face face;
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				auto it = localIndexes.emplace(tri->i[j], static_cast<unsigned>(pointIndexes.size()));
+				if (it.second)
+				{
+					pointIndexes.push_back(tri->i[j]);
+				}
+				face[j] = it.first->second;
+			}
+			dracoMesh.SetFace(draco::FaceIndex(i), face);
+		}
+
+		// save vertices
+		CC_FILE_ERROR error = CCCloudToDraco(cloud, dracoMesh, &pointIndexes);
+		if (error != CC_FERR_NO_ERROR)
+		{
+			return error;
+		}
+
+		// save the original vertex indexes
+		unsigned vertexCount = static_cast<unsigned>(pointIndexes.size());
+		draco::GeometryAttribute ga;
+		ga.Init(draco::GeometryAttribute::GENERIC, nullptr, 1, draco::DT_UINT32, false, DataTypeLength(draco::DT_UINT32), 0);
+		const int indexAttributeID = dracoMesh.AddAttribute(ga, true, vertexCount);
+		// retrieve it
+		draco::PointAttribute* indexAttribute = dracoMesh.attribute(indexAttributeID);
+		if (nullptr == indexAttribute)
+		{
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+		for (draco::PointIndex::ValueType i = 0; i < vertexCount; ++i)
+		{
+			uint32_t index = pointIndexes[i];
+			indexAttribute->SetAttributeValue(draco::AttributeValueIndex(i), &index);
+		}
+
+		if (!encoder.EncodeMeshToBuffer(dracoMesh, &buffer).ok())
+		{
+			return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+		}
+
+		tile.faceCount = faceCount;
+	}
+	else
+	{
+		draco::PointCloud dracoCloud;
+		CC_FILE_ERROR error = CCCloudToDraco(cloud, dracoCloud, &elements);
+		if (error != CC_FERR_NO_ERROR)
+		{
+			return error;
+		}
+
+		if (!encoder.EncodePointCloudToBuffer(dracoCloud, &buffer).ok())
+		{
+			return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+		}
+	}
+
+	// tile bounding box (tighter than the grid cell)
+	const std::vector<unsigned>& points = (mesh ? pointIndexes : elements);
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		CCVector3d P = cloud.toGlobal3d(*cloud.getPoint(points[i]));
+		if (i == 0)
+		{
+			tile.minCorner = tile.maxCorner = P;
+		}
+		else
+		{
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				tile.minCorner.u[d] = std::min(tile.minCorner.u[d], P.u[d]);
+				tile.maxCorner.u[d] = std::max(tile.maxCorner.u[d], P.u[d]);
+			}
+		}
+	}
+	tile.pointCount = static_cast<quint32>(points.size());
+	tile.size = buffer.size();
+
+	return CC_FERR_NO_ERROR;
+}
+
+//! Saves a cloud or a mesh as a tiled DRC container (*.drct)
+/** The entity is split in spatial tiles (regular grid) which are encoded concurrently.
+	\param tileSize tile size (0 = automatic)
+**/
+static CC_FILE_ERROR SaveTiledFile(ccHObject* entity, const QString& filename, const DracoQuantization& quantization, double tileSize)
+{
+	ccGenericMesh* mesh = nullptr;
+	ccGenericPointCloud* cloud = nullptr;
+	if (entity->isKindOf(CC_TYPES::MESH))
+	{
+		mesh = static_cast<ccGenericMesh*>(entity);
+		cloud = mesh->getAssociatedCloud();
+	}
+	else if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
+	{
+		cloud = static_cast<ccGenericPointCloud*>(entity);
+	}
+	else
+	{
+		return CC_FERR_BAD_ENTITY_TYPE;
+	}
+
+	if (!cloud)
+	{
+		assert(false);
+		return CC_FERR_BAD_ARGUMENT;
+	}
+
+	unsigned elementCount = (mesh ? mesh->size() : cloud->size());
+	if (elementCount == 0)
+	{
+		return CC_FERR_NO_SAVE;
+	}
+
+	// tiling grid
+	CCVector3 bbMin, bbMax;
+	cloud->getBoundingBox(bbMin, bbMax);
+	CCVector3d minCorner = cloud->toGlobal3d(bbMin);
+	CCVector3d extents = cloud->toGlobal3d(bbMax) - minCorner;
+
+	if (tileSize <= 0)
+	{
+		tileSize = AutoTileSize(extents, elementCount);
+	}
+	unsigned gridDim[3];
+	if (TileGridDimensions(extents, tileSize, gridDim) > s_maxTileGridCells)
+	{
+		while (TileGridDimensions(extents, tileSize, gridDim) > s_maxTileGridCells)
+		{
+			tileSize *= 2;
+		}
+		ccLog::Warning(QString("[DRACO] Too many tiles, the tile size has been increased to %1").arg(tileSize));
+	}
+
+	// the elements are tiled (again, with a smaller tile size) until all the encoded tiles are small enough
+	int tileCount = 0;
+	std::vector<DracoTile> tiles;
+	std::vector<draco::EncoderBuffer> buffers;
+	std::vector<CC_FILE_ERROR> errors;
+	while (true)
+	{
+		//release the previous attempt (if any)
+		tiles.clear();
+		buffers.clear();
+		errors.clear();
+
+		// assign the elements (points or triangles) to the grid cells
+		std::vector< std::vector<unsigned> > cellElements;
+		try
+		{
+			cellElements.resize(static_cast<size_t>(gridDim[0]) * gridDim[1] * gridDim[2]);
+			for (unsigned i = 0; i < elementCount; ++i)
+			{
+				CCVector3d P;
+				if (mesh)
+				{
+					CCVector3 A, B, C;
+					mesh->getTriangleVertices(i, A, B, C);
+					P = cloud->toGlobal3d((A + B + C) / 3);
+				}
+				else
+				{
+					P = cloud->toGlobal3d(*cloud->getPoint(i));
+				}
+
+				size_t cellIndex = 0;
+				for (int d = 2; d >= 0; --d)
+				{
+					double pos = std::max((P.u[d] - minCorner.u[d]) / tileSize, 0.0);
+					unsigned c = std::min(static_cast<unsigned>(pos), gridDim[d] - 1);
+					cellIndex = cellIndex * gridDim[d] + c;
+				}
+				cellElements[cellIndex].push_back(i);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+
+		// remove the empty cells
+		cellElements.erase(	std::remove_if(cellElements.begin(), cellElements.end(), [](const std::vector<unsigned>& elements) { return elements.empty(); }),
+							cellElements.end());
+
+		// encode the tiles
+		tileCount = static_cast<int>(cellElements.size());
+		try
+		{
+			tiles.resize(tileCount);
+			buffers.resize(tileCount);
+			errors.resize(tileCount, CC_FERR_NO_ERROR);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int i = 0; i < tileCount; ++i)
+		{
+			try
+			{
+				errors[i] = EncodeTile(*cloud, mesh, cellElements[i], quantization, tiles[i], buffers[i]);
+			}
+			catch (const std::bad_alloc&)
+			{
+				errors[i] = CC_FERR_NOT_ENOUGH_MEMORY;
+			}
+			//release memory as soon as possible
+			std::vector<unsigned>().swap(cellElements[i]);
+		}
+
+		for (CC_FILE_ERROR error : errors)
+		{
+			if (error != CC_FERR_NO_ERROR)
+			{
+				return error;
+			}
+		}
+
+		size_t largestTileBytes = 0;
+		for (const draco::EncoderBuffer& buffer : buffers)
+		{
+			largestTileBytes = std::max(largestTileBytes, buffer.size());
+		}
+		if (largestTileBytes <= s_maxTileBytes)
+		{
+			break;
+		}
+
+		tileSize /= 2;
+		if (TileGridDimensions(extents, tileSize, gridDim) > s_maxTileGridCells)
+		{
+			ccLog::Warning("[DRACO] Some tiles are too large (> 2 GB) and the tile size can't be decreased anymore");
+			return CC_FERR_NO_SAVE;
+		}
+		ccLog::Warning(QString("[DRACO] Some tiles are too large (> 2 GB), the tile size has been decreased to %1").arg(tileSize));
+	}
+
+	// write the container
+	QFile file(filename);
+	if (!file.open(QFile::WriteOnly))
+	{
+		return CC_FERR_WRITING;
+	}
+
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+	// header
+	stream.writeRawData(s_tiledSignature, sizeof(s_tiledSignature));
+	stream << s_tiledVersion;
+	stream << static_cast<quint8>(mesh ? 1 : 0);
+	stream << static_cast<quint8>(cloud->isShifted() ? 1 : 0); //whether the coordinates are global
+	stream << static_cast<quint32>(tileCount);
+
+	// index
+	quint64 offset = s_tiledHeaderSize + s_tiledIndexEntrySize * tileCount;
+	for (DracoTile& tile : tiles)
+	{
+		tile.offset = offset;
+		offset += tile.size;
+
+		stream << tile.minCorner.x << tile.minCorner.y << tile.minCorner.z;
+		stream << tile.maxCorner.x << tile.maxCorner.y << tile.maxCorner.z;
+		stream << tile.pointCount << tile.faceCount;
+		stream << tile.offset << tile.size;
+	}
+
+	// tiles
+	for (const draco::EncoderBuffer& buffer : buffers)
+	{
+		assert(buffer.size() <= s_maxTileBytes);
+		if (stream.writeRawData(buffer.data(), static_cast<int>(buffer.size())) != static_cast<int>(buffer.size()))
+		{
+			return CC_FERR_WRITING;
+		}
+	}
+
+	if (stream.status() != QDataStream::Ok)
+	{
+		return CC_FERR_WRITING;
+	}
+
+	ccLog::Print(QString("[DRACO] %1 tile(s) saved (tile size: %2)").arg(tileCount).arg(tileSize));
+
+	return CC_FERR_NO_ERROR;
+}
+
 CC_FILE_ERROR DRCFilter::saveToFile(ccHObject* entity, const QString& filename, const SaveParameters& parameters)
 {
 	if (nullptr == entity)
@@ -276,14 +708,8 @@ CC_FILE_ERROR DRCFilter::saveToFile(ccHObject* entity, const QString& filename,
 		assert(false);
 		return CC_FERR_BAD_ARGUMENT;
 	}
-	
-	draco::Encoder encoder;
-	encoder.SetSpeedOptions(0, 0);
 
-	int coordQuantization = 11;
-	int texCoordQuantization = 10;
-	int normalQuantization = 8;
-	int sfQuantization = 8;
+	DracoQuantization quantization;
 
 	// we always create the dialog, even if we don't display it, to retrieve the default values
 	SaveDracoFileDlg drcDialog(parameters.parentWidget);
@@ -295,15 +721,25 @@ CC_FILE_ERROR DRCFilter::saveToFile(ccHObject* entity, const QString& filename,
 		}
 	}
 	
-	coordQuantization = drcDialog.coordsQuantSpinBox->value();
-	//texCoordQuantization = XXX; //not available yet since we don't know how to save the texture!
-	normalQuantization = drcDialog.normQuantSpinBox->value();
-	sfQuantization = drcDialog.sfQuantSpinBox->value();
+	quantization.coords = drcDialog.coordsQuantSpinBox->value();
+	//quantization.texCoords = XXX; //not available yet since we don't know how to save the texture!
+	quantization.normals = drcDialog.normQuantSpinBox->value();
+	quantization.sf = drcDialog.sfQuantSpinBox->value();
+
+	// DGM: it seems DRACO supports only one "Generic" field
+	ccPointCloud* pc = ccHObjectCaster::ToPointCloud(entity);
+	if (pc && pc->getNumberOfScalarFields() > 1)
+	{
+		ccLog::Warning(QString("[DRACO] Cloud %1 has multiple scalar fields, however, only one can be saved (the active one by default)").arg(pc->getName()));
+	}
 
-	encoder.SetAttributeQuantization(draco::GeometryAttribute::POSITION, coordQuantization);
-	encoder.SetAttributeQuantization(draco::GeometryAttribute::TEX_COORD, texCoordQuantization);
-	encoder.SetAttributeQuantization(draco::GeometryAttribute::NORMAL, normalQuantization);
-	encoder.SetAttributeQuantization(draco::GeometryAttribute::GENERIC, sfQuantization);
+	if (IsTiledFile(filename))
+	{
+		return SaveTiledFile(entity, filename, quantization, drcDialog.tileSizeDoubleSpinBox->value());
+	}
+
+	draco::Encoder encoder;
+	InitEncoder(encoder, quantization);
 
 	draco::EncoderBuffer buffer;
 	if (entity->isKindOf(CC_TYPES::MESH))
@@ -355,7 +791,10 @@ CC_FILE_ERROR DRCFilter::saveToFile(ccHObject* entity, const QString& filename,
 	return CC_FERR_NO_ERROR;
 }
 
-static CC_FILE_ERROR LoadCloud(ccPointCloud& ccCloud, const draco::PointCloud& dracoCloud, FileIOFilter::LoadParameters& parameters)
+//! Loads a Draco cloud
+/** \param knownShift global shift to apply (if the caller has already handled it, e.g. for the tiles of a tiled file)
+**/
+static CC_FILE_ERROR LoadCloud(ccPointCloud& ccCloud, const draco::PointCloud& dracoCloud, FileIOFilter::LoadParameters& parameters, const CCVector3d* knownShift = nullptr)
 {
 	if (dracoCloud.num_points() == 0)
 	{
@@ -390,7 +829,7 @@ static CC_FILE_ERROR LoadCloud(ccPointCloud& ccCloud, const draco::PointCloud& d
 	}
 	else if (dt == draco::DT_FLOAT64)
 	{
-		CCVector3d Pshift(0, 0, 0);
+		CCVector3d Pshift = (knownShift ? *knownShift : CCVector3d(0, 0, 0));
 		bool preserveCoordinateShift = true;
 		for (draco::AttributeValueIndex i(0); i < static_cast<uint32_t>(pointAttribute->size()); ++i)
 		{
@@ -398,7 +837,7 @@ static CC_FILE_ERROR LoadCloud(ccPointCloud& ccCloud, const draco::PointCloud& d
 			pointAttribute->GetValue(i, P.u);
 
 			//first point: check for large coordinates
-			if (i == 0)
+			if (i == 0 && !knownShift)
 			{
 				if (FileIOFilter::HandleGlobalShift(P, Pshift, preserveCoordinateShift, parameters))
 				{
@@ -509,6 +948,11 @@ static CC_FILE_ERROR LoadCloud(ccPointCloud& ccCloud, const draco::PointCloud& d
 
 CC_FILE_ERROR DRCFilter::loadFile(const QString& filename, ccHObject& container, LoadParameters& parameters)
 {
+	if (IsTiledFile(filename))
+	{
+		return LoadTiledFile(filename, container, parameters, m_crop ? &m_cropMin : nullptr, m_crop ? &m_cropMax : nullptr);
+	}
+
 	draco::DecoderBuffer buffer;
 
 	QFile file(filename);
@@ -604,3 +1048,412 @@ CC_FILE_ERROR DRCFilter::loadFile(const QString& filename, ccHObject& container,
 
 	return CC_FERR_NO_ERROR;
 }
+
+//! Decodes a tile of a tiled DRC container
+/** \param shift global shift (already handled by the caller)
+	\param[out] cloud decoded cloud (or mesh vertices)
+	\param[out] faces vertex indexes of each triangle (meshes only)
+	\param[out] sourceIndexes original index of each vertex (meshes only)
+**/
+static CC_FILE_ERROR DecodeTile(const QByteArray& data,
+								bool isMesh,
+								const CCVector3d& shift,
+								FileIOFilter::LoadParameters& parameters,
+								ccPointCloud*& cloud,
+								std::vector<unsigned>& faces,
+								std::vector<unsigned>& sourceIndexes)
+{
+	cloud = nullptr;
+
+	draco::DecoderBuffer buffer;
+	buffer.Init(data.constData(), data.size());
+
+	std::unique_ptr<draco::PointCloud> dracoCloud;
+	if (isMesh)
+	{
+		auto resultMesh = draco::Decoder().DecodeMeshFromBuffer(&buffer);
+		if (!resultMesh.ok())
+		{
+			return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+		}
+		dracoCloud = std::move(resultMesh).value();
+	}
+	else
+	{
+		auto resultCloud = draco::Decoder().DecodePointCloudFromBuffer(&buffer);
+		if (!resultCloud.ok())
+		{
+			return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+		}
+		dracoCloud = std::move(resultCloud).value();
+	}
+
+	cloud = new ccPointCloud;
+	CC_FILE_ERROR error = LoadCloud(*cloud, *dracoCloud, parameters, &shift);
+	if (error == CC_FERR_NO_ERROR && isMesh)
+	{
+		const draco::Mesh& dracoMesh = static_cast<const draco::Mesh&>(*dracoCloud);
+		const draco::PointAttribute* pointAttribute = dracoMesh.GetNamedAttribute(draco::GeometryAttribute::POSITION);
+
+		// the original vertex indexes are stored in the (only) integer generic attribute
+		const draco::PointAttribute* indexAttribute = nullptr;
+		for (int i = 0; i < dracoMesh.NumNamedAttributes(draco::GeometryAttribute::GENERIC); ++i)
+		{
+			const draco::PointAttribute* attribute = dracoMesh.GetNamedAttribute(draco::GeometryAttribute::GENERIC, i);
+			if (attribute && attribute->data_type() == draco::DT_UINT32 && attribute->num_components() == 1)
+			{
+				indexAttribute = attribute;
+				break;
+			}
+		}
+
+		if (!pointAttribute || !indexAttribute)
+		{
+			error = CC_FERR_MALFORMED_FILE;
+		}
+		else
+		{
+			faces.resize(3 * static_cast<size_t>(dracoMesh.num_faces()));
+			for (draco::FaceIndex f(0); f < dracoMesh.num_faces(); ++f)
+			{
+				const draco::Mesh::Face& face = dracoMesh.face(f);
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					faces[3 * static_cast<size_t>(f.value()) + j] = pointAttribute->mapped_index(face[j]).value();
+				}
+			}
+
+			sourceIndexes.resize(cloud->size(), 0);
+			for (draco::PointIndex p(0); p < dracoMesh.num_points(); ++p)
+			{
+				uint32_t sourceIndex = 0;
+				indexAttribute->GetValue(indexAttribute->mapped_index(p), &sourceIndex);
+				sourceIndexes[pointAttribute->mapped_index(p).value()] = sourceIndex;
+			}
+		}
+	}
+
+	if (error != CC_FERR_NO_ERROR)
+	{
+		delete cloud;
+		cloud = nullptr;
+	}
+
+	return error;
+}
+
+CC_FILE_ERROR DRCFilter::LoadTiledFile(	const QString& filename,
+										ccHObject& container,
+										LoadParameters& parameters,
+										const CCVector3d* cropMin/*=nullptr*/,
+										const CCVector3d* cropMax/*=nullptr*/)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+	{
+		return CC_FERR_READING;
+	}
+
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+	// header
+	char signature[sizeof(s_tiledSignature)];
+	if (	stream.readRawData(signature, sizeof(signature)) != static_cast<int>(sizeof(signature))
+		||	memcmp(signature, s_tiledSignature, sizeof(signature)) != 0)
+	{
+		return CC_FERR_WRONG_FILE_TYPE;
+	}
+
+	quint32 version = 0;
+	quint8 isMesh = 0;
+	quint8 isGlobal = 0;
+	quint32 tileCount = 0;
+	stream >> version >> isMesh >> isGlobal >> tileCount;
+	if (stream.status() != QDataStream::Ok)
+	{
+		return CC_FERR_MALFORMED_FILE;
+	}
+	if (version > s_tiledVersion)
+	{
+		ccLog::Warning(QString("[DRACO] Unhandled tiled file version (%1)").arg(version));
+		return CC_FERR_WRONG_FILE_TYPE;
+	}
+	if (s_tiledHeaderSize + s_tiledIndexEntrySize * tileCount > static_cast<quint64>(file.size()))
+	{
+		return CC_FERR_MALFORMED_FILE;
+	}
+
+	// index (we only keep the tiles intersecting the crop box)
+	bool crop = (cropMin && cropMax);
+	std::vector<DracoTile> tiles;
+	try
+	{
+		tiles.reserve(tileCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	for (quint32 i = 0; i < tileCount; ++i)
+	{
+		DracoTile tile;
+		stream >> tile.minCorner.x >> tile.minCorner.y >> tile.minCorner.z;
+		stream >> tile.maxCorner.x >> tile.maxCorner.y >> tile.maxCorner.z;
+		stream >> tile.pointCount >> tile.faceCount;
+		stream >> tile.offset >> tile.size;
+		if (tile.size > s_maxTileBytes)
+		{
+			return CC_FERR_MALFORMED_FILE;
+		}
+
+		if (	crop
+			&&	(	tile.minCorner.x > cropMax->x || tile.maxCorner.x < cropMin->x
+				||	tile.minCorner.y > cropMax->y || tile.maxCorner.y < cropMin->y
+				||	tile.minCorner.z > cropMax->z || tile.maxCorner.z < cropMin->z))
+		{
+			continue;
+		}
+
+		tiles.push_back(tile);
+	}
+	if (stream.status() != QDataStream::Ok)
+	{
+		return CC_FERR_MALFORMED_FILE;
+	}
+	if (tiles.empty())
+	{
+		ccLog::Warning("[DRACO] No tile to load");
+		return CC_FERR_NO_LOAD;
+	}
+
+	// read the selected tiles
+	std::vector<QByteArray> buffers;
+	try
+	{
+		buffers.resize(tiles.size());
+		for (size_t i = 0; i < tiles.size(); ++i)
+		{
+			if (!file.seek(static_cast<qint64>(tiles[i].offset)))
+			{
+				return CC_FERR_MALFORMED_FILE;
+			}
+			buffers[i] = file.read(static_cast<qint64>(tiles[i].size));
+			if (static_cast<quint64>(buffers[i].size()) != tiles[i].size)
+			{
+				return CC_FERR_MALFORMED_FILE;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	// the global shift is handled once for all the tiles (the tiles are decoded concurrently)
+	CCVector3d Pshift(0, 0, 0);
+	bool preserveCoordinateShift = true;
+	bool shifted = false;
+	if (isGlobal && FileIOFilter::HandleGlobalShift(tiles.front().minCorner, Pshift, preserveCoordinateShift, parameters))
+	{
+		shifted = true;
+		ccLog::Warning("[DRACO] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
+	}
+
+	// decode the tiles
+	int selectedCount = static_cast<int>(tiles.size());
+	std::vector<ccPointCloud*> tileClouds;
+	std::vector< std::vector<unsigned> > tileFaces, tileSourceIndexes;
+	std::vector<CC_FILE_ERROR> errors;
+	try
+	{
+		tileClouds.resize(selectedCount, nullptr);
+		tileFaces.resize(selectedCount);
+		tileSourceIndexes.resize(selectedCount);
+		errors.resize(selectedCount, CC_FERR_NO_ERROR);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int i = 0; i < selectedCount; ++i)
+	{
+		try
+		{
+			errors[i] = DecodeTile(buffers[i], isMesh != 0, Pshift, parameters, tileClouds[i], tileFaces[i], tileSourceIndexes[i]);
+		}
+		catch (const std::bad_alloc&)
+		{
+			delete tileClouds[i];
+			tileClouds[i] = nullptr;
+			errors[i] = CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+		//release memory as soon as possible
+		buffers[i].clear();
+	}
+
+	CC_FILE_ERROR error = CC_FERR_NO_ERROR;
+	for (CC_FILE_ERROR tileError : errors)
+	{
+		if (tileError != CC_FERR_NO_ERROR)
+		{
+			error = tileError;
+			break;
+		}
+	}
+
+	// merge the tiles
+	ccPointCloud* cloud = nullptr;
+	std::vector<unsigned> tileOffsets;
+	if (error == CC_FERR_NO_ERROR)
+	{
+		unsigned totalPointCount = 0;
+		for (int i = 0; i < selectedCount; ++i)
+		{
+			tileOffsets.push_back(totalPointCount);
+			totalPointCount += tileClouds[i]->size();
+		}
+
+		cloud = tileClouds.front();
+		tileClouds.front() = nullptr;
+		if (cloud->reserve(totalPointCount))
+		{
+			for (int i = 1; i < selectedCount; ++i)
+			{
+				*cloud += tileClouds[i];
+				delete tileClouds[i];
+				tileClouds[i] = nullptr;
+			}
+			if (cloud->size() != totalPointCount)
+			{
+				error = CC_FERR_NOT_ENOUGH_MEMORY;
+			}
+		}
+		else
+		{
+			error = CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+	}
+
+	for (ccPointCloud* tileCloud : tileClouds)
+	{
+		delete tileCloud;
+	}
+
+	if (error != CC_FERR_NO_ERROR)
+	{
+		delete cloud;
+		return error;
+	}
+
+	if (shifted && preserveCoordinateShift)
+	{
+		cloud->setGlobalShift(Pshift);
+	}
+
+	if (!isMesh)
+	{
+		ccLog::Print(QString("[DRACO] Cloud size: %1 (%2/%3 tiles)").arg(cloud->size()).arg(selectedCount).arg(tileCount));
+		cloud->setName("unnamed - Cloud");
+		container.addChild(cloud);
+		return CC_FERR_NO_ERROR;
+	}
+
+	// merge the vertices shared by several tiles (the first occurrence is kept)
+	ccPointCloud* vertices = cloud;
+	std::vector<unsigned> vertexIndexes;
+	unsigned faceCount = 0;
+	try
+	{
+		unsigned maxSourceIndex = 0;
+		for (const std::vector<unsigned>& sourceIndexes : tileSourceIndexes)
+		{
+			for (unsigned index : sourceIndexes)
+			{
+				maxSourceIndex = std::max(maxSourceIndex, index);
+			}
+		}
+		std::vector<int> sourceToVertex(static_cast<size_t>(maxSourceIndex) + 1, -1);
+
+		CCCoreLib::ReferenceCloud keptVertices(cloud);
+		if (!keptVertices.reserve(cloud->size()))
+		{
+			delete cloud;
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+		vertexIndexes.resize(cloud->size());
+
+		unsigned rawIndex = 0;
+		for (int i = 0; i < selectedCount; ++i)
+		{
+			for (unsigned sourceIndex : tileSourceIndexes[i])
+			{
+				if (sourceToVertex[sourceIndex] < 0)
+				{
+					sourceToVertex[sourceIndex] = static_cast<int>(keptVertices.size());
+					keptVertices.addPointIndex(rawIndex);
+				}
+				vertexIndexes[rawIndex++] = static_cast<unsigned>(sourceToVertex[sourceIndex]);
+			}
+			faceCount += static_cast<unsigned>(tileFaces[i].size() / 3);
+		}
+
+		if (keptVertices.size() < cloud->size())
+		{
+			vertices = cloud->partialClone(&keptVertices);
+			delete cloud;
+			cloud = nullptr;
+			if (!vertices)
+			{
+				return CC_FERR_NOT_ENOUGH_MEMORY;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		delete cloud;
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	vertices->setName("vertices");
+
+	ccLog::Print(QString("[DRACO] Mesh size: %1 / vertex count: %2 (%3/%4 tiles)").arg(faceCount).arg(vertices->size()).arg(selectedCount).arg(tileCount));
+
+	ccMesh* mesh = new ccMesh(vertices);
+	mesh->addChild(vertices);
+	vertices->setVisible(false);
+	if (vertices->hasNormals())
+	{
+		mesh->showNormals(true);
+	}
+	if (vertices->hasColors())
+	{
+		mesh->showColors(true);
+	}
+
+	if (!mesh->reserve(faceCount))
+	{
+		delete mesh;
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	// load faces
+	for (int i = 0; i < selectedCount; ++i)
+	{
+		const std::vector<unsigned>& faces = tileFaces[i];
+		for (size_t j = 0; j + 2 < faces.size(); j += 3)
+		{
+			mesh->addTriangle(	vertexIndexes[tileOffsets[i] + faces[j]],
+								vertexIndexes[tileOffsets[i] + faces[j + 1]],
+								vertexIndexes[tileOffsets[i] + faces[j + 2]]);
+		}
+	}
+
+	container.addChild(mesh);
+
+	return CC_FERR_NO_ERROR;
+}
@@ -25,6 +25,7 @@
 static const int DefaultCoordsQuant = 11;
 static const int DefaultNormQuant = 8;
 static const int DefaultSFQuant = 8;
+static const double DefaultTileSize = 0.0; //automatic
 
 SaveDracoFileDlg::SaveDracoFileDlg(QWidget* parent/*=nullptr*/)
 	: QDialog(parent)
@@ -46,11 +47,13 @@ void SaveDracoFileDlg::initFromPersistentSettings()
 	int coordQuantization = settings.value("coordQuantization", DefaultCoordsQuant).toInt();
 	int normQuantization = settings.value("normalQuantization", DefaultNormQuant).toInt();
 	int sfQuantization = settings.value("sfQuantization", DefaultSFQuant).toInt();
+	double tileSize = settings.value("tileSize", DefaultTileSize).toDouble();
 
 	//apply parameters
 	coordsQuantSpinBox->setValue(coordQuantization);
 	normQuantSpinBox->setValue(normQuantization);
 	sfQuantSpinBox->setValue(sfQuantization);
+	tileSizeDoubleSpinBox->setValue(tileSize);
 
 	settings.endGroup();
 }
@@ -64,6 +67,7 @@ void SaveDracoFileDlg::saveToPersistentSettings()
 	settings.setValue("coordQuantization", coordsQuantSpinBox->value());
 	settings.setValue("normalQuantization", normQuantSpinBox->value());
 	settings.setValue("sfQuantization", sfQuantSpinBox->value());
+	settings.setValue("tileSize", tileSizeDoubleSpinBox->value());
 
 	settings.endGroup();
 
@@ -75,4 +79,5 @@ void SaveDracoFileDlg::reset()
 	coordsQuantSpinBox->setValue(DefaultCoordsQuant);
 	normQuantSpinBox->setValue(DefaultNormQuant);
 	sfQuantSpinBox->setValue(DefaultSFQuant);
+	tileSizeDoubleSpinBox->setValue(DefaultTileSize);
 }
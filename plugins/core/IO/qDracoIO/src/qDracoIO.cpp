@@ -18,6 +18,7 @@
 #include "../include/qDracoIO.h"
 
 #include "../include/DRCFilter.h"
+#include "../include/qDracoIOCommands.h"
 
 
 qDracoIO::qDracoIO( QObject *parent )
@@ -28,7 +29,7 @@ qDracoIO::qDracoIO( QObject *parent )
 
 void qDracoIO::registerCommands( ccCommandLineInterface *cmd )
 {
-	Q_UNUSED(cmd);
+	cmd->registerCommand( ccCommandLineInterface::Command::Shared( new CommandLoadCroppedDRC ) );
 }
 
 ccIOPluginInterface::FilterList qDracoIO::getFilters()
@@ -240,6 +240,12 @@ CC_FILE_ERROR LASFWFFilter::saveToFile(ccHObject* entity, const QString& filenam
 		return CC_FERR_BAD_ENTITY_TYPE;
 	}
 
+	if (cloud->fwfDataIsPaged() && cloud->fwfPager()->usesFile(filename))
+	{
+		ccLog::Warning("[LAS_FWF] FWF data is read from the destination file: save to another file");
+		return CC_FERR_WRITING;
+	}
+
 	try
 	{
 		bool hasFWF = cloud->hasFWF();
@@ -257,6 +263,11 @@ CC_FILE_ERROR LASFWFFilter::saveToFile(ccHObject* entity, const QString& filenam
 			QFileInfo fi(filename);
 			QString fwFilename = fi.absolutePath() + "/" + fi.completeBaseName() + ".wdp";
 			QFile fwfFile(fwFilename);
+			if (cloud->fwfDataIsPaged() && cloud->fwfPager()->usesFile(fwFilename))
+			{
+				ccLog::Warning(QString("[LAS_FWF] FWF data is read from '%1': can't overwrite it").arg(fwFilename));
+				return CC_FERR_WRITING;
+			}
 			if (fwfFile.open(QFile::WriteOnly))
 			{
 				//write the	EVLR header first
@@ -270,9 +281,7 @@ CC_FILE_ERROR LASFWFFilter::saveToFile(ccHObject* entity, const QString& filenam
 				uint16_t recordID = 65535;
 				fwfFile.write((const char*)&recordID, 2);
 
-				const ccPointCloud::SharedFWFDataContainer& data = cloud->fwfData();
-				assert(data);
-				uint64_t recordLength = data->size();
+				uint64_t recordLength = cloud->fwfDataSize();
 				fwfFile.write((const char*)&recordLength, 8);
 
 				char description[32] = { 0 };
@@ -280,7 +289,7 @@ CC_FILE_ERROR LASFWFFilter::saveToFile(ccHObject* entity, const QString& filenam
 				fwfFile.write(description, 32);
 
 				//eventually write the FWF data
-				fwfFile.write((const char*)data->data(), data->size());
+				cloud->writeFWFData(fwfFile);
 			}
 
 			if (fwfFile.error() != QFile::NoError)
@@ -1104,24 +1113,41 @@ CC_FILE_ERROR LASFWFFilter::loadFile(const QString& filename, ccHObject& contain
 			//load the FWF data
 			if (fwfDataSource.isOpen() && fwfDataCount != 0)
 			{
-				ccPointCloud::FWFDataContainer* container = new ccPointCloud::FWFDataContainer;
-				try
+				ccPointCloud::FWFDataContainer* container = nullptr;
+				if (fwfDataCount <= ccWaveformPager::InMemoryThreshold())
+				{
+					container = new ccPointCloud::FWFDataContainer;
+					try
+					{
+						container->resize(fwfDataCount);
+					}
+					catch (const std::bad_alloc&)
+					{
+						delete container;
+						container = nullptr;
+					}
+				}
+
+				if (container)
 				{
-					container->resize(fwfDataCount);
+					fwfDataSource.read((char*)container->data(), fwfDataCount);
+					cloud->fwfData() = ccPointCloud::SharedFWFDataContainer(container);
 				}
-				catch (const std::bad_alloc&)
+				else
 				{
-					ccLog::Warning(QString("Not enough memory to import the waveform data"));
-					cloud->waveforms().clear();
-					delete container;
-					hasFWF = false;
-					break;
+					//we keep the data in the source file and page it in on demand
+					ccSharedWaveformPager pager(new ccWaveformPager);
+					if (!pager->addSegment(fwfDataSource.fileName(), static_cast<uint64_t>(fwfDataSource.pos()), fwfDataCount))
+					{
+						ccLog::Warning(QString("Failed to page the waveform data"));
+						cloud->waveforms().clear();
+						hasFWF = false;
+						break;
+					}
+					cloud->fwfPager() = pager;
+					ccLog::Print(QString("[LAS_FWF] Waveform data (%1 Mb) will be paged from '%2'").arg(fwfDataCount / static_cast<double>(1 << 20), 0, 'f', 1).arg(fwfDataSource.fileName()));
 				}
-
-				fwfDataSource.read((char*)container->data(), fwfDataCount);
 				fwfDataSource.close();
-
-				cloud->fwfData() = ccPointCloud::SharedFWFDataContainer(container);
 			}
 		}
 
@@ -630,6 +630,12 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject* entity, const QString& filename
 	}
 	auto* pointCloud = static_cast<ccPointCloud*>(entity);
 
+	if (pointCloud->fwfDataIsPaged() && pointCloud->fwfPager()->usesFile(filename))
+	{
+		ccLog::Error("[LAS] Waveform data is read from the destination file: save to another file");
+		return CC_FERR_WRITING;
+	}
+
 	LasSaveDialog saveDialog(pointCloud, parameters.parentWidget);
 
 	CCVector3d bbMax, bbMin;
@@ -939,12 +945,16 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject* entity, const QString& filename
 
 	if (saver.canSaveWaveforms())
 	{
-		const ccPointCloud::SharedFWFDataContainer& fwfData = pointCloud->fwfData();
-		QFileInfo                                   info(filename);
-		QString                                     wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.baseName());
-		QFile                                       fwfFile(wdpFilename);
+		QFileInfo info(filename);
+		QString   wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.baseName());
+		QFile     fwfFile(wdpFilename);
 
-		if (!fwfFile.open(QIODevice::WriteOnly))
+		if (pointCloud->fwfDataIsPaged() && pointCloud->fwfPager()->usesFile(wdpFilename))
+		{
+			ccLog::Error("[LAS] Waveform data is read from the destination file: save to another file");
+			error = CC_FERR_WRITING;
+		}
+		else if (!fwfFile.open(QIODevice::WriteOnly))
 		{
 			ccLog::Error("[LAS] Failed to write waveform data");
 			error = CC_FERR_WRITING;
@@ -956,8 +966,15 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject* entity, const QString& filename
 				QDataStream            stream(&fwfFile);
 				stream << header;
 			}
-			fwfFile.write(reinterpret_cast<const char*>(fwfData->data()), fwfData->size());
-			ccLog::Print(QString("[LAS] Successfully saved FWF in external file '%1'").arg(wdpFilename));
+			if (!pointCloud->writeFWFData(fwfFile))
+			{
+				ccLog::Error("[LAS] Failed to write waveform data");
+				error = CC_FERR_WRITING;
+			}
+			else
+			{
+				ccLog::Print(QString("[LAS] Successfully saved FWF in external file '%1'").arg(wdpFilename));
+			}
 		}
 	}
 
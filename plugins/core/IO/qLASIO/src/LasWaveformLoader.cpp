@@ -155,24 +155,54 @@ LasWaveformLoader::LasWaveformLoader(const laszip_header_struct& laszipHeader,
 
 	if (fwfDataSource.isOpen() && fwfDataCount != 0)
 	{
-		ccPointCloud::FWFDataContainer* container{nullptr};
 		try
 		{
-			container = new ccPointCloud::FWFDataContainer;
-			container->resize(fwfDataCount);
 			pointCloud.waveforms().resize(pointCloud.capacity());
 		}
 		catch (const std::bad_alloc&)
 		{
 			ccLog::Warning(QString("[LAS] Not enough memory to import the waveform data"));
-			delete container;
+			fwfDataCount = 0;
 			return;
 		}
 
-		fwfDataSource.read((char*)container->data(), fwfDataCount);
-		fwfDataSource.close();
+		ccPointCloud::FWFDataContainer* container{nullptr};
+		if (fwfDataCount <= ccWaveformPager::InMemoryThreshold())
+		{
+			try
+			{
+				container = new ccPointCloud::FWFDataContainer;
+				container->resize(fwfDataCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				delete container;
+				container = nullptr;
+			}
+		}
 
-		pointCloud.fwfData() = ccPointCloud::SharedFWFDataContainer(container);
+		if (container)
+		{
+			fwfDataSource.read((char*)container->data(), fwfDataCount);
+			pointCloud.fwfData() = ccPointCloud::SharedFWFDataContainer(container);
+		}
+		else
+		{
+			// we keep the data in the source file and page it in on demand
+			ccSharedWaveformPager pager(new ccWaveformPager);
+			if (!pager->addSegment(fwfDataSource.fileName(), static_cast<uint64_t>(fwfDataSource.pos()), fwfDataCount))
+			{
+				ccLog::Warning(QString("[LAS] Failed to page the waveform data"));
+				pointCloud.waveforms().clear();
+				fwfDataCount = 0;
+				return;
+			}
+			pointCloud.fwfPager() = pager;
+			ccLog::Print(QString("[LAS] Waveform data (%1 Mb) will be paged from '%2'")
+			                 .arg(fwfDataCount / static_cast<double>(1 << 20), 0, 'f', 1)
+			                 .arg(fwfDataSource.fileName()));
+		}
+		fwfDataSource.close();
 	}
 }
 
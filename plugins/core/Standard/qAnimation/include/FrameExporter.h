@@ -0,0 +1,154 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                   CLOUDCOMPARE PLUGIN: qAnimation                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//Qt
+#include <QDir>
+#include <QImage>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+//System
+#include <atomic>
+#include <deque>
+#include <map>
+
+#ifdef QFFMPEG_SUPPORT
+class QVideoEncoder;
+#endif
+class FrameEncoderThread;
+
+//! Asynchronous export of the rendered frames (producer/consumer pipeline)
+/** The frames are rendered by the main thread (OpenGL) and pushed in a bounded queue.
+	A pool of workers downsamples them (super resolution) and saves them as separate
+	images, or hands them over (in the right order) to a dedicated video encoding thread.
+	The rendering is only blocked when the queue is full.
+**/
+class FrameExporter
+{
+public:
+
+	//! Default constructor
+	FrameExporter();
+
+	//! Destructor (waits for the pending frames)
+	~FrameExporter();
+
+	//! Returns a default queue size (depending on the number of threads and on the size of a rendered frame)
+	static int DefaultQueueSize(qint64 frameSizeBytes);
+
+	//! Starts exporting frames as separate images
+	/** \param outputDir output directory
+		\param format image format (e.g. "png" or "jpg")
+		\param downsampling downsampling factor applied to the frames (super resolution)
+		\param maxQueuedFrames maximum number of frames waiting to be processed
+		\return success
+	**/
+	bool startImages(const QDir& outputDir, const QString& format, int downsampling, int maxQueuedFrames);
+
+#ifdef QFFMPEG_SUPPORT
+	//! Starts encoding frames in a video
+	/** \param encoder video encoder (already opened, must remain valid until 'finish' is called)
+		\param downsampling downsampling factor applied to the frames (super resolution)
+		\param maxQueuedFrames maximum number of frames waiting to be processed
+		\return success
+	**/
+	bool startVideo(QVideoEncoder* encoder, int downsampling, int maxQueuedFrames);
+#endif
+
+	//! Pushes a rendered frame
+	/** Blocks while the queue is full.
+		\return false if an error occurred (see errorMessage)
+	**/
+	bool push(const QImage& image, int frameIndex);
+
+	//! Cancels the process (the pending frames are discarded)
+	void cancel();
+
+	//! Waits for all the pending frames to be processed
+	/** \return false if an error occurred (see errorMessage)
+	**/
+	bool finish();
+
+	//! Returns the last error message
+	QString errorMessage() const;
+
+	//! Returns the number of frames exported so far
+	inline int exportedFrameCount() const { return m_exportedCount; }
+
+protected: //methods
+
+	friend class FrameExportTask;
+	friend class FrameEncoderThread;
+
+	//! Processes a frame (called by the workers)
+	void processFrame(QImage image, int frameIndex);
+
+	//! Encodes the frames in order (called by the video encoding thread)
+	void encodeFrames();
+
+	//! Sets the error message (the first one is kept)
+	void setError(const QString& message);
+
+protected: //members
+
+	//! Output directory (images mode)
+	QDir m_outputDir;
+	//! Image format (images mode)
+	QString m_format;
+	//! Downsampling factor
+	int m_downsampling;
+
+#ifdef QFFMPEG_SUPPORT
+	//! Video encoder (video mode)
+	QVideoEncoder* m_encoder;
+#endif
+	//! Video encoding thread
+	QScopedPointer<FrameEncoderThread> m_encoderThread;
+
+	//! Workers
+	QThreadPool m_workers;
+	//! Free slots in the queue
+	QScopedPointer<QSemaphore> m_freeSlots;
+
+	//! Mutex (protects the members below)
+	mutable QMutex m_mutex;
+	//! Condition (signaled when a frame is ready to be encoded, or when the process ends)
+	QWaitCondition m_frameReady;
+	//! Order of the frames to encode
+	std::deque<int> m_pushedFrames;
+	//! Frames ready to be encoded (by index)
+	std::map<int, QImage> m_readyFrames;
+	//! Whether no more frames will be pushed
+	bool m_finishing;
+	//! Last error message
+	QString m_errorMessage;
+
+	//! Whether the process has been started
+	bool m_started;
+	//! Whether an error occurred
+	std::atomic<bool> m_failed;
+	//! Whether the process has been canceled
+	std::atomic<bool> m_canceled;
+	//! Number of exported frames
+	std::atomic<int> m_exportedCount;
+};
@@ -0,0 +1,315 @@
+//##########################################################################
+//#                                                                        #
+//#                   CLOUDCOMPARE PLUGIN: qAnimation                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "FrameExporter.h"
+
+//Qt
+#include <QRunnable>
+#include <QThread>
+
+#ifdef QFFMPEG_SUPPORT
+//QTFFmpeg
+#include <QVideoEncoder.h>
+#endif
+
+//System
+#include <algorithm>
+#include <cassert>
+
+//! Maximum amount of memory used by the queued frames (in bytes)
+static const qint64 s_maxQueueMemory = (qint64(1) << 30); //1 GB
+//! Timeout when waiting for a free slot in the queue (so as to check for errors regularly)
+static const int s_slotTimeout_ms = 100;
+
+//! Frame processing task (run by the workers)
+class FrameExportTask : public QRunnable
+{
+public:
+
+	FrameExportTask(FrameExporter& exporter, const QImage& image, int frameIndex)
+		: m_exporter(exporter)
+		, m_image(image)
+		, m_frameIndex(frameIndex)
+	{
+	}
+
+	void run() override
+	{
+		m_exporter.processFrame(m_image, m_frameIndex);
+	}
+
+protected:
+
+	FrameExporter& m_exporter;
+	QImage m_image;
+	int m_frameIndex;
+};
+
+//! Video encoding thread
+class FrameEncoderThread : public QThread
+{
+public:
+
+	explicit FrameEncoderThread(FrameExporter& exporter)
+		: m_exporter(exporter)
+	{
+	}
+
+protected:
+
+	//inherited from QThread
+	void run() override
+	{
+		m_exporter.encodeFrames();
+	}
+
+	FrameExporter& m_exporter;
+};
+
+FrameExporter::FrameExporter()
+	: m_downsampling(1)
+#ifdef QFFMPEG_SUPPORT
+	, m_encoder(nullptr)
+#endif
+	, m_finishing(false)
+	, m_started(false)
+	, m_failed(false)
+	, m_canceled(false)
+	, m_exportedCount(0)
+{
+	//the main thread renders the frames
+	m_workers.setMaxThreadCount(std::max(QThread::idealThreadCount() - 1, 1));
+}
+
+FrameExporter::~FrameExporter()
+{
+	finish();
+}
+
+int FrameExporter::DefaultQueueSize(qint64 frameSizeBytes)
+{
+	int queueSize = 2 * QThread::idealThreadCount();
+	if (frameSizeBytes > 0)
+	{
+		queueSize = static_cast<int>(std::min<qint64>(queueSize, s_maxQueueMemory / frameSizeBytes));
+	}
+	return std::max(queueSize, 1);
+}
+
+bool FrameExporter::startImages(const QDir& outputDir, const QString& format, int downsampling, int maxQueuedFrames)
+{
+	if (m_started)
+	{
+		assert(false);
+		return false;
+	}
+
+	m_outputDir = outputDir;
+	m_format = format;
+	m_downsampling = std::max(downsampling, 1);
+	m_freeSlots.reset(new QSemaphore(std::max(maxQueuedFrames, 1)));
+	m_started = true;
+
+	return true;
+}
+
+#ifdef QFFMPEG_SUPPORT
+bool FrameExporter::startVideo(QVideoEncoder* encoder, int downsampling, int maxQueuedFrames)
+{
+	if (m_started || !encoder)
+	{
+		assert(false);
+		return false;
+	}
+
+	m_encoder = encoder;
+	m_downsampling = std::max(downsampling, 1);
+	m_freeSlots.reset(new QSemaphore(std::max(maxQueuedFrames, 1)));
+	m_started = true;
+
+	m_encoderThread.reset(new FrameEncoderThread(*this));
+	m_encoderThread->start();
+
+	return true;
+}
+#endif
+
+bool FrameExporter::push(const QImage& image, int frameIndex)
+{
+	if (!m_started || m_finishing)
+	{
+		assert(false);
+		return false;
+	}
+
+	//wait for a free slot
+	while (!m_freeSlots->tryAcquire(1, s_slotTimeout_ms))
+	{
+		if (m_failed || m_canceled)
+		{
+			return false;
+		}
+	}
+
+	if (m_failed || m_canceled)
+	{
+		m_freeSlots->release();
+		return false;
+	}
+
+	if (m_encoderThread)
+	{
+		QMutexLocker locker(&m_mutex);
+		m_pushedFrames.push_back(frameIndex);
+	}
+
+	m_workers.start(new FrameExportTask(*this, image, frameIndex));
+
+	return true;
+}
+
+void FrameExporter::processFrame(QImage image, int frameIndex)
+{
+	if (!m_failed && !m_canceled)
+	{
+		//super resolution
+		if (m_downsampling > 1)
+		{
+			image = image.scaled(image.width() / m_downsampling, image.height() / m_downsampling, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		}
+
+		if (!m_encoderThread)
+		{
+			QString filename = QString("frame_%1.%2").arg(frameIndex, 6, 10, QChar('0')).arg(m_format);
+			if (image.save(m_outputDir.filePath(filename)))
+			{
+				++m_exportedCount;
+			}
+			else
+			{
+				setError(QString("Failed to save frame #%1").arg(frameIndex + 1));
+			}
+		}
+	}
+
+	if (m_encoderThread)
+	{
+		//hand the frame over to the encoding thread (even if it's invalid, so that it can release its slot)
+		QMutexLocker locker(&m_mutex);
+		m_readyFrames[frameIndex] = image;
+		m_frameReady.wakeAll();
+	}
+	else
+	{
+		m_freeSlots->release();
+	}
+}
+
+void FrameExporter::encodeFrames()
+{
+#ifdef QFFMPEG_SUPPORT
+	while (true)
+	{
+		QImage image;
+		int frameIndex = 0;
+		{
+			QMutexLocker locker(&m_mutex);
+			//wait for the next frame (in the order they were pushed)
+			while (		(m_pushedFrames.empty() || m_readyFrames.find(m_pushedFrames.front()) == m_readyFrames.end())
+					&&	!(m_finishing && m_pushedFrames.empty()) )
+			{
+				m_frameReady.wait(&m_mutex);
+			}
+
+			if (m_pushedFrames.empty())
+			{
+				//no more frames
+				break;
+			}
+
+			frameIndex = m_pushedFrames.front();
+			m_pushedFrames.pop_front();
+			auto it = m_readyFrames.find(frameIndex);
+			image = it->second;
+			m_readyFrames.erase(it);
+		}
+
+		if (!m_failed && !m_canceled)
+		{
+			QString errorString;
+			if (m_encoder->encodeImage(image, frameIndex, &errorString))
+			{
+				++m_exportedCount;
+			}
+			else
+			{
+				setError(QString("Failed to encode frame #%1: %2").arg(frameIndex + 1).arg(errorString));
+			}
+		}
+
+		m_freeSlots->release();
+	}
+#endif
+}
+
+void FrameExporter::cancel()
+{
+	m_canceled = true;
+}
+
+bool FrameExporter::finish()
+{
+	if (!m_started)
+	{
+		return !m_failed;
+	}
+
+	//wait for the workers
+	m_workers.waitForDone();
+
+	if (m_encoderThread)
+	{
+		{
+			QMutexLocker locker(&m_mutex);
+			m_finishing = true;
+			m_frameReady.wakeAll();
+		}
+		m_encoderThread->wait();
+		m_encoderThread.reset();
+	}
+
+	m_finishing = true;
+	m_started = false;
+
+	return !m_failed;
+}
+
+void FrameExporter::setError(const QString& message)
+{
+	QMutexLocker locker(&m_mutex);
+	if (!m_failed)
+	{
+		m_errorMessage = message;
+		m_failed = true;
+	}
+}
+
+QString FrameExporter::errorMessage() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_errorMessage;
+}
@@ -18,6 +18,7 @@
 #include "qAnimationDlg.h"
 
 //Local
+#include "FrameExporter.h"
 #include "ViewInterpolate.h"
 
 //qCC_db
@@ -1357,6 +1358,24 @@ void qAnimationDlg::render(bool asSeparateFrames)
 
 	QDir outputDir(QFileInfo(outputFilename).absolutePath());
 
+	//the frames are downsampled, saved or encoded asynchronously while the next ones are rendered
+	FrameExporter exporter;
+	{
+		int downsampling = (renderingMode == SUPER_RESOLUTION ? superRes : 1);
+		qint64 renderedFrameSize = static_cast<qint64>(m_view3d->glWidth()) * m_view3d->glHeight() * superRes * superRes * 4;
+		int maxQueuedFrames = FrameExporter::DefaultQueueSize(renderedFrameSize);
+#ifdef QFFMPEG_SUPPORT
+		if (encoder)
+		{
+			exporter.startVideo(encoder.data(), downsampling, maxQueuedFrames);
+		}
+		else
+#endif
+		{
+			exporter.startImages(outputDir, "png", downsampling, maxQueuedFrames);
+		}
+	}
+
 	bool success = true;
 	double currentTime = 0.0;
 	double currentStepStartTime = 0.0;
@@ -1393,35 +1412,14 @@ void qAnimationDlg::render(bool asSeparateFrames)
 				break;
 			}
 
-			if (renderingMode == SUPER_RESOLUTION && superRes > 1)
+			//downsampling (super resolution) and saving/encoding are done by the exporter
+			if (!exporter.push(image, frameIndex))
 			{
-				image = image.scaled(image.width() / superRes, image.height() / superRes, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+				//the error message will be displayed below
+				success = false;
+				break;
 			}
 
-			if (asSeparateFrames)
-			{
-				QString filename = QString("frame_%1.png").arg(frameIndex, 6, 10, QChar('0'));
-				QString fullPath = outputDir.filePath(filename);
-				if (!image.save(fullPath))
-				{
-					QMessageBox::critical(this, "Error", QString("Failed to save frame #%1").arg(frameIndex + 1));
-					success = false;
-					break;
-				}
-			}
-			else
-			{
-#ifdef QFFMPEG_SUPPORT
-				QString errorString;
-				if (!encoder->encodeImage(image, frameIndex, &errorString))
-				{
-					QMessageBox::critical(this, "Error", QString("Failed to encode frame #%1: %2").arg(frameIndex + 1).arg(errorString));
-					success = false;
-					break;
-				}
-#endif
-			}
-			
 			//next frame
 			currentTime += timeStep;
 			++frameIndex;
@@ -1430,6 +1428,7 @@ void qAnimationDlg::render(bool asSeparateFrames)
 			QApplication::processEvents();
 			if (progressDialog.wasCanceled())
 			{
+				exporter.cancel();
 				QMessageBox::warning(this, "Warning", QString("Process has been cancelled"));
 				success = false;
 				break;
@@ -1450,6 +1449,13 @@ void qAnimationDlg::render(bool asSeparateFrames)
 
 	m_view3d->setLODEnabled(lodWasEnabled);
 
+	//wait for the last frames
+	if (!exporter.finish())
+	{
+		QMessageBox::critical(this, "Error", exporter.errorMessage());
+		success = false;
+	}
+
 #ifdef QFFMPEG_SUPPORT
 	if (encoder)
 	{
@@ -24,6 +24,7 @@
 #include <CCGeom.h>
 
 //qCC_db
+#include <ccColorTypes.h>
 #include <ccGLMatrix.h>
 
 //system
@@ -146,7 +147,8 @@ protected: //methods
 	void updateSelectionBox();
 
 	//! Selects a given point
-	/** \return whether the point has been actually selected
+	/** The point is recorded in the current 'undo' step.
+		\return whether the point has been actually selected
 	**/
 	bool selectPoint(unsigned index);
 
@@ -212,6 +214,9 @@ protected: //members
 		void backup(ccPointCloud* cloud);
 
 		//! Backups the colors (not done by default)
+		/** Only required to restore the original colors at the end (as the
+			cloud colors are converted to grey levels by the tool).
+		**/
 		bool backupColors();
 
 		//! Restores the cloud
@@ -286,11 +291,22 @@ protected: //members
 	//! Current selection mode
 	SelectionModes m_selectionMode;
 
-	//! Selection table
-	std::vector<uint32_t> m_selectionTable;
+	//! Selection table (whether each point is selected or not)
+	std::vector<bool> m_selectionTable;
 
-	//! Positions of the broom (for undo)
-	std::vector<ccGLMatrix> m_undoPositions;
+	//! Undo step
+	struct UndoStep
+	{
+		//! Position of the broom
+		ccGLMatrix position;
+		//! Points selected during this step
+		std::vector<unsigned> pointIndexes;
+		//! Colors of these points before their selection
+		std::vector<ccColor::Rgba> colors;
+	};
+
+	//! Undo steps (sparse log of the selected points)
+	std::vector<UndoStep> m_undoSteps;
 
 	//! Associated application
 	ccMainAppInterface* m_app;
@@ -45,6 +45,9 @@
 #include <QSettings>
 #include <QCloseEvent>
 
+//system
+#include <algorithm>
+
 //intersection between a plane (the broom plane) and a line (represented by two points)
 static bool Intersection(const ccGLMatrix& broomTrans, const CCVector3& A, const CCVector3& B, CCVector3& I)
 {
@@ -332,10 +335,11 @@ void qBroomDlg::CloudBackup::restore()
 		//restore original colors
 		if (colors)
 		{
-			assert(ref->hasColors());
-			for (unsigned i=0; i<ref->size(); ++i)
+			assert(ref->hasColors() && colors->size() == ref->size());
+			if (ref->detachColors())
 			{
-				ref->setPointColor(i, colors->getValue(i));
+				std::copy(colors->begin(), colors->end(), ref->rgbaColors()->begin());
+				ref->colorsHaveChanged();
 			}
 		}
 	}
@@ -418,9 +422,8 @@ bool qBroomDlg::setCloud(ccPointCloud* cloud, bool ownCloud/*=false*/, bool auto
 		try
 		{
 			m_selectionTable.clear();
-			m_selectionTable.resize(pointCount, 0);
-			m_undoPositions.resize(0);
-			m_undoPositions.reserve(1);
+			m_selectionTable.resize(pointCount, false);
+			m_undoSteps.clear();
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -472,6 +475,12 @@ bool qBroomDlg::setCloud(ccPointCloud* cloud, bool ownCloud/*=false*/, bool auto
 		assert(cloud->hasColors());
 		//but we want them to be grey scaled
 		cloud->convertRGBToGreyScale();
+		//the selected points colors will be modified directly
+		if (!cloud->detachColors())
+		{
+			ccLog::Error("Not enough memory");
+			return false;
+		}
 
 		//force visibility and other parameters
 		cloud->setEnabled(true);
@@ -1650,7 +1659,7 @@ bool qBroomDlg::selectPoints(const ccGLMatrix& broomTrans, BroomDimensions* _bro
 
 	if (count)
 	{
-		//new selection
+		//new selection (only the selected points are recorded, and their colors updated)
 		addUndoStep(broomTrans);
 		size_t selectedCount = 0;
 		for (size_t i=0; i<count; ++i)
@@ -1799,16 +1808,38 @@ bool qBroomDlg::selectPoint(unsigned index)
 	}
 
 	assert(index < m_selectionTable.size());
-	if (m_selectionTable[index] != 0)
+	if (m_selectionTable[index])
 	{
 		//already selected
 		return false;
 	}
 
-	m_cloud.ref->setPointColor(index, ccColor::red);
+	if (m_undoSteps.empty())
+	{
+		//no undo step (see addUndoStep)
+		assert(false);
+		return false;
+	}
+
+	//record the point and its current color
+	RGBAColorsTableType* colors = m_cloud.ref->rgbaColors();
+	UndoStep& step = m_undoSteps.back();
+	try
+	{
+		step.colors.push_back(colors->getValue(index));
+		step.pointIndexes.push_back(index);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		step.colors.resize(step.pointIndexes.size());
+		return false;
+	}
+
+	colors->setValue(index, ccColor::red);
+	m_cloud.ref->colorsHaveChanged(index, index + 1);
 
-	assert(!m_undoPositions.empty());
-	m_selectionTable[index] = static_cast<uint32_t>(m_undoPositions.size());
+	m_selectionTable[index] = true;
 
 	return true;
 }
@@ -1821,16 +1852,17 @@ uint32_t qBroomDlg::addUndoStep(const ccGLMatrix& broomPos)
 	//new selection
 	try
 	{
-		m_undoPositions.push_back(broomPos);
+		m_undoSteps.emplace_back();
+		m_undoSteps.back().position = broomPos;
 		undoPushButton->setEnabled(true);
 		undo10PushButton->setEnabled(true);
 	}
 	catch (const std::bad_alloc&)
 	{
-		//not enough memory (undo will be broken)
+		//not enough memory (the points will be recorded in the previous step, if any)
 	}
 
-	return static_cast<uint32_t>(m_undoPositions.size());
+	return static_cast<uint32_t>(m_undoSteps.size());
 }
 
 void qBroomDlg::undo(uint32_t undoCount)
@@ -1842,44 +1874,43 @@ void qBroomDlg::undo(uint32_t undoCount)
 		return;
 	}
 
-	if (undoCount == 0 || m_undoPositions.empty())
+	if (undoCount == 0 || m_undoSteps.empty())
 	{
 		//nothing to do
 		return;
 	}
 
-	uint32_t newCursor = static_cast<uint32_t>(m_undoPositions.size());
+	uint32_t newCursor = static_cast<uint32_t>(m_undoSteps.size());
 	ccGLMatrix newPosition;
 	if (newCursor <= undoCount)
 	{
 		newCursor = 0;
-		newPosition = m_undoPositions[0];
+		newPosition = m_undoSteps[0].position;
 	}
 	else
 	{
 		newCursor -= undoCount;
-		newPosition = m_undoPositions[newCursor];
+		newPosition = m_undoSteps[newCursor].position;
 	}
 
-	for (unsigned i=0; i<m_cloud.ref->size(); ++i)
+	//only the points selected during the undone steps are restored
+	RGBAColorsTableType* colors = m_cloud.ref->rgbaColors();
+	for (size_t stepIndex = m_undoSteps.size(); stepIndex > newCursor; --stepIndex)
 	{
-		if (m_selectionTable[i] > newCursor)
+		const UndoStep& step = m_undoSteps[stepIndex - 1];
+		assert(step.colors.size() == step.pointIndexes.size());
+		for (size_t i = 0; i < step.pointIndexes.size(); ++i)
 		{
-			m_selectionTable[i] = 0;
+			unsigned index = step.pointIndexes[i];
+			m_selectionTable[index] = false;
 
 			//restore the point color
-			if (m_cloud.colors)
-			{
-				m_cloud.ref->setPointColor(i, m_cloud.colors->getValue(i));
-			}
-			else
-			{
-				assert(false);
-			}
+			colors->setValue(index, step.colors[i]);
+			m_cloud.ref->colorsHaveChanged(index, index + 1);
 		}
 	}
 
-	m_undoPositions.resize(newCursor);
+	m_undoSteps.resize(newCursor);
 	undoPushButton->setEnabled(newCursor != 0);
 	undo10PushButton->setEnabled(newCursor != 0);
 	applyPushButton->setEnabled(newCursor != 0);
@@ -1926,11 +1957,10 @@ ccPointCloud* qBroomDlg::createSegmentedCloud(ccPointCloud* cloud, bool removeSe
 
 	unsigned selectedCount = 0;
 	{
-		for (unsigned i=0; i<cloud->size(); ++i)
-			if (m_selectionTable[i] != 0)
-				++selectedCount;
+		for (const UndoStep& step : m_undoSteps)
+			selectedCount += static_cast<unsigned>(step.pointIndexes.size());
 
-		if (!removeSelected)
+		if (removeSelected)
 		{
 			selectedCount = cloud->size() - selectedCount;
 		}
@@ -1955,8 +1985,8 @@ ccPointCloud* qBroomDlg::createSegmentedCloud(ccPointCloud* cloud, bool removeSe
 
 		for (unsigned i=0; i<cloud->size(); ++i)
 		{
-			if (	( removeSelected && m_selectionTable[i] == 0) //keep non selected
-				||	(!removeSelected && m_selectionTable[i] != 0) //keep selected
+			if (	( removeSelected && !m_selectionTable[i]) //keep non selected
+				||	(!removeSelected &&  m_selectionTable[i]) //keep selected
 				)
 			{
 				selection.addPointIndex(i);
@@ -2015,7 +2045,7 @@ void qBroomDlg::apply()
 
 void qBroomDlg::closeEvent(QCloseEvent* e)
 {
-	if (!m_undoPositions.empty() || m_cloud.ownCloud)
+	if (!m_undoSteps.empty() || m_cloud.ownCloud)
 	{
 		if (QMessageBox::warning(this, "Cancel", "The selection/segmentation will be lost. Do you confirm?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
 		{
@@ -2051,7 +2081,7 @@ void qBroomDlg::validate()
 	//m_cloud.restore(); //already called by setCloud
 
 	ccPointCloud* newCloud = nullptr;
-	if (!m_undoPositions.empty())
+	if (!m_undoSteps.empty())
 	{
 		bool error;
 		newCloud = createSegmentedCloud(cloud, removeSelectedPointsCheckBox->isChecked(), error);
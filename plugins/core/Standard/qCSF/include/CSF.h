@@ -53,6 +53,7 @@ public:
 		double cloth_resolution = 1.0;
 		int rigidness = 3;
 		int iterations = 500;
+		bool parallelConstraints = true; //see Cloth::setParallelConstraints
 
 		// constants
 		const double clothYHeight = 0.05; // origin cloth height
@@ -61,6 +61,9 @@ private:
 	// total number of particles is num_particles_width*num_particles_height
 	int constraint_iterations;
 
+	//whether the constraints are satisfied in parallel (colored ordering) or not
+	bool parallel_constraints;
+
 	//double time_step;
 
 	std::vector<Particle> particles; // all particles that are part of this cloth
@@ -118,6 +121,15 @@ public:
 		this->heightvals = heightvals;
 	}
 
+	/** Sets whether the constraints should be satisfied in parallel or not.
+		In parallel mode, the particles are processed by 'colors' (the grid is split in 5x5 cells
+		and particles with the same position in their cell share the same color). As a particle
+		only interacts with particles at most 2 cells away, all the particles of a given color can
+		be processed concurrently. The result is deterministic (whatever the number of threads)
+		but slightly differs from the one of the serial mode (different ordering).
+	**/
+	inline void setParallelConstraints(bool state) { parallel_constraints = state; }
+
 	/** This is an important method where the time is progressed one time step for the entire cloth.
 		This includes calling satisfyConstraint() for every constraint, and calling timeStep() for all particles
 	**/
@@ -49,6 +49,7 @@ static const char COMMAND_CSF_MAX_ITERATION[] = "MAX_ITERATION";
 static const char COMMAND_CSF_CLASS_THRESHOLD[] = "CLASS_THRESHOLD";
 static const char COMMAND_CSF_EXPORT_GROUND[] = "EXPORT_GROUND";
 static const char COMMAND_CSF_EXPORT_OFFGROUND[] = "EXPORT_OFFGROUND";
+static const char COMMAND_CSF_SERIAL_CONSTRAINTS[] = "SERIAL_CONSTRAINTS";
 
 struct CommandCSF : public ccCommandLineInterface::Command
 {
@@ -72,6 +73,7 @@ struct CommandCSF : public ccCommandLineInterface::Command
 		int maxIteration = 500;
 		bool exportGround = false;
 		bool exportOffground = false;
+		bool parallelConstraints = true;
 
 		while (!cmd.arguments().empty())
 		{
@@ -153,6 +155,12 @@ struct CommandCSF : public ccCommandLineInterface::Command
 				cmd.print("Off-ground will be exported");
 				exportOffground = true;
 			}
+			else if (ccCommandLineInterface::IsCommand(ARGUMENT, COMMAND_CSF_SERIAL_CONSTRAINTS))
+			{
+				cmd.arguments().pop_front();
+				cmd.print("Constraints will be satisfied sequentially (legacy ordering)");
+				parallelConstraints = false;
+			}
 			else
 			{
 				cmd.print("Set all parameters");
@@ -168,6 +176,7 @@ struct CommandCSF : public ccCommandLineInterface::Command
 			csfParams.cloth_resolution = clothResolution;
 			csfParams.rigidness = csfRigidness;
 			csfParams.iterations = maxIteration;
+			csfParams.parallelConstraints = parallelConstraints;
 		}
 
 		std::vector<CLCloudDesc> newClouds;
@@ -99,13 +99,24 @@ bool CSF::Apply(const wl::PointCloud& csfPointCloud,
 					9999,
 					params.rigidness/*,
 					params.time_step*/);
+		cloth.setParallelConstraints(params.parallelConstraints);
 		if (app)
 		{
 			app->dispToConsole(QString("[CSF] Cloth creation: %1 ms").arg(timer.restart()));
 		}
 
+#if defined(_OPENMP)
+		//save the current max number of threads before changing it
+		int maxThreadCount = omp_get_max_threads();
+		omp_set_num_threads(ccQtHelpers::GetMaxThreadCount(maxThreadCount));
+#endif
+
 		if (!Rasterization::RasterTerrain(cloth, csfPointCloud, params.k_nearest_points))
 		{
+#if defined(_OPENMP)
+			//restore the original max number of threads
+			omp_set_num_threads(maxThreadCount);
+#endif
 			return false;
 		}
 	
@@ -116,12 +127,6 @@ bool CSF::Apply(const wl::PointCloud& csfPointCloud,
 
 		double squareTimeStep = params.time_step * params.time_step;
 
-#if defined(_OPENMP)
-		//save the current max number of threads before changing it
-		int maxThreadCount = omp_get_max_threads();
-		omp_set_num_threads(ccQtHelpers::GetMaxThreadCount(maxThreadCount));
-#endif
-
 		//do the filtering
 		QProgressDialog pDlg(parent);
 		pDlg.setWindowTitle("CSF");
@@ -47,6 +47,7 @@ Cloth::Cloth(	const Vec3& _origin_pos,
 				int rigidness/*,
 				double _time_step*/)
 	: constraint_iterations(rigidness)
+	, parallel_constraints(true)
 	//, time_step(_time_step)
 	, smoothThreshold(_smoothThreshold)
 	, heightThreshold(_heightThreshold)
@@ -182,24 +183,66 @@ double Cloth::timeStep()
 
 	//Instead of interating over all the constraints several times, we 
 	//compute the overall displacement of a particle accroding to the rigidness
-//#pragma omp parallel for //DGM: satisfyConstraintSelf is not thread safe at all!
-	for (int j = 0; j < particleCount; j++)
+	if (parallel_constraints)
 	{
-		particles[j].satisfyConstraintSelf(constraint_iterations);
+		//satisfyConstraintSelf modifies the particle and its neighbors (up to 2 cells away):
+		//particles that are (at least) 5 cells away from each other can be processed concurrently
+		constexpr int ColorStep = 5;
+		for (int colorY = 0; colorY < ColorStep; ++colorY)
+		{
+			int rowCount = (num_particles_height - colorY + ColorStep - 1) / ColorStep;
+			for (int colorX = 0; colorX < ColorStep; ++colorX)
+			{
+#pragma omp parallel for
+				for (int r = 0; r < rowCount; ++r)
+				{
+					int y = colorY + r * ColorStep;
+					for (int x = colorX; x < num_particles_width; x += ColorStep)
+					{
+						getParticle(x, y).satisfyConstraintSelf(constraint_iterations);
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		//DGM: satisfyConstraintSelf is not thread safe at all in this order!
+		for (int j = 0; j < particleCount; j++)
+		{
+			particles[j].satisfyConstraintSelf(constraint_iterations);
+		}
 	}
 
-	double maxDiff = 0.0;
-//#pragma omp parallel for //see https://github.com/CloudCompare/CloudCompare/issues/909
-	for (int i = 0; i < particleCount; i++)
+	//max displacement (computed per row, as the OpenMP 'max' reduction is not
+	//available everywhere - see https://github.com/CloudCompare/CloudCompare/issues/909)
+	std::vector<double> rowMaxDiff(num_particles_height, 0.0);
+#pragma omp parallel for
+	for (int y = 0; y < num_particles_height; y++)
 	{
-		if (particles[i].isMovable())
+		double rowMax = 0.0;
+		for (int x = 0; x < num_particles_width; x++)
 		{
-			double diff = std::abs(particles[i].getPreviousY() - particles[i].getPos().y);
-			if (diff > maxDiff)
+			const Particle& particle = getParticle(x, y);
+			if (particle.isMovable())
 			{
-				maxDiff = diff;
+				double diff = std::abs(particle.getPreviousY() - particle.getPos().y);
+				if (diff > rowMax)
+				{
+					rowMax = diff;
+				}
 			}
 		}
+		rowMaxDiff[y] = rowMax;
+	}
+
+	double maxDiff = 0.0;
+	for (double diff : rowMaxDiff)
+	{
+		if (diff > maxDiff)
+		{
+			maxDiff = diff;
+		}
 	}
 
 	return maxDiff;
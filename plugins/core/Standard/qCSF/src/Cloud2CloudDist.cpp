@@ -46,9 +46,12 @@ bool Cloud2CloudDist::Compute(	const Cloth& cloth,
 		return false;
 	}
 
+	//std::vector<bool> can't be written concurrently (bit packing)
+	std::vector<unsigned char> groundFlags;
 	try
 	{
 		isGround.resize(pc.size(), false);
+		groundFlags.resize(pc.size(), 0);
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -58,7 +61,9 @@ bool Cloud2CloudDist::Compute(	const Cloth& cloth,
 
 	// for each lidar point, find the projection in the cloth grid, and the sub grid which contains it.
 	//use the four corner of the subgrid to do bilinear interpolation;
-	for (unsigned i = 0; i < static_cast<unsigned>(pc.size()); i++)
+	int pointCount = static_cast<int>(pc.size());
+#pragma omp parallel for
+	for (int i = 0; i < pointCount; i++)
 	{
 		double deltaX = pc[i].x - cloth.origin_pos.x;
 		double deltaZ = pc[i].z - cloth.origin_pos.z;
@@ -84,7 +89,12 @@ bool Cloud2CloudDist::Compute(	const Cloth& cloth,
 
 		double height_var = fxy - pc[i].y;
 
-		isGround[i] = (std::abs(height_var) < class_threshold);
+		groundFlags[i] = (std::abs(height_var) < class_threshold ? 1 : 0);
+	}
+
+	for (size_t i = 0; i < groundFlags.size(); i++)
+	{
+		isGround[i] = (groundFlags[i] != 0);
 	}
 
 	return true;
@@ -29,6 +29,9 @@
 #include "Rasterization.h"
 
 // System
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <queue>
 
@@ -90,7 +93,11 @@ static double FindHeightValByNeighbor(Particle& p, Cloth &cloth)
 	return std::numeric_limits<double>::lowest();
 }
 
-static double FindHeightValByScanline(Particle& p, Cloth& cloth)
+//! Returns the height of the first particle with a valid height in the same row or column
+/** \return std::numeric_limits<double>::lowest() if none is found (see FindHeightValByNeighbor)
+	\warning read-only (thread-safe)
+**/
+static double FindHeightValByScanline(const Particle& p, const Cloth& cloth)
 {
 	for (int i = p.pos_x + 1; i < cloth.num_particles_width; i++)
 	{
@@ -120,7 +127,15 @@ static double FindHeightValByScanline(Particle& p, Cloth& cloth)
 			return crresHeight;
 	}
 
-	return FindHeightValByNeighbor(p, cloth);
+	return std::numeric_limits<double>::lowest();
+}
+
+//! Converts a (positive) double to an integer with the same ordering
+static inline uint64_t OrderedBits(double d)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &d, sizeof(double));
+	return bits;
 }
 
 bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, unsigned KNN/*=1*/)
@@ -129,8 +144,11 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, unsign
 
 	try
 	{
-		//find the nearest cloth particle for each lidar point by Rounding operation
-		for (int i = 0; i < pc.size(); i++)
+		int particleCount = cloth.getSize();
+		int pointCount = static_cast<int>(pc.size());
+
+		//returns the nearest cloth particle of a lidar point (by Rounding operation) and the corresponding squared distance
+		auto nearestParticle = [&](int i, double& pc2particleDist) -> int
 		{
 			double pc_x = pc[i].x;
 			double pc_z = pc[i].z;
@@ -139,31 +157,86 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, unsign
 			double deltaZ = pc_z - cloth.origin_pos.z;
 			int col = int(deltaX / cloth.step_x + 0.5);
 			int row = int(deltaZ / cloth.step_y + 0.5);
-			if (col >= 0 && row >= 0 )
+			if (col < 0 || row < 0 || col >= cloth.num_particles_width || row >= cloth.num_particles_height)
 			{
-				Particle& pt = cloth.getParticle(col, row);
+				return -1;
+			}
 
-				double dx = pt.getPos().x - pc_x;
-				double dz = pt.getPos().z - pc_z;
-				double pc2particleDist = dx * dx + dz * dz;
+			const Particle& pt = cloth.getParticle(col, row);
+			double dx = pt.getPos().x - pc_x;
+			double dz = pt.getPos().z - pc_z;
+			pc2particleDist = dx * dx + dz * dz;
 
-				if (pc2particleDist < pt.nearestPointDist)
+			return row * cloth.num_particles_width + col;
+		};
+
+		//find the nearest lidar point for each cloth particle (in parallel)
+		//1st pass: the minimum distance (the bits of positive doubles have the same ordering as the values)
+		std::vector< std::atomic<uint64_t> > minDist(particleCount);
+		for (std::atomic<uint64_t>& d : minDist)
+		{
+			d.store(OrderedBits(std::numeric_limits<double>::max()));
+		}
+#pragma omp parallel for
+		for (int i = 0; i < pointCount; i++)
+		{
+			double pc2particleDist = 0.0;
+			int index = nearestParticle(i, pc2particleDist);
+			if (index >= 0)
+			{
+				uint64_t bits = OrderedBits(pc2particleDist);
+				std::atomic<uint64_t>& current = minDist[index];
+				uint64_t previous = current.load();
+				while (bits < previous && !current.compare_exchange_weak(previous, bits))
 				{
-					pt.nearestPointDist = pc2particleDist;
-					pt.nearestPointHeight = pc[i].y;
-					//pt.nearestPointIndex = i;
 				}
 			}
 		}
-		
 
-		heightVal.resize(cloth.getSize());
+		//2nd pass: the first point at this distance (to get the same result as a sequential process)
+		std::vector< std::atomic<int> > nearestIndex(particleCount);
+		for (std::atomic<int>& n : nearestIndex)
+		{
+			n.store(pointCount);
+		}
+#pragma omp parallel for
+		for (int i = 0; i < pointCount; i++)
+		{
+			double pc2particleDist = 0.0;
+			int index = nearestParticle(i, pc2particleDist);
+			if (index >= 0 && OrderedBits(pc2particleDist) == minDist[index].load())
+			{
+				std::atomic<int>& current = nearestIndex[index];
+				int previous = current.load();
+				while (i < previous && !current.compare_exchange_weak(previous, i))
+				{
+				}
+			}
+		}
 
-		for (int i = 0; i < cloth.getSize(); i++)
+#pragma omp parallel for
+		for (int i = 0; i < particleCount; i++)
 		{
-			Particle& pcur = cloth.getParticleByIndex(i);
+			int pointIndex = nearestIndex[i].load();
+			if (pointIndex < pointCount)
+			{
+				Particle& pt = cloth.getParticleByIndex(i);
+				uint64_t bits = minDist[i].load();
+				memcpy(&pt.nearestPointDist, &bits, sizeof(double));
+				pt.nearestPointHeight = pc[pointIndex].y;
+				//pt.nearestPointIndex = pointIndex;
+			}
+		}
+
+		heightVal.resize(particleCount);
+
+		//the particles without any lidar point take the height of the nearest particle in the same row or column (in parallel)
+#pragma omp parallel for
+		for (int i = 0; i < particleCount; i++)
+		{
+			const Particle& pcur = cloth.getParticleByIndex(i);
 			double nearestHeight = pcur.nearestPointHeight;
-			
+
 			if (nearestHeight > std::numeric_limits<double>::lowest())
 			{
 				heightVal[i] = nearestHeight;
@@ -172,7 +245,16 @@ bool Rasterization::RasterTerrain(Cloth& cloth, const wl::PointCloud& pc, unsign
 			{
 				heightVal[i] = FindHeightValByScanline(pcur, cloth);
 			}
-		
+		}
+
+		//otherwise, the nearest particle with a valid height is searched in the cloth graph
+		//(sequentially, as the 'isVisited' flags are used)
+		for (int i = 0; i < particleCount; i++)
+		{
+			if (heightVal[i] == std::numeric_limits<double>::lowest())
+			{
+				heightVal[i] = FindHeightValByNeighbor(cloth.getParticleByIndex(i), cloth);
+			}
 		}
 	}
 	catch (const std::bad_alloc&)
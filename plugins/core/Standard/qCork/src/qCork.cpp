@@ -21,6 +21,9 @@
 #include <ccMesh.h>
 #include <ccPointCloud.h>
 
+//shared
+#include "ccMeshBooleanCulling.h"
+
 //dialog
 #include "ccCorkDlg.h"
 
@@ -211,6 +214,40 @@ ccMesh* FromCorkMesh(const CorkMesh& in, ccMainAppInterface* app = nullptr)
 	return mesh;
 }
 
+static void ToCorkMesh(const ccMeshBooleanCulling::Mesh& in, CorkMesh& out, int origin = 0)
+{
+	std::vector<CorkMesh::Tri>& outTris = out.getTris();
+	std::vector<CorkVertex>& outVerts = out.getVerts();
+	outVerts.resize(in.vertices.size());
+	outTris.resize(in.triangles.size());
+
+	for (size_t i = 0; i < in.vertices.size(); ++i)
+	{
+		const CCVector3d& P = in.vertices[i];
+		outVerts[i].pos.x = P.x;
+		outVerts[i].pos.y = P.y;
+		outVerts[i].pos.z = P.z;
+	}
+
+	for (size_t i = 0; i < in.triangles.size(); ++i)
+	{
+		const ccMeshBooleanCulling::Triangle& tri = in.triangles[i];
+		CorkTriangle corkTri;
+		corkTri.a = tri.i[0];
+		corkTri.b = tri.i[1];
+		corkTri.c = tri.i[2];
+		//the origin of each triangle is propagated to its fragments
+		corkTri.bool_alg_data = origin;
+		outTris[i].data = corkTri;
+		outTris[i].a = tri.i[0];
+		outTris[i].b = tri.i[1];
+		outTris[i].c = tri.i[2];
+	}
+}
+
+//! Maximum ratio of active triangles for the pre-culling to be worth it
+static const double s_maxActiveRatio = 0.8;
+
 //! Boolean operation parameters (for concurrent run)
 struct BoolOpParameters
 {
@@ -218,6 +255,9 @@ struct BoolOpParameters
 		: operation(ccCorkDlg::UNION)
 		, corkA(nullptr)
 		, corkB(nullptr)
+		, sourceA(nullptr)
+		, sourceB(nullptr)
+		, preCulling(false)
 		, app(nullptr)
 		, meshesAreOk(false)
 	{}
@@ -225,6 +265,10 @@ struct BoolOpParameters
 	ccCorkDlg::CSG_OPERATION operation;
 	CorkMesh* corkA;
 	CorkMesh* corkB;
+	//! Source meshes (for the pre-culling)
+	const ccMesh* sourceA;
+	const ccMesh* sourceB;
+	bool preCulling;
 	QString nameA;
 	QString nameB;
 	ccMainAppInterface* app;
@@ -232,6 +276,67 @@ struct BoolOpParameters
 };
 static BoolOpParameters s_params;
 
+//! Performs the boolean operation on the active triangles only (see ccMeshBooleanCulling)
+/** The result is stored in s_params.corkA.
+	\return false if the pre-culling can't be used (in which case the standard operation should be performed)
+**/
+static bool DoPerformCulledBooleanOp(ccMeshBooleanCulling::Operation operation)
+{
+	ccMeshBooleanCulling culling;
+	if (!culling.init(s_params.sourceA, s_params.sourceB))
+	{
+		return false;
+	}
+
+	double activeRatio = culling.activeRatio();
+	if (s_params.app)
+		s_params.app->dispToConsole(QString("[Cork] Pre-culling: %1% of the triangles are close to the other mesh").arg(activeRatio * 100.0, 0, 'f', 1));
+	if (activeRatio > s_maxActiveRatio)
+	{
+		//not worth it
+		return false;
+	}
+
+	//Cork only resolves the intersections between the active triangles
+	//(the fragments are classified afterwards, against the full meshes)
+	ccMeshBooleanCulling::Mesh resolved;
+	std::vector<bool> fromB;
+	if (!culling.activeA().triangles.empty() && !culling.activeB().triangles.empty())
+	{
+		CorkMesh corkActive;
+		ToCorkMesh(culling.activeA(), corkActive, 0);
+		CorkMesh corkActiveB;
+		ToCorkMesh(culling.activeB(), corkActiveB, 1);
+		corkActive.disjointUnion(corkActiveB);
+		corkActive.resolveIntersections();
+
+		const std::vector<CorkMesh::Tri>& tris = corkActive.getTris();
+		const std::vector<CorkVertex>& verts = corkActive.getVerts();
+		resolved.vertices.resize(verts.size());
+		for (size_t i = 0; i < verts.size(); ++i)
+		{
+			resolved.vertices[i] = CCVector3d(verts[i].pos.x, verts[i].pos.y, verts[i].pos.z);
+		}
+		resolved.triangles.resize(tris.size());
+		fromB.resize(tris.size());
+		for (size_t i = 0; i < tris.size(); ++i)
+		{
+			resolved.triangles[i] = { { static_cast<unsigned>(tris[i].a), static_cast<unsigned>(tris[i].b), static_cast<unsigned>(tris[i].c) } };
+			fromB[i] = (tris[i].data.bool_alg_data == 1);
+		}
+	}
+	//else: both sets are empty (the active triangles of one mesh are always close to active triangles of the other)
+
+	ccMeshBooleanCulling::Mesh result;
+	if (!culling.assemble(operation, resolved, fromB, result))
+	{
+		throw std::bad_alloc();
+	}
+
+	ToCorkMesh(result, *s_params.corkA);
+	return true;
+}
+
 static bool DoPerformBooleanOp()
 {
 	//invalid parameters
@@ -280,19 +385,23 @@ static bool DoPerformBooleanOp()
 		switch (s_params.operation)
 		{
 		case ccCorkDlg::UNION:
-			s_params.corkA->boolUnion(*s_params.corkB);
+			if (!s_params.preCulling || !DoPerformCulledBooleanOp(ccMeshBooleanCulling::UNION))
+				s_params.corkA->boolUnion(*s_params.corkB);
 			break;
 
 		case ccCorkDlg::INTERSECT:
-			s_params.corkA->boolIsct(*s_params.corkB);
+			if (!s_params.preCulling || !DoPerformCulledBooleanOp(ccMeshBooleanCulling::INTERSECT))
+				s_params.corkA->boolIsct(*s_params.corkB);
 			break;
 
 		case ccCorkDlg::DIFF:
-			s_params.corkA->boolDiff(*s_params.corkB);
+			if (!s_params.preCulling || !DoPerformCulledBooleanOp(ccMeshBooleanCulling::DIFF))
+				s_params.corkA->boolDiff(*s_params.corkB);
 			break;
 
 		case ccCorkDlg::SYM_DIFF:
-			s_params.corkA->boolXor(*s_params.corkB);
+			if (!s_params.preCulling || !DoPerformCulledBooleanOp(ccMeshBooleanCulling::SYM_DIFF))
+				s_params.corkA->boolXor(*s_params.corkB);
 			break;
 
 		default:
@@ -369,6 +478,9 @@ void qCork::doAction()
 		s_params.app = m_app;
 		s_params.corkA = &corkA;
 		s_params.corkB = &corkB;
+		s_params.sourceA = meshA;
+		s_params.sourceB = meshB;
+		s_params.preCulling = cDlg.preCullingEnabled();
 		s_params.nameA = meshA->getName();
 		s_params.nameB = meshB->getName();
 		s_params.operation = cDlg.getSelectedOperation();
@@ -391,6 +503,7 @@ void qCork::doAction()
 		//just to be sure
 		s_params.app = nullptr;
 		s_params.corkA = s_params.corkB = 0;
+		s_params.sourceA = s_params.sourceB = nullptr;
 
 		pDlg.hide();
 		QApplication::processEvents();
@@ -26,17 +26,34 @@
 //qCC_db
 #include <ccAdvancedTypes.h>
 
+//System
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 class ccGenericPointCloud;
 class ccPointCloud;
 
 //! Fast Marching algorithm for planar facets extraction (qFacets plugin)
 /** Extends the FastMarching class.
+	The state of the propagation of each facet is kept apart from the grid
+	(see FacetGrowth), so that several facets can be grown concurrently.
 **/
 class FastMarchingForFacetExtraction : public CCCoreLib::FastMarching
 {
 public:
 
 	//! Static entry point (helper)
+	/** Several facets are grown concurrently, from seeds taken in distinct
+		(non adjacent) regions of the grid. The facets are then validated in
+		the order of their seeds: a facet that overlaps a previously validated
+		one is discarded, and its seed will be used again later. As the seeds
+		are always taken by batches of the same size, the result doesn't depend
+		on the number of threads.
+		\warning The facets may differ from the ones extracted by the former
+		(sequential) implementation, as the seeds are not processed in the same
+		order and the arrival times are computed differently (see computeFacetT).
+	**/
 	static int ExtractPlanarFacets(	ccPointCloud* theCloud,
 									unsigned char octreeLevel,
 									ScalarType maxError,
@@ -71,7 +88,8 @@ public:
 				CCCoreLib::GenericProgressCallback* progressCb = nullptr);
 
 	//! Updates a list of point flags, indicating the points alreay processed
-	/** \return the number of newly flagged points
+	/** The cells of the current facet are removed from the grid.
+		\return the number of newly flagged points
 	**/
 	unsigned updateFlagsTable(	ccGenericPointCloud* theCloud,
 								std::vector<unsigned char>& flags,
@@ -112,20 +130,105 @@ protected:
 		ScalarType planarError;
 	};
 
+	//! State of the propagation of a single facet
+	/** The TRIAL cells are stored in a binary heap (sorted by arrival time),
+		indexed by the position of each cell in the heap (for updates).
+	**/
+	class FacetGrowth
+	{
+	public:
+
+		//! State of a cell relatively to the facet
+		enum State { TRIAL, ACTIVE, IGNORED };
+
+		//! Cell visited during the propagation
+		struct VisitedCell
+		{
+			//! Grid index
+			unsigned index = 0;
+			//! Arrival time
+			float T = 0;
+			//! State
+			State state = TRIAL;
+			//! Position in the heap (TRIAL cells only)
+			size_t heapPos = 0;
+		};
+
+		//! Resets the propagation
+		void clear();
+
+		//! Returns a visited cell (or nullptr if the cell has not been visited yet)
+		inline const VisitedCell* visited(unsigned index) const { auto it = m_visited.find(index); return it != m_visited.end() ? &it->second : nullptr; }
+
+		//! Adds a cell to the TRIAL set
+		void addTrialCell(unsigned index, float T);
+		//! Updates the arrival time of a TRIAL cell (if it's smaller)
+		void updateTrialCell(unsigned index, float T);
+		//! Removes the TRIAL cell with the smallest arrival time (returns false if there's none)
+		bool popNearestTrialCell(VisitedCell*& cell);
+		//! Moves a cell to the ACTIVE set
+		void addActiveCell(unsigned index, float T);
+
+		//! Returns the ACTIVE cells
+		inline const std::vector<unsigned>& activeCells() const { return m_activeCells; }
+
+		//! Facet points
+		std::unique_ptr<CCCoreLib::ReferenceCloud> points;
+		//! Facet error
+		ScalarType error = 0;
+
+	protected:
+
+		//! Moves a heap element up (towards the root)
+		void siftUp(size_t pos);
+		//! Moves a heap element down (towards the leaves)
+		void siftDown(size_t pos);
+
+		//! Visited cells (by grid index)
+		std::unordered_map<unsigned, VisitedCell> m_visited;
+		//! TRIAL cells (binary heap)
+		std::vector<VisitedCell*> m_trialHeap;
+		//! ACTIVE cells (grid indexes)
+		std::vector<unsigned> m_activeCells;
+	};
+
 	//inherited methods (see FastMarchingAlgorithm)
 	virtual float computeTCoefApprox(CCCoreLib::FastMarching::Cell* currentCell, CCCoreLib::FastMarching::Cell* neighbourCell) const override;
 	virtual int step() override;
 	virtual void initTrialCells() override;
 	virtual bool instantiateGrid(unsigned size) override { return instantiateGridTpl<PlanarCell*>(size); }
 
-	//! Adds a given cell's points to the current facet and returns the resulting RMS
-	ScalarType addCellToCurrentFacet(unsigned index);
+	//! Starts the propagation of a facet from a seed cell
+	/** Thread-safe (the grid is not modified).
+		\return false if the seed cell is invalid or if an error occurred
+	**/
+	bool startFacet(FacetGrowth& facet, unsigned seedIndex) const;
+
+	//! Processes the TRIAL cell of a facet with the smallest arrival time
+	/** Thread-safe (the grid is not modified).
+		\return 1 if a cell has been processed, 0 if there's no more TRIAL cell, and a negative value if an error occurred
+	**/
+	int stepFacet(FacetGrowth& facet) const;
+
+	//! Computes the arrival time of a cell (relatively to the ACTIVE cells of a facet)
+	/** Earliest arrival time from the ACTIVE neighbours of the cell (instead of
+		solving the eikonal equation as FastMarching::computeT does).
+	**/
+	float computeFacetT(const FacetGrowth& facet, unsigned index) const;
+
+	//! Adds a given cell's points to a facet and returns the resulting error
+	ScalarType addCellToFacet(FacetGrowth& facet, unsigned index) const;
 
-	//! Current facet points
-	CCCoreLib::ReferenceCloud* m_currentFacetPoints;
+	//! Flags the points of a facet, and removes its cells from the grid
+	/** \return the number of newly flagged points
+	**/
+	unsigned commitFacet(	FacetGrowth& facet,
+							ccGenericPointCloud* theCloud,
+							std::vector<unsigned char>& flags,
+							unsigned facetIndex);
 
-	//! Current facet error
-	ScalarType m_currentFacetError;
+	//! Current facet
+	FacetGrowth m_currentFacet;
 
 	//! Max facet error
 	ScalarType m_maxError;
@@ -28,6 +28,27 @@
 //Qt
 #include <QApplication>
 
+//System
+#include <algorithm>
+#include <unordered_set>
+
+//! Number of regions (per dimension) used to pick the seeds of the facets grown concurrently
+static const int c_regionCountPerDim = 16;
+//! Maximum number of facets grown concurrently (fixed, so that the result doesn't depend on the number of threads)
+static const size_t c_seedBatchSize = 32;
+//! Maximum number of points scanned when looking for the next seeds
+static const unsigned c_seedSearchWindow = (1 << 16);
+//! Growth result for invalid seeds
+static const int c_invalidSeed = 1;
+
+//! Seed of a facet
+struct Seed
+{
+	//! Index of the seed point
+	unsigned pointIndex;
+	//! Index of the seed cell (in the Fast Marching grid)
+	unsigned cellIndex;
+};
 
 //! 26-connexity neighbouring cells positions (common edges)
 const int c_3dNeighboursPosShift[] {-1,-1,-1,
@@ -59,8 +80,6 @@ const int c_3dNeighboursPosShift[] {-1,-1,-1,
 
 FastMarchingForFacetExtraction::FastMarchingForFacetExtraction()
 	: CCCoreLib::FastMarching()
-	, m_currentFacetPoints(nullptr)
-	, m_currentFacetError(0)
 	, m_maxError(0)
 	, m_errorMeasure(CCCoreLib::DistanceComputationTools::RMS)
 	, m_useRetroProjectionError(false)
@@ -71,10 +90,124 @@ FastMarchingForFacetExtraction::FastMarchingForFacetExtraction()
 
 FastMarchingForFacetExtraction::~FastMarchingForFacetExtraction()
 {
-	if (m_currentFacetPoints)
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::clear()
+{
+	m_visited.clear();
+	m_trialHeap.clear();
+	m_activeCells.clear();
+	if (points)
+	{
+		points->clear(false);
+	}
+	error = 0;
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::addTrialCell(unsigned index, float T)
+{
+	VisitedCell& cell = m_visited[index];
+	cell.index = index;
+	cell.T = T;
+	cell.state = TRIAL;
+	cell.heapPos = m_trialHeap.size();
+
+	m_trialHeap.push_back(&cell);
+	siftUp(cell.heapPos);
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::updateTrialCell(unsigned index, float T)
+{
+	auto it = m_visited.find(index);
+	if (it == m_visited.end() || it->second.state != TRIAL)
+	{
+		assert(false);
+		return;
+	}
+
+	//the arrival time can only decrease
+	VisitedCell& cell = it->second;
+	if (T < cell.T)
+	{
+		cell.T = T;
+		siftUp(cell.heapPos);
+	}
+}
+
+bool FastMarchingForFacetExtraction::FacetGrowth::popNearestTrialCell(VisitedCell*& cell)
+{
+	if (m_trialHeap.empty())
+	{
+		return false;
+	}
+
+	cell = m_trialHeap.front();
+
+	VisitedCell* lastCell = m_trialHeap.back();
+	m_trialHeap.pop_back();
+	if (!m_trialHeap.empty())
+	{
+		m_trialHeap.front() = lastCell;
+		lastCell->heapPos = 0;
+		siftDown(0);
+	}
+
+	return true;
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::addActiveCell(unsigned index, float T)
+{
+	VisitedCell& cell = m_visited[index];
+	cell.index = index;
+	cell.T = T;
+	cell.state = ACTIVE;
+
+	m_activeCells.push_back(index);
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::siftUp(size_t pos)
+{
+	VisitedCell* cell = m_trialHeap[pos];
+	while (pos > 0)
+	{
+		size_t parentPos = (pos - 1) / 2;
+		if (m_trialHeap[parentPos]->T <= cell->T)
+		{
+			break;
+		}
+		m_trialHeap[pos] = m_trialHeap[parentPos];
+		m_trialHeap[pos]->heapPos = pos;
+		pos = parentPos;
+	}
+	m_trialHeap[pos] = cell;
+	cell->heapPos = pos;
+}
+
+void FastMarchingForFacetExtraction::FacetGrowth::siftDown(size_t pos)
+{
+	VisitedCell* cell = m_trialHeap[pos];
+	size_t heapSize = m_trialHeap.size();
+	while (true)
 	{
-		delete m_currentFacetPoints;
+		size_t childPos = 2 * pos + 1;
+		if (childPos >= heapSize)
+		{
+			break;
+		}
+		if (childPos + 1 < heapSize && m_trialHeap[childPos + 1]->T < m_trialHeap[childPos]->T)
+		{
+			++childPos;
+		}
+		if (m_trialHeap[childPos]->T >= cell->T)
+		{
+			break;
+		}
+		m_trialHeap[pos] = m_trialHeap[childPos];
+		m_trialHeap[pos]->heapPos = pos;
+		pos = childPos;
 	}
+	m_trialHeap[pos] = cell;
+	cell->heapPos = pos;
 }
 
 static bool ComputeCellStats(	CCCoreLib::ReferenceCloud* subset,
@@ -202,69 +335,62 @@ int FastMarchingForFacetExtraction::step()
 	if (!m_initialized)
 		return -1;
 
+	return stepFacet(m_currentFacet);
+}
+
+int FastMarchingForFacetExtraction::stepFacet(FacetGrowth& facet) const
+{
 	//get 'earliest' cell
-	unsigned minTCellIndex = getNearestTrialCell();
-	if (minTCellIndex == 0)
+	FacetGrowth::VisitedCell* minTCell = nullptr;
+	if (!facet.popNearestTrialCell(minTCell))
 		return 0;
 
-	CCCoreLib::FastMarching::Cell* minTCell =  m_theGrid[minTCellIndex];
-	assert(minTCell && minTCell->state != PlanarCell::ACTIVE_CELL);
+	unsigned minTCellIndex = minTCell->index;
+	assert(m_theGrid[minTCellIndex]);
 
 	if (minTCell->T < Cell::T_INF())
 	{
-		assert(m_currentFacetPoints);
-		unsigned sizeBefore = m_currentFacetPoints->size();
+		assert(facet.points);
+		unsigned sizeBefore = facet.points->size();
 
 		//check if we can add the cell to the current "ACTIVE" set
-		ScalarType error = addCellToCurrentFacet(minTCellIndex);
+		ScalarType error = addCellToFacet(facet, minTCellIndex);
 
 		if (error >= 0)
 		{
 			if (error > m_maxError)
 			{
 				//resulting error would be too high
-				m_currentFacetPoints->resize(sizeBefore);
-				//we leave the cell as is (in the EMPTY state)
-				//so that we won't look at it again!
-				addIgnoredCell(minTCellIndex);
+				facet.points->resize(sizeBefore);
+				//we ignore the cell so that we won't look at it again!
+				minTCell->state = FacetGrowth::IGNORED;
 			}
 			else
 			{
-				m_currentFacetError = error;
+				facet.error = error;
 
 				//add the cell to the "ACTIVE" set
-				addActiveCell(minTCellIndex);
+				facet.addActiveCell(minTCellIndex, minTCell->T);
 
 				//add its neighbors to the TRIAL set
 				for (unsigned i = 0; i < m_numberOfNeighbours; ++i)
 				{
 					//get neighbor cell
 					unsigned nIndex = minTCellIndex + m_neighboursIndexShift[i];
-					CCCoreLib::FastMarching::Cell* nCell = m_theGrid[nIndex];
-					if (nCell)
+					if (!m_theGrid[nIndex])
+						continue;
+
+					const FacetGrowth::VisitedCell* nCell = facet.visited(nIndex);
+					//if it' not yet a TRIAL cell
+					if (!nCell)
 					{
-						//if it' not yet a TRIAL cell
-						if (nCell->state == PlanarCell::FAR_CELL)
-						{
-							nCell->T = computeT(nIndex);
-							addTrialCell(nIndex);
-						}
-						//otherwise we must update it's arrival time
-						else if (nCell->state == PlanarCell::TRIAL_CELL)
-						{
-							const float& t_old = nCell->T;
-							float t_new = computeT(nIndex);
-
-							if (t_new < t_old)
-								nCell->T = t_new;
-						}
+						facet.addTrialCell(nIndex, computeFacetT(facet, nIndex));
+					}
+					//otherwise we must update it's arrival time
+					else if (nCell->state == FacetGrowth::TRIAL)
+					{
+						facet.updateTrialCell(nIndex, computeFacetT(facet, nIndex));
 					}
-				}
-
-				m_propagateProgress += (m_currentFacetPoints->size() - sizeBefore);
-				if (m_propagateProgressCb)
-				{
-					m_propagateProgressCb->update((100.0f * m_propagateProgress) / m_currentFacetPoints->getAssociatedCloud()->size());
 				}
 			}
 		}
@@ -276,12 +402,35 @@ int FastMarchingForFacetExtraction::step()
 	}
 	else
 	{
-		addIgnoredCell(minTCellIndex);
+		minTCell->state = FacetGrowth::IGNORED;
 	}
 
 	return 1;
 }
 
+float FastMarchingForFacetExtraction::computeFacetT(const FacetGrowth& facet, unsigned index) const
+{
+	CCCoreLib::FastMarching::Cell* theCell = m_theGrid[index];
+	if (!theCell)
+		return Cell::T_INF();
+
+	//earliest arrival time from the ACTIVE neighbours
+	float T = Cell::T_INF();
+	for (unsigned i = 0; i < m_numberOfNeighbours; ++i)
+	{
+		unsigned nIndex = index + m_neighboursIndexShift[i];
+		const FacetGrowth::VisitedCell* nCell = facet.visited(nIndex);
+		if (nCell && nCell->state == FacetGrowth::ACTIVE)
+		{
+			float nT = nCell->T + m_neighboursDistance[i] * computeTCoefApprox(m_theGrid[nIndex], theCell);
+			if (nT < T)
+				T = nT;
+		}
+	}
+
+	return T;
+}
+
 float FastMarchingForFacetExtraction::computeTCoefApprox(CCCoreLib::FastMarching::Cell* originCell, CCCoreLib::FastMarching::Cell* destCell) const
 {
 	PlanarCell* oCell = static_cast<PlanarCell*>(originCell);
@@ -346,50 +495,40 @@ unsigned FastMarchingForFacetExtraction::updateFlagsTable(	ccGenericPointCloud*
 															std::vector<unsigned char>& flags,
 															unsigned facetIndex)
 {
-	if (!m_initialized || !m_currentFacetPoints)
+	if (!m_initialized || !m_currentFacet.points)
 		return 0;
 
-	unsigned pointCount = m_currentFacetPoints->size();
+	return commitFacet(m_currentFacet, theCloud, flags, facetIndex);
+}
+
+unsigned FastMarchingForFacetExtraction::commitFacet(	FacetGrowth& facet,
+														ccGenericPointCloud* theCloud,
+														std::vector<unsigned char>& flags,
+														unsigned facetIndex)
+{
+	unsigned pointCount = facet.points->size();
 	for (unsigned k = 0; k < pointCount; ++k)
 	{
-		unsigned index = m_currentFacetPoints->getPointGlobalIndex(k);
+		unsigned index = facet.points->getPointGlobalIndex(k);
 		flags[index] = 1;
 
 		theCloud->setPointScalarValue(index, static_cast<ScalarType>(facetIndex));
 	}
 
-	if (m_currentFacetPoints)
+	//we remove the processed cells so as to be sure not to consider them again!
+	for (unsigned cellIndex : facet.activeCells())
 	{
-		m_currentFacetPoints->clear(false);
+		CCCoreLib::FastMarching::Cell* cell = m_theGrid[cellIndex];
+		m_theGrid[cellIndex] = nullptr;
+		delete cell;
 	}
 
-	//for (size_t i = 0; i < m_activeCells.size(); ++i)
-	//{
-	//	//we remove the processed cell so as to be sure not to consider them again!
-	//	CCCoreLib::FastMarching::Cell* cell = m_theGrid[m_activeCells[i]];
-	//	m_theGrid[m_activeCells[i]] = 0;
-	//	if (cell)
-	//		delete cell;
-	//}
-	
-	//unsigned pointCount = 0;
-	CCCoreLib::ReferenceCloud Yk(m_octree->associatedCloud());
-	for (size_t i = 0; i < m_activeCells.size(); ++i)
-	{
-		PlanarCell* aCell = static_cast<PlanarCell*>(m_theGrid[m_activeCells[i]]);
-		if (!m_octree->getPointsInCell(aCell->cellCode, m_gridLevel, &Yk, true))
-			continue;
-
-		for (unsigned k = 0; k < Yk.size(); ++k)
-		{
-			unsigned index = Yk.getPointGlobalIndex(k);
-			assert(flags[index] == 1);
-			//flags.setValue(index,1);			
-			//++pointCount;
-		}
+	facet.clear();
 
-		m_theGrid[m_activeCells[i]] = nullptr;
-		delete aCell;
+	m_propagateProgress += pointCount;
+	if (m_propagateProgressCb)
+	{
+		m_propagateProgressCb->update((100.0f * m_propagateProgress) / theCloud->size());
 	}
 
 	return pointCount;
@@ -402,28 +541,57 @@ bool FastMarchingForFacetExtraction::setSeedCell(const Tuple3i& pos)
 		return false;
 	}
 
-	if (m_octree)
+	if (!m_octree)
 	{
-		if (!m_currentFacetPoints)
-		{
-			m_currentFacetPoints = new CCCoreLib::ReferenceCloud(m_octree->associatedCloud());
-		}
-		assert(m_currentFacetPoints->size() == 0);
+		return true;
+	}
 
-		unsigned index = pos2index(pos);
-		m_currentFacetError = addCellToCurrentFacet(index);
-		if (m_currentFacetError < 0) //invalid error?
-			return false;
+	return startFacet(m_currentFacet, pos2index(pos));
+}
+
+bool FastMarchingForFacetExtraction::startFacet(FacetGrowth& facet, unsigned seedIndex) const
+{
+	facet.clear();
 
-		m_propagateProgress += m_currentFacetPoints->size();
+	PlanarCell* seedCell = static_cast<PlanarCell*>(m_theGrid[seedIndex]);
+	if (!seedCell || !m_octree)
+	{
+		return false;
+	}
+
+	if (!facet.points)
+	{
+		facet.points.reset(new CCCoreLib::ReferenceCloud(m_octree->associatedCloud()));
+	}
+
+	facet.error = addCellToFacet(facet, seedIndex);
+	if (facet.error < 0) //invalid error?
+	{
+		return false;
+	}
+	facet.addActiveCell(seedIndex, 0);
+
+	if (facet.error <= m_maxError)
+	{
+		//add all its neighbour cells to the TRIAL set
+		for (unsigned i = 0; i < m_numberOfNeighbours; ++i)
+		{
+			unsigned nIndex = seedIndex + m_neighboursIndexShift[i];
+			PlanarCell* nCell = static_cast<PlanarCell*>(m_theGrid[nIndex]);
+			if (nCell)
+			{
+				//compute its approximate arrival time
+				facet.addTrialCell(nIndex, m_neighboursDistance[i] * computeTCoefApprox(seedCell, nCell));
+			}
+		}
 	}
 
 	return true;
 }
 
-ScalarType FastMarchingForFacetExtraction::addCellToCurrentFacet(unsigned index)
+ScalarType FastMarchingForFacetExtraction::addCellToFacet(FacetGrowth& facet, unsigned index) const
 {
-	if (!m_currentFacetPoints || !m_initialized || !m_octree || m_gridLevel > CCCoreLib::DgmOctree::MAX_OCTREE_LEVEL)
+	if (!facet.points || !m_initialized || !m_octree || m_gridLevel > CCCoreLib::DgmOctree::MAX_OCTREE_LEVEL)
 		return -1;
 
 	PlanarCell* cell = static_cast<PlanarCell*>(m_theGrid[index]);
@@ -434,7 +602,7 @@ ScalarType FastMarchingForFacetExtraction::addCellToCurrentFacet(unsigned index)
 	if (!m_octree->getPointsInCell(cell->cellCode, m_gridLevel, &Yk, true))
 		return -1;
 
-	if (!m_currentFacetPoints->add(Yk))
+	if (!facet.points->add(Yk))
 	{
 		//not enough memory?
 		return -1;
@@ -444,41 +612,14 @@ ScalarType FastMarchingForFacetExtraction::addCellToCurrentFacet(unsigned index)
 	CCVector3 N;
 	CCVector3 C;
 	ScalarType error;
-	ComputeCellStats(m_currentFacetPoints, N, C, error, m_errorMeasure);
+	ComputeCellStats(facet.points.get(), N, C, error, m_errorMeasure);
 
 	return error;
 }
 
 void FastMarchingForFacetExtraction::initTrialCells()
 {
-	//we expect at most one 'ACTIVE' cell (i.e. the current seed)
-	size_t seedCount = m_activeCells.size();
-	assert(seedCount <= 1);
-
-	if (seedCount == 1 && m_currentFacetError <= m_maxError)
-	{
-		unsigned index = m_activeCells.front();
-		PlanarCell* seedCell = static_cast<PlanarCell*>(m_theGrid[index]);
-
-		assert(seedCell != nullptr);
-		assert(seedCell->T == 0);
-
-		//add all its neighbour cells to the TRIAL set
-		for (unsigned i = 0; i < m_numberOfNeighbours; ++i)
-		{
-			unsigned nIndex = index + m_neighboursIndexShift[i];
-			PlanarCell* nCell = (PlanarCell*)m_theGrid[nIndex];
-			//if the neighbor exists (it shouldn't be in the TRIAL or ACTIVE sets)
-			if (nCell/* && nCell->state == PlanarCell::FAR_CELL*/)
-			{
-				assert(nCell->state == PlanarCell::FAR_CELL);
-				addTrialCell(nIndex);
-
-				//compute its approximate arrival time
-				nCell->T = seedCell->T + m_neighboursDistance[i] * computeTCoefApprox(seedCell,nCell);
-			}
-		}
-	}
+	//nothing to do: the seed's neighbours are added to the TRIAL set by startFacet (see setSeedCell)
 }
 
 int FastMarchingForFacetExtraction::ExtractPlanarFacets(	ccPointCloud* theCloud,
@@ -589,72 +730,160 @@ int FastMarchingForFacetExtraction::ExtractPlanarFacets(	ccPointCloud* theCloud,
 	//enable 26-connectivity mode
 	//fm.setExtendedConnectivity(true);
 
+	//several facets are grown concurrently, from seeds taken in distinct (non adjacent) regions
+	//of the grid, so that they rarely overlap (by batches of fixed size, whatever the number of threads)
+	const size_t maxConcurrentFacets = c_seedBatchSize;
+	const int regionWidth = std::max(1, (octreeWidth + 1) / c_regionCountPerDim);
+	const int regionKeyWidth = (octreeWidth / regionWidth) + 3; //+2 for the neighbours of the border regions
+
+	std::vector<FacetGrowth> facets;
+	std::vector<Seed> seeds;
+	std::vector<int> growthResults;
+	try
+	{
+		facets.resize(maxConcurrentFacets);
+		seeds.reserve(maxConcurrentFacets);
+		growthResults.resize(maxConcurrentFacets);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[FastMarchingForFacetExtraction] Not enough memory!");
+		return -5;
+	}
+	std::unordered_set<int> usedRegions;
+
 	//while non-processed points remain...
-	unsigned resolvedPoints = 0;
-	int lastProcessedPoint = -1;
+	unsigned firstUnprocessedPoint = 0;
 	unsigned facetIndex = 0;
 	while (true)
 	{
 		//find the next non-processed point
-		do
+		while (firstUnprocessedPoint < numberOfPoints && flags[firstUnprocessedPoint] != 0)
 		{
-			++lastProcessedPoint;
+			++firstUnprocessedPoint;
 		}
-		while (lastProcessedPoint < static_cast<int>(numberOfPoints) && flags[lastProcessedPoint] != 0);
 
 		//all points have been processed? Then we can stop.
-		if (lastProcessedPoint == static_cast<int>(numberOfPoints))
+		if (firstUnprocessedPoint == numberOfPoints)
 		{
 			break;
 		}
 
-		//we start the propagation from this point
-		//(from its corresponding cell in fact ;)
-		const CCVector3* thePoint = theCloud->getPoint(lastProcessedPoint);
-		Tuple3i pos;
-		theOctree->getTheCellPosWhichIncludesThePoint(thePoint, pos, octreeLevel);
+		//look for the next seeds (starting from the first non-processed point)
+		seeds.clear();
+		usedRegions.clear();
+		unsigned searchEnd = (numberOfPoints - firstUnprocessedPoint > c_seedSearchWindow ? firstUnprocessedPoint + c_seedSearchWindow : numberOfPoints);
+		for (unsigned i = firstUnprocessedPoint; i < searchEnd && seeds.size() < maxConcurrentFacets; ++i)
+		{
+			if (flags[i] != 0)
+			{
+				continue;
+			}
 
-		//clipping (in case the octree is not 'complete')
-		pos.x = std::min(octreeWidth, pos.x);
-		pos.y = std::min(octreeWidth, pos.y);
-		pos.z = std::min(octreeWidth, pos.z);
+			//we start the propagation from this point
+			//(from its corresponding cell in fact ;)
+			const CCVector3* thePoint = theCloud->getPoint(i);
+			Tuple3i pos;
+			theOctree->getTheCellPosWhichIncludesThePoint(thePoint, pos, octreeLevel);
+
+			//clipping (in case the octree is not 'complete')
+			pos.x = std::min(octreeWidth, pos.x);
+			pos.y = std::min(octreeWidth, pos.y);
+			pos.z = std::min(octreeWidth, pos.z);
+
+			//the region of the seed and its neighbours must be free
+			Tuple3i regionPos(pos.x / regionWidth + 1, pos.y / regionWidth + 1, pos.z / regionWidth + 1);
+			bool regionIsFree = true;
+			for (int dz = -1; dz <= 1 && regionIsFree; ++dz)
+			{
+				for (int dy = -1; dy <= 1 && regionIsFree; ++dy)
+				{
+					for (int dx = -1; dx <= 1 && regionIsFree; ++dx)
+					{
+						int key = (regionPos.x + dx) + ((regionPos.y + dy) + (regionPos.z + dz) * regionKeyWidth) * regionKeyWidth;
+						regionIsFree = (usedRegions.count(key) == 0);
+					}
+				}
+			}
+			if (!regionIsFree)
+			{
+				continue;
+			}
+			usedRegions.insert(regionPos.x + (regionPos.y + regionPos.z * regionKeyWidth) * regionKeyWidth);
 
-		//set corresponding FM cell as 'seed'
-		if (!fm.setSeedCell(pos))
-		{
-			//an error occurred?!
-			//result = -7;
-			//break;
-			continue;
+			seeds.push_back({ i, fm.pos2index(pos) });
 		}
 
-		//launch propagation
-		int propagationResult = fm.propagate();
-		if (propagationResult < 0)
+		//launch the propagations
+		int seedCount = static_cast<int>(seeds.size());
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1) if(seedCount > 1)
+#endif
+		for (int i = 0; i < seedCount; ++i)
 		{
-			//an error occurred or the process was cancelled by the user
-			result = -7;
-			break;
+			FacetGrowth& facet = facets[i];
+			if (!fm.startFacet(facet, seeds[i].cellIndex))
+			{
+				growthResults[i] = c_invalidSeed;
+				continue;
+			}
+
+			int stepResult = 1;
+			while (stepResult > 0)
+			{
+				stepResult = fm.stepFacet(facet);
+			}
+			growthResults[i] = stepResult;
 		}
 
-		//compute the number of points processed during this pass
-		unsigned count = fm.updateFlagsTable(theCloud, flags, ++facetIndex);
+		//validate the facets (in the order of their seeds)
+		for (int i = 0; i < seedCount; ++i)
+		{
+			if (growthResults[i] == c_invalidSeed)
+			{
+				//we skip this point
+				flags[seeds[i].pointIndex] = 1;
+				continue;
+			}
+			else if (growthResults[i] < 0)
+			{
+				//an error occurred
+				result = -7;
+				break;
+			}
+
+			//the facet must not overlap the facets validated before
+			//(otherwise its seed will be used again later, unless it belongs to them)
+			FacetGrowth& facet = facets[i];
+			bool overlaps = false;
+			for (unsigned cellIndex : facet.activeCells())
+			{
+				if (!fm.m_theGrid[cellIndex])
+				{
+					overlaps = true;
+					break;
+				}
+			}
+			if (overlaps)
+			{
+				facet.clear();
+				continue;
+			}
+
+			fm.commitFacet(facet, theCloud, flags, ++facetIndex);
+		}
 
-		if (count != 0)
+		if (result < 0)
 		{
-			resolvedPoints += count;
-			//if (progressCb)
-			//{
-			//	if (progressCb->isCancelRequested())
-			//	{
-			//		result = -7;
-			//		break;
-			//	}
-			//	progressCb->update((resolvedPoints * 100.0f) / numberOfPoints);
-			//}
+			break;
 		}
 
-		fm.cleanLastPropagation();
+		if (progressCb && progressCb->isCancelRequested())
+		{
+			//the process was cancelled by the user
+			result = -7;
+			break;
+		}
 	}
 
 	fm.setPropagateCallback(nullptr);
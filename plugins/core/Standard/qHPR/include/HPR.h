@@ -0,0 +1,92 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qHPR                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#ifndef Q_HPR_ALGORITHM_HEADER
+#define Q_HPR_ALGORITHM_HEADER
+
+//CCCoreLib
+#include <CCGeom.h>
+
+//Qt
+#include <QString>
+
+//system
+#include <vector>
+
+namespace CCCoreLib
+{
+	class GenericProgressCallback;
+}
+
+//! Hidden Point Removal (Katz et al.) for one or several viewpoints
+namespace HPR
+{
+	//! Viewpoint
+	struct Viewpoint
+	{
+		//! Position
+		CCVector3d position;
+		//! Viewing direction (a null vector means 'omnidirectional')
+		CCVector3d direction{ 0.0, 0.0, 0.0 };
+		//! Half-angle of the viewing cone (in radians, only used if the direction is not null)
+		double halfAngle_rad = 0.0;
+		//! Maximum range (0 = no limit)
+		double maxRange = 0.0;
+		//! Name (for the output scalar field)
+		QString name;
+	};
+
+	//! Computes the points visible from a given viewpoint
+	/** The convex hull computation (qhull) is not reentrant: concurrent calls
+		are serialized internally. The other steps can be run in parallel.
+		\param points input points
+		\param candidates indexes of the points to consider (all points if nullptr)
+		\param viewPoint viewpoint
+		\param fParam spherical flipping parameter (the radius is 10^fParam times the max. distance)
+		\param[out] visible indexes of the visible points (in the same order as the candidates)
+		\return success
+	**/
+	bool ComputeVisibility(	const std::vector<CCVector3d>& points,
+							const std::vector<unsigned>* candidates,
+							const CCVector3d& viewPoint,
+							double fParam,
+							std::vector<unsigned>& visible);
+
+	//! Returns the indexes of the points inside the viewing cone and the range of a viewpoint
+	bool CullPoints(const std::vector<CCVector3d>& points,
+					const Viewpoint& viewpoint,
+					std::vector<unsigned>& candidates);
+
+	//! Computes the visibility of a set of points for many viewpoints (in parallel)
+	/** Each viewpoint only processes the points inside its viewing cone and its range.
+		\param points input points
+		\param viewpoints viewpoints
+		\param fParam spherical flipping parameter
+		\param[out] visibilityCount number of viewpoints from which each point is visible
+		\param[out] visibleByViewpoint visible points of each viewpoint (optional)
+		\param progressCb progress callback (optional)
+		\return success
+	**/
+	bool ComputeBatchVisibility(const std::vector<CCVector3d>& points,
+								const std::vector<Viewpoint>& viewpoints,
+								double fParam,
+								std::vector<unsigned>& visibilityCount,
+								std::vector< std::vector<unsigned> >* visibleByViewpoint = nullptr,
+								CCCoreLib::GenericProgressCallback* progressCb = nullptr);
+}
+
+#endif
@@ -27,6 +27,9 @@ public:
 
 	//! Default constructor
 	explicit ccHprDlg(QWidget* parent = nullptr);
+
+	//! Shows or hides the parameters of the multiple viewpoints mode
+	void setBatchMode(bool state);
 };
 
 #endif
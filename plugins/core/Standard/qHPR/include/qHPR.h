@@ -51,6 +51,12 @@ protected:
 	//! Slot called when associated ation is triggered
 	void doAction();
 
+	//! Slot called when the multiple viewpoints action is triggered
+	/** The viewpoints are the positions of the selected sensors and trajectories
+		(or of the sensors associated to the cloud if none is selected).
+	**/
+	void doBatchAction();
+
 protected:
 
 	//! Katz et al. algorithm
@@ -58,6 +64,8 @@ protected:
 
 	//! Associated action
 	QAction* m_action;
+	//! Multiple viewpoints action
+	QAction* m_batchAction;
 };
 
 #endif
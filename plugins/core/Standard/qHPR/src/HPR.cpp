@@ -0,0 +1,318 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qHPR                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "HPR.h"
+
+//CCCoreLib
+#include <GenericProgressCallback.h>
+
+//Qt
+#include <QMutex>
+
+//Qhull
+extern "C"
+{
+#include <qhull_a.h>
+}
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+//system
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+//! The bundled qhull library relies on global variables: it can't be called concurrently
+static QMutex s_qhullMutex;
+
+//! Returns whether the current thread is the master thread (i.e. the one that can interact with the GUI)
+static inline bool IsMasterThread()
+{
+#if defined(_OPENMP)
+	return omp_get_thread_num() == 0;
+#else
+	return true;
+#endif
+}
+
+bool HPR::ComputeVisibility(const std::vector<CCVector3d>& points,
+							const std::vector<unsigned>* candidates,
+							const CCVector3d& viewPoint,
+							double fParam,
+							std::vector<unsigned>& visible)
+{
+	visible.clear();
+
+	size_t count = (candidates ? candidates->size() : points.size());
+	if (count == 0)
+	{
+		return true;
+	}
+
+	auto pointIndex = [&](size_t i) { return (candidates ? (*candidates)[i] : static_cast<unsigned>(i)); };
+
+	//less than 4 points? no need for calculation, all the points are visible
+	if (count < 4)
+	{
+		try
+		{
+			visible.resize(count);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			visible[i] = pointIndex(i);
+		}
+		return true;
+	}
+
+	//convert the points to an array of double triplets (for qHull)
+	std::vector<coordT> pt_array;
+	std::vector<bool> pointBelongsToCvxHull;
+	try
+	{
+		pt_array.resize((count + 1) * 3, 0); //the last point is the view point (Cf. HPR)
+		pointBelongsToCvxHull.resize(count + 1, false);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	double maxRadius = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		CCVector3d P = points[pointIndex(i)] - viewPoint;
+		pt_array[3 * i    ] = static_cast<coordT>(P.x);
+		pt_array[3 * i + 1] = static_cast<coordT>(P.y);
+		pt_array[3 * i + 2] = static_cast<coordT>(P.z);
+
+		//we keep track of the highest 'radius'
+		maxRadius = std::max(maxRadius, P.norm2());
+	}
+
+	//apply spherical flipping
+	maxRadius = sqrt(maxRadius) * pow(10.0, fParam) * 2;
+	for (size_t i = 0; i < count; ++i)
+	{
+		coordT* P = pt_array.data() + 3 * i;
+		double r = (maxRadius / sqrt(P[0] * P[0] + P[1] * P[1] + P[2] * P[2])) - 1.0;
+		P[0] *= r;
+		P[1] *= r;
+		P[2] *= r;
+	}
+
+	//flag the points on the convex hull
+	{
+		QMutexLocker locker(&s_qhullMutex);
+
+		static char qHullCommand[] = "qhull QJ Qci";
+		bool success = (qh_new_qhull(3, static_cast<int>(count + 1), pt_array.data(), False, qHullCommand, nullptr, stderr) == 0);
+		if (success)
+		{
+			vertexT *vertex = nullptr;
+			vertexT **vertexp = nullptr;
+			facetT *facet = nullptr;
+
+			FORALLfacets
+			{
+				setT* vertices = qh_facet3vertex(facet);
+				FOREACHvertex_(vertices)
+				{
+					pointBelongsToCvxHull[qh_pointid(vertex->point)] = true;
+				}
+				qh_settempfree(&vertices);
+			}
+		}
+
+		qh_freeqhull(!qh_ALL);
+		//free long memory
+		int curlong = 0;
+		int totlong = 0;
+		qh_memfreeshort(&curlong, &totlong);
+		//free short memory and memory allocator
+
+		if (!success)
+		{
+			return false;
+		}
+	}
+
+	try
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (pointBelongsToCvxHull[i])
+			{
+				visible.push_back(pointIndex(i));
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		visible.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool HPR::CullPoints(	const std::vector<CCVector3d>& points,
+						const Viewpoint& viewpoint,
+						std::vector<unsigned>& candidates)
+{
+	candidates.clear();
+
+	bool useRange = (viewpoint.maxRange > 0);
+	double maxRange2 = viewpoint.maxRange * viewpoint.maxRange;
+
+	double dirNorm = viewpoint.direction.norm();
+	bool useCone = (dirNorm > 0);
+	CCVector3d dir = (useCone ? viewpoint.direction / dirNorm : viewpoint.direction);
+	double cosHalfAngle = cos(viewpoint.halfAngle_rad);
+
+	try
+	{
+		unsigned pointCount = static_cast<unsigned>(points.size());
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			CCVector3d P = points[i] - viewpoint.position;
+			double d2 = P.norm2();
+			if (useRange && d2 > maxRange2)
+			{
+				continue;
+			}
+			if (useCone && P.dot(dir) < cosHalfAngle * sqrt(d2))
+			{
+				continue;
+			}
+			candidates.push_back(i);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		candidates.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool HPR::ComputeBatchVisibility(	const std::vector<CCVector3d>& points,
+									const std::vector<Viewpoint>& viewpoints,
+									double fParam,
+									std::vector<unsigned>& visibilityCount,
+									std::vector< std::vector<unsigned> >* visibleByViewpoint/*=nullptr*/,
+									CCCoreLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	try
+	{
+		visibilityCount.assign(points.size(), 0);
+		if (visibleByViewpoint)
+		{
+			visibleByViewpoint->clear();
+			visibleByViewpoint->resize(viewpoints.size());
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	int viewpointCount = static_cast<int>(viewpoints.size());
+	if (viewpointCount == 0)
+	{
+		return true;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Hidden Point Removal");
+			progressCb->setInfo(qPrintable(QString("Viewpoints: %1\nPoints: %2").arg(viewpointCount).arg(points.size())));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+
+	//each viewpoint only processes the points in its range / viewing cone, so that the
+	//(serialized) convex hull computations are much smaller than with the whole cloud,
+	//while the culling and the spherical flipping of the other viewpoints run in parallel
+	std::atomic<int> processedCount(0);
+	std::atomic<bool> canceled(false);
+	std::atomic<bool> failed(false);
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int k = 0; k < viewpointCount; ++k)
+	{
+		if (canceled || failed)
+		{
+			continue;
+		}
+
+		const Viewpoint& viewpoint = viewpoints[k];
+		std::vector<unsigned> candidates;
+		std::vector<unsigned> visible;
+		if (	!CullPoints(points, viewpoint, candidates)
+			||	!ComputeVisibility(points, &candidates, viewpoint.position, fParam, visible) )
+		{
+			failed = true;
+			continue;
+		}
+		candidates.clear();
+		candidates.shrink_to_fit();
+
+		for (unsigned index : visible)
+		{
+#if defined(_OPENMP)
+#pragma omp atomic
+#endif
+			++visibilityCount[index];
+		}
+
+		if (visibleByViewpoint)
+		{
+			(*visibleByViewpoint)[k].swap(visible);
+		}
+
+		int processed = ++processedCount;
+		if (progressCb && IsMasterThread())
+		{
+			progressCb->update((100.0f * processed) / viewpointCount);
+			if (progressCb->isCancelRequested())
+			{
+				canceled = true;
+			}
+		}
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	return !canceled && !failed;
+}
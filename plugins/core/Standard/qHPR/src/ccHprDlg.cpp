@@ -26,4 +26,12 @@ ccHprDlg::ccHprDlg(QWidget* parent)
 	setupUi(this);
 
 	octreeLevelSpinBox->setRange(2, CCCoreLib::DgmOctree::MAX_OCTREE_LEVEL);
+
+	setBatchMode(false);
+}
+
+void ccHprDlg::setBatchMode(bool state)
+{
+	batchGroupBox->setVisible(state);
+	adjustSize();
 }
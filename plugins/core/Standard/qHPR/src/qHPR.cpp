@@ -17,6 +17,7 @@
 
 #include "qHPR.h"
 #include "ccHprDlg.h"
+#include "HPR.h"
 
 //Qt
 #include <QtGui>
@@ -28,6 +29,10 @@
 #include <ccOctreeProxy.h>
 #include <ccProgressDialog.h>
 #include <cc2DViewportObject.h>
+#include <ccCameraSensor.h>
+#include <ccGBLSensor.h>
+#include <ccIndexedTransformationBuffer.h>
+#include <ccScalarField.h>
 
 //qCC
 #include <ccGLWindowInterface.h>
@@ -35,16 +40,12 @@
 //CCCoreLib
 #include <CloudSamplingTools.h>
 
-//Qhull
-extern "C"
-{
-#include <qhull_a.h>
-}
 
 qHPR::qHPR(QObject* parent)
 	: QObject(parent)
 	, ccStdPluginInterface(":/CC/plugin/qHPR/info.json")
 	, m_action(nullptr)
+	, m_batchAction(nullptr)
 {
 }
 
@@ -60,7 +61,17 @@ QList<QAction *> qHPR::getActions()
 		connect(m_action, &QAction::triggered, this, &qHPR::doAction);
 	}
 
-	return QList<QAction *>{ m_action };
+	//multiple viewpoints action
+	if (!m_batchAction)
+	{
+		m_batchAction = new QAction(getName() + " (multiple viewpoints)", this);
+		m_batchAction->setToolTip("Computes the visibility of the points from each position of the selected sensors / trajectories (or of the sensors associated to the cloud)");
+		m_batchAction->setIcon(getIcon());
+		//connect signal
+		connect(m_batchAction, &QAction::triggered, this, &qHPR::doBatchAction);
+	}
+
+	return QList<QAction *>{ m_action, m_batchAction };
 }
 
 void qHPR::onNewSelection(const ccHObject::Container& selectedEntities)
@@ -70,6 +81,21 @@ void qHPR::onNewSelection(const ccHObject::Container& selectedEntities)
 		//a single point cloud must be selected
 		m_action->setEnabled(selectedEntities.size() == 1 && selectedEntities.front()->isA(CC_TYPES::POINT_CLOUD));
 	}
+
+	if (m_batchAction)
+	{
+		//a single point cloud, and optionally sensors or trajectories, must be selected
+		unsigned cloudCount = 0;
+		bool otherEntities = false;
+		for (ccHObject* entity : selectedEntities)
+		{
+			if (entity->isA(CC_TYPES::POINT_CLOUD))
+				++cloudCount;
+			else if (!entity->isKindOf(CC_TYPES::SENSOR) && !entity->isA(CC_TYPES::TRANS_BUFFER))
+				otherEntities = true;
+		}
+		m_batchAction->setEnabled(cloudCount == 1 && !otherEntities);
+	}
 }
 
 CCCoreLib::ReferenceCloud* qHPR::removeHiddenPoints(CCCoreLib::GenericIndexedCloudPersist* theCloud, const CCVector3d& viewPoint, double fParam)
@@ -80,136 +106,40 @@ CCCoreLib::ReferenceCloud* qHPR::removeHiddenPoints(CCCoreLib::GenericIndexedClo
 	if (nbPoints == 0)
 		return nullptr;
 
-	//less than 4 points? no need for calculation, we return the whole cloud
-	if (nbPoints < 4)
+	std::vector<CCVector3d> points;
+	std::vector<unsigned> visibleIndexes;
+	try
 	{
-		CCCoreLib::ReferenceCloud* visiblePoints = new CCCoreLib::ReferenceCloud(theCloud);
-		if (!visiblePoints->addPointIndex(0, nbPoints)) //well even for less than 4 points we never know ;)
-		{
-			//not enough memory!
-			delete visiblePoints;
-			visiblePoints = nullptr;
-		}
-		return visiblePoints;
+		points.resize(nbPoints);
 	}
-
-	double maxRadius = 0;
-
-	//convert point cloud to an array of double triplets (for qHull)
-	coordT* pt_array = new coordT[(nbPoints + 1) * 3];
+	catch (const std::bad_alloc&)
 	{
-		coordT* _pt_array = pt_array;
-
-		for (unsigned i = 0; i < nbPoints; ++i)
-		{
-			CCVector3d P = theCloud->getPoint(i)->toDouble() - viewPoint;
-			*_pt_array++ = static_cast<coordT>(P.x);
-			*_pt_array++ = static_cast<coordT>(P.y);
-			*_pt_array++ = static_cast<coordT>(P.z);
-
-			//we keep track of the highest 'radius'
-			double r2 = P.norm2();
-			if (maxRadius < r2)
-				maxRadius = r2;
-		}
-
-		//we add the view point (Cf. HPR)
-		*_pt_array++ = 0;
-		*_pt_array++ = 0;
-		*_pt_array++ = 0;
-
-		maxRadius = sqrt(maxRadius);
+		//not enough memory!
+		return nullptr;
 	}
-
-	//apply spherical flipping
+	for (unsigned i = 0; i < nbPoints; ++i)
 	{
-		maxRadius *= pow(10.0, fParam) * 2;
-
-		coordT* _pt_array = pt_array;
-		for (unsigned i = 0; i < nbPoints; ++i)
-		{
-			CCVector3d P = theCloud->getPoint(i)->toDouble() - viewPoint;
-
-			double r = (maxRadius / P.norm()) - 1.0;
-			*_pt_array++ *= r;
-			*_pt_array++ *= r;
-			*_pt_array++ *= r;
-		}
+		points[i] = theCloud->getPoint(i)->toDouble();
 	}
 
-	//array to flag points on the convex hull
-	std::vector<bool> pointBelongsToCvxHull;
-
-	static char qHullCommand[] = "qhull QJ Qci";
-	if (!qh_new_qhull(3, nbPoints + 1, pt_array, False, qHullCommand, nullptr, stderr))
+	if (!HPR::ComputeVisibility(points, nullptr, viewPoint, fParam, visibleIndexes) || visibleIndexes.empty())
 	{
-		try
-		{
-			pointBelongsToCvxHull.resize(nbPoints + 1, false);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory!
-			delete[] pt_array;
-			return nullptr;
-		}
-
-		vertexT *vertex = nullptr;
-		vertexT **vertexp = nullptr;
-		facetT *facet = nullptr;
-
-		FORALLfacets
-		{
-			//if (!facet->simplicial)
-			//	error("convhulln: non-simplicial facet"); // should never happen with QJ
-
-			setT* vertices = qh_facet3vertex(facet);
-			FOREACHvertex_(vertices)
-			{
-				pointBelongsToCvxHull[qh_pointid(vertex->point)] = true;
-			}
-			qh_settempfree(&vertices);
-		}
+		return nullptr;
 	}
 
-	delete[] pt_array;
-	pt_array = nullptr;
-
-	qh_freeqhull(!qh_ALL);
-	//free long memory
-	int curlong = 0;
-	int totlong = 0;
-	qh_memfreeshort(&curlong, &totlong);
-	//free short memory and memory allocator
-
-	if (!pointBelongsToCvxHull.empty())
+	CCCoreLib::ReferenceCloud* visiblePoints = new CCCoreLib::ReferenceCloud(theCloud);
+	if (!visiblePoints->reserve(static_cast<unsigned>(visibleIndexes.size())))
 	{
-		//compute the number of points belonging to the convex hull
-		unsigned cvxHullSize = 0;
-		{
-			for (unsigned i = 0; i < nbPoints; ++i)
-				if (pointBelongsToCvxHull[i])
-					++cvxHullSize;
-		}
-
-		CCCoreLib::ReferenceCloud* visiblePoints = new CCCoreLib::ReferenceCloud(theCloud);
-		if (cvxHullSize != 0 && visiblePoints->reserve(cvxHullSize))
-		{
-			for (unsigned i = 0; i < nbPoints; ++i)
-				if (pointBelongsToCvxHull[i])
-					visiblePoints->addPointIndex(i); //can't fail, see above
-
-			return visiblePoints;
-
-		}
-		else //not enough memory
-		{
-			delete visiblePoints;
-			visiblePoints = nullptr;
-		}
+		//not enough memory
+		delete visiblePoints;
+		return nullptr;
+	}
+	for (unsigned index : visibleIndexes)
+	{
+		visiblePoints->addPointIndex(index); //can't fail, see above
 	}
 
-	return nullptr;
+	return visiblePoints;
 }
 
 void qHPR::doAction()
@@ -388,3 +318,322 @@ void qHPR::doAction()
 	//currently selected entities appearance may have changed!
 	m_app->refreshAll();
 }
+
+//! Adds the viewpoints corresponding to the positions of a sensor
+static void AddSensorViewpoints(const ccSensor* sensor, int step, double maxRange, std::vector<HPR::Viewpoint>& viewpoints)
+{
+	HPR::Viewpoint viewpoint;
+	viewpoint.maxRange = maxRange;
+
+	CCVector3d localDirection(0, 0, 0);
+	if (sensor->isA(CC_TYPES::GBL_SENSOR))
+	{
+		//ground based lidars have their own range
+		PointCoordinateType sensorRange = static_cast<const ccGBLSensor*>(sensor)->getSensorRange();
+		if (sensorRange > 0)
+		{
+			viewpoint.maxRange = sensorRange;
+		}
+	}
+	else if (sensor->isA(CC_TYPES::CAMERA_SENSOR))
+	{
+		//cameras look along -Z (we use the cone enclosing the frustum)
+		const ccCameraSensor::IntrinsicParameters& params = static_cast<const ccCameraSensor*>(sensor)->getIntrinsicParameters();
+		double aspectRatio = (params.arrayHeight > 0 ? static_cast<double>(params.arrayWidth) / params.arrayHeight : 1.0);
+		viewpoint.halfAngle_rad = atan(tan(params.vFOV_rad / 2) * sqrt(1.0 + aspectRatio * aspectRatio));
+		localDirection = CCVector3d(0, 0, -1);
+	}
+
+	std::vector<double> indexes;
+	const ccIndexedTransformationBuffer* positions = sensor->getPositions();
+	if (positions && !positions->empty())
+	{
+		for (size_t i = 0; i < positions->size(); i += step)
+		{
+			indexes.push_back(positions->at(i).getIndex());
+		}
+	}
+	else
+	{
+		indexes.push_back(sensor->getActiveIndex());
+	}
+
+	for (double index : indexes)
+	{
+		ccIndexedTransformation trans;
+		if (!sensor->getAbsoluteTransformation(trans, index))
+		{
+			continue;
+		}
+
+		viewpoint.position = trans.getTranslationAsVec3D().toDouble();
+		viewpoint.direction = localDirection;
+		trans.applyRotation(viewpoint.direction);
+		viewpoint.name = (indexes.size() > 1 ? QString("%1 @ %2").arg(sensor->getName()).arg(index) : sensor->getName());
+		viewpoints.push_back(viewpoint);
+	}
+}
+
+//! Adds the viewpoints corresponding to the positions of a trajectory
+static void AddTrajectoryViewpoints(const ccIndexedTransformationBuffer* trajectory, int step, double maxRange, std::vector<HPR::Viewpoint>& viewpoints)
+{
+	HPR::Viewpoint viewpoint;
+	viewpoint.maxRange = maxRange;
+
+	for (size_t i = 0; i < trajectory->size(); i += step)
+	{
+		const ccIndexedTransformation& trans = trajectory->at(i);
+		viewpoint.position = trans.getTranslationAsVec3D().toDouble();
+		viewpoint.name = QString("%1 @ %2").arg(trajectory->getName()).arg(trans.getIndex());
+		viewpoints.push_back(viewpoint);
+	}
+}
+
+//! Returns the scalar field with a given name (creates it if necessary)
+static ccScalarField* GetOrCreateScalarField(ccPointCloud* cloud, const QString& name)
+{
+	int sfIdx = cloud->getScalarFieldIndexByName(name.toStdString());
+	if (sfIdx < 0)
+	{
+		sfIdx = cloud->addScalarField(name.toStdString());
+		if (sfIdx < 0)
+		{
+			return nullptr;
+		}
+	}
+
+	return static_cast<ccScalarField*>(cloud->getScalarField(sfIdx));
+}
+
+void qHPR::doBatchAction()
+{
+	assert(m_app);
+	if (!m_app)
+		return;
+
+	const ccHObject::Container& selectedEntities = m_app->getSelectedEntities();
+
+	//the cloud and the viewpoints sources (sensors or trajectories)
+	ccPointCloud* cloud = nullptr;
+	ccHObject::Container sources;
+	for (ccHObject* entity : selectedEntities)
+	{
+		if (entity->isA(CC_TYPES::POINT_CLOUD))
+		{
+			if (cloud)
+			{
+				m_app->dispToConsole("Select only one cloud!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+				return;
+			}
+			cloud = static_cast<ccPointCloud*>(entity);
+		}
+		else if (entity->isKindOf(CC_TYPES::SENSOR) || entity->isA(CC_TYPES::TRANS_BUFFER))
+		{
+			sources.push_back(entity);
+		}
+	}
+
+	if (!cloud)
+	{
+		m_app->dispToConsole("Select one cloud!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	//by default, we use the sensors associated to the cloud
+	if (sources.empty())
+	{
+		cloud->filterChildren(sources, true, CC_TYPES::SENSOR);
+	}
+	if (sources.empty())
+	{
+		m_app->dispToConsole("No viewpoint! Select sensors or trajectories along with the cloud (or associate sensors to the cloud)", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	ccHprDlg dlg(m_app->getMainWindow());
+	dlg.setBatchMode(true);
+	if (!dlg.exec())
+		return;
+
+	int octreeLevel = dlg.octreeLevelSpinBox->value();
+	assert(octreeLevel >= 0 && octreeLevel <= CCCoreLib::DgmOctree::MAX_OCTREE_LEVEL);
+	double maxRange = dlg.maxRangeDoubleSpinBox->value();
+	int step = dlg.trajectoryStepSpinBox->value();
+	bool perViewpointSF = dlg.perViewpointSFCheckBox->isChecked();
+
+	//gather the viewpoints
+	std::vector<HPR::Viewpoint> viewpoints;
+	try
+	{
+		for (ccHObject* source : sources)
+		{
+			if (source->isKindOf(CC_TYPES::SENSOR))
+			{
+				AddSensorViewpoints(static_cast<ccSensor*>(source), step, maxRange, viewpoints);
+			}
+			else
+			{
+				AddTrajectoryViewpoints(static_cast<ccIndexedTransformationBuffer*>(source), step, maxRange, viewpoints);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		m_app->dispToConsole("Not enough memory!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	if (viewpoints.empty())
+	{
+		m_app->dispToConsole("No valid viewpoint!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	//progress dialog
+	ccProgressDialog progressCb(true, m_app->getMainWindow());
+
+	//compute octree if cloud hasn't any
+	ccOctree::Shared theOctree = cloud->getOctree();
+	if (!theOctree)
+	{
+		theOctree = cloud->computeOctree(&progressCb);
+		if (theOctree && cloud->getParent())
+		{
+			m_app->addToDB(cloud->getOctreeProxy());
+		}
+	}
+
+	if (!theOctree)
+	{
+		m_app->dispToConsole("Couldn't compute octree!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	QElapsedTimer eTimer;
+	eTimer.start();
+
+	//the octree cells are the 'points' seen by the viewpoints
+	QScopedPointer<CCCoreLib::ReferenceCloud> theCellCenters( CCCoreLib::CloudSamplingTools::subsampleCloudWithOctreeAtLevel(	cloud,
+																										static_cast<unsigned char>(octreeLevel),
+																										CCCoreLib::CloudSamplingTools::NEAREST_POINT_TO_CELL_CENTER,
+																										&progressCb,
+																										theOctree.data()) );
+	if (!theCellCenters)
+	{
+		m_app->dispToConsole("Error while simplifying point cloud with octree!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	unsigned cellCount = theCellCenters->size();
+	std::vector<CCVector3d> cellPoints;
+	std::vector<unsigned> pointCells;
+	try
+	{
+		cellPoints.resize(cellCount);
+		pointCells.resize(cloud->size(), 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		m_app->dispToConsole("Not enough memory!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	for (unsigned i = 0; i < cellCount; ++i)
+	{
+		cellPoints[i] = theCellCenters->getPoint(i)->toDouble();
+	}
+	theCellCenters.reset(nullptr);
+
+	//index of the cell of each point
+	{
+		CCCoreLib::DgmOctree::cellIndexesContainer cellIndexes;
+		if (!theOctree->getCellIndexes(static_cast<unsigned char>(octreeLevel), cellIndexes) || cellIndexes.size() != cellCount)
+		{
+			m_app->dispToConsole("Couldn't fetch the list of octree cell indexes! (Not enough memory?)", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+			return;
+		}
+
+		CCCoreLib::ReferenceCloud Yk(theOctree->associatedCloud());
+		for (unsigned i = 0; i < cellCount; ++i)
+		{
+			Yk.clear(false);
+			theOctree->getPointsInCellByCellIndex(&Yk, cellIndexes[i], static_cast<unsigned char>(octreeLevel));
+			for (unsigned j = 0; j < Yk.size(); ++j)
+			{
+				pointCells[Yk.getPointGlobalIndex(j)] = i;
+			}
+		}
+	}
+
+	//HPR
+	std::vector<unsigned> visibilityCount;
+	std::vector< std::vector<unsigned> > visibleCells;
+	if (!HPR::ComputeBatchVisibility(cellPoints, viewpoints, 3.5, visibilityCount, perViewpointSF ? &visibleCells : nullptr, &progressCb))
+	{
+		m_app->dispToConsole("Process failed or canceled by the user", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+
+	m_app->dispToConsole(QString("[HPR] Viewpoints: %1 - Cells: %2 - Time: %3 s").arg(viewpoints.size()).arg(cellCount).arg(eTimer.elapsed() / 1.0e3));
+
+	//visibility count
+	unsigned pointCount = cloud->size();
+	ccScalarField* countSF = GetOrCreateScalarField(cloud, "HPR visibility count");
+	if (!countSF)
+	{
+		m_app->dispToConsole("Not enough memory!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return;
+	}
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		countSF->setValue(i, static_cast<ScalarType>(visibilityCount[pointCells[i]]));
+	}
+	countSF->computeMinAndMax();
+
+	//visibility per viewpoint
+	if (perViewpointSF)
+	{
+		std::vector<bool> cellIsVisible;
+		try
+		{
+			cellIsVisible.resize(cellCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_app->dispToConsole("Not enough memory!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+			visibleCells.clear();
+		}
+
+		for (size_t k = 0; k < visibleCells.size(); ++k)
+		{
+			ccScalarField* sf = GetOrCreateScalarField(cloud, QString("HPR visibility (%1)").arg(viewpoints[k].name));
+			if (!sf)
+			{
+				m_app->dispToConsole("Not enough memory!", ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+				break;
+			}
+
+			std::fill(cellIsVisible.begin(), cellIsVisible.end(), false);
+			for (unsigned index : visibleCells[k])
+			{
+				cellIsVisible[index] = true;
+			}
+			visibleCells[k].clear();
+			visibleCells[k].shrink_to_fit();
+
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				sf->setValue(i, cellIsVisible[pointCells[i]] ? static_cast<ScalarType>(1) : static_cast<ScalarType>(0));
+			}
+			sf->computeMinAndMax();
+		}
+	}
+
+	cloud->setCurrentDisplayedScalarField(cloud->getScalarFieldIndexByName("HPR visibility count"));
+	cloud->showSF(true);
+	cloud->prepareDisplayForRefresh();
+
+	//currently selected entities appearance may have changed!
+	m_app->refreshAll();
+	m_app->updateUI();
+}
@@ -41,6 +41,9 @@ public:
 	//! Returns whether mesh order has been swappped or not
 	bool isSwapped() const { return m_isSwapped; }
 
+	//! Returns whether the regions far from the other mesh should be skipped (pre-culling)
+	bool preCullingEnabled() const { return preCullingCheckBox->isChecked(); }
+
 protected Q_SLOTS:
 
 	void unionSelected();
@@ -21,6 +21,9 @@
 #include <ccMesh.h>
 #include <ccPointCloud.h>
 
+//shared
+#include "ccMeshBooleanCulling.h"
+
 //dialog
 #include "ccMeshBooleanDialog.h"
 
@@ -45,6 +48,7 @@
 #pragma warning( disable: 4267 )
 #pragma warning( disable: 4566 )
 #endif
+#include <igl/copyleft/cgal/intersect_other.h>
 #include <igl/copyleft/cgal/mesh_boolean.h>
 
 //! ligIGL mesh
@@ -197,12 +201,41 @@ ccMesh* FromIGLMesh(const IGLMesh& in, ccMainAppInterface* app = nullptr)
 	return mesh;
 }
 
+static void ToIGLMesh(const ccMeshBooleanCulling::Mesh& in, IGLMesh& out)
+{
+	out.V.resize(in.vertices.size(), 3);
+	out.F.resize(in.triangles.size(), 3);
+
+	for (size_t i = 0; i < in.vertices.size(); ++i)
+	{
+		const CCVector3d& P = in.vertices[i];
+		out.V(i, 0) = P.x;
+		out.V(i, 1) = P.y;
+		out.V(i, 2) = P.z;
+	}
+
+	for (size_t i = 0; i < in.triangles.size(); ++i)
+	{
+		const ccMeshBooleanCulling::Triangle& tri = in.triangles[i];
+		out.F(i, 0) = static_cast<int>(tri.i[0]);
+		out.F(i, 1) = static_cast<int>(tri.i[1]);
+		out.F(i, 2) = static_cast<int>(tri.i[2]);
+	}
+}
+
+//! Maximum ratio of active triangles for the pre-culling to be worth it
+static const double s_maxActiveRatio = 0.8;
+
 //! Boolean operation parameters (for concurrent run)
 struct BoolOpParameters
 {
 	ccMeshBooleanDialog::CSG_OPERATION operation = ccMeshBooleanDialog::UNION;
 	IGLMesh* meshA = nullptr;
 	IGLMesh* meshB = nullptr;
+	//! Source meshes (for the pre-culling)
+	const ccMesh* sourceA = nullptr;
+	const ccMesh* sourceB = nullptr;
+	bool preCulling = false;
 	IGLMesh output;
 	QString nameA;
 	QString nameB;
@@ -210,6 +243,81 @@ struct BoolOpParameters
 };
 static BoolOpParameters s_params;
 
+//! Performs the boolean operation on the active triangles only (see ccMeshBooleanCulling)
+/** \return false if the pre-culling can't be used (in which case the standard operation should be performed)
+**/
+static bool DoPerformCulledBooleanOp(ccMeshBooleanCulling::Operation operation)
+{
+	ccMeshBooleanCulling culling;
+	if (!culling.init(s_params.sourceA, s_params.sourceB))
+	{
+		return false;
+	}
+
+	double activeRatio = culling.activeRatio();
+	if (s_params.app)
+		s_params.app->dispToConsole(QString("[Mesh boolean] Pre-culling: %1% of the triangles are close to the other mesh").arg(activeRatio * 100.0, 0, 'f', 1));
+	if (activeRatio > s_maxActiveRatio)
+	{
+		//not worth it
+		return false;
+	}
+
+	//the exact kernel only resolves the intersections between the active triangles
+	//(the fragments are classified afterwards, against the full meshes)
+	ccMeshBooleanCulling::Mesh resolved;
+	std::vector<bool> fromB;
+	if (!culling.activeA().triangles.empty() && !culling.activeB().triangles.empty())
+	{
+		IGLMesh activeA;
+		IGLMesh activeB;
+		ToIGLMesh(culling.activeA(), activeA);
+		ToIGLMesh(culling.activeB(), activeB);
+
+		Eigen::MatrixXi IF;
+		IGLMesh remeshed;
+		Eigen::VectorXi J;
+		Eigen::VectorXi IM;
+		igl::copyleft::cgal::intersect_other(	activeA.V,
+												activeA.F,
+												activeB.V,
+												activeB.F,
+												igl::copyleft::cgal::RemeshSelfIntersectionsParam(false, false, true),
+												IF,
+												remeshed.V,
+												remeshed.F,
+												J,
+												IM );
+
+		resolved.vertices.resize(remeshed.V.rows());
+		for (Eigen::Index i = 0; i < remeshed.V.rows(); ++i)
+		{
+			resolved.vertices[i] = CCVector3d(remeshed.V(i, 0), remeshed.V(i, 1), remeshed.V(i, 2));
+		}
+		resolved.triangles.resize(remeshed.F.rows());
+		fromB.resize(remeshed.F.rows());
+		for (Eigen::Index i = 0; i < remeshed.F.rows(); ++i)
+		{
+			//stitch the duplicated vertices
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				resolved.triangles[i].i[j] = static_cast<unsigned>(IM(remeshed.F(i, j)));
+			}
+			fromB[i] = (J(i) >= activeA.F.rows());
+		}
+	}
+	//else: both sets are empty (the active triangles of one mesh are always close to active triangles of the other)
+
+	ccMeshBooleanCulling::Mesh result;
+	if (!culling.assemble(operation, resolved, fromB, result))
+	{
+		throw std::bad_alloc();
+	}
+
+	ToIGLMesh(result, s_params.output);
+	return true;
+}
+
 static bool DoPerformBooleanOp()
 {
 	//invalid parameters
@@ -225,23 +333,28 @@ static bool DoPerformBooleanOp()
 		timer.start();
 
 		igl::MeshBooleanType booleanType = igl::NUM_MESH_BOOLEAN_TYPES; // = invalid
+		ccMeshBooleanCulling::Operation cullingOperation = ccMeshBooleanCulling::UNION;
 		//perform the boolean operation
 		switch (s_params.operation)
 		{
 		case ccMeshBooleanDialog::UNION:
 			booleanType = igl::MESH_BOOLEAN_TYPE_UNION;
+			cullingOperation = ccMeshBooleanCulling::UNION;
 			break;
 
 		case ccMeshBooleanDialog::INTERSECT:
 			booleanType = igl::MESH_BOOLEAN_TYPE_INTERSECT;
+			cullingOperation = ccMeshBooleanCulling::INTERSECT;
 			break;
 
 		case ccMeshBooleanDialog::DIFF:
 			booleanType = igl::MESH_BOOLEAN_TYPE_MINUS;
+			cullingOperation = ccMeshBooleanCulling::DIFF;
 			break;
 
 		case ccMeshBooleanDialog::SYM_DIFF:
 			booleanType = igl::MESH_BOOLEAN_TYPE_XOR;
+			cullingOperation = ccMeshBooleanCulling::SYM_DIFF;
 			break;
 
 		default:
@@ -252,13 +365,14 @@ static bool DoPerformBooleanOp()
 		}
 
 		s_params.output = IGLMesh();
-		if (!igl::copyleft::cgal::mesh_boolean(	s_params.meshA->V,
-												s_params.meshA->F,
-												s_params.meshB->V,
-												s_params.meshB->F,
-												booleanType,
-												s_params.output.V,
-												s_params.output.F ))
+		bool done = (s_params.preCulling && DoPerformCulledBooleanOp(cullingOperation));
+		if (!done && !igl::copyleft::cgal::mesh_boolean(	s_params.meshA->V,
+														s_params.meshA->F,
+														s_params.meshB->V,
+														s_params.meshB->F,
+														booleanType,
+														s_params.output.V,
+														s_params.output.F ))
 		{
 			if (s_params.app)
 				s_params.app->dispToConsole("[Mesh boolean] CSG operation failed", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
@@ -335,6 +449,9 @@ void qMeshBoolean::doAction()
 		s_params.app = m_app;
 		s_params.meshA = &iglMeshA;
 		s_params.meshB = &iglMeshB;
+		s_params.sourceA = meshA;
+		s_params.sourceB = meshB;
+		s_params.preCulling = cDlg.preCullingEnabled();
 		s_params.nameA = meshA->getName();
 		s_params.nameB = meshB->getName();
 		s_params.operation = cDlg.getSelectedOperation();
@@ -357,6 +474,7 @@ void qMeshBoolean::doAction()
 		//just to be sure
 		s_params.app = nullptr;
 		s_params.meshA = s_params.meshB = nullptr;
+		s_params.sourceA = s_params.sourceB = nullptr;
 
 		pDlg.hide();
 		QApplication::processEvents();
@@ -25,7 +25,6 @@
 
 //Local
 #include "dialogs/SIFTExtractDlg.h"
-#include "../utils/PCLConv.h"
 #include "../utils/cc2sm.h"
 #include "../utils/sm2cc.h"
 
@@ -210,50 +209,34 @@ int ExtractSIFT::compute()
 		return InvalidInput;
 	}
 
-	QStringList scalarFields;
-	if (m_mode == SCALAR_FIELD)
-	{
-		scalarFields << m_field_to_use;
-	}
-	
-	PCLCloud::Ptr sm_cloud = cc2smReader(cloud).getAsSM(true, false, m_mode == RGB, scalarFields);
-	if (!sm_cloud)
-	{
-		return NotEnoughMemory;
-	}
-
-	//Now change the name of the field to use to a standard name, only if in OTHER_FIELD mode
-	if (m_mode == SCALAR_FIELD)
-	{
-		int field_index = pcl::getFieldIndex(*sm_cloud, m_field_to_use_no_space);
-		sm_cloud->fields[field_index].name = "intensity"; //we always use intensity as name... even if it is curvature or another field.
-	}
-
-	//Now do the actual computation
+	//Now do the actual computation (the points are directly converted to the right PCL point type)
 	pcl::PointCloud<pcl::PointXYZ> out_cloud;
 	if (m_mode == SCALAR_FIELD)
 	{
-		pcl::PointCloud<pcl::PointXYZI>::Ptr cloud_i(new pcl::PointCloud<pcl::PointXYZI>);
-		FROM_PCL_CLOUD(*sm_cloud, *cloud_i);
+		pcl::PointCloud<pcl::PointXYZI>::Ptr cloud_i = cc2smReader(cloud).getAsPointXYZI(m_field_to_use);
+		if (!cloud_i)
+		{
+			return NotEnoughMemory;
+		}
 		EstimateSIFT<pcl::PointXYZI, pcl::PointXYZ>(cloud_i, out_cloud, m_nr_octaves, m_min_scale, m_nr_scales_per_octave, m_min_contrast );
 	}
 	else if (m_mode == RGB)
 	{
-		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rgb(new pcl::PointCloud<pcl::PointXYZRGB>);
-		FROM_PCL_CLOUD(*sm_cloud, *cloud_rgb);
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_rgb = cc2smReader(cloud).getAsPointXYZRGB();
+		if (!cloud_rgb)
+		{
+			return NotEnoughMemory;
+		}
 		EstimateSIFT<pcl::PointXYZRGB, pcl::PointXYZ>(cloud_rgb, out_cloud, m_nr_octaves, m_min_scale, m_nr_scales_per_octave, m_min_contrast );
 	}
 
-	PCLCloud out_cloud_sm;
-	TO_PCL_CLOUD(out_cloud, out_cloud_sm);
-
-	if (out_cloud_sm.height * out_cloud_sm.width == 0)
+	if (out_cloud.empty())
 	{
 		//cloud is empty
 		return EmptyOutput;
 	}
 
-	ccPointCloud* out_cloud_cc = pcl2cc::Convert(out_cloud_sm);
+	ccPointCloud* out_cloud_cc = pcl2cc::Convert(out_cloud);
 	if (!out_cloud_cc)
 	{
 		//conversion failed (not enough memory?)
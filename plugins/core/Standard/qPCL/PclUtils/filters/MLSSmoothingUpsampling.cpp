@@ -19,7 +19,6 @@
 
 //Local
 #include "dialogs/MLSDialog.h"
-#include "../utils/PCLConv.h"
 #include "../utils/cc2sm.h"
 #include "../utils/sm2cc.h"
 
@@ -151,10 +150,8 @@ int MLSSmoothingUpsampling::compute()
 	SmoothMLS<pcl::PointXYZ, pcl::PointNormal> (xyzCloud, m_parameters, rawCloudWithNormals);
 #endif
 
-	PCLCloud cloudWithNormals;
-	TO_PCL_CLOUD(*rawCloudWithNormals, cloudWithNormals);
-
-	ccPointCloud* outputCCCloud = pcl2cc::Convert(cloudWithNormals);
+	//direct conversion (no intermediate PCLPointCloud2)
+	ccPointCloud* outputCCCloud = pcl2cc::Convert(*rawCloudWithNormals);
 	if (!outputCCCloud)
 	{
 		//conversion failed (not enough memory?)
@@ -19,45 +19,21 @@
 
 //Local
 #include "dialogs/NormalEstimationDlg.h"
-#include "../utils/PCLConv.h"
-#include "../utils/cc2sm.h"
-#include "../utils/sm2cc.h"
+#include "../utils/ccCloudView.h"
 
 //PCL
-#include <pcl/features/impl/normal_3d_omp.hpp>
+#include <pcl/features/normal_3d.h>
 
 //qCC_plugins
 #include <ccMainAppInterface.h>
 
 //qCC_db
 #include <ccPointCloud.h>
+#include <ccScalarField.h>
 
 //Qt
 #include <QMainWindow>
 
-template <typename PointInT, typename PointOutT>
-int ComputeNormals(	const typename pcl::PointCloud<PointInT>::Ptr incloud,
-					float radius,
-					bool useKnn, //true if use knn, false if radius search
-					typename pcl::PointCloud<PointOutT>& outcloud)
-{
-	typename pcl::NormalEstimationOMP<PointInT, PointOutT> normalEstimator;
-	
-	if (useKnn) //use knn
-	{
-		normalEstimator.setKSearch(static_cast<int>(radius)); //cast to int
-	}
-	else //use radius search
-	{
-		normalEstimator.setRadiusSearch(radius);
-	}
-
-	normalEstimator.setInputCloud(incloud);
-	normalEstimator.compute(outcloud);
-
-	return BaseFilter::Success;
-}
-
 NormalEstimation::NormalEstimation()
 	: BaseFilter(FilterDescription(	"Estimate Normals",
 									"Estimate Normals and Curvature",
@@ -113,50 +89,118 @@ int NormalEstimation::compute()
 	if (!cloud)
 		return InvalidInput;
 
-	//get xyz as a PCL cloud
-	pcl::PointCloud<pcl::PointXYZ>::Ptr xyzCloud = cc2smReader(cloud).getRawXYZ();
-	if (!xyzCloud)
-	{
-		return ComputationError;
-	}
+	unsigned pointCount = cloud->size();
+	if (pointCount == 0)
+		return InvalidInput;
 
-	//now compute the normals
-	pcl::PointCloud<pcl::PointNormal> rawCloudWithNormals;
-	int result = ComputeNormals<pcl::PointXYZ, pcl::PointNormal>(xyzCloud, m_useKnn ? m_knn_radius: m_radius, m_useKnn, rawCloudWithNormals);
-	if (result < 0)
+	//the neighbors are searched directly in the cloud coordinates (no conversion to a PCL cloud)
+	ccCloudView cloudView(cloud);
+	if (!cloudView.buildIndex())
 	{
-		return ComputationError;
+		return NotEnoughMemory;
 	}
 
-	//if we have normals delete them!
-	if (!cloud->hasNormals())
+	//the curvature values are directly written in a scalar field
+	static const char s_curvatureSFName[] = "curvature";
+	int curvatureSFIdx = cloud->getScalarFieldIndexByName(s_curvatureSFName);
+	ccScalarField* curvatureSF = nullptr;
+	if (curvatureSFIdx < 0 || m_overwrite_curvature)
 	{
-		if (!cloud->resizeTheNormsTable())
+		curvatureSF = new ccScalarField(s_curvatureSFName);
+		if (!curvatureSF->resizeSafe(pointCount))
 		{
+			curvatureSF->release();
 			return NotEnoughMemory;
 		}
 	}
 
-	//copy the notmals
-	unsigned pointCount = cloud->size();
-	for (unsigned i = 0; i < pointCount; ++i)
+	//if we have no normals, we create them
+	//(otherwise we make sure they are not shared with another cloud, as they are modified concurrently)
+	bool normalsReady = cloud->hasNormals() ? cloud->detachNormals() : cloud->resizeTheNormsTable();
+	if (!normalsReady)
+	{
+		if (curvatureSF)
+			curvatureSF->release();
+		return NotEnoughMemory;
+	}
+
+	//now compute the normals (same as pcl::NormalEstimation, with the default (0, 0, 0) viewpoint)
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
 	{
-		const pcl::PointNormal& point = rawCloudWithNormals[i];
-		CCVector3 N(static_cast<PointCoordinateType>(point.normal_x),
-					static_cast<PointCoordinateType>(point.normal_y),
-					static_cast<PointCoordinateType>(point.normal_z));
+		std::vector<int> indices;
+		std::vector<PointCoordinateType> sqrDistances;
 
-		cloud->setPointNormal(i, N);
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic, 1024)
+#endif
+		for (int i = 0; i < static_cast<int>(pointCount); ++i)
+		{
+			const CCVector3* P = cloudView.getPoint(i);
+			int neighborCount = (m_useKnn	? cloudView.nearestKSearch(*P, m_knn_radius, indices, sqrDistances)
+											: cloudView.radiusSearch(*P, m_radius, indices, sqrDistances) );
+
+			CCVector3 N(0, 0, 0);
+			ScalarType curvature = CCCoreLib::NAN_VALUE;
+			if (neighborCount >= 3)
+			{
+				//centroid
+				Eigen::Vector3d G(0, 0, 0);
+				for (int j = 0; j < neighborCount; ++j)
+				{
+					const CCVector3* Q = cloudView.getPoint(indices[j]);
+					G += Eigen::Vector3d(Q->x, Q->y, Q->z);
+				}
+				G /= neighborCount;
+
+				//covariance matrix
+				Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+				for (int j = 0; j < neighborCount; ++j)
+				{
+					const CCVector3* Q = cloudView.getPoint(indices[j]);
+					Eigen::Vector3d D = Eigen::Vector3d(Q->x, Q->y, Q->z) - G;
+					covariance += D * D.transpose();
+				}
+				covariance /= neighborCount;
+
+				float nx = 0.0f;
+				float ny = 0.0f;
+				float nz = 0.0f;
+				float c = 0.0f;
+				pcl::solvePlaneParameters(covariance.cast<float>(), nx, ny, nz, c);
+
+				N = CCVector3(	static_cast<PointCoordinateType>(nx),
+								static_cast<PointCoordinateType>(ny),
+								static_cast<PointCoordinateType>(nz) );
+				//flip the normal towards the viewpoint
+				if (N.dot(*P) > 0)
+				{
+					N = -N;
+				}
+				curvature = static_cast<ScalarType>(c);
+			}
+
+			cloud->setPointNormal(i, N);
+			if (curvatureSF)
+			{
+				curvatureSF->setValue(i, curvature);
+			}
+		}
 	}
 	cloud->showNormals(true);
 
-	// FIXME: find a way to avoid converting to a PCLPointCloud2 just to get the curvature values!
-	PCLCloud::Ptr cloudWithNormals(new PCLCloud);
-	TO_PCL_CLOUD(rawCloudWithNormals, *cloudWithNormals);
-	pcl2cc::CopyScalarField(*cloudWithNormals, "curvature", *cloud, m_overwrite_curvature);
+	if (curvatureSF)
+	{
+		if (curvatureSFIdx >= 0)
+		{
+			cloud->deleteScalarField(curvatureSFIdx);
+		}
+		curvatureSF->computeMinAndMax();
+		cloud->addScalarField(curvatureSF);
+	}
 
 	Q_EMIT entityHasChanged(cloud);
 
 	return Success;
 }
-
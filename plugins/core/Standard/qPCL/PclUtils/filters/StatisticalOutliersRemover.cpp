@@ -19,11 +19,7 @@
 
 //Local
 #include "dialogs/StatisticalOutliersRemoverDlg.h"
-#include "../utils/cc2sm.h"
-#include "../utils/sm2cc.h"
-
-//PCL
-#include <pcl/filters/statistical_outlier_removal.h>
+#include "../utils/ccCloudView.h"
 
 //qCC_plugins
 #include <ccMainAppInterface.h>
@@ -34,8 +30,9 @@
 //Qt
 #include <QMainWindow>
 
-//Boost
-#include <boost/make_shared.hpp>
+//system
+#include <algorithm>
+#include <cmath>
 
 StatisticalOutliersRemover::StatisticalOutliersRemover()
 	: BaseFilter(FilterDescription("Statistical Outlier Removal",
@@ -60,26 +57,83 @@ int StatisticalOutliersRemover::compute()
 		return InvalidInput;
 	}
 
-	//now as sensor message
-	PCLCloud::Ptr tmp_cloud = cc2smReader(cloud).getAsSM();
-	if (!tmp_cloud)
+	unsigned pointCount = cloud->size();
+	if (pointCount == 0 || m_kNN <= 0)
 	{
-		return ComputationError;
+		return InvalidParameters;
 	}
 
-	PCLCloud outcloud;
+	//the neighbors are searched directly in the cloud coordinates (no conversion to a PCL cloud)
+	ccCloudView cloudView(cloud);
+	std::vector<double> meanDistances;
+	try
+	{
+		meanDistances.resize(pointCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return NotEnoughMemory;
+	}
+	if (!cloudView.buildIndex())
+	{
+		return NotEnoughMemory;
+	}
 
-	pcl::StatisticalOutlierRemoval<PCLCloud> remover;
-	remover.setInputCloud(tmp_cloud);
-	remover.setMeanK(m_kNN);
-	remover.setStddevMulThresh(m_std);
-	remover.filter(outcloud);
+	//mean distance of each point to its neighbors (same as pcl::StatisticalOutlierRemoval)
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+	{
+		std::vector<int> indices;
+		std::vector<PointCoordinateType> sqrDistances;
+
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic, 1024)
+#endif
+		for (int i = 0; i < static_cast<int>(pointCount); ++i)
+		{
+			//the first neighbor is the point itself
+			int neighborCount = cloudView.nearestKSearch(*cloudView.getPoint(i), m_kNN + 1, indices, sqrDistances);
+			double sumDist = 0.0;
+			for (int j = 1; j < neighborCount; ++j)
+			{
+				sumDist += sqrt(static_cast<double>(sqrDistances[j]));
+			}
+			meanDistances[i] = (neighborCount > 1 ? sumDist / (neighborCount - 1) : 0.0);
+		}
+	}
+
+	//mean and standard deviation of the mean distances
+	double sum = 0.0;
+	double sum2 = 0.0;
+	for (double d : meanDistances)
+	{
+		sum += d;
+		sum2 += d * d;
+	}
+	double mean = sum / pointCount;
+	double variance = (pointCount > 1 ? (sum2 - sum * sum / pointCount) / (pointCount - 1) : 0.0);
+	double distanceThreshold = mean + m_std * sqrt(std::max(variance, 0.0));
+
+	//the inliers are directly extracted from the original cloud (with all their features)
+	CCCoreLib::ReferenceCloud inliers(cloud);
+	if (!inliers.reserve(pointCount))
+	{
+		return NotEnoughMemory;
+	}
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		if (meanDistances[i] <= distanceThreshold)
+		{
+			inliers.addPointIndex(i);
+		}
+	}
+	meanDistances.clear();
 
-	//get back outcloud as a ccPointCloud
-	ccPointCloud* final_cloud = pcl2cc::Convert(outcloud);
+	ccPointCloud* final_cloud = cloud->partialClone(&inliers);
 	if (!final_cloud)
 	{
-		return ComputationError;
+		return NotEnoughMemory;
 	}
 
 	//create a suitable name for the entity
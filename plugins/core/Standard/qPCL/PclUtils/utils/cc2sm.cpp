@@ -382,3 +382,84 @@ pcl::PointCloud<pcl::PointNormal>::Ptr cc2smReader::getAsPointNormal() const
 	
 	return pcl_cloud;
 }
+
+pcl::PointCloud<pcl::PointXYZI>::Ptr cc2smReader::getAsPointXYZI(const QString& sfName) const
+{
+	if (!m_ccCloud)
+	{
+		assert(false);
+		return {};
+	}
+
+	int sfIdx = m_ccCloud->getScalarFieldIndexByName(sfName.toStdString());
+	if (sfIdx < 0)
+	{
+		return {};
+	}
+	const CCCoreLib::ScalarField* sf = m_ccCloud->getScalarField(sfIdx);
+	assert(sf);
+
+	PointCloud<pcl::PointXYZI>::Ptr pcl_cloud(new PointCloud<pcl::PointXYZI>);
+
+	unsigned pointCount = m_ccCloud->size();
+
+	try
+	{
+		pcl_cloud->resize(pointCount);
+	}
+	catch (...)
+	{
+		//any error (memory, etc.)
+		return {};
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		const CCVector3* P = m_ccCloud->getPoint(i);
+		pcl::PointXYZI& point = pcl_cloud->at(i);
+		point.x = static_cast<float>(P->x);
+		point.y = static_cast<float>(P->y);
+		point.z = static_cast<float>(P->z);
+		point.intensity = static_cast<float>(sf->getValue(i));
+	}
+
+	return pcl_cloud;
+}
+
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr cc2smReader::getAsPointXYZRGB() const
+{
+	if (!m_ccCloud || !m_ccCloud->hasColors())
+	{
+		assert(false);
+		return {};
+	}
+
+	PointCloud<pcl::PointXYZRGB>::Ptr pcl_cloud(new PointCloud<pcl::PointXYZRGB>);
+
+	unsigned pointCount = m_ccCloud->size();
+
+	try
+	{
+		pcl_cloud->resize(pointCount);
+	}
+	catch (...)
+	{
+		//any error (memory, etc.)
+		return {};
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		const CCVector3* P = m_ccCloud->getPoint(i);
+		const ccColor::Rgb& rgb = m_ccCloud->getPointColor(i);
+		pcl::PointXYZRGB& point = pcl_cloud->at(i);
+		point.x = static_cast<float>(P->x);
+		point.y = static_cast<float>(P->y);
+		point.z = static_cast<float>(P->z);
+		point.r = static_cast<uint8_t>(rgb.r);
+		point.g = static_cast<uint8_t>(rgb.g);
+		point.b = static_cast<uint8_t>(rgb.b);
+	}
+
+	return pcl_cloud;
+}
@@ -53,6 +53,12 @@ public:
 	//! Converts the ccPointCloud to a 'pcl::PointNormal' cloud
 	pcl::PointCloud<pcl::PointNormal>::Ptr getAsPointNormal() const;
 
+	//! Converts the ccPointCloud to a 'pcl::PointXYZI' cloud (the intensity is read from a scalar field)
+	pcl::PointCloud<pcl::PointXYZI>::Ptr getAsPointXYZI(const QString& sfName) const;
+
+	//! Converts the ccPointCloud to a 'pcl::PointXYZRGB' cloud
+	pcl::PointCloud<pcl::PointXYZRGB>::Ptr getAsPointXYZRGB() const;
+
 	static std::string GetSimplifiedSFName(const QString& ccSfName);
 
 protected:
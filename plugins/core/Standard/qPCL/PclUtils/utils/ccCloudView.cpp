@@ -0,0 +1,118 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qPCL                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+//
+#include "ccCloudView.h"
+
+//FLANN (PCL dependency)
+#include <flann/flann.hpp>
+
+//system
+#include <algorithm>
+#include <cassert>
+
+struct ccCloudView::Index
+{
+	using Distance = flann::L2_Simple<PointCoordinateType>;
+
+	Index(const flann::Matrix<PointCoordinateType>& data, int maxLeafSize)
+		//no reordering, otherwise FLANN would copy the coordinates
+		: kdTree(data, flann::KDTreeSingleIndexParams(maxLeafSize, false))
+	{
+	}
+
+	flann::KDTreeSingleIndex<Distance> kdTree;
+};
+
+ccCloudView::ccCloudView(const ccPointCloud* cloud)
+	: m_cloud(cloud)
+{
+	assert(m_cloud);
+}
+
+ccCloudView::~ccCloudView() = default;
+
+bool ccCloudView::buildIndex(int maxLeafSize/*=15*/)
+{
+	m_index.reset();
+
+	unsigned pointCount = size();
+	if (pointCount == 0)
+	{
+		return false;
+	}
+
+	//the coordinates are stored contiguously in the cloud: FLANN can read them in place
+	flann::Matrix<PointCoordinateType> data(const_cast<PointCoordinateType*>(m_cloud->getPoint(0)->u),
+											pointCount,
+											3,
+											sizeof(CCVector3)); //stride (in bytes)
+
+	try
+	{
+		m_index.reset(new Index(data, std::max(maxLeafSize, 1)));
+		m_index->kdTree.buildIndex();
+	}
+	catch (...)
+	{
+		//any error (memory, etc.)
+		m_index.reset();
+		return false;
+	}
+
+	return true;
+}
+
+int ccCloudView::nearestKSearch(const CCVector3& P, int k, std::vector<int>& indices, std::vector<PointCoordinateType>& sqrDistances) const
+{
+	k = std::min(k, static_cast<int>(size()));
+	if (!m_index || k <= 0)
+	{
+		indices.clear();
+		sqrDistances.clear();
+		return 0;
+	}
+
+	indices.resize(k);
+	sqrDistances.resize(k);
+
+	flann::Matrix<PointCoordinateType> query(const_cast<PointCoordinateType*>(P.u), 1, 3);
+	flann::Matrix<int> indicesMat(indices.data(), 1, k);
+	flann::Matrix<PointCoordinateType> sqrDistancesMat(sqrDistances.data(), 1, k);
+	m_index->kdTree.knnSearch(query, indicesMat, sqrDistancesMat, k, flann::SearchParams(-1, 0.0f, true));
+
+	return k;
+}
+
+int ccCloudView::radiusSearch(const CCVector3& P, PointCoordinateType radius, std::vector<int>& indices, std::vector<PointCoordinateType>& sqrDistances) const
+{
+	indices.clear();
+	sqrDistances.clear();
+	if (!m_index || radius <= 0)
+	{
+		return 0;
+	}
+
+	flann::Matrix<PointCoordinateType> query(const_cast<PointCoordinateType*>(P.u), 1, 3);
+	std::vector< std::vector<int> > indicesVec(1);
+	std::vector< std::vector<PointCoordinateType> > sqrDistancesVec(1);
+	m_index->kdTree.radiusSearch(query, indicesVec, sqrDistancesVec, static_cast<float>(radius * radius), flann::SearchParams(-1, 0.0f, true));
+
+	indices.swap(indicesVec.front());
+	sqrDistances.swap(sqrDistancesVec.front());
+
+	return static_cast<int>(indices.size());
+}
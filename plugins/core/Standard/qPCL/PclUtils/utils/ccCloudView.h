@@ -0,0 +1,85 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qPCL                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+//
+#ifndef Q_PCL_PLUGIN_CC_CLOUD_VIEW_H
+#define Q_PCL_PLUGIN_CC_CLOUD_VIEW_H
+
+//qCC_db
+#include <ccPointCloud.h>
+
+//system
+#include <memory>
+#include <vector>
+
+//! Zero-copy view on the coordinates of a ccPointCloud, for nearest neighbors searches
+/** The PCL search classes (pcl::KdTreeFLANN, pcl::search::KdTree) always copy the input
+	points (through their point representation) in a contiguous FLANN matrix, which itself
+	requires the whole cloud to be converted to a pcl::PointCloud first.
+	This view gives FLANN (the library behind these classes) a strided access to the
+	coordinates stored in the ccPointCloud itself: the kd-tree only stores indexes.
+	The normals and scalar fields can be read (or written) in place with the point indexes.
+	\warning The cloud must not be modified (points added or removed) while the view is used.
+**/
+class ccCloudView
+{
+public:
+
+	//! Default constructor
+	explicit ccCloudView(const ccPointCloud* cloud);
+
+	//! Destructor
+	~ccCloudView();
+
+	//! Builds the kd-tree (the coordinates are not copied)
+	/** \return success
+	**/
+	bool buildIndex(int maxLeafSize = 15);
+
+	//! Returns the associated cloud
+	inline const ccPointCloud* cloud() const { return m_cloud; }
+
+	//! Returns the number of points
+	inline unsigned size() const { return m_cloud ? m_cloud->size() : 0; }
+
+	//! Returns a point (in place)
+	inline const CCVector3* getPoint(unsigned index) const { return m_cloud->getPoint(index); }
+
+	//! Searches for the k nearest neighbors of a point
+	/** Same semantic as pcl::search::Search::nearestKSearch (the query point is returned if it belongs to the cloud).
+		Can be called concurrently (once the index is built).
+		\return the number of neighbors found
+	**/
+	int nearestKSearch(const CCVector3& P, int k, std::vector<int>& indices, std::vector<PointCoordinateType>& sqrDistances) const;
+
+	//! Searches for the neighbors of a point in a sphere
+	/** Same semantic as pcl::search::Search::radiusSearch (the neighbors are sorted by increasing distance).
+		Can be called concurrently (once the index is built).
+		\return the number of neighbors found
+	**/
+	int radiusSearch(const CCVector3& P, PointCoordinateType radius, std::vector<int>& indices, std::vector<PointCoordinateType>& sqrDistances) const;
+
+protected:
+
+	//! Associated cloud
+	const ccPointCloud* m_cloud;
+
+	//! Kd-tree (hidden so as to not expose FLANN)
+	struct Index;
+	std::unique_ptr<Index> m_index;
+};
+
+#endif // Q_PCL_PLUGIN_CC_CLOUD_VIEW_H
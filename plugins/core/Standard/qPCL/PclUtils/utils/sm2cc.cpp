@@ -484,3 +484,61 @@ ccPointCloud* pcl2cc::Convert(	const PCLCloud& pclCloud,
 
 	return ccCloud;
 }
+
+ccPointCloud* pcl2cc::Convert(const pcl::PointCloud<pcl::PointXYZ>& pclCloud)
+{
+	size_t pointCount = pclCloud.size();
+
+	ccPointCloud* ccCloud = new ccPointCloud();
+	if (!ccCloud->reserve(static_cast<unsigned>(pointCount)))
+	{
+		delete ccCloud;
+		return nullptr;
+	}
+
+	for (const pcl::PointXYZ& point : pclCloud)
+	{
+		ccCloud->addPoint(CCVector3(static_cast<PointCoordinateType>(point.x),
+									static_cast<PointCoordinateType>(point.y),
+									static_cast<PointCoordinateType>(point.z)));
+	}
+
+	return ccCloud;
+}
+
+ccPointCloud* pcl2cc::Convert(const pcl::PointCloud<pcl::PointNormal>& pclCloud)
+{
+	unsigned pointCount = static_cast<unsigned>(pclCloud.size());
+
+	ccPointCloud* ccCloud = new ccPointCloud();
+	if (!ccCloud->reserve(pointCount) || !ccCloud->reserveTheNormsTable())
+	{
+		delete ccCloud;
+		return nullptr;
+	}
+
+	ccScalarField* curvatureSF = new ccScalarField("curvature");
+	if (!curvatureSF->reserveSafe(pointCount))
+	{
+		curvatureSF->release();
+		delete ccCloud;
+		return nullptr;
+	}
+
+	for (const pcl::PointNormal& point : pclCloud)
+	{
+		ccCloud->addPoint(CCVector3(static_cast<PointCoordinateType>(point.x),
+									static_cast<PointCoordinateType>(point.y),
+									static_cast<PointCoordinateType>(point.z)));
+		ccCloud->addNorm(CCVector3(	static_cast<PointCoordinateType>(point.normal_x),
+									static_cast<PointCoordinateType>(point.normal_y),
+									static_cast<PointCoordinateType>(point.normal_z)));
+		curvatureSF->addElement(static_cast<ScalarType>(point.curvature));
+	}
+	ccCloud->showNormals(true);
+
+	curvatureSF->computeMinAndMax();
+	ccCloud->addScalarField(curvatureSF);
+
+	return ccCloud;
+}
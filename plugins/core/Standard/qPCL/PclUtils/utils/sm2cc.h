@@ -20,6 +20,10 @@
 //Local
 #include "PCLCloud.h"
 
+//PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
 //qCC_db
 #include <ccPointCloud.h>
 
@@ -38,6 +42,12 @@ public:
 									ccGLMatrixd* _transform = nullptr,
 									FileIOFilter::LoadParameters* _loadParameters = nullptr );
 
+	//! Converts a PCL 'PointXYZ' cloud to a ccPointCloud (without intermediate PCLPointCloud2)
+	static ccPointCloud* Convert(const pcl::PointCloud<pcl::PointXYZ>& pclCloud);
+
+	//! Converts a PCL 'PointNormal' cloud to a ccPointCloud (with normals and a 'curvature' scalar field)
+	static ccPointCloud* Convert(const pcl::PointCloud<pcl::PointNormal>& pclCloud);
+
 public: // other related utility functions
 
 	static bool CopyXYZ(const PCLCloud& pclCloud,
@@ -46,6 +46,7 @@ public:
 		\param height height of the OpenGL context used to simulate illumination
 		\param progressCb optional progress bar (optional)
 		\param entityName entity name (optional)
+		\param softwareRenderer whether to use the (multi-threaded) software renderer instead of OpenGL
 		\return number of 'light' directions actually used (or a value <0 if an error occurred)
 	**/
 	static int Launch(	unsigned numberOfRays,
@@ -56,7 +57,8 @@ public:
 						unsigned width = 1024,
 						unsigned height = 1024,
 						CCCoreLib::GenericProgressCallback* progressCb = nullptr,
-						const QString& entityName = QString());
+						const QString& entityName = QString(),
+						bool softwareRenderer = false);
 
 	//! Simulates global illumination on a cloud (or a mesh) with OpenGL
 	/** Computes per-vertex illumination intensity as a scalar field.
@@ -68,7 +70,9 @@ public:
 		\param height height of the OpenGL context used to simulate illumination
 		\param progressCb optional progress bar (optional)
 		\param entityName entity name (optional)
+		\param softwareRenderer whether to use the (multi-threaded) software renderer instead of OpenGL
 		\return success
+		\warning the software renderer is also used if no OpenGL context can be created (e.g. on a headless server)
 	**/
 	static bool Launch(	const std::vector<CCVector3>& rays,
 						CCCoreLib::GenericCloud* vertices,
@@ -77,7 +81,8 @@ public:
 						unsigned width = 1024,
 						unsigned height = 1024,
 						CCCoreLib::GenericProgressCallback* progressCb = nullptr,
-						const QString& entityName = QString());
+						const QString& entityName = QString(),
+						bool softwareRenderer = false);
 
 	//! Generates a given number of rays
 	static bool GenerateRays(	unsigned numberOfRays,
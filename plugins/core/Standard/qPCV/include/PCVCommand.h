@@ -38,7 +38,8 @@ public:
 							bool meshIsClosed,
 							unsigned resolution,
 							ccProgressDialog* progressDlg = nullptr,
-							ccMainAppInterface* app = nullptr);
+							ccMainAppInterface* app = nullptr,
+							bool softwareRenderer = false);
 
 	bool process(ccCommandLineInterface& cmd) override;
 };
@@ -0,0 +1,97 @@
+//##########################################################################
+//#                                                                        #
+//#                                PCV                                     #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef PCV_RASTERIZER_HEADER
+#define PCV_RASTERIZER_HEADER
+
+//CCCoreLib
+#include <GenericCloud.h>
+#include <GenericMesh.h>
+#include <GenericProgressCallback.h>
+
+//system
+#include <vector>
+
+//! PCV (Portion de Ciel Visible / Ambiant Illumination) software renderer
+/** CPU counterpart of PCVContext: the entity is rasterized in an orthographic
+	depth map for each light direction, without any OpenGL context. The same
+	projection, depth offsets and face culling rules as PCVContext are used,
+	so that both backends give (almost) the same results.
+	Several directions are processed concurrently (one depth map per thread).
+**/
+class PCVRasterizer
+{
+public:
+	//! Default constructor
+	PCVRasterizer();
+
+	//! Initialization
+	/** \param W depth map width (pixels)
+		\param H depth map height (pixels)
+		\param cloud associated cloud (or mesh vertices)
+		\param mesh associated mesh (if any)
+		\param closedMesh whether mesh is closed (faster) or not
+		\return initialization success
+	**/
+	bool init(	unsigned W,
+				unsigned H,
+				CCCoreLib::GenericCloud* cloud,
+				CCCoreLib::GenericMesh* mesh = nullptr,
+				bool closedMesh = true);
+
+	//! Increments the visibility counter of each vertex for all the light directions it is viewed from
+	/** \param rays light directions
+		\param visibilityCount per-vertex visibility count (same size as the number of vertices)
+		\param progressCb optional progress callback
+		\return success
+	**/
+	bool accumulate(const std::vector<CCVector3>& rays,
+					std::vector<int>& visibilityCount,
+					CCCoreLib::GenericProgressCallback* progressCb = nullptr) const;
+
+protected:
+
+	//! Depth map (one per thread)
+	struct DepthMap
+	{
+		std::vector<float> depth;
+		std::vector<unsigned char> coverage; //only for non closed meshes
+	};
+
+	//! Renders the entity for a given direction and flags the vertices seen
+	void accumPixel(const CCVector3& V, DepthMap& map, std::vector<int>& visibilityCount) const;
+
+	//! Vertices (copy)
+	std::vector<CCVector3> m_vertices;
+	//! Triangles (3 consecutive vertices per triangle - optional)
+	std::vector<CCVector3> m_triangles;
+
+	//! Zoom
+	PointCoordinateType m_zoom;
+	//! Entity center
+	CCVector3 m_viewCenter;
+
+	//! Depth map width (pixels)
+	unsigned m_width;
+	//! Depth map height (pixels)
+	unsigned m_height;
+
+	//! Whether displayed mesh is closed or not
+	bool m_meshIsClosed;
+};
+
+#endif
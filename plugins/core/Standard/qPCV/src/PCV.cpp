@@ -18,6 +18,10 @@
 
 #include "PCV.h"
 #include "PCVContext.h"
+#include "PCVRasterizer.h"
+
+//qCC_db
+#include <ccLog.h>
 
 //Qt
 #include <QString>
@@ -209,7 +213,8 @@ int PCV::Launch(unsigned numberOfRays,
 				unsigned width/*=1024*/,
 				unsigned height/*=1024*/,
 				CCCoreLib::GenericProgressCallback* progressCb/*=nullptr*/,
-				const QString& entityName/*=QString()*/)
+				const QString& entityName/*=QString()*/,
+				bool softwareRenderer/*=false*/)
 {
 	//generates light directions
 	std::vector<CCVector3> rays;
@@ -218,7 +223,7 @@ int PCV::Launch(unsigned numberOfRays,
 		return -2;
 	}
 
-	if (!Launch(rays, vertices, mesh, meshIsClosed, width, height, progressCb, entityName))
+	if (!Launch(rays, vertices, mesh, meshIsClosed, width, height, progressCb, entityName, softwareRenderer))
 	{
 		return -1;
 	}
@@ -233,7 +238,8 @@ bool PCV::Launch(const std::vector<CCVector3>& rays,
 				 unsigned width/*=1024*/,
 				 unsigned height/*=1024*/,
 				 CCCoreLib::GenericProgressCallback* progressCb/*=nullptr*/,
-				 const QString& entityName/*=QString()*/)
+				 const QString& entityName/*=QString()*/,
+				 bool softwareRenderer/*=false*/)
 {
 	if (rays.empty())
 		return false;
@@ -284,7 +290,19 @@ bool PCV::Launch(const std::vector<CCVector3>& rays,
 
 	//must be done after progress dialog display!
 	PCVContext win;
-	if (win.init(width, height, vertices, mesh, meshIsClosed))
+	if (!softwareRenderer && !win.init(width, height, vertices, mesh, meshIsClosed))
+	{
+		ccLog::Warning("[PCV] Failed to create the OpenGL context, the software renderer will be used instead");
+		softwareRenderer = true;
+	}
+
+	if (softwareRenderer)
+	{
+		//all the directions are rendered concurrently
+		PCVRasterizer rasterizer;
+		success = (rasterizer.init(width, height, vertices, mesh, meshIsClosed) && rasterizer.accumulate(rays, visibilityCount, progressCb));
+	}
+	else
 	{
 		for (unsigned i = 0; i < numberOfRays; ++i)
 		{
@@ -300,21 +318,17 @@ bool PCV::Launch(const std::vector<CCVector3>& rays,
 				break;
 			}
 		}
+	}
 
-		if (success)
+	if (success)
+	{
+		//we convert per-vertex accumulators to an 'intensity' scalar field
+		for (unsigned j = 0; j < numberOfPoints; ++j)
 		{
-			//we convert per-vertex accumulators to an 'intensity' scalar field
-			for (unsigned j = 0; j < numberOfPoints; ++j)
-			{
-				ScalarType visValue = static_cast<ScalarType>(visibilityCount[j]) / numberOfRays;
-				vertices->setPointScalarValue(j, visValue);
-			}
+			ScalarType visValue = static_cast<ScalarType>(visibilityCount[j]) / numberOfRays;
+			vertices->setPointScalarValue(j, visValue);
 		}
 	}
-	else
-	{
-		success = false;
-	}
 
 	return success;
 }
@@ -10,6 +10,9 @@
 #include <ccProgressDialog.h>
 #include <ccScalarField.h>
 
+//Qt
+#include <QScopedPointer>
+
 constexpr char CC_PCV_FIELD_LABEL_NAME[] = "Illuminance (PCV)";
 
 constexpr char COMMAND_PCV[] = "PCV";
@@ -17,6 +20,7 @@ constexpr char COMMAND_PCV_N_RAYS[] = "N_RAYS";
 constexpr char COMMAND_PCV_IS_CLOSED[] = "IS_CLOSED";
 constexpr char COMMAND_PCV_180[] = "180";
 constexpr char COMMAND_PCV_RESOLUTION[] = "RESOLUTION";
+constexpr char COMMAND_PCV_OPENGL[] = "OPENGL";
 
 PCVCommand::PCVCommand()
 	: Command("PCV", COMMAND_PCV)
@@ -28,7 +32,8 @@ bool PCVCommand::Process(	const ccHObject::Container& candidates,
 							bool meshIsClosed,
 							unsigned resolution,
 							ccProgressDialog* progressDlg/*=nullptr*/,
-							ccMainAppInterface* app/*=nullptr*/)
+							ccMainAppInterface* app/*=nullptr*/,
+							bool softwareRenderer/*=false*/)
 {
 	size_t count = 0;
 	size_t errorCount = 0;
@@ -89,7 +94,7 @@ bool PCVCommand::Process(	const ccHObject::Container& candidates,
 		bool wasVisible = obj->isVisible();
 		obj->setEnabled(true);
 		obj->setVisible(true);
-		bool success = PCV::Launch(rays, cloud, mesh, meshIsClosed, resolution, resolution, progressDlg, objNameForPorgressDialog);
+		bool success = PCV::Launch(rays, cloud, mesh, meshIsClosed, resolution, resolution, progressDlg, objNameForPorgressDialog, softwareRenderer);
 		obj->setEnabled(wasEnabled);
 		obj->setVisible(wasVisible);
 
@@ -153,6 +158,8 @@ bool PCVCommand::process(ccCommandLineInterface& cmd)
 	bool meshIsClosed = false;
 	bool mode360 = true;
 	unsigned resolution = 1024;
+	//the software renderer doesn't require any OpenGL context (headless servers, etc.) and uses all the cores
+	bool softwareRenderer = true;
 
 	while (!cmd.arguments().empty())
 	{
@@ -180,6 +187,11 @@ bool PCVCommand::process(ccCommandLineInterface& cmd)
 				return cmd.error(QObject::tr("Invalid parameter: value after \"-%1\"").arg(COMMAND_PCV_N_RAYS));
 			}
 		}
+		else if (ccCommandLineInterface::IsCommand(arg, COMMAND_PCV_OPENGL))
+		{
+			cmd.arguments().pop_front();
+			softwareRenderer = false;
+		}
 		else if (ccCommandLineInterface::IsCommand(arg, COMMAND_PCV_RESOLUTION))
 		{
 			cmd.arguments().pop_front();
@@ -203,8 +215,12 @@ bool PCVCommand::process(ccCommandLineInterface& cmd)
 		return cmd.error(QObject::tr("Failed to generate the set of rays"));
 	}
 
-	ccProgressDialog pcvProgressCb(true);
-	pcvProgressCb.setAutoClose(false);
+	QScopedPointer<ccProgressDialog> pcvProgressCb(nullptr);
+	if (!cmd.silentMode())
+	{
+		pcvProgressCb.reset(new ccProgressDialog(true, cmd.widgetParent()));
+		pcvProgressCb->setAutoClose(false);
+	}
 
 	ccHObject::Container candidates;
 	try
@@ -221,7 +237,7 @@ bool PCVCommand::process(ccCommandLineInterface& cmd)
 	for (CLMeshDesc& desc : cmd.meshes())
 		candidates.push_back(desc.mesh);
 
-	if (!Process(candidates, rays, meshIsClosed, resolution, &pcvProgressCb, nullptr))
+	if (!Process(candidates, rays, meshIsClosed, resolution, pcvProgressCb.data(), nullptr, softwareRenderer))
 	{
 		return cmd.error(QObject::tr("Process failed"));
 	}
@@ -0,0 +1,344 @@
+//##########################################################################
+//#                                                                        #
+//#                                PCV                                     #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the License.  #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "PCVRasterizer.h"
+
+//CCCoreLib
+#include <CCMath.h>
+#include <GenericTriangle.h>
+
+//system
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+using namespace CCCoreLib;
+
+//same depth offset as PCVContext
+#ifndef ZTWIST
+#define ZTWIST 1e-3f
+#endif
+
+PCVRasterizer::PCVRasterizer()
+	: m_zoom(1)
+	, m_width(0)
+	, m_height(0)
+	, m_meshIsClosed(false)
+{
+}
+
+bool PCVRasterizer::init(	unsigned W,
+							unsigned H,
+							CCCoreLib::GenericCloud* cloud,
+							CCCoreLib::GenericMesh* mesh/*=nullptr*/,
+							bool closedMesh/*=true*/)
+{
+	assert(cloud);
+	if (!cloud || W == 0 || H == 0)
+	{
+		return false;
+	}
+
+	//we copy the vertices and the triangles, as GenericCloud and GenericMesh
+	//can only be browsed with (non thread-safe) iterators
+	try
+	{
+		unsigned nVert = cloud->size();
+		m_vertices.resize(nVert);
+		cloud->placeIteratorAtBeginning();
+		for (unsigned i = 0; i < nVert; ++i)
+		{
+			m_vertices[i] = *cloud->getNextPoint();
+		}
+
+		m_triangles.clear();
+		if (mesh)
+		{
+			unsigned nTri = mesh->size();
+			m_triangles.resize(3 * static_cast<size_t>(nTri));
+			mesh->placeIteratorAtBeginning();
+			for (unsigned i = 0; i < nTri; ++i)
+			{
+				GenericTriangle* t = mesh->_getNextTriangle();
+				m_triangles[3 * static_cast<size_t>(i)    ] = *t->_getA();
+				m_triangles[3 * static_cast<size_t>(i) + 1] = *t->_getB();
+				m_triangles[3 * static_cast<size_t>(i) + 2] = *t->_getC();
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_vertices.clear();
+		m_triangles.clear();
+		return false;
+	}
+
+	m_width = W;
+	m_height = H;
+	m_meshIsClosed = (closedMesh || !mesh);
+
+	//same zoom and view center as PCVContext
+	CCVector3 bbMin;
+	CCVector3 bbMax;
+	cloud->getBoundingBox(bbMin, bbMax);
+	PointCoordinateType maxD = (bbMax - bbMin).norm();
+	m_zoom = (CCCoreLib::GreaterThanEpsilon(maxD) ? static_cast<PointCoordinateType>(std::min(m_width, m_height)) / maxD : CCCoreLib::PC_ONE);
+	m_viewCenter = (bbMax + bbMin) / 2;
+
+	return true;
+}
+
+bool PCVRasterizer::accumulate(	const std::vector<CCVector3>& rays,
+								std::vector<int>& visibilityCount,
+								CCCoreLib::GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	if (m_vertices.size() != visibilityCount.size() || m_width == 0 || m_height == 0)
+	{
+		assert(false);
+		return false;
+	}
+	if (rays.empty())
+	{
+		return true;
+	}
+
+	int threadCount = 1;
+#if defined(_OPENMP)
+	threadCount = std::max(1, std::min(omp_get_max_threads(), static_cast<int>(rays.size())));
+#endif
+
+	//one depth map per thread
+	std::vector<DepthMap> maps;
+	try
+	{
+		size_t pixelCount = static_cast<size_t>(m_width) * m_height;
+		maps.resize(threadCount);
+		for (DepthMap& map : maps)
+		{
+			map.depth.resize(pixelCount);
+			if (!m_meshIsClosed)
+			{
+				map.coverage.resize(pixelCount);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	std::atomic<int> processedCount(0);
+	std::atomic<bool> canceled(false);
+	int rayCount = static_cast<int>(rays.size());
+
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(threadCount) schedule(dynamic, 1)
+#endif
+	for (int i = 0; i < rayCount; ++i)
+	{
+		if (canceled)
+		{
+			continue;
+		}
+
+		int threadIndex = 0;
+#if defined(_OPENMP)
+		threadIndex = omp_get_thread_num();
+#endif
+		accumPixel(rays[i], maps[threadIndex], visibilityCount);
+
+		int processed = ++processedCount;
+		if (progressCb && threadIndex == 0)
+		{
+			//the progress callback can only be updated by the main thread
+			progressCb->update(100.0f * processed / rayCount);
+			if (progressCb->isCancelRequested())
+			{
+				canceled = true;
+			}
+		}
+	}
+
+	return !canceled;
+}
+
+//The method below mimics PCVContext::GLAccumPixel (itself inspired from Cignoni's ShadeVis)
+void PCVRasterizer::accumPixel(const CCVector3& V, DepthMap& map, std::vector<int>& visibilityCount) const
+{
+	//same camera as PCVContext::setViewDirection (gluLookAt)
+	CCVector3 U(0, 0, 1);
+	if (1 - std::abs(V.dot(U)) < 1.0e-4)
+	{
+		U.y = 1;
+		U.z = 0;
+	}
+	CCVector3 f = V;
+	f.normalize();
+	CCVector3 s = f.cross(U);
+	s.normalize();
+	CCVector3 u = s.cross(f);
+
+	//orthographic projection (see PCVContext::glInit)
+	const float w2 = 0.5f * m_width;
+	const float h2 = 0.5f * m_height;
+	const float maxD = static_cast<float>(std::max(m_width, m_height));
+	const int width = static_cast<int>(m_width);
+	const int height = static_cast<int>(m_height);
+
+	//projects a point in 'window' coordinates (the depth is in [0 ; 1])
+	auto project = [&](const CCVector3& P, float& x, float& y, float& z)
+	{
+		CCVector3 Q = (P - m_viewCenter) * m_zoom;
+		x = static_cast<float>(Q.dot(s)) + w2;
+		y = static_cast<float>(Q.dot(u)) + h2;
+		float zEye = -static_cast<float>(Q.dot(f)) - 1.0f;
+		z = 0.5f * (1.0f - zEye / maxD);
+	};
+
+	//first pass: depth map (depth range = [2*ZTWIST ; 1])
+	std::fill(map.depth.begin(), map.depth.end(), 1.0f);
+	if (!m_meshIsClosed)
+	{
+		std::fill(map.coverage.begin(), map.coverage.end(), static_cast<unsigned char>(0));
+	}
+	const float firstPassOffset = 2.0f * ZTWIST;
+	const float depthScale = 1.0f - 2.0f * ZTWIST;
+
+	if (!m_triangles.empty())
+	{
+		size_t nTri = m_triangles.size() / 3;
+		for (size_t t = 0; t < nTri; ++t)
+		{
+			float x[3];
+			float y[3];
+			float z[3];
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				project(m_triangles[3 * t + k], x[k], y[k], z[k]);
+				z[k] = firstPassOffset + depthScale * z[k];
+			}
+
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+			if (area == 0.0f || (m_meshIsClosed && area < 0.0f))
+			{
+				//degenerate or back face (culled)
+				continue;
+			}
+			float invArea = 1.0f / area;
+
+			int xMin = std::max(0, static_cast<int>(std::floor(std::min(std::min(x[0], x[1]), x[2]))));
+			int xMax = std::min(width - 1, static_cast<int>(std::ceil(std::max(std::max(x[0], x[1]), x[2]))));
+			int yMin = std::max(0, static_cast<int>(std::floor(std::min(std::min(y[0], y[1]), y[2]))));
+			int yMax = std::min(height - 1, static_cast<int>(std::ceil(std::max(std::max(y[0], y[1]), y[2]))));
+
+			for (int j = yMin; j <= yMax; ++j)
+			{
+				float py = j + 0.5f;
+				float* depthRow = map.depth.data() + static_cast<size_t>(j) * m_width;
+				for (int i = xMin; i <= xMax; ++i)
+				{
+					float px = i + 0.5f;
+					//barycentric coordinates (edge functions) - the depth is linear in an orthographic view
+					float b0 = ((x[1] - px) * (y[2] - py) - (y[1] - py) * (x[2] - px)) * invArea;
+					float b1 = ((x[2] - px) * (y[0] - py) - (y[2] - py) * (x[0] - px)) * invArea;
+					float b2 = 1.0f - b0 - b1;
+					if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+					{
+						continue;
+					}
+
+					float d = b0 * z[0] + b1 * z[1] + b2 * z[2];
+					if (d < depthRow[i])
+					{
+						depthRow[i] = d;
+					}
+					if (!m_meshIsClosed)
+					{
+						map.coverage[static_cast<size_t>(j) * m_width + i] = 1;
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		//points (1 pixel each)
+		for (const CCVector3& P : m_vertices)
+		{
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+			project(P, x, y, z);
+			int xi = static_cast<int>(std::floor(x));
+			int yi = static_cast<int>(std::floor(y));
+			if (xi >= 0 && xi < width && yi >= 0 && yi < height)
+			{
+				float& d = map.depth[xi + static_cast<size_t>(yi) * m_width];
+				d = std::min(d, firstPassOffset + depthScale * z);
+			}
+		}
+	}
+
+	//second pass: vertices (depth range = [0 ; 1 - 2*ZTWIST])
+	int nVert = static_cast<int>(m_vertices.size());
+	for (int i = 0; i < nVert; ++i)
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		project(m_vertices[i], x, y, z);
+
+		int xi = static_cast<int>(std::floor(x));
+		int yi = static_cast<int>(std::floor(y));
+		if (xi < 0 || xi >= width || yi < 0 || yi >= height)
+		{
+			continue;
+		}
+
+		size_t dec = xi + static_cast<size_t>(yi) * m_width;
+		if (!m_meshIsClosed)
+		{
+			//the vertex must be close to a rendered pixel (2x2 neighborhood)
+			int xi1 = std::min(xi + 1, width - 1);
+			int yi1 = std::min(yi + 1, height - 1);
+			size_t dec1 = xi1 + static_cast<size_t>(yi1) * m_width;
+			if (	map.coverage[dec] == 0
+				&&	map.coverage[xi1 + static_cast<size_t>(yi) * m_width] == 0
+				&&	map.coverage[xi + static_cast<size_t>(yi1) * m_width] == 0
+				&&	map.coverage[dec1] == 0)
+			{
+				continue;
+			}
+		}
+
+		if (depthScale * z < map.depth[dec])
+		{
+#if defined(_OPENMP)
+#pragma omp atomic
+#endif
+			++visibilityCount[i];
+		}
+	}
+}
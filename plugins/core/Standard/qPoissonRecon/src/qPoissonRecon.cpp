@@ -26,6 +26,7 @@
 #include <QMainWindow>
 #include <QProgressDialog>
 #include <QtCore>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 #include <QtGui>
 
@@ -39,6 +40,13 @@
 #include <ccScalarField.h>
 
 //System
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 #if defined(CC_WINDOWS)
 #include "Windows.h"
 #else
@@ -50,20 +58,23 @@ template <typename Real>
 class PointCloudWrapper : public PoissonReconLib::ICloud<Real>
 {
 public:
-	explicit PointCloudWrapper( const ccPointCloud& cloud ) : m_cloud(cloud) {}
+	explicit PointCloudWrapper( const ccPointCloud& cloud, const std::vector<unsigned>* indexes = nullptr )
+		: m_cloud(cloud)
+		, m_indexes(indexes)
+	{}
 
-	virtual size_t size() const { return m_cloud.size(); }
+	virtual size_t size() const { return m_indexes ? m_indexes->size() : m_cloud.size(); }
 	virtual bool hasNormals() const { return m_cloud.hasNormals(); }
 	virtual bool hasColors() const { return m_cloud.hasColors(); }
 	virtual void getPoint(size_t index, Real* coords) const
 	{
-		if (index >= m_cloud.size())
+		if (index >= size())
 		{
 			assert(false);
 			return;
 		}
 		//point
-		const CCVector3* P = m_cloud.getPoint(static_cast<unsigned>(index));
+		const CCVector3* P = m_cloud.getPoint(cloudIndex(index));
 		coords[0] = static_cast<Real>(P->x);
 		coords[1] = static_cast<Real>(P->y);
 		coords[2] = static_cast<Real>(P->z);
@@ -71,13 +82,13 @@ public:
 
 	virtual void getNormal(size_t index, Real* coords) const
 	{
-		if (index >= m_cloud.size() || !m_cloud.hasNormals())
+		if (index >= size() || !m_cloud.hasNormals())
 		{
 			assert(false);
 			return;
 		}
 
-		const CCVector3& N = m_cloud.getPointNormal(static_cast<unsigned>(index));
+		const CCVector3& N = m_cloud.getPointNormal(cloudIndex(index));
 		coords[0] = static_cast<Real>(N.x);
 		coords[1] = static_cast<Real>(N.y);
 		coords[2] = static_cast<Real>(N.z);
@@ -85,20 +96,25 @@ public:
 	
 	virtual void getColor(size_t index, Real* rgb) const
 	{
-		if (index >= m_cloud.size() || !m_cloud.hasColors())
+		if (index >= size() || !m_cloud.hasColors())
 		{
 			assert(false);
 			return;
 		}
 
-		const ccColor::Rgb& color = m_cloud.getPointColor(static_cast<unsigned>(index));
+		const ccColor::Rgb& color = m_cloud.getPointColor(cloudIndex(index));
 		rgb[0] = static_cast<Real>(color.r);
 		rgb[1] = static_cast<Real>(color.g);
 		rgb[2] = static_cast<Real>(color.b);
 	}
 
 protected:
+	//! Returns the index of a point in the cloud
+	inline unsigned cloudIndex(size_t index) const { return m_indexes ? (*m_indexes)[index] : static_cast<unsigned>(index); }
+
 	const ccPointCloud& m_cloud;
+	//! Subset of the cloud (optional)
+	const std::vector<unsigned>* m_indexes;
 };
 
 template <typename Real>
@@ -229,9 +245,788 @@ public:
 		setupUi(this);
 
 		threadSpinBox->setRange(1, PoissonReconLib::Parameters::GetMaxThreadCount());
+
+		connect(tilingCheckBox, &QCheckBox::toggled, this, &PoissonReconParamDlg::onTilingToggled);
+		onTilingToggled(tilingCheckBox->isChecked());
+	}
+
+protected:
+	void onTilingToggled(bool state)
+	{
+		tileSizeDoubleSpinBox->setEnabled(state);
+		tileOverlapDoubleSpinBox->setEnabled(state);
+		densityTrimDoubleSpinBox->setEnabled(state);
+		memoryBudgetSpinBox->setEnabled(state);
+	}
+};
+
+//! Reconstructed (and trimmed) part of a tile
+struct TileMesh
+{
+	std::vector<CCVector3> vertices;
+	std::vector<ScalarType> densities;
+	std::vector<ccColor::Rgb> colors;
+	std::vector<CCCoreLib::VerticesIndexes> triangles;
+
+	void clear()
+	{
+		vertices.clear();
+		densities.clear();
+		colors.clear();
+		triangles.clear();
 	}
 };
 
+template <typename Real>
+class TileMeshWrapper : public PoissonReconLib::IMesh<Real>
+{
+public:
+	explicit TileMeshWrapper(TileMesh& mesh)
+		: m_mesh(mesh)
+		, m_error(false)
+	{}
+
+	virtual void addVertex(const Real* coords) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+		try
+		{
+			m_mesh.vertices.push_back(CCVector3::fromArray(coords));
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = true;
+		}
+	}
+
+	virtual void addNormal(const Real* /*coords*/) override
+	{
+		//the normals are computed on the final mesh
+	}
+
+	virtual void addColor(const Real* rgb) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+		try
+		{
+			m_mesh.colors.emplace_back(	static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[0]))),
+										static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[1]))),
+										static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[2]))) );
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = true;
+		}
+	}
+
+	virtual void addDensity(double d) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+		try
+		{
+			m_mesh.densities.push_back(static_cast<ScalarType>(d));
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = true;
+		}
+	}
+
+	void addTriangle(size_t i1, size_t i2, size_t i3) override
+	{
+		if (m_error)
+		{
+			return;
+		}
+		try
+		{
+			m_mesh.triangles.emplace_back(static_cast<unsigned>(i1), static_cast<unsigned>(i2), static_cast<unsigned>(i3));
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = true;
+		}
+	}
+
+	bool isInErrorState() const { return m_error; }
+
+protected:
+	TileMesh& m_mesh;
+	bool m_error;
+};
+
+//! Tiled reconstruction parameters
+struct TilingParams
+{
+	//! Tile size
+	double tileSize = 0.0;
+	//! Overlap (margin added on each side of the tiles)
+	double overlap = 0.0;
+	//! Minimum density of the vertices of the kept triangles (0 = no trimming)
+	double minDensity = 6.0;
+	//! Memory budget for a tile reconstruction (in MB)
+	int memoryBudget_mb = 4096;
+	//! Minimum number of points of a tile (the sparser tiles are skipped)
+	unsigned minPointCount = 100;
+};
+
+//! Tile
+struct Tile
+{
+	//! Core block (without the overlap)
+	/** The sides on the border of the tiling are unbounded.
+	**/
+	CCVector3d coreMin;
+	CCVector3d coreMax;
+	//! Points of the tile (with the overlap)
+	std::vector<unsigned> pointIndexes;
+	//! Trimmed mesh
+	TileMesh mesh;
+	//! Whether the reconstruction succeeded
+	bool success = false;
+};
+
+//! The PoissonRecon library relies on static/global state (thread pool, allocators): it can't be called concurrently
+static QMutex s_poissonReconMutex;
+
+//! Rough estimate of the memory required to reconstruct a tile (in MB)
+static double EstimateTileMemory_mb(size_t pointCount, double extent, double cellWidth)
+{
+	//input samples (position, normal, color and weight per sample) plus the nodes of the finest
+	//octree levels, that hold about (extent / cell width)^2 nodes per 'layer' around the surface
+	double cellsPerSide = extent / cellWidth;
+	double bytes = pointCount * 128.0 + cellsPerSide * cellsPerSide * 4.0 * 256.0;
+	return bytes / (1 << 20);
+}
+
+//! Splits a cloud in overlapping tiles, small enough to respect the memory budget
+static bool CreateTiles(const ccPointCloud& cloud,
+						const TilingParams& tiling,
+						double cellWidth,
+						std::vector<Tile>& tiles,
+						unsigned& overBudgetCount)
+{
+	tiles.clear();
+	overBudgetCount = 0;
+
+	const double inf = std::numeric_limits<double>::max();
+	CCVector3 bbMin, bbMax;
+	cloud.getBoundingBox(bbMin, bbMax);
+
+	int dim[3];
+	double tileCount = 1.0;
+	for (unsigned char d = 0; d < 3; ++d)
+	{
+		dim[d] = std::max(1, static_cast<int>(std::ceil((bbMax.u[d] - bbMin.u[d]) / tiling.tileSize)));
+		tileCount *= dim[d];
+	}
+	if (tileCount > (1 << 16))
+	{
+		ccLog::Warning(QString("[PoissonRecon] Too many tiles (%1), the tile size is too small").arg(tileCount));
+		return false;
+	}
+
+	try
+	{
+		//regular grid first
+		std::vector< std::vector<unsigned> > gridPoints(static_cast<size_t>(tileCount));
+		unsigned pointCount = cloud.size();
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			const CCVector3* P = cloud.getPoint(i);
+
+			//tiles whose extended box contains the point
+			int cMin[3];
+			int cMax[3];
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				double x = static_cast<double>(P->u[d]) - bbMin.u[d];
+				cMin[d] = std::max(0, static_cast<int>(std::floor((x - tiling.overlap) / tiling.tileSize)));
+				cMax[d] = std::min(dim[d] - 1, static_cast<int>(std::floor((x + tiling.overlap) / tiling.tileSize)));
+			}
+
+			for (int k = cMin[2]; k <= cMax[2]; ++k)
+				for (int j = cMin[1]; j <= cMax[1]; ++j)
+					for (int i2 = cMin[0]; i2 <= cMax[0]; ++i2)
+						gridPoints[i2 + dim[0] * (j + dim[1] * k)].push_back(i);
+		}
+
+		std::vector<Tile> stack;
+		for (int k = 0; k < dim[2]; ++k)
+		{
+			for (int j = 0; j < dim[1]; ++j)
+			{
+				for (int i = 0; i < dim[0]; ++i)
+				{
+					std::vector<unsigned>& points = gridPoints[i + dim[0] * (j + dim[1] * k)];
+					if (points.empty())
+					{
+						continue;
+					}
+
+					Tile tile;
+					int c[3] = { i, j, k };
+					for (unsigned char d = 0; d < 3; ++d)
+					{
+						tile.coreMin.u[d] = (c[d] == 0 ? -inf : bbMin.u[d] + c[d] * tiling.tileSize);
+						tile.coreMax.u[d] = (c[d] + 1 == dim[d] ? inf : bbMin.u[d] + (c[d] + 1) * tiling.tileSize);
+					}
+					tile.pointIndexes.swap(points);
+					stack.push_back(std::move(tile));
+				}
+			}
+		}
+		gridPoints.clear();
+
+		//then the tiles exceeding the memory budget are split in two (along their largest dimension)
+		while (!stack.empty())
+		{
+			Tile tile = std::move(stack.back());
+			stack.pop_back();
+
+			//actual extents (the unbounded sides are limited by the cloud bounding-box)
+			CCVector3d tileMin;
+			CCVector3d tileMax;
+			unsigned char largestDim = 0;
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				tileMin.u[d] = std::max(tile.coreMin.u[d], static_cast<double>(bbMin.u[d]));
+				tileMax.u[d] = std::min(tile.coreMax.u[d], static_cast<double>(bbMax.u[d]));
+				if (tileMax.u[d] - tileMin.u[d] > tileMax.u[largestDim] - tileMin.u[largestDim])
+				{
+					largestDim = d;
+				}
+			}
+			double extent = tileMax.u[largestDim] - tileMin.u[largestDim];
+
+			double memory_mb = EstimateTileMemory_mb(tile.pointIndexes.size(), extent + 2 * tiling.overlap, cellWidth);
+			if (memory_mb <= tiling.memoryBudget_mb)
+			{
+				tiles.push_back(std::move(tile));
+				continue;
+			}
+			if (extent < 2 * tiling.overlap || extent < 32 * cellWidth)
+			{
+				//can't split it further
+				++overBudgetCount;
+				tiles.push_back(std::move(tile));
+				continue;
+			}
+
+			double splitValue = (tileMin.u[largestDim] + tileMax.u[largestDim]) / 2;
+			Tile halves[2];
+			halves[0].coreMin = halves[1].coreMin = tile.coreMin;
+			halves[0].coreMax = halves[1].coreMax = tile.coreMax;
+			halves[0].coreMax.u[largestDim] = splitValue;
+			halves[1].coreMin.u[largestDim] = splitValue;
+			for (unsigned index : tile.pointIndexes)
+			{
+				double x = cloud.getPoint(index)->u[largestDim];
+				if (x < splitValue + tiling.overlap)
+				{
+					halves[0].pointIndexes.push_back(index);
+				}
+				if (x >= splitValue - tiling.overlap)
+				{
+					halves[1].pointIndexes.push_back(index);
+				}
+			}
+			tile.pointIndexes.clear();
+			tile.pointIndexes.shrink_to_fit();
+
+			for (Tile& half : halves)
+			{
+				if (!half.pointIndexes.empty())
+				{
+					stack.push_back(std::move(half));
+				}
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		tiles.clear();
+		return false;
+	}
+
+	return true;
+}
+
+//! Keeps the triangles of a tile mesh that belong to its core block (and are dense enough)
+static bool TrimTileMesh(Tile& tile, double minDensity)
+{
+	TileMesh& mesh = tile.mesh;
+	bool useDensity = (minDensity > 0.0 && mesh.densities.size() == mesh.vertices.size());
+
+	std::vector<int> newIndexes;
+	try
+	{
+		newIndexes.resize(mesh.vertices.size(), -1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	//each triangle belongs to the tile containing its barycenter
+	size_t keptTriangles = 0;
+	unsigned keptVertices = 0;
+	for (const CCCoreLib::VerticesIndexes& tri : mesh.triangles)
+	{
+		if (	tri.i1 >= mesh.vertices.size()
+			||	tri.i2 >= mesh.vertices.size()
+			||	tri.i3 >= mesh.vertices.size())
+		{
+			assert(false);
+			continue;
+		}
+
+		if (useDensity)
+		{
+			if (	mesh.densities[tri.i1] < minDensity
+				||	mesh.densities[tri.i2] < minDensity
+				||	mesh.densities[tri.i3] < minDensity)
+			{
+				continue;
+			}
+		}
+
+		CCVector3d G = (	mesh.vertices[tri.i1].toDouble()
+						+	mesh.vertices[tri.i2].toDouble()
+						+	mesh.vertices[tri.i3].toDouble()) / 3.0;
+		if (	G.x < tile.coreMin.x || G.x >= tile.coreMax.x
+			||	G.y < tile.coreMin.y || G.y >= tile.coreMax.y
+			||	G.z < tile.coreMin.z || G.z >= tile.coreMax.z)
+		{
+			continue;
+		}
+
+		CCCoreLib::VerticesIndexes newTri;
+		for (unsigned char j = 0; j < 3; ++j)
+		{
+			unsigned i = tri.i[j];
+			if (newIndexes[i] < 0)
+			{
+				newIndexes[i] = static_cast<int>(keptVertices++);
+			}
+			newTri.i[j] = static_cast<unsigned>(newIndexes[i]);
+		}
+		mesh.triangles[keptTriangles++] = newTri;
+	}
+	mesh.triangles.resize(keptTriangles);
+	mesh.triangles.shrink_to_fit();
+
+	//compact the vertices (in place, the new indexes are always lower than the old ones)
+	for (size_t i = 0; i < newIndexes.size(); ++i)
+	{
+		if (newIndexes[i] >= 0)
+		{
+			size_t j = static_cast<size_t>(newIndexes[i]);
+			mesh.vertices[j] = mesh.vertices[i];
+			if (j < mesh.densities.size() && i < mesh.densities.size())
+				mesh.densities[j] = mesh.densities[i];
+			if (j < mesh.colors.size() && i < mesh.colors.size())
+				mesh.colors[j] = mesh.colors[i];
+		}
+	}
+	mesh.vertices.resize(keptVertices);
+	mesh.vertices.shrink_to_fit();
+	if (!mesh.densities.empty())
+	{
+		mesh.densities.resize(keptVertices);
+		mesh.densities.shrink_to_fit();
+	}
+	if (!mesh.colors.empty())
+	{
+		mesh.colors.resize(keptVertices);
+		mesh.colors.shrink_to_fit();
+	}
+
+	return true;
+}
+
+//! Reconstructs, then trims a tile
+static void ReconstructTile(Tile& tile, const ccPointCloud& cloud, const PoissonReconLib::Parameters& params, double minDensity)
+{
+	tile.success = false;
+	tile.mesh.clear();
+
+	{
+		//the reconstructions are serialized (but the library itself is multi-threaded),
+		//while the other tiles are trimmed in parallel
+		QMutexLocker locker(&s_poissonReconMutex);
+
+		TileMeshWrapper<PointCoordinateType> meshWrapper(tile.mesh);
+		PointCloudWrapper<PointCoordinateType> cloudWrapper(cloud, &tile.pointIndexes);
+
+		if (!PoissonReconLib::Reconstruct(params, cloudWrapper, meshWrapper) || meshWrapper.isInErrorState())
+		{
+			tile.mesh.clear();
+			return;
+		}
+	}
+
+	tile.pointIndexes.clear();
+	tile.pointIndexes.shrink_to_fit();
+
+	tile.success = TrimTileMesh(tile, minDensity);
+}
+
+//! Stitches the tiles in a single mesh
+/** The vertices of the tile borders that are closer than the weld radius to a vertex of
+	another tile are merged (at their mean position).
+**/
+static bool StitchTiles(std::vector<Tile>& tiles,
+						double weldRadius,
+						ccMesh& mesh,
+						ccPointCloud& vertices,
+						ccScalarField* densitySF)
+{
+	struct Candidate
+	{
+		unsigned vertexIndex;
+		unsigned tileIndex;
+	};
+
+	//global vertex indexes
+	std::vector<unsigned> tileOffsets(tiles.size() + 1, 0);
+	for (size_t t = 0; t < tiles.size(); ++t)
+	{
+		tileOffsets[t + 1] = tileOffsets[t] + static_cast<unsigned>(tiles[t].mesh.vertices.size());
+	}
+	unsigned vertexCount = tileOffsets.back();
+	if (vertexCount == 0)
+	{
+		return false;
+	}
+
+	bool withColors = true;
+	bool withDensity = (densitySF != nullptr);
+	size_t triangleCount = 0;
+	for (const Tile& tile : tiles)
+	{
+		withColors &= (tile.mesh.colors.size() == tile.mesh.vertices.size());
+		withDensity &= (tile.mesh.densities.size() == tile.mesh.vertices.size());
+		triangleCount += tile.mesh.triangles.size();
+	}
+
+	try
+	{
+		//vertices close to the border of their core block
+		std::vector<Candidate> candidates;
+		CCVector3d candidatesMin(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+		for (unsigned t = 0; t < static_cast<unsigned>(tiles.size()); ++t)
+		{
+			const Tile& tile = tiles[t];
+			for (unsigned i = 0; i < static_cast<unsigned>(tile.mesh.vertices.size()); ++i)
+			{
+				CCVector3d P = tile.mesh.vertices[i].toDouble();
+				bool nearBorder = false;
+				for (unsigned char d = 0; d < 3; ++d)
+				{
+					nearBorder |= (P.u[d] - tile.coreMin.u[d] < weldRadius || tile.coreMax.u[d] - P.u[d] < weldRadius);
+				}
+				if (nearBorder)
+				{
+					candidates.push_back({ tileOffsets[t] + i, t });
+					for (unsigned char d = 0; d < 3; ++d)
+					{
+						candidatesMin.u[d] = std::min(candidatesMin.u[d], P.u[d]);
+					}
+				}
+			}
+		}
+
+		auto vertex = [&](unsigned globalIndex) -> const CCVector3&
+		{
+			size_t t = std::upper_bound(tileOffsets.begin(), tileOffsets.end(), globalIndex) - tileOffsets.begin() - 1;
+			return tiles[t].mesh.vertices[globalIndex - tileOffsets[t]];
+		};
+
+		//spatial hashing of the candidates
+		auto cellCoord = [&](const CCVector3& P, unsigned char d)
+		{
+			return static_cast<int64_t>(std::floor((P.u[d] - candidatesMin.u[d]) / weldRadius));
+		};
+		auto cellKey = [](int64_t x, int64_t y, int64_t z)
+		{
+			return static_cast<uint64_t>(((x & 0x1FFFFF) << 42) | ((y & 0x1FFFFF) << 21) | (z & 0x1FFFFF));
+		};
+		std::unordered_map< uint64_t, std::vector<unsigned> > cells;
+		for (unsigned c = 0; c < static_cast<unsigned>(candidates.size()); ++c)
+		{
+			const CCVector3& P = vertex(candidates[c].vertexIndex);
+			cells[cellKey(cellCoord(P, 0), cellCoord(P, 1), cellCoord(P, 2))].push_back(c);
+		}
+
+		//union-find of the welded vertices
+		std::vector<unsigned> parent(vertexCount);
+		for (unsigned i = 0; i < vertexCount; ++i)
+		{
+			parent[i] = i;
+		}
+		auto root = [&parent](unsigned i)
+		{
+			while (parent[i] != i)
+			{
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		};
+
+		//each candidate is welded to the closest candidate of another tile
+		double weldRadius2 = weldRadius * weldRadius;
+		for (const Candidate& candidate : candidates)
+		{
+			const CCVector3& P = vertex(candidate.vertexIndex);
+			int64_t c[3] = { cellCoord(P, 0), cellCoord(P, 1), cellCoord(P, 2) };
+
+			double bestDist2 = weldRadius2;
+			int best = -1;
+			for (int64_t k = c[2] - 1; k <= c[2] + 1; ++k)
+			{
+				for (int64_t j = c[1] - 1; j <= c[1] + 1; ++j)
+				{
+					for (int64_t i = c[0] - 1; i <= c[0] + 1; ++i)
+					{
+						auto it = cells.find(cellKey(i, j, k));
+						if (it == cells.end())
+						{
+							continue;
+						}
+						for (unsigned other : it->second)
+						{
+							if (candidates[other].tileIndex == candidate.tileIndex)
+							{
+								continue;
+							}
+							double dist2 = (vertex(candidates[other].vertexIndex) - P).norm2d();
+							if (dist2 < bestDist2)
+							{
+								bestDist2 = dist2;
+								best = static_cast<int>(other);
+							}
+						}
+					}
+				}
+			}
+
+			if (best >= 0)
+			{
+				unsigned r1 = root(candidate.vertexIndex);
+				unsigned r2 = root(candidates[best].vertexIndex);
+				if (r1 != r2)
+				{
+					parent[std::max(r1, r2)] = std::min(r1, r2);
+				}
+			}
+		}
+		cells.clear();
+		candidates.clear();
+
+		//output vertices (the welded vertices are blended)
+		std::vector<int> newIndexes(vertexCount, -1);
+		std::vector<CCVector3d> sums;
+		std::vector<double> densitySums;
+		std::vector<unsigned> counts;
+		std::vector<unsigned> firstVertex;
+		for (unsigned i = 0; i < vertexCount; ++i)
+		{
+			unsigned r = root(i);
+			if (newIndexes[r] < 0)
+			{
+				newIndexes[r] = static_cast<int>(sums.size());
+				sums.push_back(CCVector3d(0, 0, 0));
+				densitySums.push_back(0.0);
+				counts.push_back(0);
+				firstVertex.push_back(i);
+			}
+			newIndexes[i] = newIndexes[r];
+
+			size_t t = std::upper_bound(tileOffsets.begin(), tileOffsets.end(), i) - tileOffsets.begin() - 1;
+			unsigned localIndex = i - tileOffsets[t];
+			size_t n = static_cast<size_t>(newIndexes[i]);
+			sums[n] += tiles[t].mesh.vertices[localIndex].toDouble();
+			if (withDensity)
+			{
+				densitySums[n] += tiles[t].mesh.densities[localIndex];
+			}
+			++counts[n];
+		}
+		parent.clear();
+		parent.shrink_to_fit();
+
+		unsigned outputVertexCount = static_cast<unsigned>(sums.size());
+		if (	!vertices.reserve(outputVertexCount)
+			||	(withColors && !vertices.reserveTheRGBTable())
+			||	(withDensity && !densitySF->reserveSafe(outputVertexCount)))
+		{
+			return false;
+		}
+		for (unsigned n = 0; n < outputVertexCount; ++n)
+		{
+			vertices.addPoint((sums[n] / counts[n]).toPC());
+			if (withColors)
+			{
+				unsigned i = firstVertex[n];
+				size_t t = std::upper_bound(tileOffsets.begin(), tileOffsets.end(), i) - tileOffsets.begin() - 1;
+				vertices.addColor(tiles[t].mesh.colors[i - tileOffsets[t]]);
+			}
+			if (withDensity)
+			{
+				densitySF->addElement(static_cast<ScalarType>(densitySums[n] / counts[n]));
+			}
+		}
+		sums.clear();
+		densitySums.clear();
+		counts.clear();
+		firstVertex.clear();
+
+		//output triangles
+		if (!mesh.reserve(static_cast<unsigned>(triangleCount)))
+		{
+			return false;
+		}
+		for (size_t t = 0; t < tiles.size(); ++t)
+		{
+			TileMesh& tileMesh = tiles[t].mesh;
+			for (const CCCoreLib::VerticesIndexes& tri : tileMesh.triangles)
+			{
+				unsigned i1 = static_cast<unsigned>(newIndexes[tileOffsets[t] + tri.i1]);
+				unsigned i2 = static_cast<unsigned>(newIndexes[tileOffsets[t] + tri.i2]);
+				unsigned i3 = static_cast<unsigned>(newIndexes[tileOffsets[t] + tri.i3]);
+				//the welding may have collapsed some triangles
+				if (i1 != i2 && i2 != i3 && i3 != i1)
+				{
+					mesh.addTriangle(i1, i2, i3);
+				}
+			}
+			//release the tile memory as soon as possible
+			tileMesh.clear();
+			tileMesh.triangles.shrink_to_fit();
+			tileMesh.vertices.shrink_to_fit();
+		}
+		mesh.resize(mesh.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+//! Tiled reconstruction
+static bool ReconstructTiled(	const ccPointCloud& cloud,
+								const PoissonReconLib::Parameters& params,
+								const TilingParams& tiling,
+								ccMesh& mesh,
+								ccPointCloud& vertices,
+								ccScalarField* densitySF,
+								QWidget* parentWidget)
+{
+	//all the tiles share the same resolution
+	PoissonReconLib::Parameters tileParams = params;
+	double cellWidth = params.finestCellWidth;
+	if (params.depth > 0)
+	{
+		//the library enlarges the bounding-box of the input points by 10% (default 'scale')
+		cellWidth = (tiling.tileSize + 2 * tiling.overlap) * 1.1 / (1 << params.depth);
+		tileParams.depth = 0;
+		tileParams.finestCellWidth = static_cast<float>(cellWidth);
+	}
+	if (cellWidth <= 0.0)
+	{
+		ccLog::Warning("[PoissonRecon] Invalid resolution");
+		return false;
+	}
+	//the density is used to trim the tiles
+	tileParams.density = true;
+
+	std::vector<Tile> tiles;
+	unsigned overBudgetCount = 0;
+	if (!CreateTiles(cloud, tiling, cellWidth, tiles, overBudgetCount))
+	{
+		ccLog::Warning("[PoissonRecon] Failed to split the cloud in tiles (not enough memory or tile size too small)");
+		return false;
+	}
+	if (overBudgetCount != 0)
+	{
+		ccLog::Warning(QString("[PoissonRecon] %1 tile(s) may exceed the memory budget").arg(overBudgetCount));
+	}
+
+	//skip the tiles with too few points (the reconstruction would fail or be meaningless)
+	size_t tileCount = tiles.size();
+	tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [&tiling](const Tile& tile) { return tile.pointIndexes.size() < tiling.minPointCount; }), tiles.end());
+	if (tiles.size() != tileCount)
+	{
+		ccLog::Warning(QString("[PoissonRecon] %1 tile(s) with less than %2 points skipped").arg(tileCount - tiles.size()).arg(tiling.minPointCount));
+	}
+	if (tiles.empty())
+	{
+		ccLog::Warning("[PoissonRecon] Not enough points in the tiles (tile size too small?)");
+		return false;
+	}
+	ccLog::Print(QString("[PoissonRecon] %1 tiles (cell width: %2)").arg(tiles.size()).arg(cellWidth));
+
+	//progress dialog (the reconstruction of a tile can't be canceled)
+	QProgressDialog pDlg(QObject::tr("Tiled reconstruction"), QString(), 0, static_cast<int>(tiles.size()), parentWidget);
+	pDlg.setWindowTitle("Poisson Reconstruction");
+	pDlg.setCancelButton(nullptr);
+	pDlg.show();
+	QApplication::processEvents();
+
+	std::atomic<int> processedTiles(0);
+	QFuture<void> future = QtConcurrent::map(tiles, [&](Tile& tile)
+	{
+		ReconstructTile(tile, cloud, tileParams, tiling.minDensity);
+		++processedTiles;
+	});
+
+	while (!future.isFinished())
+	{
+#if defined(CC_WINDOWS)
+		::Sleep(500);
+#else
+		usleep(500 * 1000);
+#endif
+		pDlg.setLabelText(QObject::tr("Tiled reconstruction\ntile %1/%2").arg(processedTiles.load()).arg(tiles.size()));
+		pDlg.setValue(processedTiles);
+		QApplication::processEvents();
+	}
+
+	for (const Tile& tile : tiles)
+	{
+		if (!tile.success)
+		{
+			ccLog::Warning("[PoissonRecon] Failed to reconstruct a tile (not enough memory?)");
+			return false;
+		}
+	}
+
+	pDlg.setLabelText(QObject::tr("Stitching the tiles"));
+	QApplication::processEvents();
+
+	//welding distance: about one cell of the finest level
+	if (!StitchTiles(tiles, cellWidth, mesh, vertices, densitySF))
+	{
+		ccLog::Warning("[PoissonRecon] Failed to stitch the tiles (not enough memory?)");
+		return false;
+	}
+
+	return true;
+}
+
 qPoissonRecon::qPoissonRecon(QObject* parent/*=nullptr*/)
 	: QObject(parent)
 	, ccStdPluginInterface(":/CC/plugin/qPoissonRecon/info.json")
@@ -261,6 +1056,8 @@ QList<QAction *> qPoissonRecon::getActions()
 }
 
 static PoissonReconLib::Parameters s_params;
+static bool s_tilingEnabled = false;
+static TilingParams s_tiling;
 static ccPointCloud* s_cloud = nullptr;
 static ccMesh* s_mesh = nullptr;
 static ccPointCloud* s_meshVertices = nullptr;
@@ -330,6 +1127,8 @@ void qPoissonRecon::doAction()
 	if (s_defaultResolution == 0.0 || s_lastEntityID != pc->getUniqueID())
 	{
 		s_defaultResolution = pc->getOwnBB().getDiagNormd() / 200.0;
+		s_tiling.tileSize = pc->getOwnBB().getMaxBoxDim() / 4;
+		s_tiling.overlap = s_tiling.tileSize / 10;
 		s_lastEntityID = pc->getUniqueID();
 	}
 	
@@ -350,6 +1149,11 @@ void qPoissonRecon::doAction()
 	prpDlg.weightDoubleSpinBox->setValue(s_params.pointWeight);
 	prpDlg.threadSpinBox->setValue(s_params.threads);
 	prpDlg.linearFitCheckBox->setChecked(s_params.linearFit);
+	prpDlg.tilingCheckBox->setChecked(s_tilingEnabled);
+	prpDlg.tileSizeDoubleSpinBox->setValue(s_tiling.tileSize);
+	prpDlg.tileOverlapDoubleSpinBox->setValue(s_tiling.overlap);
+	prpDlg.densityTrimDoubleSpinBox->setValue(s_tiling.minDensity);
+	prpDlg.memoryBudgetSpinBox->setValue(s_tiling.memoryBudget_mb);
 	switch (s_params.boundary)
 	{
 	case PoissonReconLib::Parameters::FREE:
@@ -381,6 +1185,11 @@ void qPoissonRecon::doAction()
 	s_params.pointWeight = static_cast<float>(prpDlg.weightDoubleSpinBox->value());
 	s_params.threads = prpDlg.threadSpinBox->value();
 	s_params.linearFit = prpDlg.linearFitCheckBox->isChecked();
+	s_tilingEnabled = prpDlg.tilingCheckBox->isChecked();
+	s_tiling.tileSize = prpDlg.tileSizeDoubleSpinBox->value();
+	s_tiling.overlap = prpDlg.tileOverlapDoubleSpinBox->value();
+	s_tiling.minDensity = prpDlg.densityTrimDoubleSpinBox->value();
+	s_tiling.memoryBudget_mb = prpDlg.memoryBudgetSpinBox->value();
 	switch (prpDlg.boundaryComboBox->currentIndex())
 	{
 	case 0:
@@ -408,8 +1217,24 @@ void qPoissonRecon::doAction()
 	ccMesh* newMesh = new ccMesh(newPC);
 	newMesh->addChild(newPC);
 
-	//run in a separate thread
 	bool result = false;
+	if (s_tilingEnabled)
+	{
+		m_app->dispToConsole(QString("[PoissonRecon] Tiled job started (tile size %1 - overlap %2 - %3 threads)").arg(s_tiling.tileSize).arg(s_tiling.overlap).arg(s_params.threads), ccMainAppInterface::STD_CONSOLE_MESSAGE);
+
+		if (s_params.density)
+		{
+			densitySF = new ccScalarField("Density");
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+
+		result = ReconstructTiled(*pc, s_params, s_tiling, *newMesh, *newPC, densitySF, m_app->getMainWindow());
+
+		ccLog::Print(QString("[PoissonRecon] Duration: %1 s").arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+	}
+	else //run in a separate thread
 	{
 		//start message
 		m_app->dispToConsole(QString("[PoissonRecon] Job started (level %1 - %2 threads)").arg(s_params.depth).arg(s_params.threads), ccMainAppInterface::STD_CONSOLE_MESSAGE);
@@ -482,7 +1307,10 @@ void qPoissonRecon::doAction()
 	//success message
 	m_app->dispToConsole(QString("[PoissonRecon] Job finished (%1 triangles, %2 vertices)").arg(newMesh->size()).arg(newPC->size()), ccMainAppInterface::STD_CONSOLE_MESSAGE);
 
-	newMesh->setName(QString("Mesh[%1] (level %2)").arg(pc->getName()).arg(s_params.depth));
+	if (s_tilingEnabled)
+		newMesh->setName(QString("Mesh[%1] (tiled)").arg(pc->getName()));
+	else
+		newMesh->setName(QString("Mesh[%1] (level %2)").arg(pc->getName()).arg(s_params.depth));
 	newPC->setEnabled(false);
 	newMesh->setVisible(true);
 	newMesh->computeNormals(true);
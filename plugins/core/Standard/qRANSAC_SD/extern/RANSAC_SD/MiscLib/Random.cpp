@@ -6,6 +6,8 @@
  *
  */
 #include <stdio.h>
+#include <atomic>
+#include <time.h>
 #include "Random.h"
 #define register 
 using namespace MiscLib;
@@ -19,8 +21,11 @@ using namespace MiscLib;
 #define is_odd(x)     ( (x) & 1 )
 #define evenize(x)    ( (x) & (MM-2) )
 
-size_t MiscLib::rn_buf[MiscLib_RN_BUFSIZE];
-size_t MiscLib::rn_point = MiscLib_RN_BUFSIZE;
+thread_local size_t MiscLib::rn_buf[MiscLib_RN_BUFSIZE];
+thread_local size_t MiscLib::rn_point = MiscLib_RN_BUFSIZE;
+//threads that never called rn_setseed (e.g. OpenMP workers) are seeded on their first draw
+static thread_local bool rn_seeded = false;
+static std::atomic<size_t> rn_seedCounter(0);
 
 void MiscLib::rn_setseed(size_t seed)
 {
@@ -52,11 +57,14 @@ void MiscLib::rn_setseed(size_t seed)
   }
   for (j=0;j<LL;j++) rn_buf[j+KK-LL]=x[j];
   for (;j<KK;j++) rn_buf[j-LL]=x[j];  
+  rn_seeded = true;
 }
 
 size_t MiscLib::rn_refresh()
 {
 /* You remember Duff's device? If it would help then it should be used here */
+  if (!rn_seeded)
+    rn_setseed((size_t)time(NULL) + 7919 * (++rn_seedCounter));
   rn_point=1;
 
   register int i, j;
@@ -20,6 +20,9 @@
 
 #include "ccStdPluginInterface.h"
 
+//system
+#include <vector>
+
 
 //! Wrapper to Schnabel et al. library for automatic shape detection in point cloud
 /** "Efficient RANSAC for Point-Cloud Shape Detection", Ruwen Schnabel, Roland Wahl, 
@@ -67,6 +70,8 @@ public:
 		float minTorusMajorRadius;
 		float maxTorusMinorRadius;
 		float maxTorusMajorRadius;
+		float tileSize; // edge length of the tiles processed in parallel (0 = no tiling)
+		float tileOverlap; // margin added on each side of the tiles (for merging the shapes across the tile borders)
 
 		RansacParams() : epsilon(0.005f)
 			, bitmapEpsilon(0.001f)
@@ -89,6 +94,8 @@ public:
 			, minTorusMajorRadius(0)
 			, maxTorusMinorRadius(std::numeric_limits<float>::max())
 			, maxTorusMajorRadius(std::numeric_limits<float>::max())
+			, tileSize(0)
+			, tileOverlap(0)
 		{
 			primEnabled[RPT_PLANE] = true;
 			primEnabled[RPT_SPHERE] = true;
@@ -118,6 +125,8 @@ public:
 			, minTorusMajorRadius(0)
 			, maxTorusMinorRadius(std::numeric_limits<float>::max())
 			, maxTorusMajorRadius(std::numeric_limits<float>::max())
+			, tileSize(0)
+			, tileOverlap(0)
 		{
 			primEnabled[RPT_PLANE] = true;
 			primEnabled[RPT_SPHERE] = true;
@@ -136,6 +145,13 @@ public:
 	virtual void registerCommands(ccCommandLineInterface* cmd) override;
 
 	static ccHObject* executeRANSAC(ccPointCloud* ccPC, const RansacParams& params, bool silent = false);
+
+	//! Runs the shape detection on several clouds concurrently
+	/** The detection of each cloud (or of each tile if tiling is enabled) runs in its own thread.
+		\return one group per input cloud (nullptr if nothing was detected)
+	**/
+	static std::vector<ccHObject*> executeRANSAC(const std::vector<ccPointCloud*>& clouds, const std::vector<RansacParams>& params, bool silent = false);
+
 protected:
 
 	//! Slot called when associated ation is triggered
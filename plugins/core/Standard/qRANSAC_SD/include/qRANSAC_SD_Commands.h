@@ -46,6 +46,8 @@ constexpr char OUTPUT_INDIVIDUAL_PRIMITIVES[] = "OUTPUT_INDIVIDUAL_PRIMITIVES";
 constexpr char OUTPUT_INDIVIDUAL_SUBCLOUDS[] = "OUTPUT_INDIVIDUAL_SUBCLOUDS";
 constexpr char OUTPUT_INDIVIDUAL_PAIRED_CLOUD_PRIMITIVE[] = "OUTPUT_INDIVIDUAL_PAIRED_CLOUD_PRIMITIVE";
 constexpr char OUTPUT_GROUPED[] = "OUTPUT_GROUPED";
+constexpr char TILE_SIZE[] = "TILE_SIZE";
+constexpr char TILE_OVERLAP[] = "TILE_OVERLAP";
 
 constexpr char PRIM_PLANE[] = "PLANE";
 constexpr char PRIM_SPHERE[] = "SPHERE";
@@ -69,7 +71,8 @@ struct CommandRANSAC : public ccCommandLineInterface::Command
 			BITMAP_EPSILON_PERCENTAGE_OF_SCALE << BITMAP_EPSILON_ABSOLUTE <<
 			SUPPORT_POINTS << MAX_NORMAL_DEV << PROBABILITY << ENABLE_PRIMITIVE <<
 			OUT_CLOUD_DIR << OUT_MESH_DIR << OUT_GROUP_DIR << OUT_PAIR_DIR << OUT_RANDOM_COLOR << OUTPUT_INDIVIDUAL_PRIMITIVES <<
-			OUTPUT_INDIVIDUAL_SUBCLOUDS << OUTPUT_GROUPED << OUTPUT_INDIVIDUAL_PAIRED_CLOUD_PRIMITIVE;
+			OUTPUT_INDIVIDUAL_SUBCLOUDS << OUTPUT_GROUPED << OUTPUT_INDIVIDUAL_PAIRED_CLOUD_PRIMITIVE <<
+			TILE_SIZE << TILE_OVERLAP;
 		QStringList primitiveNames = QStringList() << PRIM_PLANE << PRIM_SPHERE << PRIM_CYLINDER << PRIM_CONE << PRIM_TORUS;
 		QString outputCloudsDir;
 		QString outputMeshesDir;
@@ -205,6 +208,36 @@ struct CommandRANSAC : public ccCommandLineInterface::Command
 					cmd.print(QObject::tr("\tProbability : %1").arg(val));
 					params.probability = val;
 				}
+				else if (param == TILE_SIZE)
+				{
+					if (cmd.arguments().empty())
+					{
+						return cmd.error(QObject::tr("Missing parameter: number after \"-%1 %2\"").arg(COMMAND_RANSAC, TILE_SIZE));
+					}
+					bool ok;
+					float val = cmd.arguments().takeFirst().toFloat(&ok);
+					if (!ok || val <= 0.0f)
+					{
+						return cmd.error("Invalid number for tile size!");
+					}
+					cmd.print(QObject::tr("\tTile size : %1").arg(val));
+					params.tileSize = val;
+				}
+				else if (param == TILE_OVERLAP)
+				{
+					if (cmd.arguments().empty())
+					{
+						return cmd.error(QObject::tr("Missing parameter: number after \"-%1 %2\"").arg(COMMAND_RANSAC, TILE_OVERLAP));
+					}
+					bool ok;
+					float val = cmd.arguments().takeFirst().toFloat(&ok);
+					if (!ok || val < 0.0f)
+					{
+						return cmd.error("Invalid number for tile overlap!");
+					}
+					cmd.print(QObject::tr("\tTile overlap : %1").arg(val));
+					params.tileOverlap = val;
+				}
 				else if (param == OUT_RANDOM_COLOR)
 				{
 					params.randomColor = true;
@@ -333,8 +366,15 @@ struct CommandRANSAC : public ccCommandLineInterface::Command
 			outputGrouped = true;
 		}
 
-		for (CLCloudDesc clCloud : cmd.clouds())
+		//the clouds are processed concurrently (the output clouds are appended to the list afterwards)
+		size_t cloudCount = cmd.clouds().size();
+		std::vector<ccPointCloud*> clouds(cloudCount, nullptr);
+		std::vector<qRansacSD::RansacParams> cloudParams(cloudCount, params);
+		for (size_t i = 0; i < cloudCount; ++i)
 		{
+			const CLCloudDesc& clCloud = cmd.clouds()[i];
+			clouds[i] = clCloud.pc;
+			qRansacSD::RansacParams& p = cloudParams[i];
 
 			CCVector3 bbMin, bbMax;
 			clCloud.pc->getBoundingBox(bbMin, bbMax);
@@ -342,31 +382,42 @@ struct CommandRANSAC : public ccCommandLineInterface::Command
 			float scale = std::max(std::max(diff[0], diff[1]), diff[2]);
 			if (epsilonPercentage > 0.0f)
 			{
-				params.epsilon = (epsilonPercentage * scale);
+				p.epsilon = (epsilonPercentage * scale);
 			}
 			if (bitmapEpsilonPercentage > 0.0f)
 			{
-				params.bitmapEpsilon = (bitmapEpsilonPercentage * scale);
+				p.bitmapEpsilon = (bitmapEpsilonPercentage * scale);
 			}
 			if (epsilonABS > 0.0f)
 			{
-				params.epsilon = epsilonABS;
+				p.epsilon = epsilonABS;
 			}
 			if (bitmapEpsilonABS > 0.0f)
 			{
-				params.bitmapEpsilon = bitmapEpsilonABS;
+				p.bitmapEpsilon = bitmapEpsilonABS;
 			}
-			if (params.epsilon < 0.0f)
+			if (p.epsilon < 0.0f)
 			{
-				params.epsilon = (0.005f * scale);
+				p.epsilon = (0.005f * scale);
 			}
-			if (params.bitmapEpsilon < 0.0f)
+			if (p.bitmapEpsilon < 0.0f)
 			{
-				params.bitmapEpsilon = (0.01f * scale);
+				p.bitmapEpsilon = (0.01f * scale);
 			}
+			if (p.tileSize > 0.0f && p.tileOverlap <= 0.0f)
+			{
+				//the shapes can only be merged across the tile borders if the tiles overlap
+				p.tileOverlap = 4 * p.epsilon;
+			}
+		}
+
+		std::vector<ccHObject*> groups = qRansacSD::executeRANSAC(clouds, cloudParams, cmd.silentMode());
+
+		for (size_t i = 0; i < cloudCount; ++i)
+		{
+			CLCloudDesc clCloud = cmd.clouds()[i];
+			ccHObject* group = groups[i];
 
-			ccHObject* group = qRansacSD::executeRANSAC(clCloud.pc, params, cmd.silentMode());
-			
 			if (group)
 			{
 				if (outputGrouped)
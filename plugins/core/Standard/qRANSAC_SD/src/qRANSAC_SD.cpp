@@ -37,8 +37,7 @@
 //Qt
 #include <QtGui>
 #include <QApplication>
-#include <QtConcurrentRun>
-#include <QApplication>
+#include <QtConcurrentMap>
 #include <QMainWindow>
 
 //qCC_db
@@ -56,8 +55,15 @@
 #include <ScalarField.h>
 #include <CCPlatform.h>
 
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 //System
 #include <algorithm>
+#include <cmath>
+#include <vector>
 #if defined(CC_WINDOWS)
 #include "windows.h"
 #else
@@ -105,18 +111,6 @@ void qRansacSD::registerCommands(ccCommandLineInterface* cmd)
 	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandRANSAC));
 }
 
-static MiscLib::Vector< std::pair< MiscLib::RefCountPtr< PrimitiveShape >, size_t > >* s_shapes; // stores the detected shapes
-static size_t s_remainingPoints = 0;
-static RansacShapeDetector* s_detector = 0;
-static PointCloud* s_cloud = 0;
-void doDetection()
-{
-	if (!s_detector || !s_cloud || !s_shapes)
-		return;
-
-	s_remainingPoints = s_detector->Detect(*s_cloud, 0, s_cloud->size(), s_shapes);
-}
-
 //for parameters persistence
 static unsigned s_supportPoints = 500;	// this is the minimal numer of points required for a primitive
 static double   s_maxNormalDev_deg = 25.0;	// maximal normal deviation from ideal shape (in degrees)
@@ -150,6 +144,9 @@ static double s_minTorusMinorRadius = 1;
 static double s_minTorusMajorRadius = 1;
 static double s_maxTorusMinorRadius = 1;
 static double s_maxTorusMajorRadius = 1;
+static bool s_tilingEnabled = false;
+static double s_tileSize = 0;
+static double s_tileOverlap = 0;
 
 void qRansacSD::doAction()
 {
@@ -219,6 +216,9 @@ void qRansacSD::doAction()
 	rsdDlg.maxTorusMinorRadiusdoubleSpinBox->setValue(s_maxTorusMinorRadius);
 	rsdDlg.maxTorusMajorRadiusdoubleSpinBox->setValue(s_maxTorusMajorRadius);
 	rsdDlg.randomColorcheckBox->setChecked(s_randomColor);
+	rsdDlg.tilingGroupBox->setChecked(s_tilingEnabled);
+	rsdDlg.tileSizeDoubleSpinBox->setValue(s_tileSize > 0 ? s_tileSize : scale / 4);		// 4 tiles per dimension by default
+	rsdDlg.tileOverlapDoubleSpinBox->setValue(s_tileOverlap > 0 ? s_tileOverlap : .02 * scale);
 	if (!rsdDlg.exec())
 	{
 		return;
@@ -235,6 +235,9 @@ void qRansacSD::doAction()
 	s_maxTorusMinorRadiusEnabled = rsdDlg.maxTorusMinorRadiuscheckBox->isChecked();
 	s_maxTorusMajorRadiusEnabled = rsdDlg.maxTorusMajorRadiuscheckBox->isChecked();
 	s_randomColor = rsdDlg.randomColorcheckBox->isChecked();
+	s_tilingEnabled = rsdDlg.tilingGroupBox->isChecked();
+	s_tileSize = rsdDlg.tileSizeDoubleSpinBox->value();
+	s_tileOverlap = rsdDlg.tileOverlapDoubleSpinBox->value();
 	RansacParams params;
 	{
 		params.epsilon = static_cast<float>(rsdDlg.epsilonDoubleSpinBox->value());
@@ -307,6 +310,11 @@ void qRansacSD::doAction()
 			params.maxTorusMajorRadius = static_cast<float>(rsdDlg.maxTorusMajorRadiusdoubleSpinBox->value());
 			s_maxTorusMajorRadius = params.maxTorusMajorRadius;
 		}
+		if (s_tilingEnabled)
+		{
+			params.tileSize = static_cast<float>(s_tileSize);
+			params.tileOverlap = static_cast<float>(s_tileOverlap);
+		}
 	}
 	
 	ccHObject* group = executeRANSAC(pc, params, false);
@@ -320,160 +328,160 @@ void qRansacSD::doAction()
 }
 
 
-ccHObject* qRansacSD::executeRANSAC(ccPointCloud* ccPC, const RansacParams& params, bool silent)
+#ifndef POINTSWITHINDEX
+#error "qRansacSD requires the point indexes (POINTSWITHINDEX) to map the detected shapes back to the input cloud"
+#endif
+
+//! Detected shape with the indexes of its points (in the input cloud)
+struct DetectedShape
 {
-	//consistency check
-	{
-		unsigned char primCount = 0;
-		for (unsigned char k = 0; k < 5; ++k)
-		{
-			primCount += static_cast<unsigned>(params.primEnabled[k]);
-		}
-		if (primCount == 0)
-		{
-			ccLog::Error("[qRansacSD] No primitive type selected!");
-			return nullptr;
-		}
-	}
-	for (unsigned char k = 0; k < 5; ++k)
-	{
-		s_primEnabled[k] = params.primEnabled[k];
-	}
-	s_supportPoints = params.supportPoints;
-	s_maxNormalDev_deg = params.maxNormalDev_deg;
-	s_proba = params.probability;
-	s_createCloudFromLeftOverPoints = params.createCloudFromLeftOverPoints;
-	s_allowSimplification = params.allowSimplification;
-	unsigned count = ccPC->size();
-	bool hasNorms = ccPC->hasNormals();
-	CCVector3 bbMin, bbMax;
-	ccPC->getBoundingBox(bbMin, bbMax);
-	const CCVector3d& globalShift = ccPC->getGlobalShift();
-	double globalScale = ccPC->getGlobalScale();
-	PointCloud cloud;
-	{
-		try
-		{
-			cloud.reserve(count);
-		}
-		catch (...)
-		{
-			ccLog::Error("[qRansacSD] Could not create temporary cloud, Not enough memory!");
-			return nullptr;
-		}
+	MiscLib::RefCountPtr<PrimitiveShape> shape;
+	std::vector<unsigned> pointIndexes;
+};
 
-		//default point & normal
-		Point Pt;
-		Pt.normal[0] = 0.0;
-		Pt.normal[1] = 0.0;
-		Pt.normal[2] = 0.0;
-		for (unsigned i = 0; i < count; ++i)
+//! Detection job (a whole cloud or one tile of a cloud)
+struct DetectionJob
+{
+	//! Input cloud (with normals)
+	const ccPointCloud* cloud = nullptr;
+	//! Detection parameters
+	const qRansacSD::RansacParams* params = nullptr;
+	//! Indexes of the points of the tile (empty = the whole cloud)
+	std::vector<unsigned> pointIndexes;
+	//! Index of the tile in its grid (if any)
+	int tileIndex = -1;
+	//! Number of threads the detector may use (OpenMP)
+	int threadCount = 1;
+	//! Detected shapes (output)
+	std::vector<DetectedShape> shapes;
+	//! Whether the job succeeded (output)
+	bool success = false;
+};
+
+//! Regular grid of cubical tiles
+struct TileGrid
+{
+	CCVector3 origin;
+	PointCoordinateType size = 0;
+	PointCoordinateType overlap = 0;
+	int dim[3] = { 1, 1, 1 };
+
+	//! Returns the number of tiles
+	inline int count() const { return dim[0] * dim[1] * dim[2]; }
+
+	//! Returns the index of the tile containing a point (without the overlap)
+	inline int tileIndex(const CCVector3& P) const
+	{
+		int c[3];
+		for (unsigned char d = 0; d < 3; ++d)
 		{
-			const CCVector3* P = ccPC->getPoint(i);
-			Pt.pos[0] = static_cast<float>(P->x);
-			Pt.pos[1] = static_cast<float>(P->y);
-			Pt.pos[2] = static_cast<float>(P->z);
-			if (hasNorms)
-			{
-				const CCVector3& N = ccPC->getPointNormal(i);
-				Pt.normal[0] = static_cast<float>(N.x);
-				Pt.normal[1] = static_cast<float>(N.y);
-				Pt.normal[2] = static_cast<float>(N.z);
-			}
-#ifdef POINTSWITHINDEX
-			Pt.index = i;
-#endif
-			cloud.push_back(Pt);
+			c[d] = std::max(0, std::min(static_cast<int>((P.u[d] - origin.u[d]) / size), dim[d] - 1));
 		}
-
-		//manually set bounding box!
-		Vec3f cbbMin, cbbMax;
-		cbbMin[0] = static_cast<float>(bbMin.x);
-		cbbMin[1] = static_cast<float>(bbMin.y);
-		cbbMin[2] = static_cast<float>(bbMin.z);
-		cbbMax[0] = static_cast<float>(bbMax.x);
-		cbbMax[1] = static_cast<float>(bbMax.y);
-		cbbMax[2] = static_cast<float>(bbMax.z);
-		cloud.setBBox(cbbMin, cbbMax);
+		return c[0] + dim[0] * (c[1] + dim[1] * c[2]);
 	}
+};
 
+static RansacShapeDetector::Options GetDetectorOptions(const qRansacSD::RansacParams& params)
+{
 	RansacShapeDetector::Options ransacOptions;
 	{
 		ransacOptions.m_epsilon = params.epsilon;
 		ransacOptions.m_bitmapEpsilon = params.bitmapEpsilon;
-		ransacOptions.m_normalThresh = static_cast<float>(cos( CCCoreLib::DegreesToRadians( params.maxNormalDev_deg ) ));
+		ransacOptions.m_normalThresh = static_cast<float>(cos(CCCoreLib::DegreesToRadians(params.maxNormalDev_deg)));
 		assert(ransacOptions.m_normalThresh >= 0);
 		ransacOptions.m_probability = params.probability;
 		ransacOptions.m_minSupport = params.supportPoints;
 		ransacOptions.m_allowSimplification = params.allowSimplification;
 		ransacOptions.m_fitting = params.allowFitting ? RansacShapeDetector::Options::LS_FITTING : RansacShapeDetector::Options::NO_FITTING;
 	}
-	const float scale = cloud.getScale();
+	return ransacOptions;
+}
+
+//! Runs the detection of a job (can be called concurrently on different jobs)
+static void RunDetection(DetectionJob& job)
+{
+	job.success = false;
+	job.shapes.clear();
+
+	assert(job.cloud && job.params && job.cloud->hasNormals());
+	const ccPointCloud* ccPC = job.cloud;
+	const qRansacSD::RansacParams& params = *job.params;
+
+#if defined(_OPENMP)
+	//the detector uses OpenMP internally: when several jobs run concurrently, each one is restricted to a single thread
+	omp_set_num_threads(job.threadCount);
+#endif
 
-	if (!hasNorms)
+	bool wholeCloud = job.pointIndexes.empty();
+	unsigned count = (wholeCloud ? ccPC->size() : static_cast<unsigned>(job.pointIndexes.size()));
+	if (count == 0)
 	{
-		ccProgressDialog* pDlg = nullptr;
-		if (!silent)
-		{
-			pDlg = new ccProgressDialog(false, s_app ? s_app->getMainWindow() : nullptr);
-			pDlg->setWindowTitle("Ransac Shape Detection");
-			pDlg->setMethodTitle(tr("Computing normals (please wait)"));
-			pDlg->setRange(0, 0); // infinite loop
-			pDlg->show();
-		}
-		QApplication::processEvents();
+		job.success = true;
+		return;
+	}
 
-		cloud.calcNormals(.01f * scale);
+	PointCloud cloud;
+	try
+	{
+		cloud.reserve(count);
 
-		if (ccPC->reserveTheNormsTable())
+		Vec3f bbMin, bbMax;
+		Point Pt;
+		for (unsigned i = 0; i < count; ++i)
 		{
-			for (unsigned i = 0; i < count; ++i)
+			unsigned index = (wholeCloud ? i : job.pointIndexes[i]);
+			const CCVector3* P = ccPC->getPoint(index);
+			Pt.pos[0] = static_cast<float>(P->x);
+			Pt.pos[1] = static_cast<float>(P->y);
+			Pt.pos[2] = static_cast<float>(P->z);
+			const CCVector3& N = ccPC->getPointNormal(index);
+			Pt.normal[0] = static_cast<float>(N.x);
+			Pt.normal[1] = static_cast<float>(N.y);
+			Pt.normal[2] = static_cast<float>(N.z);
+			Pt.index = index;
+			cloud.push_back(Pt);
+
+			if (i != 0)
 			{
-				Vec3f& Nvi = cloud[i].normal;
-				CCVector3 Ni = CCVector3::fromArray(Nvi);
-				//normalize the vector in case of
-				Ni.normalize();
-				ccPC->addNorm(Ni);
+				for (unsigned char d = 0; d < 3; ++d)
+				{
+					bbMin[d] = std::min(bbMin[d], Pt.pos[d]);
+					bbMax[d] = std::max(bbMax[d], Pt.pos[d]);
+				}
 			}
-			ccPC->showNormals(true);
-
-			//currently selected entities appearance may have changed!
-			ccPC->prepareDisplayForRefresh_recursive();
-		}
-		else
-		{
-			ccLog::Error("[qRansacSD] Not enough memory to compute normals!");
-			if (pDlg)
+			else
 			{
-				pDlg->hide();
-				delete pDlg;
+				bbMin = bbMax = Pt.pos;
 			}
-			return nullptr;
-		}
-		if (pDlg)
-		{
-			pDlg->hide();
-			delete pDlg;
 		}
+
+		//manually set bounding box!
+		cloud.setBBox(bbMin, bbMax);
+	}
+	catch (...)
+	{
+		//not enough memory
+		return;
 	}
 
-	RansacShapeDetector detector(ransacOptions); // the detector object
+	//the tile points are not needed anymore (the cloud points have their index)
+	job.pointIndexes.clear();
+	job.pointIndexes.shrink_to_fit();
 
-	if (params.primEnabled[RPT_PLANE])
+	RansacShapeDetector detector(GetDetectorOptions(params)); // the detector object
+
+	if (params.primEnabled[qRansacSD::RPT_PLANE])
 		detector.Add(new PlanePrimitiveShapeConstructor());
-	if (params.primEnabled[RPT_SPHERE])
+	if (params.primEnabled[qRansacSD::RPT_SPHERE])
 		detector.Add(new SpherePrimitiveShapeConstructor(params.minSphereRadius, params.maxSphereRadius));
-	if (params.primEnabled[RPT_CYLINDER])
+	if (params.primEnabled[qRansacSD::RPT_CYLINDER])
 		detector.Add(new CylinderPrimitiveShapeConstructor(params.minCylinderRadius, params.maxCylinderRadius, params.maxCylinderLength));
-	if (params.primEnabled[RPT_CONE])
+	if (params.primEnabled[qRansacSD::RPT_CONE])
 		detector.Add(new ConePrimitiveShapeConstructor(params.maxConeRadius, CCCoreLib::DegreesToRadians(params.maxConeAngle_deg), params.maxConeLength));
-	if (params.primEnabled[RPT_TORUS])
+	if (params.primEnabled[qRansacSD::RPT_TORUS])
 		detector.Add(new TorusPrimitiveShapeConstructor(false, params.minTorusMinorRadius, params.minTorusMajorRadius, params.maxTorusMinorRadius, params.maxTorusMajorRadius)); // Do not allow apple shaped torus
 
-
-	unsigned remaining = count;
-	typedef std::pair< MiscLib::RefCountPtr< PrimitiveShape >, size_t > DetectedShape;
-	MiscLib::Vector< DetectedShape > shapes; // stores the detected shapes
+	MiscLib::Vector< std::pair< MiscLib::RefCountPtr< PrimitiveShape >, size_t > > shapes; // stores the detected shapes
 
 	// run detection
 	// returns number of unassigned points
@@ -483,467 +491,993 @@ ccHObject* qRansacSD::executeRANSAC(ccPointCloud* ccPC, const RansacParams& para
 	// i.e. into the range [ pc.size() - shapes[0].second, pc.size() )
 	// the points of shape i are found in the range
 	// [ pc.size() - \sum_{j=0..i} shapes[j].second, pc.size() - \sum_{j=0..i-1} shapes[j].second )
+	detector.Detect(cloud, 0, cloud.size(), &shapes);
 
+	try
 	{
-		//progress dialog (Qtconcurrent::run can't be canceled!)
-		ccProgressDialog* pDlg = nullptr;
-		if (!silent)
-		{
-			pDlg = new ccProgressDialog(false, s_app ? s_app->getMainWindow() : nullptr);
-			pDlg->setWindowTitle("Ransac Shape Detection");
-			pDlg->setMethodTitle(tr("Operation in progress (please wait)"));
-			pDlg->setRange(0, 0); // infinite progress
-			pDlg->show();
-		}
-
-		//run in a separate thread
-		s_detector = &detector;
-		s_shapes = &shapes;
-		s_cloud = &cloud;
-		QElapsedTimer eTimer;
-		eTimer.start();
-		QFuture<void> future = QtConcurrent::run(doDetection);
+		job.shapes.resize(shapes.size());
 
-		while (!future.isFinished())
+		size_t shapeEnd = cloud.size();
+		for (size_t i = 0; i < shapes.size(); ++i)
 		{
-#if defined(CC_WINDOWS)
-			::Sleep(500);
-#else
-			usleep(500 * 1000);
-#endif
-			if (!silent && pDlg)
+			size_t shapePointsCount = shapes[i].second;
+			if (shapePointsCount > shapeEnd)
 			{
-				pDlg->setValue(pDlg->value() + 1);
+				//inconsistent result
+				job.shapes.clear();
+				return;
 			}
-			QApplication::processEvents();
-		}
-		remaining = static_cast<unsigned>(s_remainingPoints);
 
-		QApplication::processEvents();
-		if (pDlg)
-		{
-			pDlg->hide();
-			delete pDlg;
+			DetectedShape& detectedShape = job.shapes[i];
+			detectedShape.shape = shapes[i].first;
+			detectedShape.pointIndexes.resize(shapePointsCount);
+			for (size_t j = 0; j < shapePointsCount; ++j)
+			{
+				detectedShape.pointIndexes[j] = cloud[shapeEnd - 1 - j].index;
+			}
+			shapeEnd -= shapePointsCount;
 		}
-		qint64 elapsedTime_ms = eTimer.elapsed();
-
-		ccLog::Print("[qRANSAC] Search Timing: %2.3f s", static_cast<double>(elapsedTime_ms) / 1.0e3);
+	}
+	catch (const std::bad_alloc&)
+	{
+		job.shapes.clear();
+		return;
 	}
 
-#if 0 //def _DEBUG
-	FILE* fp = fopen("RANS_SD_trace.txt", "wt");
+	job.success = true;
+}
 
-	fprintf(fp, "[Options]\n");
-	fprintf(fp, "epsilon=%f\n", ransacOptions.m_epsilon);
-	fprintf(fp, "bitmap epsilon=%f\n", ransacOptions.m_bitmapEpsilon);
-	fprintf(fp, "normal thresh=%f\n", ransacOptions.m_normalThresh);
-	fprintf(fp, "min support=%i\n", ransacOptions.m_minSupport);
-	fprintf(fp, "probability=%f\n", ransacOptions.m_probability);
+//! Splits a cloud in overlapping tiles
+/** \return the indexes of the points of each tile (including the overlap)
+**/
+static bool CreateTiles(const ccPointCloud* cloud, TileGrid& grid, std::vector< std::vector<unsigned> >& tilePoints)
+{
+	CCVector3 bbMin, bbMax;
+	cloud->getBoundingBox(bbMin, bbMax);
+	grid.origin = bbMin;
 
-	fprintf(fp, "\n[Statistics]\n");
-	fprintf(fp, "input points=%i\n", count);
-	fprintf(fp, "segmented=%i\n", count - remaining);
-	fprintf(fp, "remaining=%i\n", remaining);
+	double tileCount = 1.0;
+	for (unsigned char d = 0; d < 3; ++d)
+	{
+		grid.dim[d] = std::max(1, static_cast<int>(std::ceil((bbMax.u[d] - bbMin.u[d]) / grid.size)));
+		tileCount *= grid.dim[d];
+	}
+	if (tileCount > (1 << 20))
+	{
+		ccLog::Warning(QString("[qRansacSD] Too many tiles (%1), the tile size is too small").arg(tileCount));
+		return false;
+	}
 
-	if (shapes.size() > 0)
+	try
 	{
-		fprintf(fp, "\n[Shapes]\n");
-		for (unsigned i = 0; i < shapes.size(); ++i)
+		tilePoints.clear();
+		tilePoints.resize(grid.count());
+
+		unsigned pointCount = cloud->size();
+		for (unsigned i = 0; i < pointCount; ++i)
 		{
-			PrimitiveShape* shape = shapes[i].first;
-			size_t shapePointsCount = shapes[i].second;
+			const CCVector3* P = cloud->getPoint(i);
+
+			//tiles whose extended box contains the point
+			int cMin[3];
+			int cMax[3];
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				PointCoordinateType x = P->u[d] - grid.origin.u[d];
+				cMin[d] = std::max(0, static_cast<int>(std::floor((x - grid.overlap) / grid.size)));
+				cMax[d] = std::min(grid.dim[d] - 1, static_cast<int>(std::floor((x + grid.overlap) / grid.size)));
+			}
 
-			std::string desc;
-			shape->Description(&desc);
-			fprintf(fp, "#%i - %s - %i points\n", i + 1, desc.c_str(), shapePointsCount);
+			for (int k = cMin[2]; k <= cMax[2]; ++k)
+				for (int j = cMin[1]; j <= cMax[1]; ++j)
+					for (int i2 = cMin[0]; i2 <= cMax[0]; ++i2)
+						tilePoints[i2 + grid.dim[0] * (j + grid.dim[1] * k)].push_back(i);
 		}
 	}
-	fclose(fp);
-#endif
+	catch (const std::bad_alloc&)
+	{
+		tilePoints.clear();
+		return false;
+	}
+
+	return true;
+}
 
+//! Returns the distance between a point and a line
+static float DistanceToLine(const Vec3f& P, const Vec3f& linePoint, const Vec3f& lineDir)
+{
+	Vec3f v = P - linePoint;
+	return (v - lineDir * v.dot(lineDir)).length();
+}
 
-	if (remaining == count)
+//! Returns whether two primitives (detected in neighboring tiles) describe the same shape
+static bool AreCompatible(const PrimitiveShape* a, const PrimitiveShape* b, float tolerance, float normalThresh)
+{
+	if (a->Identifier() != b->Identifier())
 	{
-		ccLog::Error("[qRansacSD] Segmentation failed...");
-		return nullptr;
+		return false;
 	}
 
-	if (shapes.size() > 0)
+	switch (a->Identifier())
 	{
-		unsigned planeCount = 1;
-		unsigned sphereCount = 1;
-		unsigned cylinderCount = 1;
-		unsigned coneCount = 1;
-		unsigned torusCount = 1;
-		ccHObject* group = nullptr;
-		for (MiscLib::Vector<DetectedShape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it)
-		{
-			const PrimitiveShape* shape = it->first;
-			unsigned shapePointsCount = static_cast<unsigned>(it->second);
+	case qRansacSD::RPT_PLANE:
+	{
+		const Plane& pa = static_cast<const PlanePrimitiveShape*>(a)->Internal();
+		const Plane& pb = static_cast<const PlanePrimitiveShape*>(b)->Internal();
+		return	std::abs(pa.getNormal().dot(pb.getNormal())) >= normalThresh
+			&&	pa.Distance(pb.getPosition()) <= tolerance
+			&&	pb.Distance(pa.getPosition()) <= tolerance;
+	}
 
-			//too many points?!
-			if (shapePointsCount > count)
-			{
-				ccLog::Error("[qRansacSD] Inconsistent result!");
-				break;
-			}
+	case qRansacSD::RPT_SPHERE:
+	{
+		const Sphere& sa = static_cast<const SpherePrimitiveShape*>(a)->Internal();
+		const Sphere& sb = static_cast<const SpherePrimitiveShape*>(b)->Internal();
+		return	(sa.Center() - sb.Center()).length() <= tolerance
+			&&	std::abs(sa.Radius() - sb.Radius()) <= tolerance;
+	}
 
-			if (shapePointsCount < params.supportPoints)
-			{
-				ccLog::Warning("[qRansacSD] Skipping shape, did not meet minimum point requirement");
-				count -= shapePointsCount;
-				continue;
-			}
+	case qRansacSD::RPT_CYLINDER:
+	{
+		const Cylinder& ca = static_cast<const CylinderPrimitiveShape*>(a)->Internal();
+		const Cylinder& cb = static_cast<const CylinderPrimitiveShape*>(b)->Internal();
+		return	std::abs(ca.AxisDirection().dot(cb.AxisDirection())) >= normalThresh
+			&&	std::abs(ca.Radius() - cb.Radius()) <= tolerance
+			&&	DistanceToLine(cb.AxisPosition(), ca.AxisPosition(), ca.AxisDirection()) <= tolerance
+			&&	DistanceToLine(ca.AxisPosition(), cb.AxisPosition(), cb.AxisDirection()) <= tolerance;
+	}
 
-			std::string desc;
-			shape->Description(&desc);
+	case qRansacSD::RPT_CONE:
+	{
+		const Cone& ca = static_cast<const ConePrimitiveShape*>(a)->Internal();
+		const Cone& cb = static_cast<const ConePrimitiveShape*>(b)->Internal();
+		return	ca.AxisDirection().dot(cb.AxisDirection()) >= normalThresh
+			&&	std::cos(ca.Angle() - cb.Angle()) >= normalThresh
+			&&	(ca.Center() - cb.Center()).length() <= tolerance;
+	}
 
-			// points to current shapes last point in cloud
-			const auto shapeCloudIndex = count - 1;
+	case qRansacSD::RPT_TORUS:
+	{
+		const Torus& ta = static_cast<const TorusPrimitiveShape*>(a)->Internal();
+		const Torus& tb = static_cast<const TorusPrimitiveShape*>(b)->Internal();
+		return	std::abs(ta.AxisDirection().dot(tb.AxisDirection())) >= normalThresh
+			&&	(ta.Center() - tb.Center()).length() <= tolerance
+			&&	std::abs(ta.MinorRadius() - tb.MinorRadius()) <= tolerance
+			&&	std::abs(ta.MajorRadius() - tb.MajorRadius()) <= tolerance;
+	}
 
-			//new cloud for sub-part
-			ccPointCloud* pcShape = nullptr;
-			bool saveNormals = true;
-			{
-#ifdef POINTSWITHINDEX
-				CCCoreLib::ReferenceCloud refPcShape(ccPC);
-				//we fill cloud with sub-part points
-				if (!refPcShape.reserve(static_cast<unsigned>(shapePointsCount)))
-				{
-					ccLog::Error("[qRansacSD] Not enough memory!");
-					break;
-				}
+	default:
+		break;
+	}
 
-				for (unsigned j = 0; j < shapePointsCount; ++j)
-				{
-					refPcShape.addPointIndex(cloud[shapeCloudIndex - j].index);
-				}
-				int warnings = 0;
-				pcShape = ccPC->partialClone(&refPcShape, &warnings);
-				if (warnings != 0)
-				{
-					if ((warnings & ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS) == ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS)
-					{
-						saveNormals = false;
-					}
-				}
+	return false;
+}
 
-#else
-				pcShape = new ccPointCloud(desc.c_str());
-				if (!pcShape->reserve(static_cast<unsigned>(shapePointsCount)))
-				{
-					ccLog::Error("[qRansacSD] Not enough memory!");
-					delete pcShape;
-					break;
-				}
-				saveNormals = pcShape->reserveTheNormsTable();
+//! Merges the shapes detected in the tiles of a cloud
+/** Each point belongs to the shape detected in its own tile (i.e. without the overlap).
+	Two shapes of different tiles that share points (in the overlap) and have compatible
+	parameters are merged. The points of the overlap that were not assigned in their own
+	tile are given to the first shape of a neighboring tile that claimed them.
+**/
+static bool MergeTileShapes(const ccPointCloud* cloud,
+							const TileGrid& grid,
+							std::vector<DetectionJob*>& tileJobs,
+							const qRansacSD::RansacParams& params,
+							std::vector<DetectedShape>& mergedShapes)
+{
+	mergedShapes.clear();
 
-				for (unsigned j = 0; j < shapePointsCount; ++j)
-				{
-					pcShape->addPoint(CCVector3::fromArray(cloud[shapeCloudIndex - j].pos));
-					if (saveNormals)
-					{
-						pcShape->addNorm(CCVector3::fromArray(cloud[shapeCloudIndex - j].normal));
-					}
+	//the primitives are fitted on different parts of the surface: we are a bit more tolerant than the detection itself
+	const float tolerance = 2 * params.epsilon;
+	const float normalThresh = GetDetectorOptions(params).m_normalThresh;
 
-				}
-				pcShape->setGlobalShift(globalShift);
-				pcShape->setGlobalScale(globalScale);
-#endif
-			}
-			//random color
-			ccColor::Rgb col = ccColor::Generator::Random();
-			if (params.randomColor)
+	try
+	{
+		//flatten the shapes
+		std::vector<DetectedShape*> shapes;
+		std::vector<int> shapeTiles;
+		for (DetectionJob* job : tileJobs)
+		{
+			for (DetectedShape& shape : job->shapes)
 			{
-				pcShape->setColor(col);
-				pcShape->showSF(false);
-				pcShape->showColors(true);
+				shapes.push_back(&shape);
+				shapeTiles.push_back(job->tileIndex);
 			}
-			pcShape->showNormals(saveNormals);
-			pcShape->setVisible(true);
-
+		}
+		int shapeCount = static_cast<int>(shapes.size());
 
-			//convert detected primitive into a CC primitive type
-			ccGenericPrimitive* prim = nullptr;
-			switch (shape->Identifier())
-			{
-			case RPT_PLANE: //plane
+		//owner of each point (the shape detected in its own tile)
+		std::vector<int> owner(cloud->size(), -1);
+		for (int s = 0; s < shapeCount; ++s)
+		{
+			for (unsigned index : shapes[s]->pointIndexes)
 			{
-				const PlanePrimitiveShape* plane = static_cast<const PlanePrimitiveShape*>(shape);
-				Vec3f G = plane->Internal().getPosition();
-				Vec3f N = plane->Internal().getNormal();
-				Vec3f X = plane->getXDim();
-				Vec3f Y = plane->getYDim();
-
-				//we look for real plane extents
-				float minX, maxX, minY, maxY;
-				for (unsigned j = 0; j < shapePointsCount; ++j)
+				if (grid.tileIndex(*cloud->getPoint(index)) == shapeTiles[s])
 				{
-					std::pair<float, float> param;
-					plane->Parameters(cloud[shapeCloudIndex - j].pos, &param);
-					if (j != 0)
-					{
-						if (minX < param.first)
-							minX = param.first;
-						else if (maxX > param.first)
-							maxX = param.first;
-						if (minY < param.second)
-							minY = param.second;
-						else if (maxY > param.second)
-							maxY = param.second;
-					}
-					else
-					{
-						minX = maxX = param.first;
-						minY = maxY = param.second;
-					}
+					owner[index] = s;
 				}
-
-				//we recenter plane (as it is not always the case!)
-				float dX = maxX - minX;
-				float dY = maxY - minY;
-				G += X * (minX + dX / 2);
-				G += Y * (minY + dY / 2);
-
-				//we build matrix from these vectors
-				ccGLMatrix glMat(CCVector3::fromArray(X.getValue()),
-				    CCVector3::fromArray(Y.getValue()),
-				    CCVector3::fromArray(N.getValue()),
-				    CCVector3::fromArray(G.getValue()));
-
-				//plane primitive
-				//ccLog::Print(QString("dX: %1, dY: %2").arg(dX).arg(dY));
-				prim = new ccPlane(std::abs(dX), std::abs(dY), &glMat);
-				prim->setSelectionBehavior(ccHObject::SELECTION_FIT_BBOX);
-				prim->enableStippling(true);
-				PointCoordinateType dip = 0.0f;
-				PointCoordinateType dipDir = 0.0f;
-				ccNormalVectors::ConvertNormalToDipAndDipDir(CCVector3::fromArray(N.getValue()), dip, dipDir);
-				QString dipAndDipDirStr = ccNormalVectors::ConvertDipAndDipDirToString(dip, dipDir);
-				prim->setName(dipAndDipDirStr);
-				pcShape->setName(QString("Plane_%1").arg(planeCount, 4, 10, QChar('0')));
-				planeCount++;
-			}
-			break;
-
-			case RPT_SPHERE: //sphere
-			{
-				const SpherePrimitiveShape* sphere = static_cast<const SpherePrimitiveShape*>(shape);
-				float radius = sphere->Internal().Radius();
-				Vec3f CC = sphere->Internal().Center();
-
-				//we build matrix from these vecctors
-				ccGLMatrix glMat;
-				glMat.setTranslation(CC.getValue());
-				//sphere primitive
-				prim = new ccSphere(radius, &glMat);
-				prim->setEnabled(false);
-				prim->setName(QString("Sphere (r=%1)").arg(radius, 0, 'f'));
-				pcShape->setName(QString("Sphere_%1").arg(sphereCount, 4, 10, QChar('0')));
-				sphereCount++;
 			}
-			break;
+		}
 
-			case RPT_CYLINDER: //cylinder
+		//union-find of the compatible shapes
+		std::vector<int> parent(shapeCount);
+		for (int s = 0; s < shapeCount; ++s)
+		{
+			parent[s] = s;
+		}
+		auto root = [&parent](int s)
+		{
+			while (parent[s] != s)
 			{
-				const CylinderPrimitiveShape* cyl = static_cast<const CylinderPrimitiveShape*>(shape);
-				Vec3f G = cyl->Internal().AxisPosition();
-				Vec3f N = cyl->Internal().AxisDirection();
-				Vec3f X = cyl->Internal().AngularDirection();
-				Vec3f Y = N.cross(X);
-				float r = cyl->Internal().Radius();
-				float hMin = cyl->MinHeight();
-				float hMax = cyl->MaxHeight();
-				float h = hMax - hMin;
-				G += N * (hMin + h / 2);
-
-				//we build matrix from these vecctors
-				ccGLMatrix glMat(CCVector3::fromArray(X.getValue()),
-				    CCVector3::fromArray(Y.getValue()),
-				    CCVector3::fromArray(N.getValue()),
-				    CCVector3::fromArray(G.getValue()));
-
-				//cylinder primitive
-				prim = new ccCylinder(r, h, &glMat);
-				prim->setEnabled(false);
-				prim->setName(QString("Cylinder (r=%1/h=%2)").arg(r, 0, 'f').arg(h, 0, 'f'));
-				pcShape->setName(QString("Cylinder_%1").arg(cylinderCount, 4, 10, QChar('0')));
-				cylinderCount++;
+				parent[s] = parent[parent[s]];
+				s = parent[s];
 			}
-			break;
+			return s;
+		};
 
-			case RPT_CONE: //cone
+		for (int s = 0; s < shapeCount; ++s)
+		{
+			for (unsigned index : shapes[s]->pointIndexes)
 			{
-				const ConePrimitiveShape* cone = static_cast<const ConePrimitiveShape*>(shape);
-				Vec3f CC = cone->Internal().Center();
-				Vec3f CA = cone->Internal().AxisDirection();
-				float alpha_rad = cone->Internal().Angle();
-
-				//compute max height
-				Vec3f minP, maxP;
-				float minHeight, maxHeight;
-				minP = maxP = cloud[shapeCloudIndex].pos;
-				minHeight = maxHeight = cone->Internal().Height(cloud[shapeCloudIndex].pos);
-				for (size_t j = 1; j < shapePointsCount; ++j)
+				int o = owner[index];
+				if (o < 0 || o == s || shapeTiles[o] == shapeTiles[s])
 				{
-					float h = cone->Internal().Height(cloud[shapeCloudIndex - j].pos);
-					if (h < minHeight)
-					{
-						minHeight = h;
-						minP = cloud[shapeCloudIndex - j].pos;
-					}
-					else if (h > maxHeight)
-					{
-						maxHeight = h;
-						maxP = cloud[shapeCloudIndex - j].pos;
-					}
-
+					continue;
 				}
 
-
-				float minRadius = tan(alpha_rad) * minHeight;
-				float maxRadius = tan(alpha_rad) * maxHeight;
-
-				//let's build the cone primitive
+				int rs = root(s);
+				int ro = root(o);
+				if (rs != ro && AreCompatible(shapes[s]->shape, shapes[o]->shape, tolerance, normalThresh))
 				{
-					//the bottom should be the largest part so we inverse the axis direction
-					CCVector3 Z = -CCVector3::fromArray(CA.getValue());
-					Z.normalize();
-
-					//the center is halfway between the min and max height
-					float midHeight = (minHeight + maxHeight) / 2;
-					CCVector3 C = CCVector3::fromArray((CC + CA * midHeight).getValue());
-
-					//radial axis
-					CCVector3 X = CCVector3::fromArray((maxP - (CC + maxHeight * CA)).getValue());
-					X.normalize();
-
-					//orthogonal radial axis
-					CCVector3 Y = Z * X;
-
-					//we build the transformation matrix from these vecctors
-					ccGLMatrix glMat(X, Y, Z, C);
-
-					//eventually create the cone primitive
-					prim = new ccCone(maxRadius, minRadius, maxHeight - minHeight, 0, 0, &glMat);
-					prim->setEnabled(false);
-					prim->setName(QString("Cone (alpha=%1 deg / h=%2)").arg(CCCoreLib::RadiansToDegrees(alpha_rad), 0, 'f').arg(static_cast<double>(maxHeight) - minHeight, 0, 'f'));
-					pcShape->setName(QString("Cone_%1").arg(coneCount, 4, 10, QChar('0')));
-					coneCount++;
+					parent[std::max(rs, ro)] = std::min(rs, ro);
 				}
-
 			}
-			break;
+		}
 
-			case RPT_TORUS: //torus
+		//overlap points not assigned in their own tile
+		for (int s = 0; s < shapeCount; ++s)
+		{
+			for (unsigned index : shapes[s]->pointIndexes)
 			{
-				const TorusPrimitiveShape* torus = static_cast<const TorusPrimitiveShape*>(shape);
-				if (torus->Internal().IsAppleShaped())
-				{
-					ccLog::Warning("[qRansacSD] Apple-shaped torus are not handled by CloudCompare!");
-				}
-				else
+				if (owner[index] < 0)
 				{
-					Vec3f CC = torus->Internal().Center();
-					Vec3f CA = torus->Internal().AxisDirection();
-					float minRadius = torus->Internal().MinorRadius();
-					float maxRadius = torus->Internal().MajorRadius();
-
-					CCVector3 Z = CCVector3::fromArray(CA.getValue());
-					CCVector3 C = CCVector3::fromArray(CC.getValue());
-					//construct remaining of base
-					CCVector3 X = Z.orthogonal();
-					CCVector3 Y = Z * X;
-
-					//we build matrix from these vecctors
-					ccGLMatrix glMat(X, Y, Z, C);
-
-					//torus primitive
-					prim = new ccTorus(maxRadius - minRadius, maxRadius + minRadius, M_PI * 2.0, false, 0, &glMat);
-					prim->setEnabled(false);
-					prim->setName(QString("Torus (r=%1/R=%2)").arg(minRadius, 0, 'f').arg(maxRadius, 0, 'f'));
-					pcShape->setName(QString("Torus_%1").arg(torusCount, 4, 10, QChar('0')));
-					torusCount++;
+					owner[index] = s;
 				}
-
-			}
-			break;
 			}
+		}
 
-			//is there a primitive to add to part cloud?
-			if (prim)
+		//gather the points of each group of shapes
+		std::vector<int> groupIndexes(shapeCount, -1);
+		std::vector<int> groupShapes;
+		for (int s = 0; s < shapeCount; ++s)
+		{
+			int r = root(s);
+			if (groupIndexes[r] < 0)
 			{
-				prim->copyGlobalShiftAndScale(*ccPC);
-				prim->applyGLTransformation_recursive();
-				pcShape->addChild(prim);
-				prim->setDisplay(pcShape->getDisplay());
-				if (params.randomColor)
-				{
-					prim->setColor(col);
+				groupIndexes[r] = static_cast<int>(groupShapes.size());
+				groupShapes.push_back(s);
+			}
+			else if (shapes[s]->pointIndexes.size() > shapes[groupShapes[groupIndexes[r]]]->pointIndexes.size())
+			{
+				//the best supported shape is used as representative
+				groupShapes[groupIndexes[r]] = s;
+			}
+		}
+
+		mergedShapes.resize(groupShapes.size());
+		for (size_t g = 0; g < groupShapes.size(); ++g)
+		{
+			mergedShapes[g].shape = shapes[groupShapes[g]]->shape;
+		}
+
+		unsigned pointCount = cloud->size();
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			if (owner[i] >= 0)
+			{
+				mergedShapes[groupIndexes[root(owner[i])]].pointIndexes.push_back(i);
+			}
+		}
+
+		//largest shapes first (as the detector does)
+		std::sort(mergedShapes.begin(), mergedShapes.end(), [](const DetectedShape& a, const DetectedShape& b) { return a.pointIndexes.size() > b.pointIndexes.size(); });
+
+		ccLog::Print(QString("[qRansacSD] %1 shapes detected in %2 tiles, %3 after merging").arg(shapeCount).arg(tileJobs.size()).arg(mergedShapes.size()));
+	}
+	catch (const std::bad_alloc&)
+	{
+		mergedShapes.clear();
+		return false;
+	}
+
+	return true;
+}
+
+//! Computes the normals of a cloud with the RANSAC library (as the detection requires them)
+static bool ComputeNormals(ccPointCloud* ccPC, bool silent)
+{
+	unsigned count = ccPC->size();
+
+	PointCloud cloud;
+	try
+	{
+		cloud.reserve(count);
+	}
+	catch (...)
+	{
+		ccLog::Error("[qRansacSD] Could not create temporary cloud, Not enough memory!");
+		return false;
+	}
+
+	CCVector3 bbMin, bbMax;
+	ccPC->getBoundingBox(bbMin, bbMax);
+	{
+		//default point & normal
+		Point Pt;
+		Pt.normal[0] = 0.0;
+		Pt.normal[1] = 0.0;
+		Pt.normal[2] = 0.0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			const CCVector3* P = ccPC->getPoint(i);
+			Pt.pos[0] = static_cast<float>(P->x);
+			Pt.pos[1] = static_cast<float>(P->y);
+			Pt.pos[2] = static_cast<float>(P->z);
+			Pt.index = i;
+			cloud.push_back(Pt);
+		}
+
+		//manually set bounding box!
+		Vec3f cbbMin, cbbMax;
+		cbbMin[0] = static_cast<float>(bbMin.x);
+		cbbMin[1] = static_cast<float>(bbMin.y);
+		cbbMin[2] = static_cast<float>(bbMin.z);
+		cbbMax[0] = static_cast<float>(bbMax.x);
+		cbbMax[1] = static_cast<float>(bbMax.y);
+		cbbMax[2] = static_cast<float>(bbMax.z);
+		cloud.setBBox(cbbMin, cbbMax);
+	}
+
+	const float scale = cloud.getScale();
+
+	ccProgressDialog* pDlg = nullptr;
+	if (!silent)
+	{
+		pDlg = new ccProgressDialog(false, s_app ? s_app->getMainWindow() : nullptr);
+		pDlg->setWindowTitle("Ransac Shape Detection");
+		pDlg->setMethodTitle(QObject::tr("Computing normals (please wait)"));
+		pDlg->setRange(0, 0); // infinite loop
+		pDlg->show();
+	}
+	QApplication::processEvents();
+
+	cloud.calcNormals(.01f * scale);
+
+	bool success = ccPC->reserveTheNormsTable();
+	if (success)
+	{
+		for (unsigned i = 0; i < count; ++i)
+		{
+			Vec3f& Nvi = cloud[i].normal;
+			CCVector3 Ni = CCVector3::fromArray(Nvi);
+			//normalize the vector in case of
+			Ni.normalize();
+			ccPC->addNorm(Ni);
+		}
+		ccPC->showNormals(true);
+
+		//currently selected entities appearance may have changed!
+		ccPC->prepareDisplayForRefresh_recursive();
+	}
+	else
+	{
+		ccLog::Error("[qRansacSD] Not enough memory to compute normals!");
+	}
+
+	if (pDlg)
+	{
+		pDlg->hide();
+		delete pDlg;
+	}
+
+	return success;
+}
+
+//! Converts the detected shapes into CC entities
+static ccHObject* CreateShapeEntities(ccPointCloud* ccPC, const std::vector<DetectedShape>& shapes, const qRansacSD::RansacParams& params)
+{
+	if (shapes.empty())
+	{
+		ccLog::Error("[qRansacSD] Segmentation failed...");
+		return nullptr;
+	}
+
+	unsigned count = ccPC->size();
+
+	//points that were not assigned to any shape
+	std::vector<bool> assigned;
+	try
+	{
+		assigned.resize(count, false);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[qRansacSD] Not enough memory!");
+		return nullptr;
+	}
+
+	unsigned planeCount = 1;
+	unsigned sphereCount = 1;
+	unsigned cylinderCount = 1;
+	unsigned coneCount = 1;
+	unsigned torusCount = 1;
+	ccHObject* group = nullptr;
+	for (const DetectedShape& detectedShape : shapes)
+	{
+		const PrimitiveShape* shape = detectedShape.shape;
+		const std::vector<unsigned>& shapePointIndexes = detectedShape.pointIndexes;
+		unsigned shapePointsCount = static_cast<unsigned>(shapePointIndexes.size());
+
+		//too many points?!
+		if (shapePointsCount > count)
+		{
+			ccLog::Error("[qRansacSD] Inconsistent result!");
+			break;
+		}
+
+		for (unsigned index : shapePointIndexes)
+		{
+			assigned[index] = true;
+		}
+
+		if (shapePointsCount < params.supportPoints)
+		{
+			ccLog::Warning("[qRansacSD] Skipping shape, did not meet minimum point requirement");
+			continue;
+		}
+
+		auto shapePoint = [&](unsigned j)
+		{
+			const CCVector3* P = ccPC->getPoint(shapePointIndexes[j]);
+			return Vec3f(static_cast<float>(P->x), static_cast<float>(P->y), static_cast<float>(P->z));
+		};
+
+		//new cloud for sub-part
+		ccPointCloud* pcShape = nullptr;
+		bool saveNormals = true;
+		{
+			CCCoreLib::ReferenceCloud refPcShape(ccPC);
+			//we fill cloud with sub-part points
+			if (!refPcShape.reserve(static_cast<unsigned>(shapePointsCount)))
+			{
+				ccLog::Error("[qRansacSD] Not enough memory!");
+				break;
+			}
+
+			for (unsigned index : shapePointIndexes)
+			{
+				refPcShape.addPointIndex(index);
+			}
+			int warnings = 0;
+			pcShape = ccPC->partialClone(&refPcShape, &warnings);
+			if (!pcShape)
+			{
+				ccLog::Error("[qRansacSD] Not enough memory!");
+				break;
+			}
+			if (warnings != 0)
+			{
+				if ((warnings & ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS) == ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS)
+				{
+					saveNormals = false;
+				}
+			}
+		}
+		//random color
+		ccColor::Rgb col = ccColor::Generator::Random();
+		if (params.randomColor)
+		{
+			pcShape->setColor(col);
+			pcShape->showSF(false);
+			pcShape->showColors(true);
+		}
+		pcShape->showNormals(saveNormals);
+		pcShape->setVisible(true);
+
+
+		//convert detected primitive into a CC primitive type
+		ccGenericPrimitive* prim = nullptr;
+		switch (shape->Identifier())
+		{
+		case qRansacSD::RPT_PLANE: //plane
+		{
+			const PlanePrimitiveShape* plane = static_cast<const PlanePrimitiveShape*>(shape);
+			Vec3f G = plane->Internal().getPosition();
+			Vec3f N = plane->Internal().getNormal();
+			Vec3f X = plane->getXDim();
+			Vec3f Y = plane->getYDim();
+
+			//we look for real plane extents
+			float minX, maxX, minY, maxY;
+			for (unsigned j = 0; j < shapePointsCount; ++j)
+			{
+				std::pair<float, float> param;
+				plane->Parameters(shapePoint(j), &param);
+				if (j != 0)
+				{
+					if (minX < param.first)
+						minX = param.first;
+					else if (maxX > param.first)
+						maxX = param.first;
+					if (minY < param.second)
+						minY = param.second;
+					else if (maxY > param.second)
+						maxY = param.second;
 				}
-				prim->showColors(true);
-				prim->setVisible(true);
-				if (!group)
+				else
 				{
-					group = new ccHObject(QString("Ransac Detected Shapes (%1)").arg(ccPC->getName()));
+					minX = maxX = param.first;
+					minY = maxY = param.second;
 				}
-				group->addChild(pcShape);
 			}
 
+			//we recenter plane (as it is not always the case!)
+			float dX = maxX - minX;
+			float dY = maxY - minY;
+			G += X * (minX + dX / 2);
+			G += Y * (minY + dY / 2);
+
+			//we build matrix from these vectors
+			ccGLMatrix glMat(CCVector3::fromArray(X.getValue()),
+			    CCVector3::fromArray(Y.getValue()),
+			    CCVector3::fromArray(N.getValue()),
+			    CCVector3::fromArray(G.getValue()));
+
+			//plane primitive
+			//ccLog::Print(QString("dX: %1, dY: %2").arg(dX).arg(dY));
+			prim = new ccPlane(std::abs(dX), std::abs(dY), &glMat);
+			prim->setSelectionBehavior(ccHObject::SELECTION_FIT_BBOX);
+			prim->enableStippling(true);
+			PointCoordinateType dip = 0.0f;
+			PointCoordinateType dipDir = 0.0f;
+			ccNormalVectors::ConvertNormalToDipAndDipDir(CCVector3::fromArray(N.getValue()), dip, dipDir);
+			QString dipAndDipDirStr = ccNormalVectors::ConvertDipAndDipDirToString(dip, dipDir);
+			prim->setName(dipAndDipDirStr);
+			pcShape->setName(QString("Plane_%1").arg(planeCount, 4, 10, QChar('0')));
+			planeCount++;
+		}
+		break;
+
+		case qRansacSD::RPT_SPHERE: //sphere
+		{
+			const SpherePrimitiveShape* sphere = static_cast<const SpherePrimitiveShape*>(shape);
+			float radius = sphere->Internal().Radius();
+			Vec3f CC = sphere->Internal().Center();
+
+			//we build matrix from these vecctors
+			ccGLMatrix glMat;
+			glMat.setTranslation(CC.getValue());
+			//sphere primitive
+			prim = new ccSphere(radius, &glMat);
+			prim->setEnabled(false);
+			prim->setName(QString("Sphere (r=%1)").arg(radius, 0, 'f'));
+			pcShape->setName(QString("Sphere_%1").arg(sphereCount, 4, 10, QChar('0')));
+			sphereCount++;
+		}
+		break;
 
-			count -= shapePointsCount;
+		case qRansacSD::RPT_CYLINDER: //cylinder
+		{
+			const CylinderPrimitiveShape* cyl = static_cast<const CylinderPrimitiveShape*>(shape);
+			Vec3f G = cyl->Internal().AxisPosition();
+			Vec3f N = cyl->Internal().AxisDirection();
+			Vec3f X = cyl->Internal().AngularDirection();
+			Vec3f Y = N.cross(X);
+			float r = cyl->Internal().Radius();
+			float hMin = cyl->MinHeight();
+			float hMax = cyl->MaxHeight();
+			float h = hMax - hMin;
+			G += N * (hMin + h / 2);
+
+			//we build matrix from these vecctors
+			ccGLMatrix glMat(CCVector3::fromArray(X.getValue()),
+			    CCVector3::fromArray(Y.getValue()),
+			    CCVector3::fromArray(N.getValue()),
+			    CCVector3::fromArray(G.getValue()));
+
+			//cylinder primitive
+			prim = new ccCylinder(r, h, &glMat);
+			prim->setEnabled(false);
+			prim->setName(QString("Cylinder (r=%1/h=%2)").arg(r, 0, 'f').arg(h, 0, 'f'));
+			pcShape->setName(QString("Cylinder_%1").arg(cylinderCount, 4, 10, QChar('0')));
+			cylinderCount++;
+		}
+		break;
+
+		case qRansacSD::RPT_CONE: //cone
+		{
+			const ConePrimitiveShape* cone = static_cast<const ConePrimitiveShape*>(shape);
+			Vec3f CC = cone->Internal().Center();
+			Vec3f CA = cone->Internal().AxisDirection();
+			float alpha_rad = cone->Internal().Angle();
+
+			//compute max height
+			Vec3f minP, maxP;
+			float minHeight, maxHeight;
+			minP = maxP = shapePoint(0);
+			minHeight = maxHeight = cone->Internal().Height(minP);
+			for (unsigned j = 1; j < shapePointsCount; ++j)
+			{
+				Vec3f Pj = shapePoint(j);
+				float h = cone->Internal().Height(Pj);
+				if (h < minHeight)
+				{
+					minHeight = h;
+					minP = Pj;
+				}
+				else if (h > maxHeight)
+				{
+					maxHeight = h;
+					maxP = Pj;
+				}
+
+			}
+
+
+			float minRadius = tan(alpha_rad) * minHeight;
+			float maxRadius = tan(alpha_rad) * maxHeight;
+
+			//let's build the cone primitive
+			{
+				//the bottom should be the largest part so we inverse the axis direction
+				CCVector3 Z = -CCVector3::fromArray(CA.getValue());
+				Z.normalize();
+
+				//the center is halfway between the min and max height
+				float midHeight = (minHeight + maxHeight) / 2;
+				CCVector3 C = CCVector3::fromArray((CC + CA * midHeight).getValue());
+
+				//radial axis
+				CCVector3 X = CCVector3::fromArray((maxP - (CC + maxHeight * CA)).getValue());
+				X.normalize();
+
+				//orthogonal radial axis
+				CCVector3 Y = Z * X;
+
+				//we build the transformation matrix from these vecctors
+				ccGLMatrix glMat(X, Y, Z, C);
+
+				//eventually create the cone primitive
+				prim = new ccCone(maxRadius, minRadius, maxHeight - minHeight, 0, 0, &glMat);
+				prim->setEnabled(false);
+				prim->setName(QString("Cone (alpha=%1 deg / h=%2)").arg(CCCoreLib::RadiansToDegrees(alpha_rad), 0, 'f').arg(static_cast<double>(maxHeight) - minHeight, 0, 'f'));
+				pcShape->setName(QString("Cone_%1").arg(coneCount, 4, 10, QChar('0')));
+				coneCount++;
+			}
 
-			QApplication::processEvents();
 		}
+		break;
 
-		if (group)
+		case qRansacSD::RPT_TORUS: //torus
 		{
-			assert(group->getChildrenNumber() != 0);
+			const TorusPrimitiveShape* torus = static_cast<const TorusPrimitiveShape*>(shape);
+			if (torus->Internal().IsAppleShaped())
+			{
+				ccLog::Warning("[qRansacSD] Apple-shaped torus are not handled by CloudCompare!");
+			}
+			else
+			{
+				Vec3f CC = torus->Internal().Center();
+				Vec3f CA = torus->Internal().AxisDirection();
+				float minRadius = torus->Internal().MinorRadius();
+				float maxRadius = torus->Internal().MajorRadius();
+
+				CCVector3 Z = CCVector3::fromArray(CA.getValue());
+				CCVector3 C = CCVector3::fromArray(CC.getValue());
+				//construct remaining of base
+				CCVector3 X = Z.orthogonal();
+				CCVector3 Y = Z * X;
 
-			//we hide input cloud
-			ccPC->setEnabled(false);
-			ccLog::Warning("[qRansacSD] Input cloud has been automtically hidden!");
+				//we build matrix from these vecctors
+				ccGLMatrix glMat(X, Y, Z, C);
 
+				//torus primitive
+				prim = new ccTorus(maxRadius - minRadius, maxRadius + minRadius, M_PI * 2.0, false, 0, &glMat);
+				prim->setEnabled(false);
+				prim->setName(QString("Torus (r=%1/R=%2)").arg(minRadius, 0, 'f').arg(maxRadius, 0, 'f'));
+				pcShape->setName(QString("Torus_%1").arg(torusCount, 4, 10, QChar('0')));
+				torusCount++;
+			}
+
+		}
+		break;
+		}
 
-			group->setVisible(true);
-			group->setDisplay_recursive(ccPC->getDisplay());
-#ifdef POINTSWITHINDEX
-			if (params.createCloudFromLeftOverPoints)
+		//is there a primitive to add to part cloud?
+		if (prim)
+		{
+			prim->copyGlobalShiftAndScale(*ccPC);
+			prim->applyGLTransformation_recursive();
+			pcShape->addChild(prim);
+			prim->setDisplay(pcShape->getDisplay());
+			if (params.randomColor)
+			{
+				prim->setColor(col);
+			}
+			prim->showColors(true);
+			prim->setVisible(true);
+			if (!group)
 			{
-				//new cloud for left overs
-				ccPointCloud* pcLeftOvers = nullptr;
-				CCCoreLib::ReferenceCloud refPcLO(ccPC);
-				//we fill cloud with left over points
-				if (!refPcLO.reserve(remaining))
+				group = new ccHObject(QString("Ransac Detected Shapes (%1)").arg(ccPC->getName()));
+			}
+			group->addChild(pcShape);
+		}
+		else
+		{
+			delete pcShape;
+			pcShape = nullptr;
+		}
+
+		QApplication::processEvents();
+	}
+
+	if (group)
+	{
+		assert(group->getChildrenNumber() != 0);
+
+		//we hide input cloud
+		ccPC->setEnabled(false);
+		ccLog::Warning("[qRansacSD] Input cloud has been automtically hidden!");
+
+
+		group->setVisible(true);
+		group->setDisplay_recursive(ccPC->getDisplay());
+		if (params.createCloudFromLeftOverPoints)
+		{
+			//new cloud for left overs
+			ccPointCloud* pcLeftOvers = nullptr;
+			CCCoreLib::ReferenceCloud refPcLO(ccPC);
+			//we fill cloud with left over points
+			if (!refPcLO.reserve(count))
+			{
+				ccLog::Error("[qRansacSD] Not enough memory!");
+			}
+			else
+			{
+				for (unsigned j = 0; j < count; ++j)
 				{
-					ccLog::Error("[qRansacSD] Not enough memory!");
+					if (!assigned[j])
+					{
+						refPcLO.addPointIndex(j);
+					}
 				}
+				if (refPcLO.size() != 0)
+				{
+					pcLeftOvers = ccPC->partialClone(&refPcLO);
+				}
+			}
+			if (pcLeftOvers)
+			{
+				pcLeftOvers->setName("Leftovers");
+				group->addChild(pcLeftOvers);
+			}
+		}
+	}
+
+	return group;
+}
+
+ccHObject* qRansacSD::executeRANSAC(ccPointCloud* ccPC, const RansacParams& params, bool silent)
+{
+	std::vector<ccHObject*> groups = executeRANSAC(std::vector<ccPointCloud*>{ ccPC }, std::vector<RansacParams>{ params }, silent);
+	return groups.empty() ? nullptr : groups.front();
+}
+
+std::vector<ccHObject*> qRansacSD::executeRANSAC(const std::vector<ccPointCloud*>& clouds, const std::vector<RansacParams>& params, bool silent)
+{
+	std::vector<ccHObject*> groups(clouds.size(), nullptr);
+	if (clouds.size() != params.size())
+	{
+		assert(false);
+		return groups;
+	}
+
+	//consistency check
+	for (const RansacParams& cloudParams : params)
+	{
+		unsigned char primCount = 0;
+		for (unsigned char k = 0; k < 5; ++k)
+		{
+			primCount += static_cast<unsigned>(cloudParams.primEnabled[k]);
+		}
+		if (primCount == 0)
+		{
+			ccLog::Error("[qRansacSD] No primitive type selected!");
+			return groups;
+		}
+	}
+	if (!params.empty())
+	{
+		const RansacParams& lastParams = params.back();
+		for (unsigned char k = 0; k < 5; ++k)
+		{
+			s_primEnabled[k] = lastParams.primEnabled[k];
+		}
+		s_supportPoints = lastParams.supportPoints;
+		s_maxNormalDev_deg = lastParams.maxNormalDev_deg;
+		s_proba = lastParams.probability;
+		s_createCloudFromLeftOverPoints = lastParams.createCloudFromLeftOverPoints;
+		s_allowSimplification = lastParams.allowSimplification;
+	}
+
+	//the detection requires normals
+	std::vector<bool> validClouds(clouds.size(), false);
+	for (size_t i = 0; i < clouds.size(); ++i)
+	{
+		validClouds[i] = (clouds[i] && clouds[i]->size() != 0 && (clouds[i]->hasNormals() || ComputeNormals(clouds[i], silent)));
+	}
+
+	//create the jobs (one per cloud, or one per tile)
+	std::vector<DetectionJob> jobs;
+	std::vector<TileGrid> grids(clouds.size());
+	try
+	{
+		for (size_t i = 0; i < clouds.size(); ++i)
+		{
+			if (!validClouds[i])
+			{
+				continue;
+			}
+
+			DetectionJob job;
+			job.cloud = clouds[i];
+			job.params = &params[i];
 
-				for (unsigned j = 0; j < remaining; ++j)
+			if (params[i].tileSize > 0)
+			{
+				TileGrid& grid = grids[i];
+				grid.size = params[i].tileSize;
+				grid.overlap = std::max(0.0f, std::min(params[i].tileOverlap, params[i].tileSize / 2));
+
+				std::vector< std::vector<unsigned> > tilePoints;
+				if (!CreateTiles(clouds[i], grid, tilePoints))
 				{
-					refPcLO.addPointIndex(cloud[j].index);
+					ccLog::Error("[qRansacSD] Failed to split the cloud in tiles (not enough memory or tile size too small)");
+					validClouds[i] = false;
+					continue;
 				}
-				int warnings = 0;
-				pcLeftOvers = ccPC->partialClone(&refPcLO, &warnings);
-				bool saveNormals = true;
-				if (warnings != 0)
+
+				for (size_t t = 0; t < tilePoints.size(); ++t)
 				{
-					if ((warnings & ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS) == ccPointCloud::WRN_OUT_OF_MEM_FOR_NORMALS)
+					//not enough points to detect anything (the points will be leftovers)
+					if (tilePoints[t].size() < params[i].supportPoints)
 					{
-						saveNormals = false;
+						continue;
 					}
-				}
-				if (pcLeftOvers)
-				{
-					pcLeftOvers->setName("Leftovers");
-					group->addChild(pcLeftOvers);
+					job.tileIndex = static_cast<int>(t);
+					job.pointIndexes.swap(tilePoints[t]);
+					jobs.push_back(job);
+					job.pointIndexes.clear();
 				}
 			}
+			else
+			{
+				jobs.push_back(job);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[qRansacSD] Not enough memory!");
+		return groups;
+	}
+
+	//the detector uses OpenMP internally: a single job can use all the threads
+	int threadCount = 1;
+#if defined(_OPENMP)
+	threadCount = (jobs.size() == 1 ? omp_get_max_threads() : 1);
+#endif
+	for (DetectionJob& job : jobs)
+	{
+		job.threadCount = threadCount;
+	}
+
+	{
+		//progress dialog (the detection can't be canceled!)
+		ccProgressDialog* pDlg = nullptr;
+		if (!silent)
+		{
+			pDlg = new ccProgressDialog(false, s_app ? s_app->getMainWindow() : nullptr);
+			pDlg->setWindowTitle("Ransac Shape Detection");
+			pDlg->setMethodTitle(tr("Operation in progress (please wait)"));
+			if (jobs.size() > 1)
+			{
+				pDlg->setInfo(tr("Tiles/clouds: %1").arg(jobs.size()));
+				pDlg->setRange(0, static_cast<int>(jobs.size()));
+			}
+			else
+			{
+				pDlg->setRange(0, 0); // infinite progress
+			}
+			pDlg->show();
+		}
+
+		//run in separate threads
+		QElapsedTimer eTimer;
+		eTimer.start();
+		QFuture<void> future = QtConcurrent::map(jobs, RunDetection);
+
+		while (!future.isFinished())
+		{
+#if defined(CC_WINDOWS)
+			::Sleep(500);
+#else
+			usleep(500 * 1000);
 #endif
+			if (!silent && pDlg)
+			{
+				pDlg->setValue(jobs.size() > 1 ? future.progressValue() : pDlg->value() + 1);
+			}
+			QApplication::processEvents();
+		}
+
+		QApplication::processEvents();
+		if (pDlg)
+		{
+			pDlg->hide();
+			delete pDlg;
+		}
+		qint64 elapsedTime_ms = eTimer.elapsed();
 
-			return group;
+		ccLog::Print("[qRANSAC] Search Timing: %2.3f s", static_cast<double>(elapsedTime_ms) / 1.0e3);
+	}
+
+	//gather (and merge) the shapes of each cloud
+	for (size_t i = 0; i < clouds.size(); ++i)
+	{
+		if (!validClouds[i])
+		{
+			continue;
 		}
+
+		std::vector<DetectionJob*> cloudJobs;
+		bool success = true;
+		for (DetectionJob& job : jobs)
+		{
+			if (job.cloud == clouds[i])
+			{
+				cloudJobs.push_back(&job);
+				success &= job.success;
+			}
+		}
+		if (!success)
+		{
+			ccLog::Error(QString("[qRansacSD] Detection failed on cloud '%1' (not enough memory?)").arg(clouds[i]->getName()));
+			continue;
+		}
+
+		std::vector<DetectedShape> shapes;
+		if (params[i].tileSize > 0)
+		{
+			if (!MergeTileShapes(clouds[i], grids[i], cloudJobs, params[i], shapes))
+			{
+				ccLog::Error("[qRansacSD] Not enough memory to merge the shapes of the tiles!");
+				continue;
+			}
+		}
+		else if (!cloudJobs.empty())
+		{
+			shapes.swap(cloudJobs.front()->shapes);
+		}
+
+		//release the memory of the tiles as soon as possible
+		for (DetectionJob* job : cloudJobs)
+		{
+			job->shapes.clear();
+		}
+
+		groups[i] = CreateShapeEntities(clouds[i], shapes, params[i]);
 	}
 
-	return nullptr;
+	return groups;
 }
@@ -36,6 +36,14 @@
 #include <QTextStream>
 #include <QMainWindow>
 
+//system
+#include <algorithm>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 //Meta-data key for profile (polyline) origin
 const char PROFILE_ORIGIN_KEY[] = "ProfileOrigin";
 //Meta-data key for profile (polyline) axis
@@ -47,6 +55,11 @@ const char PROFILE_HEIGHT_SHIFT_KEY[] = "ProfileHeightShift";
 static const double M_PI_DIV_2 = M_PI / 2;
 static const double M_PI_DIV_4 = M_PI / 4;
 
+//Number of points processed between two progress updates (parallel loops)
+static const unsigned s_pointChunkSize = (1 << 16);
+//Maximum amount of memory used by the per-thread grids of CreateMap (in bytes)
+static const size_t s_maxThreadGridsMemory = (size_t(1) << 30); //1 GB
+
 //helper
 static inline double ComputeLatitude_rad(	PointCoordinateType x,
 											PointCoordinateType y,
@@ -62,6 +75,194 @@ static inline double ComputeLatitude_rad(	PointCoordinateType x,
 	return atan(z / sqrt(static_cast<double>(r)));
 }
 
+//! Height-interval index over the segments of a profile
+/** The height range of the profile is divided in regular slices, and each slice lists the
+	(non horizontal) segments that overlap it. Therefore, only a few segments have to be tested
+	to find the ones spanning a given height, instead of all the profile segments.
+**/
+class ProfileSegmentIndex
+{
+public:
+
+	//! Builds the index
+	/** \param vertices profile vertices (X = radius, Y = height)
+		\return false if not enough memory
+	**/
+	bool init(const CCCoreLib::GenericIndexedCloudPersist& vertices)
+	{
+		m_sliceStart.clear();
+		m_segments.clear();
+
+		unsigned vertexCount = vertices.size();
+		if (vertexCount < 2)
+		{
+			return true;
+		}
+
+		//height range and cumulated height of the segments
+		double totalSpan = 0.0;
+		m_minHeight = m_maxHeight = vertices.getPoint(0)->y;
+		for (unsigned j = 1; j < vertexCount; ++j)
+		{
+			double hA = vertices.getPoint(j - 1)->y;
+			double hB = vertices.getPoint(j)->y;
+			totalSpan += std::abs(hB - hA);
+			m_minHeight = std::min(m_minHeight, hB);
+			m_maxHeight = std::max(m_maxHeight, hB);
+		}
+		if (totalSpan <= 0.0)
+		{
+			//only horizontal segments
+			return true;
+		}
+
+		//the number of slices is chosen so that each segment overlaps a few slices on average
+		double range = m_maxHeight - m_minHeight;
+		double sliceCount = std::ceil(8.0 * (vertexCount - 1) * range / totalSpan);
+		m_sliceCount = static_cast<unsigned>(std::max(1.0, std::min(sliceCount, static_cast<double>(vertexCount - 1))));
+		m_sliceHeight = range / m_sliceCount;
+
+		try
+		{
+			m_sliceStart.resize(m_sliceCount + 1, 0);
+
+			//count the segments per slice
+			for (unsigned j = 1; j < vertexCount; ++j)
+			{
+				unsigned first = 0;
+				unsigned last = 0;
+				if (segmentSlices(vertices, j, first, last))
+				{
+					for (unsigned k = first; k <= last; ++k)
+					{
+						++m_sliceStart[k + 1];
+					}
+				}
+			}
+			for (unsigned k = 0; k < m_sliceCount; ++k)
+			{
+				m_sliceStart[k + 1] += m_sliceStart[k];
+			}
+
+			//fill the slices (the segments remain sorted in each slice)
+			m_segments.resize(m_sliceStart.back());
+			std::vector<unsigned> fillPos(m_sliceStart.begin(), m_sliceStart.end() - 1);
+			for (unsigned j = 1; j < vertexCount; ++j)
+			{
+				unsigned first = 0;
+				unsigned last = 0;
+				if (segmentSlices(vertices, j, first, last))
+				{
+					for (unsigned k = first; k <= last; ++k)
+					{
+						m_segments[fillPos[k]++] = j;
+					}
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_sliceStart.clear();
+			m_segments.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Returns the segments that may span a given height
+	/** Segments are designated by the index of their last vertex (i.e. segment [j-1 ; j]).
+		\return the number of candidate segments
+	**/
+	inline unsigned candidates(double height, const unsigned*& segments) const
+	{
+		if (m_sliceStart.empty() || height < m_minHeight || height > m_maxHeight)
+		{
+			return 0;
+		}
+
+		unsigned k = sliceIndex(height);
+		segments = m_segments.data() + m_sliceStart[k];
+		return m_sliceStart[k + 1] - m_sliceStart[k];
+	}
+
+protected:
+
+	//! Returns the slice index of a given height (inside the height range)
+	inline unsigned sliceIndex(double height) const
+	{
+		return std::min(static_cast<unsigned>((height - m_minHeight) / m_sliceHeight), m_sliceCount - 1);
+	}
+
+	//! Returns the slices overlapped by a (non horizontal) segment
+	inline bool segmentSlices(const CCCoreLib::GenericIndexedCloudPersist& vertices, unsigned j, unsigned& first, unsigned& last) const
+	{
+		double hA = vertices.getPoint(j - 1)->y;
+		double hB = vertices.getPoint(j)->y;
+		if (hA == hB)
+		{
+			//horizontal segments can't be 'spanned' (see ComputeRadialDist)
+			return false;
+		}
+		first = sliceIndex(std::min(hA, hB));
+		last = sliceIndex(std::max(hA, hB));
+		return true;
+	}
+
+	//! Height range
+	double m_minHeight = 0.0, m_maxHeight = 0.0;
+	//! Number of slices
+	unsigned m_sliceCount = 0;
+	//! Slice height
+	double m_sliceHeight = 0.0;
+	//! Position of the first segment of each slice in 'm_segments' (+ total count)
+	std::vector<unsigned> m_sliceStart;
+	//! Segments of all slices
+	std::vector<unsigned> m_segments;
+};
+
+//! Projects a value in a cell of a distance map
+static inline void AddValueToCell(	DistanceMapGenerationTool::MapCell& cell,
+									double value,
+									unsigned count,
+									DistanceMapGenerationTool::FillStrategyType fillStrategy)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (cell.count) //if there's already values projected in this cell
+	{
+		switch (fillStrategy)
+		{
+		case DistanceMapGenerationTool::FILL_STRAT_MIN_DIST:
+			// Set the minimum SF value
+			if (value < cell.value)
+				cell.value = value;
+			break;
+		case DistanceMapGenerationTool::FILL_STRAT_AVG_DIST:
+			// Sum the values
+			cell.value += value;
+			break;
+		case DistanceMapGenerationTool::FILL_STRAT_MAX_DIST:
+			// Set the maximum SF value
+			if (value > cell.value)
+				cell.value = value;
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+	else
+	{
+		//for the first value(s), we simply have to store it (whatever the case)
+		cell.value = value;
+	}
+	cell.count += count;
+}
+
 //helper
 static bool GetPolylineMetaVector(const ccPolyline* polyline, const QString& key, CCVector3& P)
 {
@@ -270,6 +471,15 @@ bool DistanceMapGenerationTool::ComputeRadialDist(	ccPointCloud* cloud,
 		return false;
 	}
 
+	//height-interval index over the profile segments
+	ProfileSegmentIndex segmentIndex;
+	if (!segmentIndex.init(*vertices))
+	{
+		if (app)
+			app->dispToConsole(QString("Not enough memory!"), ccMainAppInterface::ERR_CONSOLE_MESSAGE);
+		return false;
+	}
+
 	//reserve a new scalar field (or take the old one if it already exists)
 	int sfIdx = cloud->getScalarFieldIndexByName(RADIAL_DIST_SF_NAME);
 	if (sfIdx < 0)
@@ -320,65 +530,71 @@ bool DistanceMapGenerationTool::ComputeRadialDist(	ccPointCloud* cloud,
 		dlg.start();
 		CCCoreLib::NormalizedProgress nProgress(static_cast<CCCoreLib::GenericProgressCallback*>(&dlg), pointCount);
 
-		for (unsigned i = 0; i < pointCount; ++i)
+		//the points are processed in parallel, by chunks (to update the progress bar)
+		for (unsigned start = 0; start < pointCount; start += s_pointChunkSize)
 		{
-			const CCVector3* P = cloud->getPoint(i);
+			unsigned stop = std::min(pointCount, start + s_pointChunkSize);
 
-			//relative point position
-			CCVector3 Prel = cloudToProfile * (*P);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (int i = static_cast<int>(start); i < static_cast<int>(stop); ++i)
+			{
+				const CCVector3* P = cloud->getPoint(i);
 
-			//deduce point height and radius (i.e. in profile 2D coordinate system)
-			double height = Prel.u[profileDesc.revolDim];
-			//TODO FIXME: we assume the surface of revolution is smooth!
-			double radius = sqrt(Prel.u[dim1] * Prel.u[dim1] + Prel.u[dim2] * Prel.u[dim2]);
+				//relative point position
+				CCVector3 Prel = cloudToProfile * (*P);
 
-			if (radiiSf)
-			{
-				ScalarType radiusVal = static_cast<ScalarType>(radius);
-				radiiSf->setValue(i, radiusVal);
-			}
+				//deduce point height and radius (i.e. in profile 2D coordinate system)
+				double height = Prel.u[profileDesc.revolDim];
+				//TODO FIXME: we assume the surface of revolution is smooth!
+				double radius = sqrt(Prel.u[dim1] * Prel.u[dim1] + Prel.u[dim2] * Prel.u[dim2]);
 
-			//search nearest "segment" in polyline
-			ScalarType minDist = CCCoreLib::NAN_VALUE;
-			for (unsigned j = 1; j < vertexCount; ++j)
-			{
-				const CCVector3* A = vertices->getPoint(j - 1);
-				const CCVector3* B = vertices->getPoint(j);
+				if (radiiSf)
+				{
+					ScalarType radiusVal = static_cast<ScalarType>(radius);
+					radiiSf->setValue(i, radiusVal);
+				}
 
-				double alpha = (height - A->y) / (B->y - A->y);
-				if (alpha >= 0.0 && alpha <= 1.0)
+				//search nearest "segment" in polyline (only among the ones overlapping the point height)
+				ScalarType minDist = CCCoreLib::NAN_VALUE;
+				const unsigned* segments = nullptr;
+				unsigned segmentCount = segmentIndex.candidates(height, segments);
+				for (unsigned k = 0; k < segmentCount; ++k)
 				{
-					//we deduce the right radius by linear interpolation
-					double radius_th = A->x + alpha * (B->x - A->x);
-					double dist = radius - radius_th;
+					unsigned j = segments[k];
+					const CCVector3* A = vertices->getPoint(j - 1);
+					const CCVector3* B = vertices->getPoint(j);
 
-					//we look at the closest segment (if the polyline is concave!)
-					if (	!CCCoreLib::ScalarField::ValidValue(minDist)
-						||	(dist * dist) < (static_cast<double>(minDist) * minDist) )
+					double alpha = (height - A->y) / (B->y - A->y);
+					if (alpha >= 0.0 && alpha <= 1.0)
 					{
-						minDist = static_cast<ScalarType>(dist);
+						//we deduce the right radius by linear interpolation
+						double radius_th = A->x + alpha * (B->x - A->x);
+						double dist = radius - radius_th;
+
+						//we look at the closest segment (if the polyline is concave!)
+						if (	!CCCoreLib::ScalarField::ValidValue(minDist)
+							||	(dist * dist) < (static_cast<double>(minDist) * minDist) )
+						{
+							minDist = static_cast<ScalarType>(dist);
+						}
 					}
 				}
-			}
 
-			sf->setValue(i, minDist);
+				sf->setValue(i, minDist);
+			}
 
-			if (!nProgress.oneStep())
+			if (!nProgress.steps(stop - start))
 			{
 				//cancelled by user
-				for (unsigned j = i; j < pointCount; ++j)
+				for (unsigned j = stop; j < pointCount; ++j)
 					sf->setValue(j, CCCoreLib::NAN_VALUE);
 
 				success = false;
 				break;
 			}
-
-			//TEST
-			//*const_cast<CCVector3*>(P) = Prel;
 		}
-
-		//TEST
-		//cloud->invalidateBoundingBox();
 	}
 
 	sf->computeMinAndMax();
@@ -560,7 +776,29 @@ QSharedPointer<DistanceMapGenerationTool::Map> DistanceMapGenerationTool::Create
 	grid->counterclockwise = counterclockwise;
 	double ccw = (counterclockwise ? -1.0 : 1.0);
 
-	for (unsigned n = 0; n < count; ++n)
+	//each thread projects its points in its own grid (the first thread uses the output grid)
+	int threadCount = 1;
+#if defined(_OPENMP)
+	threadCount = omp_get_max_threads();
+	//limit the memory used by the additional grids
+	threadCount = std::max(1, std::min(threadCount, static_cast<int>(s_maxThreadGridsMemory / (sizeof(MapCell) * cellCount)) + 1));
+#endif
+	std::vector< std::vector<MapCell> > threadGrids;
+	try
+	{
+		threadGrids.resize(threadCount - 1, std::vector<MapCell>(cellCount));
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory for the additional grids: we project the points with a single thread
+		threadGrids.clear();
+		threadCount = 1;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(threadCount)
+#endif
+	for (int n = 0; n < static_cast<int>(count); ++n)
 	{
 		//we skip invalid values
 		const ScalarType& val = sf->getValue(n);
@@ -604,39 +842,28 @@ QSharedPointer<DistanceMapGenerationTool::Map> DistanceMapGenerationTool::Create
 		}
 		assert(i >= 0 && j >= 0);
 
-		MapCell& cell = (*grid)[j*static_cast<int>(grid->xSteps) + i];
-		if (cell.count) //if there's already values projected in this cell
+		int threadIndex = 0;
+#if defined(_OPENMP)
+		threadIndex = omp_get_thread_num();
+#endif
+		MapCell* cells = (threadIndex == 0 ? grid->data() : threadGrids[threadIndex - 1].data());
+		AddValueToCell(cells[j*static_cast<int>(grid->xSteps) + i], val, 1, fillStrategy);
+	}
+
+	//merge the per-thread grids
+	if (!threadGrids.empty())
+	{
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < static_cast<int>(cellCount); ++i)
 		{
-			switch (fillStrategy)
+			MapCell& cell = (*grid)[i];
+			for (const std::vector<MapCell>& threadGrid : threadGrids)
 			{
-			case FILL_STRAT_MIN_DIST:
-				// Set the minimum SF value
-				if (val < cell.value)
-					cell.value = val;
-				break;
-			case FILL_STRAT_AVG_DIST:
-				// Sum the values
-				cell.value += static_cast<double>(val);
-				break;
-			case FILL_STRAT_MAX_DIST:
-				// Set the maximum SF value
-				if (val > cell.value)
-					cell.value = val;
-				break;
-			default:
-				assert(false);
-				break;
+				AddValueToCell(cell, threadGrid[i].value, threadGrid[i].count, fillStrategy);
 			}
 		}
-		else
-		{
-			//for the first point, we simply have to store its associated value (whatever the case)
-			cell.value = val;
-		}
-		++cell.count;
-
-		//if (progressCb)
-		//	progressCb->update(30.0 * (float)n / (float)cloud->size());
 	}
 
 	//we need to finish the average values computation
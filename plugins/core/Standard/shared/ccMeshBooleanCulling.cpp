@@ -0,0 +1,837 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+#include "ccMeshBooleanCulling.h"
+
+//qCC_db
+#include <ccGenericPointCloud.h>
+#include <ccLog.h>
+#include <ccMesh.h>
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
+//! Maximum number of triangles per BVH leaf
+static const unsigned s_leafSize = 4;
+//! Relative tolerance on the barycentric coordinates (to detect the rays passing too close to an edge or a vertex)
+static const double s_baryTolerance = 1.0e-9;
+
+//! Ray directions (arbitrary, so as to avoid being aligned with the mesh edges)
+static const CCVector3d s_rayDirections[3] = {	CCVector3d( 0.5773502691896258,  0.5773502691896258,  0.5773502691896258),
+												CCVector3d(-0.2672612419124244,  0.5345224838248488,  0.8017837257372732),
+												CCVector3d( 0.8164965809277261, -0.4082482904638631,  0.4082482904638631) };
+
+static inline CCVector3d TriangleNormal(const ccMeshBooleanCulling::Mesh& mesh, const ccMeshBooleanCulling::Triangle& tri)
+{
+	const CCVector3d& A = mesh.vertices[tri.i[0]];
+	const CCVector3d& B = mesh.vertices[tri.i[1]];
+	const CCVector3d& C = mesh.vertices[tri.i[2]];
+	return (B - A).cross(C - A);
+}
+
+static inline CCVector3d TriangleCenter(const ccMeshBooleanCulling::Mesh& mesh, const ccMeshBooleanCulling::Triangle& tri)
+{
+	return (mesh.vertices[tri.i[0]] + mesh.vertices[tri.i[1]] + mesh.vertices[tri.i[2]]) / 3.0;
+}
+
+//! Union-find 'find' with path halving
+static inline unsigned FindRoot(std::vector<unsigned>& parents, unsigned i)
+{
+	while (parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+ccMeshBooleanCulling::ccMeshBooleanCulling()
+	: m_epsilon(0.0)
+{
+}
+
+bool ccMeshBooleanCulling::Convert(const ccMesh* in, Mesh& out)
+{
+	if (!in || !in->getAssociatedCloud())
+	{
+		assert(false);
+		return false;
+	}
+
+	const ccGenericPointCloud* vertices = in->getAssociatedCloud();
+	unsigned vertCount = vertices->size();
+	unsigned triCount = in->size();
+
+	try
+	{
+		out.vertices.resize(vertCount);
+		out.triangles.resize(triCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		out.vertices[i] = vertices->getPoint(i)->toDouble();
+	}
+
+	for (unsigned i = 0; i < triCount; ++i)
+	{
+		const CCCoreLib::VerticesIndexes* tsi = in->getTriangleVertIndexes(i);
+		out.triangles[i] = { { tsi->i1, tsi->i2, tsi->i3 } };
+	}
+
+	return true;
+}
+
+bool ccMeshBooleanCulling::BVH::build(const Mesh& inputMesh)
+{
+	mesh = &inputMesh;
+	nodes.clear();
+
+	unsigned triCount = static_cast<unsigned>(inputMesh.triangles.size());
+	std::vector<CCVector3d> centers;
+	try
+	{
+		triangles.resize(triCount);
+		triangleBoxes.resize(triCount);
+		centers.resize(triCount);
+		nodes.reserve(2 * (triCount / s_leafSize + 1));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	if (triCount == 0)
+	{
+		return true;
+	}
+
+	for (unsigned i = 0; i < triCount; ++i)
+	{
+		const Triangle& tri = inputMesh.triangles[i];
+		Box& box = triangleBoxes[i];
+		box.minCorner = box.maxCorner = inputMesh.vertices[tri.i[0]];
+		for (unsigned j = 1; j < 3; ++j)
+		{
+			const CCVector3d& P = inputMesh.vertices[tri.i[j]];
+			box.minCorner.x = std::min(box.minCorner.x, P.x);
+			box.minCorner.y = std::min(box.minCorner.y, P.y);
+			box.minCorner.z = std::min(box.minCorner.z, P.z);
+			box.maxCorner.x = std::max(box.maxCorner.x, P.x);
+			box.maxCorner.y = std::max(box.maxCorner.y, P.y);
+			box.maxCorner.z = std::max(box.maxCorner.z, P.z);
+		}
+		centers[i] = (box.minCorner + box.maxCorner) / 2;
+		triangles[i] = i;
+	}
+
+	//top-down construction (median split along the largest dimension of the centers)
+	struct Range
+	{
+		unsigned nodeIndex;
+		unsigned begin;
+		unsigned end;
+	};
+	std::vector<Range> ranges;
+	try
+	{
+		nodes.emplace_back();
+		ranges.push_back({ 0, 0, triCount });
+
+		while (!ranges.empty())
+		{
+			Range range = ranges.back();
+			ranges.pop_back();
+
+			Box box = triangleBoxes[triangles[range.begin]];
+			CCVector3d minCenter = centers[triangles[range.begin]];
+			CCVector3d maxCenter = minCenter;
+			for (unsigned i = range.begin + 1; i < range.end; ++i)
+			{
+				const Box& triBox = triangleBoxes[triangles[i]];
+				const CCVector3d& C = centers[triangles[i]];
+				for (unsigned d = 0; d < 3; ++d)
+				{
+					box.minCorner.u[d] = std::min(box.minCorner.u[d], triBox.minCorner.u[d]);
+					box.maxCorner.u[d] = std::max(box.maxCorner.u[d], triBox.maxCorner.u[d]);
+					minCenter.u[d] = std::min(minCenter.u[d], C.u[d]);
+					maxCenter.u[d] = std::max(maxCenter.u[d], C.u[d]);
+				}
+			}
+			nodes[range.nodeIndex].box = box;
+
+			unsigned count = range.end - range.begin;
+			if (count <= s_leafSize)
+			{
+				nodes[range.nodeIndex].first = range.begin;
+				nodes[range.nodeIndex].count = count;
+				continue;
+			}
+
+			CCVector3d extents = maxCenter - minCenter;
+			unsigned char dim = (extents.x >= extents.y ? (extents.x >= extents.z ? 0 : 2) : (extents.y >= extents.z ? 1 : 2));
+			unsigned middle = range.begin + count / 2;
+			std::nth_element(	triangles.begin() + range.begin,
+								triangles.begin() + middle,
+								triangles.begin() + range.end,
+								[&](unsigned a, unsigned b) { return centers[a].u[dim] < centers[b].u[dim]; });
+
+			unsigned firstChild = static_cast<unsigned>(nodes.size());
+			nodes[range.nodeIndex].first = firstChild;
+			nodes[range.nodeIndex].count = 0;
+			nodes.emplace_back();
+			nodes.emplace_back();
+			ranges.push_back({ firstChild, range.begin, middle });
+			ranges.push_back({ firstChild + 1, middle, range.end });
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		nodes.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ccMeshBooleanCulling::BVH::overlaps(const Box& box, double margin) const
+{
+	if (nodes.empty())
+	{
+		return false;
+	}
+
+	std::vector<unsigned> stack;
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.box.overlaps(box, margin))
+		{
+			continue;
+		}
+
+		if (node.count != 0)
+		{
+			for (unsigned i = node.first; i < node.first + node.count; ++i)
+			{
+				if (triangleBoxes[triangles[i]].overlaps(box, margin))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+		}
+	}
+
+	return false;
+}
+
+ccMeshBooleanCulling::Location ccMeshBooleanCulling::BVH::locate(const CCVector3d& P, const CCVector3d& N, double epsilon) const
+{
+	if (nodes.empty())
+	{
+		return OUTSIDE;
+	}
+
+	unsigned insideVotes = 0;
+	unsigned rayCount = 0;
+	std::vector<unsigned> stack;
+
+	for (const CCVector3d& dir : s_rayDirections)
+	{
+		CCVector3d invDir(1.0 / dir.x, 1.0 / dir.y, 1.0 / dir.z);
+		unsigned crossings = 0;
+		bool ambiguous = false;
+
+		stack.clear();
+		stack.push_back(0);
+		while (!stack.empty() && !ambiguous)
+		{
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+
+			//slab test
+			double tMin = -epsilon;
+			double tMax = std::numeric_limits<double>::max();
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				double t1 = (node.box.minCorner.u[d] - epsilon - P.u[d]) * invDir.u[d];
+				double t2 = (node.box.maxCorner.u[d] + epsilon - P.u[d]) * invDir.u[d];
+				tMin = std::max(tMin, std::min(t1, t2));
+				tMax = std::min(tMax, std::max(t1, t2));
+			}
+			if (tMin > tMax)
+			{
+				continue;
+			}
+
+			if (node.count == 0)
+			{
+				stack.push_back(node.first);
+				stack.push_back(node.first + 1);
+				continue;
+			}
+
+			for (unsigned k = node.first; k < node.first + node.count; ++k)
+			{
+				//Moller-Trumbore ray/triangle intersection
+				const Triangle& tri = mesh->triangles[triangles[k]];
+				const CCVector3d& A = mesh->vertices[tri.i[0]];
+				CCVector3d e1 = mesh->vertices[tri.i[1]] - A;
+				CCVector3d e2 = mesh->vertices[tri.i[2]] - A;
+				CCVector3d p = dir.cross(e2);
+				double det = e1.dot(p);
+				if (std::abs(det) <= std::numeric_limits<double>::epsilon() * e1.norm() * e2.norm())
+				{
+					//ray parallel to the triangle (the other rays will decide)
+					continue;
+				}
+
+				CCVector3d s = P - A;
+				double u = s.dot(p) / det;
+				if (u < -s_baryTolerance || u > 1.0 + s_baryTolerance)
+				{
+					continue;
+				}
+				CCVector3d q = s.cross(e1);
+				double v = dir.dot(q) / det;
+				if (v < -s_baryTolerance || u + v > 1.0 + s_baryTolerance)
+				{
+					continue;
+				}
+				double t = e2.dot(q) / det;
+				if (t < -epsilon)
+				{
+					continue;
+				}
+
+				if (t <= epsilon && u >= 0.0 && v >= 0.0 && u + v <= 1.0)
+				{
+					//the point lies on the surface of the mesh
+					return (N.dot(e1.cross(e2)) >= 0 ? ON_SAME_SIDE : ON_OPPOSITE_SIDE);
+				}
+
+				if (	u <= s_baryTolerance || v <= s_baryTolerance || u + v >= 1.0 - s_baryTolerance
+					||	t <= epsilon )
+				{
+					//the ray passes too close to an edge or a vertex
+					ambiguous = true;
+					break;
+				}
+
+				++crossings;
+			}
+		}
+
+		if (!ambiguous)
+		{
+			return ((crossings & 1) ? INSIDE : OUTSIDE);
+		}
+
+		//we keep the result as a (last resort) vote
+		++rayCount;
+		if (crossings & 1)
+		{
+			++insideVotes;
+		}
+	}
+
+	return (2 * insideVotes > rayCount ? INSIDE : OUTSIDE);
+}
+
+bool ccMeshBooleanCulling::Keep(Operation operation, bool fromB, Location location, bool& flip)
+{
+	flip = false;
+
+	switch (operation)
+	{
+	case UNION:
+		//coplanar faces with the same orientation: only one copy is kept
+		return (location == OUTSIDE || (!fromB && location == ON_SAME_SIDE));
+
+	case INTERSECT:
+		return (location == INSIDE || (!fromB && location == ON_SAME_SIDE));
+
+	case DIFF:
+		if (fromB)
+		{
+			//the inner part of B closes A
+			flip = true;
+			return (location == INSIDE);
+		}
+		return (location == OUTSIDE || location == ON_OPPOSITE_SIDE);
+
+	case SYM_DIFF:
+		//the inner parts of both meshes are kept (flipped)
+		flip = (location == INSIDE);
+		return (location == OUTSIDE || location == INSIDE);
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return false;
+}
+
+bool ccMeshBooleanCulling::Split(	const BVH& bvh,
+									const BVH& otherBVH,
+									double margin,
+									double epsilon,
+									Mesh& active,
+									std::vector<unsigned>& passiveTriangles,
+									std::vector<unsigned>& passivePatches,
+									std::vector<Location>& patchLocations,
+									std::vector<bool>& border)
+{
+	const Mesh& mesh = *bvh.mesh;
+	int triCount = static_cast<int>(mesh.triangles.size());
+	unsigned vertCount = static_cast<unsigned>(mesh.vertices.size());
+
+	std::vector<char> isActive;
+	std::vector<int> activeVertexIndexes;
+	std::vector<unsigned> parents;
+	std::vector<bool> usedByActive;
+	std::vector<bool> usedByPassive;
+	try
+	{
+		isActive.resize(triCount, 0);
+		activeVertexIndexes.resize(vertCount, -1);
+		parents.resize(vertCount);
+		usedByActive.resize(vertCount, false);
+		usedByPassive.resize(vertCount, false);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	//flag the triangles that may intersect the other mesh
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+	for (int i = 0; i < triCount; ++i)
+	{
+		isActive[i] = (otherBVH.overlaps(bvh.triangleBoxes[i], margin) ? 1 : 0);
+	}
+
+	active.vertices.clear();
+	active.triangles.clear();
+	passiveTriangles.clear();
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		parents[i] = i;
+	}
+
+	try
+	{
+		for (int i = 0; i < triCount; ++i)
+		{
+			const Triangle& tri = mesh.triangles[i];
+			if (isActive[i])
+			{
+				Triangle activeTri;
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					unsigned vertIndex = tri.i[j];
+					if (activeVertexIndexes[vertIndex] < 0)
+					{
+						activeVertexIndexes[vertIndex] = static_cast<int>(active.vertices.size());
+						active.vertices.push_back(mesh.vertices[vertIndex]);
+					}
+					activeTri.i[j] = static_cast<unsigned>(activeVertexIndexes[vertIndex]);
+					usedByActive[vertIndex] = true;
+				}
+				active.triangles.push_back(activeTri);
+			}
+			else
+			{
+				passiveTriangles.push_back(static_cast<unsigned>(i));
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					usedByPassive[tri.i[j]] = true;
+				}
+				//the passive triangles sharing a vertex belong to the same patch
+				unsigned r0 = FindRoot(parents, tri.i[0]);
+				unsigned r1 = FindRoot(parents, tri.i[1]);
+				unsigned r2 = FindRoot(parents, tri.i[2]);
+				parents[r1] = r0;
+				parents[FindRoot(parents, r2)] = r0;
+			}
+		}
+
+		border.resize(vertCount);
+		for (unsigned i = 0; i < vertCount; ++i)
+		{
+			border[i] = (usedByActive[i] && usedByPassive[i]);
+		}
+		//note: two passive triangles sharing a vertex are necessarily on the same side of the other mesh
+		//(otherwise this vertex would lie on the other mesh, and both triangles would be active)
+
+		//number the patches
+		std::vector<int> patchIndexes(vertCount, -1);
+		std::vector<unsigned> representatives;
+		passivePatches.resize(passiveTriangles.size());
+		for (size_t i = 0; i < passiveTriangles.size(); ++i)
+		{
+			unsigned root = FindRoot(parents, mesh.triangles[passiveTriangles[i]].i[0]);
+			if (patchIndexes[root] < 0)
+			{
+				patchIndexes[root] = static_cast<int>(representatives.size());
+				representatives.push_back(passiveTriangles[i]);
+			}
+			passivePatches[i] = static_cast<unsigned>(patchIndexes[root]);
+		}
+
+		patchLocations.resize(representatives.size());
+
+		//classify each patch (the passive triangles don't cross the other mesh)
+		int patchCount = static_cast<int>(representatives.size());
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int i = 0; i < patchCount; ++i)
+		{
+			const Triangle& tri = mesh.triangles[representatives[i]];
+			Location location = otherBVH.locate(TriangleCenter(mesh, tri), TriangleNormal(mesh, tri), epsilon);
+			//a passive triangle can't be on the surface of the other mesh
+			patchLocations[i] = (location == INSIDE ? INSIDE : OUTSIDE);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool ccMeshBooleanCulling::IsClosed(const Mesh& mesh)
+{
+	if (mesh.triangles.empty())
+	{
+		return false;
+	}
+
+	//number of triangles per edge
+	std::unordered_map<uint64_t, unsigned> edgeCount;
+	try
+	{
+		edgeCount.reserve(mesh.triangles.size() * 3 / 2);
+
+		for (const Triangle& tri : mesh.triangles)
+		{
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				unsigned i1 = tri.i[j];
+				unsigned i2 = tri.i[(j + 1) % 3];
+				if (i1 == i2)
+				{
+					//degenerate triangle
+					return false;
+				}
+				uint64_t key = (static_cast<uint64_t>(std::min(i1, i2)) << 32) | std::max(i1, i2);
+				++edgeCount[key];
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccMeshBooleanCulling] Not enough memory to check the meshes topology");
+		return false;
+	}
+
+	for (const auto& edge : edgeCount)
+	{
+		if (edge.second != 2)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ccMeshBooleanCulling::init(const ccMesh* meshA, const ccMesh* meshB, double relativeMargin/*=1.0e-3*/)
+{
+	if (	!Convert(meshA, m_meshA)
+		||	!Convert(meshB, m_meshB) )
+	{
+		ccLog::Warning("[ccMeshBooleanCulling] Failed to convert the input meshes (not enough memory?)");
+		return false;
+	}
+
+	if (m_meshA.vertices.empty() || m_meshB.vertices.empty())
+	{
+		return false;
+	}
+
+	//the inside/outside classification (ray parity) requires closed meshes
+	if (	!IsClosed(m_meshA)
+		||	!IsClosed(m_meshB) )
+	{
+		ccLog::Warning("[ccMeshBooleanCulling] At least one of the meshes is not closed (pre-culling skipped)");
+		return false;
+	}
+
+	//global bounding box
+	CCVector3d minCorner = m_meshA.vertices.front();
+	CCVector3d maxCorner = minCorner;
+	for (const Mesh* mesh : { &m_meshA, &m_meshB })
+	{
+		for (const CCVector3d& P : mesh->vertices)
+		{
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				minCorner.u[d] = std::min(minCorner.u[d], P.u[d]);
+				maxCorner.u[d] = std::max(maxCorner.u[d], P.u[d]);
+			}
+		}
+	}
+	double diagonal = (maxCorner - minCorner).norm();
+	double margin = relativeMargin * diagonal;
+	m_epsilon = 1.0e-7 * diagonal;
+
+	if (	!m_bvhA.build(m_meshA)
+		||	!m_bvhB.build(m_meshB) )
+	{
+		ccLog::Warning("[ccMeshBooleanCulling] Not enough memory to build the BVHs");
+		return false;
+	}
+
+	if (	!Split(m_bvhA, m_bvhB, margin, m_epsilon, m_activeA, m_passiveA, m_passivePatchA, m_patchLocationA, m_borderA)
+		||	!Split(m_bvhB, m_bvhA, margin, m_epsilon, m_activeB, m_passiveB, m_passivePatchB, m_patchLocationB, m_borderB) )
+	{
+		ccLog::Warning("[ccMeshBooleanCulling] Not enough memory to split the meshes");
+		return false;
+	}
+
+	return true;
+}
+
+double ccMeshBooleanCulling::activeRatio() const
+{
+	size_t totalCount = m_meshA.triangles.size() + m_meshB.triangles.size();
+	if (totalCount == 0)
+	{
+		return 0.0;
+	}
+
+	return static_cast<double>(m_activeA.triangles.size() + m_activeB.triangles.size()) / totalCount;
+}
+
+bool ccMeshBooleanCulling::assemble(Operation operation,
+									const Mesh& resolved,
+									const std::vector<bool>& fromB,
+									Mesh& output) const
+{
+	output.vertices.clear();
+	output.triangles.clear();
+
+	if (fromB.size() != resolved.triangles.size())
+	{
+		assert(false);
+		return false;
+	}
+
+	int fragmentCount = static_cast<int>(resolved.triangles.size());
+	std::vector<char> fragmentStates; //0 = discarded, 1 = kept, 2 = kept and flipped
+	std::vector<int> resolvedVertexIndexes;
+	try
+	{
+		fragmentStates.resize(fragmentCount, 0);
+		resolvedVertexIndexes.resize(resolved.vertices.size(), -1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	//classify the fragments against the full other mesh
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+	for (int i = 0; i < fragmentCount; ++i)
+	{
+		const Triangle& tri = resolved.triangles[i];
+		CCVector3d N = TriangleNormal(resolved, tri);
+		if (N.norm2() == 0)
+		{
+			//degenerate fragment
+			continue;
+		}
+
+		const BVH& otherBVH = (fromB[i] ? m_bvhA : m_bvhB);
+		Location location = otherBVH.locate(TriangleCenter(resolved, tri), N, m_epsilon);
+		bool flip = false;
+		if (Keep(operation, fromB[i], location, flip))
+		{
+			fragmentStates[i] = (flip ? 2 : 1);
+		}
+	}
+
+	//spatial hash of the resolved vertices (to weld them with the border vertices of the passive triangles)
+	double cellSize = std::max(2 * m_epsilon, std::numeric_limits<double>::min());
+	auto cellKey = [cellSize](const CCVector3d& P, int dx, int dy, int dz) -> uint64_t
+	{
+		uint64_t x = static_cast<uint64_t>(static_cast<int64_t>(std::floor(P.x / cellSize)) + dx);
+		uint64_t y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(P.y / cellSize)) + dy);
+		uint64_t z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(P.z / cellSize)) + dz);
+		return (x * 73856093ULL) ^ (y * 19349663ULL) ^ (z * 83492791ULL);
+	};
+
+	try
+	{
+		std::unordered_multimap<uint64_t, unsigned> resolvedGrid;
+		resolvedGrid.reserve(resolved.vertices.size());
+		for (unsigned i = 0; i < resolved.vertices.size(); ++i)
+		{
+			resolvedGrid.emplace(cellKey(resolved.vertices[i], 0, 0, 0), i);
+		}
+
+		auto addResolvedVertex = [&](unsigned index) -> unsigned
+		{
+			if (resolvedVertexIndexes[index] < 0)
+			{
+				resolvedVertexIndexes[index] = static_cast<int>(output.vertices.size());
+				output.vertices.push_back(resolved.vertices[index]);
+			}
+			return static_cast<unsigned>(resolvedVertexIndexes[index]);
+		};
+
+		//kept fragments
+		for (int i = 0; i < fragmentCount; ++i)
+		{
+			if (fragmentStates[i] == 0)
+			{
+				continue;
+			}
+			const Triangle& tri = resolved.triangles[i];
+			Triangle outTri;
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				outTri.i[j] = addResolvedVertex(tri.i[j]);
+			}
+			if (fragmentStates[i] == 2)
+			{
+				std::swap(outTri.i[1], outTri.i[2]);
+			}
+			output.triangles.push_back(outTri);
+		}
+
+		//kept passive patches
+		for (unsigned k = 0; k < 2; ++k)
+		{
+			bool isB = (k == 1);
+			const Mesh& mesh = (isB ? m_meshB : m_meshA);
+			const std::vector<unsigned>& passive = (isB ? m_passiveB : m_passiveA);
+			const std::vector<unsigned>& patches = (isB ? m_passivePatchB : m_passivePatchA);
+			const std::vector<Location>& locations = (isB ? m_patchLocationB : m_patchLocationA);
+			const std::vector<bool>& border = (isB ? m_borderB : m_borderA);
+
+			std::vector<int> vertexIndexes(mesh.vertices.size(), -1);
+			auto addVertex = [&](unsigned index) -> unsigned
+			{
+				if (vertexIndexes[index] >= 0)
+				{
+					return static_cast<unsigned>(vertexIndexes[index]);
+				}
+
+				const CCVector3d& P = mesh.vertices[index];
+				if (border[index])
+				{
+					//look for the same vertex in the resolved mesh (the kernel may have slightly moved it)
+					int nearestIndex = -1;
+					double nearestDist2 = m_epsilon * m_epsilon;
+					for (int dx = -1; dx <= 1; ++dx)
+					for (int dy = -1; dy <= 1; ++dy)
+					for (int dz = -1; dz <= 1; ++dz)
+					{
+						auto range = resolvedGrid.equal_range(cellKey(P, dx, dy, dz));
+						for (auto it = range.first; it != range.second; ++it)
+						{
+							double dist2 = (resolved.vertices[it->second] - P).norm2();
+							if (dist2 <= nearestDist2)
+							{
+								nearestDist2 = dist2;
+								nearestIndex = static_cast<int>(it->second);
+							}
+						}
+					}
+					if (nearestIndex >= 0)
+					{
+						vertexIndexes[index] = static_cast<int>(addResolvedVertex(static_cast<unsigned>(nearestIndex)));
+						return static_cast<unsigned>(vertexIndexes[index]);
+					}
+				}
+
+				vertexIndexes[index] = static_cast<int>(output.vertices.size());
+				output.vertices.push_back(P);
+				return static_cast<unsigned>(vertexIndexes[index]);
+			};
+
+			for (size_t i = 0; i < passive.size(); ++i)
+			{
+				bool flip = false;
+				if (!Keep(operation, isB, locations[patches[i]], flip))
+				{
+					continue;
+				}
+				const Triangle& tri = mesh.triangles[passive[i]];
+				Triangle outTri;
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					outTri.i[j] = addVertex(tri.i[j]);
+				}
+				if (flip)
+				{
+					std::swap(outTri.i[1], outTri.i[2]);
+				}
+				output.triangles.push_back(outTri);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		output.vertices.clear();
+		output.triangles.clear();
+		return false;
+	}
+
+	return true;
+}
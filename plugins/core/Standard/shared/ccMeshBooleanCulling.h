@@ -0,0 +1,183 @@
+#pragma once
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: CloudCompare project                      #
+//#                                                                        #
+//##########################################################################
+
+//CCCoreLib
+#include <CCGeom.h>
+
+//system
+#include <vector>
+
+class ccMesh;
+
+//! Pre-culling of the regions that can't be affected by a boolean operation between two meshes
+/** Exact CSG kernels (libigl/CGAL, Cork) process every triangle of both meshes, while
+	only the triangles close to the other mesh can be cut. This class builds a BVH over the
+	triangles of each mesh and splits them in two sets:
+	- the 'active' triangles, whose bounding box (enlarged by a margin) overlaps the bounding
+	box of at least one triangle of the other mesh. Only these triangles are sent to the exact
+	kernel, which resolves their intersections;
+	- the 'passive' triangles, which can't intersect the other mesh. They are grouped by
+	connected patches, and each patch is classified as inside or outside of the other mesh
+	by ray parity (one test per patch).
+	The fragments returned by the kernel are classified the same way (against the full other
+	mesh), then the kept fragments and passive patches are merged and welded.
+	\warning both meshes must be closed (watertight), otherwise the ray parity is meaningless.
+	This is checked by init.
+**/
+class ccMeshBooleanCulling
+{
+public:
+
+	//! Boolean operations
+	enum Operation { UNION, INTERSECT, DIFF, SYM_DIFF };
+
+	//! Triangle
+	struct Triangle
+	{
+		unsigned i[3];
+	};
+
+	//! Simple indexed mesh (double precision)
+	struct Mesh
+	{
+		std::vector<CCVector3d> vertices;
+		std::vector<Triangle> triangles;
+	};
+
+	//! Default constructor
+	ccMeshBooleanCulling();
+
+	//! Converts both meshes, builds their BVH and splits their triangles
+	/** Fails if one of the meshes is not closed (in which case the standard
+		boolean operation should be performed).
+		\param meshA first mesh
+		\param meshB second mesh
+		\param relativeMargin margin, relatively to the diagonal of the meshes bounding box
+		\return success
+	**/
+	bool init(const ccMesh* meshA, const ccMesh* meshB, double relativeMargin = 1.0e-3);
+
+	//! Returns the ratio of active triangles (relatively to the total number of triangles)
+	/** If most triangles are active, the pre-culling is not worth it.
+	**/
+	double activeRatio() const;
+
+	//! Returns the active triangles of the first mesh (to be sent to the exact kernel)
+	inline const Mesh& activeA() const { return m_activeA; }
+	//! Returns the active triangles of the second mesh (to be sent to the exact kernel)
+	inline const Mesh& activeB() const { return m_activeB; }
+
+	//! Assembles the result of a boolean operation
+	/** \param operation boolean operation
+		\param resolved active triangles once their intersections have been resolved by the exact kernel (may be empty)
+		\param fromB for each triangle of 'resolved', whether it comes from the second mesh
+		\param[out] output result
+		\return success
+	**/
+	bool assemble(	Operation operation,
+					const Mesh& resolved,
+					const std::vector<bool>& fromB,
+					Mesh& output) const;
+
+	//! Converts a mesh
+	static bool Convert(const ccMesh* in, Mesh& out);
+
+protected: //methods
+
+	//! Position of a surface element relatively to the other mesh
+	enum Location { OUTSIDE, INSIDE, ON_SAME_SIDE, ON_OPPOSITE_SIDE };
+
+	//! Returns whether a surface element should be kept (and flipped)
+	static bool Keep(Operation operation, bool fromB, Location location, bool& flip);
+
+	//! Returns whether a mesh is closed (i.e. each edge is shared by exactly two triangles)
+	static bool IsClosed(const Mesh& mesh);
+
+	//! Axis-aligned bounding box
+	struct Box
+	{
+		CCVector3d minCorner;
+		CCVector3d maxCorner;
+
+		inline bool overlaps(const Box& other, double margin) const
+		{
+			return	minCorner.x <= other.maxCorner.x + margin && other.minCorner.x <= maxCorner.x + margin
+				&&	minCorner.y <= other.maxCorner.y + margin && other.minCorner.y <= maxCorner.y + margin
+				&&	minCorner.z <= other.maxCorner.z + margin && other.minCorner.z <= maxCorner.z + margin;
+		}
+	};
+
+	//! Bounding volume hierarchy over the triangles of a mesh
+	struct BVH
+	{
+		//! Node
+		struct Node
+		{
+			Box box;
+			//! Index of the first child node (inner nodes) or of the first triangle in 'triangles' (leaves)
+			unsigned first = 0;
+			//! Number of triangles (0 for inner nodes, whose children are 'first' and 'first + 1')
+			unsigned count = 0;
+		};
+
+		const Mesh* mesh = nullptr;
+		std::vector<Node> nodes;
+		std::vector<unsigned> triangles;
+		std::vector<Box> triangleBoxes;
+
+		//! Builds the hierarchy
+		bool build(const Mesh& inputMesh);
+
+		//! Returns whether a box overlaps the bounding box of at least one triangle
+		bool overlaps(const Box& box, double margin) const;
+
+		//! Locates a point (e.g. the center of a triangle with normal N) relatively to the mesh, by ray parity
+		Location locate(const CCVector3d& P, const CCVector3d& N, double epsilon) const;
+	};
+
+	//! Splits the triangles of one mesh in active and passive triangles, and classifies the passive patches
+	static bool Split(	const BVH& bvh,
+						const BVH& otherBVH,
+						double margin,
+						double epsilon,
+						Mesh& active,
+						std::vector<unsigned>& passiveTriangles,
+						std::vector<unsigned>& passivePatches,
+						std::vector<Location>& patchLocations,
+						std::vector<bool>& border);
+
+protected: //members
+
+	//! Input meshes
+	Mesh m_meshA, m_meshB;
+	//! BVHs
+	BVH m_bvhA, m_bvhB;
+	//! Active triangles
+	Mesh m_activeA, m_activeB;
+	//! Passive triangles
+	std::vector<unsigned> m_passiveA, m_passiveB;
+	//! Location of the passive patches
+	std::vector<Location> m_patchLocationA, m_patchLocationB;
+	//! Patch index of each passive triangle
+	std::vector<unsigned> m_passivePatchA, m_passivePatchB;
+	//! Whether each vertex is shared by active and passive triangles
+	std::vector<bool> m_borderA, m_borderB;
+	//! Tolerance (to detect coplanar triangles and weld the vertices)
+	double m_epsilon;
+};
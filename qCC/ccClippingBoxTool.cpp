@@ -37,6 +37,14 @@
 //Qt
 #include <QMessageBox>
 
+//system
+#include <atomic>
+
+#if defined(_OPENMP)
+//OpenMP
+#include <omp.h>
+#endif
+
 namespace
 {
 	//Last envelope or contour unique ID
@@ -383,18 +391,23 @@ void ccClippingBoxTool::removeLastContour()
 	MainWindow* mainWindow = MainWindow::TheInstance();
 	if (mainWindow)
 	{
+		ccHObject::Container toBeRemoved;
 		for (size_t i = 0; i < s_lastContourUniqueIDs.size(); ++i)
 		{
 			ccHObject* obj = mainWindow->db()->find(s_lastContourUniqueIDs[i]);
 			if (obj)
 			{
-				//obj->prepareDisplayForRefresh();
-				mainWindow->removeFromDB(obj);
-				ccGLWindowInterface* win = mainWindow->getActiveGLWindow();
-				if (win)
-					win->redraw();
+				toBeRemoved.push_back(obj);
 			}
 		}
+
+		if (!toBeRemoved.empty())
+		{
+			mainWindow->db()->removeElements(toBeRemoved);
+			ccGLWindowInterface* win = mainWindow->getActiveGLWindow();
+			if (win)
+				win->redraw();
+		}
 	}
 
 	s_lastContourUniqueIDs.resize(0);
@@ -554,6 +567,202 @@ static unsigned ComputeGridDimensions(	const ccBBox& localBox,
 	return cellCount;
 }
 
+//! Status of a slice after envelope or contour extraction
+enum SliceStatus { SLICE_NOT_PROCESSED, SLICE_OK, SLICE_EMPTY, SLICE_FAILED, SLICE_NOT_ENOUGH_MEMORY };
+
+//! Returns whether the current thread is the master thread (i.e. the one that can interact with the GUI)
+static inline bool IsMasterThread()
+{
+#if defined(_OPENMP)
+	return omp_get_thread_num() == 0;
+#else
+	return true;
+#endif
+}
+
+//! Minimum number of points processed by each parallel task
+static const unsigned s_pointBlockSize = (1 << 16);
+
+//! Computes the bounding box of a cloud in the local clipping box ref. (in parallel)
+static ccBBox ComputeLocalBoundingBox(const ccGenericPointCloud* cloud, const ccGLMatrix& localTrans)
+{
+	unsigned pointCount = cloud->size();
+	int blockCount = static_cast<int>((static_cast<size_t>(pointCount) + s_pointBlockSize - 1) / s_pointBlockSize);
+	std::vector<ccBBox> blockBoxes(blockCount);
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int b = 0; b < blockCount; ++b)
+	{
+		unsigned first = static_cast<unsigned>(b) * s_pointBlockSize;
+		unsigned last = std::min(first + s_pointBlockSize, pointCount);
+		ccBBox& box = blockBoxes[b];
+		for (unsigned i = first; i < last; ++i)
+		{
+			CCVector3 P = *cloud->getPoint(i);
+			localTrans.apply(P);
+			box.add(P);
+		}
+	}
+
+	ccBBox localBox;
+	for (const ccBBox& box : blockBoxes)
+	{
+		localBox += box;
+	}
+	return localBox;
+}
+
+//! Regular grid of slices (in the local clipping box ref.)
+struct SliceGrid
+{
+	ccGLMatrix localTrans;
+	CCVector3 origin;
+	CCVector3 cellSize;
+	CCVector3 cellSizePlusGap;
+	PointCoordinateType gap = 0;
+	int indexMins[3]{ 0, 0, 0 };
+	int indexMaxs[3]{ 0, 0, 0 };
+	int gridDim[3]{ 0, 0, 0 };
+	unsigned cellCount = 0;
+
+	//! Returns the index of the cell in which a point falls (or -1 if it falls in a gap)
+	inline int cellIndex(const CCVector3& point) const
+	{
+		CCVector3 P = point;
+		localTrans.apply(P);
+
+		//relative coordinates (between 0 and 1)
+		P -= origin;
+		P.x /= cellSizePlusGap.x;
+		P.y /= cellSizePlusGap.y;
+		P.z /= cellSizePlusGap.z;
+
+		int xi = static_cast<int>(floor(P.x));
+		xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
+		int yi = static_cast<int>(floor(P.y));
+		yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
+		int zi = static_cast<int>(floor(P.z));
+		zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
+
+		if (gap != 0 &&
+			(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x > cellSize.x
+			||	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y > cellSize.y
+			||	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z > cellSize.z))
+		{
+			return -1;
+		}
+
+		return ((zi - indexMins[2]) * gridDim[1] + (yi - indexMins[1])) * gridDim[0] + (xi - indexMins[0]);
+	}
+};
+
+//! Points of a cloud sorted by grid cell
+struct CellPartition
+{
+	//! Position of the first point of each cell in 'indexes' (+ total count at the end)
+	std::vector<unsigned> cellStart;
+	//! Point indexes (sorted by cell, and by increasing index inside each cell)
+	std::vector<unsigned> indexes;
+
+	//! Returns the number of points in a given cell
+	inline unsigned count(unsigned cellIndex) const { return cellStart[cellIndex + 1] - cellStart[cellIndex]; }
+};
+
+//! Sorts the points of a cloud by grid cell (parallel counting sort)
+/** Each thread counts the points of a contiguous range of points in its own histogram.
+	The histograms are then turned into write positions (prefix sum) so that all the
+	point indexes can be scattered in a single, exactly preallocated, array.
+**/
+static bool PartitionCloud(const ccGenericPointCloud* cloud, const SliceGrid& grid, CellPartition& partition)
+{
+	unsigned pointCount = cloud->size();
+	unsigned cellCount = grid.cellCount;
+
+	int blockCount = 1;
+#if defined(_OPENMP)
+	blockCount = std::max(1, std::min(omp_get_max_threads(), static_cast<int>(pointCount / s_pointBlockSize) + 1));
+#endif
+
+	std::vector<unsigned> blockCursors;
+	try
+	{
+		blockCursors.resize(static_cast<size_t>(blockCount) * cellCount, 0);
+		partition.cellStart.resize(static_cast<size_t>(cellCount) + 1, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	unsigned pointsPerBlock = (pointCount + static_cast<unsigned>(blockCount) - 1) / static_cast<unsigned>(blockCount);
+
+	//count the points of each cell (one histogram per block)
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(blockCount)
+#endif
+	for (int b = 0; b < blockCount; ++b)
+	{
+		unsigned* histogram = blockCursors.data() + static_cast<size_t>(b) * cellCount;
+		unsigned first = std::min(static_cast<unsigned>(b) * pointsPerBlock, pointCount);
+		unsigned last = std::min(first + pointsPerBlock, pointCount);
+		for (unsigned i = first; i < last; ++i)
+		{
+			int c = grid.cellIndex(*cloud->getPoint(i));
+			if (c >= 0)
+			{
+				++histogram[c];
+			}
+		}
+	}
+
+	//prefix sum (the blocks of a given cell are consecutive, in the block order)
+	unsigned total = 0;
+	for (unsigned c = 0; c < cellCount; ++c)
+	{
+		partition.cellStart[c] = total;
+		for (int b = 0; b < blockCount; ++b)
+		{
+			unsigned& cursor = blockCursors[static_cast<size_t>(b) * cellCount + c];
+			unsigned count = cursor;
+			cursor = total;
+			total += count;
+		}
+	}
+	partition.cellStart[cellCount] = total;
+
+	try
+	{
+		partition.indexes.resize(total);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	//scatter the point indexes
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(blockCount)
+#endif
+	for (int b = 0; b < blockCount; ++b)
+	{
+		unsigned* cursors = blockCursors.data() + static_cast<size_t>(b) * cellCount;
+		unsigned first = std::min(static_cast<unsigned>(b) * pointsPerBlock, pointCount);
+		unsigned last = std::min(first + pointsPerBlock, pointCount);
+		for (unsigned i = first; i < last; ++i)
+		{
+			int c = grid.cellIndex(*cloud->getPoint(i));
+			if (c >= 0)
+			{
+				partition.indexes[cursors[c]++] = i;
+			}
+		}
+	}
+
+	return true;
+}
+
 bool ccClippingBoxTool::ExtractSlicesAndContours
 (
 	const std::vector<ccGenericPointCloud*>& clouds,
@@ -663,99 +872,57 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 		{
 			if (!clouds.empty()) //extract sections from clouds
 			{
-				//compute 'grid' extents in the local clipping box ref.
-				ccBBox localBox;
-				for (ccGenericPointCloud* cloud : clouds)
-				{
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
-				}
-
-				int indexMins[3]{ 0, 0, 0 };
-				int indexMaxs[3]{ 0, 0, 0 };
-				int gridDim[3]{ 0, 0, 0 };
-				unsigned cellCount = ComputeGridDimensions(localBox, repeatDimensions, indexMins, indexMaxs, gridDim, gridOrigin, cellSizePlusGap);
-
-				//we'll potentially create up to one (ref.) cloud per input loud and per cell
-				std::vector<CCCoreLib::ReferenceCloud*> refClouds;
-				refClouds.resize(cellCount * clouds.size(), nullptr);
-
 				if (progressDialog)
 				{
 					progressDialog->setWindowTitle(tr("Preparing extraction"));
+					progressDialog->setInfo(tr("Clouds: %L1").arg(clouds.size()));
 					progressDialog->start();
 					progressDialog->show();
 					progressDialog->setAutoClose(false);
+					QApplication::processEvents();
 				}
 
-				unsigned subCloudsCount = 0;
+				//compute 'grid' extents in the local clipping box ref.
+				ccBBox localBox;
+				for (ccGenericPointCloud* cloud : clouds)
+				{
+					localBox += ComputeLocalBoundingBox(cloud, localTrans);
+				}
+
+				SliceGrid grid;
+				grid.localTrans = localTrans;
+				grid.origin = gridOrigin;
+				grid.cellSize = cellSize;
+				grid.cellSizePlusGap = cellSizePlusGap;
+				grid.gap = gap;
+				grid.cellCount = ComputeGridDimensions(localBox, repeatDimensions, grid.indexMins, grid.indexMaxs, grid.gridDim, gridOrigin, cellSizePlusGap);
 
-				//project points into grid
+				//sort the points of each cloud by cell
+				std::vector<CellPartition> partitions(clouds.size());
+				unsigned subCloudsCount = 0;
 				for (size_t ci = 0; ci != clouds.size(); ++ci)
 				{
 					ccGenericPointCloud* cloud = clouds[ci];
-					unsigned pointCount = cloud->size();
-
-					QString infos = tr("Cloud '%1").arg(cloud->getName());
-					infos += tr("Points: %L1").arg( pointCount );
 					if (progressDialog)
 					{
-						progressDialog->setInfo(infos);
+						progressDialog->setInfo(tr("Cloud '%1'\nPoints: %L2").arg(cloud->getName()).arg(cloud->size()));
+						QApplication::processEvents();
 					}
-					QApplication::processEvents();
 
-					CCCoreLib::NormalizedProgress nProgress(progressDialog, pointCount);
-					for (unsigned i = 0; i < pointCount; ++i)
+					if (!PartitionCloud(cloud, grid, partitions[ci]))
 					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-
-						//relative coordinates (between 0 and 1)
-						P -= gridOrigin;
-						P.x /= cellSizePlusGap.x;
-						P.y /= cellSizePlusGap.y;
-						P.z /= cellSizePlusGap.z;
-
-						int xi = static_cast<int>(floor(P.x));
-						xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
-						int yi = static_cast<int>(floor(P.y));
-						yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
-						int zi = static_cast<int>(floor(P.z));
-						zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
-
-						if (gap == 0 ||
-							(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x <= cellSize.x
-							&&	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y <= cellSize.y
-							&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
-						{
-							int cloudIndex = ((zi - indexMins[2]) * static_cast<int>(gridDim[1]) + (yi - indexMins[1])) * static_cast<int>(gridDim[0]) + (xi - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() + ci < refClouds.size());
-
-							CCCoreLib::ReferenceCloud*& destCloud = refClouds[cloudIndex * clouds.size() + ci];
-							if (!destCloud)
-							{
-								destCloud = new CCCoreLib::ReferenceCloud(cloud);
-								++subCloudsCount;
-							}
-
-							if (!destCloud->addPointIndex(i))
-							{
-								ccLog::Error("Not enough memory!");
-								error = true;
-								break;
-							}
-						}
+						ccLog::Error(tr("Not enough memory!"));
+						return false;
 					}
 
-					if (!nProgress.oneStep())
+					for (unsigned c = 0; c < grid.cellCount; ++c)
 					{
-						// sadly, we can't cancel in the middle of this process!
+						if (partitions[ci].count(c) != 0)
+						{
+							++subCloudsCount;
+						}
 					}
-				} //project points into grid
+				}
 
 				if (progressDialog)
 				{
@@ -766,97 +933,101 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					QApplication::processEvents();
 				}
 
+				outputSlices.reserve(outputSlices.size() + subCloudsCount);
+
 				//reset count
 				subCloudsCount = 0;
 
 				//now create the real clouds
-				for (int i = indexMins[0]; i <= indexMaxs[0]; ++i)
+				for (int i = grid.indexMins[0]; i <= grid.indexMaxs[0] && !error; ++i)
 				{
-					for (int j = indexMins[1]; j <= indexMaxs[1]; ++j)
+					for (int j = grid.indexMins[1]; j <= grid.indexMaxs[1] && !error; ++j)
 					{
-						for (int k = indexMins[2]; k <= indexMaxs[2]; ++k)
+						for (int k = grid.indexMins[2]; k <= grid.indexMaxs[2] && !error; ++k)
 						{
-							int cloudIndex = ((k - indexMins[2]) * static_cast<int>(gridDim[1]) + (j - indexMins[1])) * static_cast<int>(gridDim[0]) + (i - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() < refClouds.size());
+							int cellIndex = ((k - grid.indexMins[2]) * grid.gridDim[1] + (j - grid.indexMins[1])) * grid.gridDim[0] + (i - grid.indexMins[0]);
+							assert(cellIndex >= 0 && static_cast<unsigned>(cellIndex) < grid.cellCount);
 
 							for (size_t ci = 0; ci != clouds.size(); ++ci)
 							{
+								const CellPartition& partition = partitions[ci];
+								unsigned count = partition.count(cellIndex);
+								if (count == 0) //some slices can be empty!
+								{
+									continue;
+								}
+
+								//generate slice from the sorted indexes
 								ccGenericPointCloud* cloud = clouds[ci];
-								CCCoreLib::ReferenceCloud* destCloud = refClouds[cloudIndex * clouds.size() + ci];
-								if (destCloud) //some slices can be empty!
+								CCCoreLib::ReferenceCloud destCloud(cloud);
+								if (!destCloud.reserve(count))
 								{
-									//generate slice from previous selection
-									int warnings = 0;
-									ccPointCloud* sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(destCloud, &warnings) : ccPointCloud::From(destCloud, cloud);
-									warningsIssued |= (warnings != 0);
+									ccLog::Error(tr("Not enough memory!"));
+									error = true;
+									break;
+								}
+								const unsigned* cellIndexes = partition.indexes.data() + partition.cellStart[cellIndex];
+								for (unsigned n = 0; n < count; ++n)
+								{
+									destCloud.addPointIndex(cellIndexes[n]);
+								}
+
+								int warnings = 0;
+								ccPointCloud* sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(&destCloud, &warnings) : ccPointCloud::From(&destCloud, cloud);
+								warningsIssued |= (warnings != 0);
 
-									if (sliceCloud)
+								if (sliceCloud)
+								{
+									if (generateRandomColors)
 									{
-										if (generateRandomColors)
+										ccColor::Rgb col = ccColor::Generator::Random();
+										if (!sliceCloud->setColor(col))
 										{
-											ccColor::Rgb col = ccColor::Generator::Random();
-											if (!sliceCloud->setColor(col))
-											{
-												ccLog::Error("Not enough memory!");
-												error = true;
-												i = indexMaxs[0];
-												j = indexMaxs[1];
-												k = indexMaxs[2];
-											}
-											sliceCloud->showColors(true);
+											ccLog::Error("Not enough memory!");
+											error = true;
 										}
+										sliceCloud->showColors(true);
+									}
 
-										sliceCloud->setEnabled(true);
-										sliceCloud->setVisible(true);
-										sliceCloud->setDisplay(cloud->getDisplay());
-
-										CCVector3 cellOrigin(	gridOrigin.x + i * cellSizePlusGap.x,
-																gridOrigin.y + j * cellSizePlusGap.y,
-																gridOrigin.z + k * cellSizePlusGap.z);
-										QString slicePosStr = QString("(%1 ; %2 ; %3)").arg(cellOrigin.x).arg(cellOrigin.y).arg(cellOrigin.z);
-										sliceCloud->setName(cloud->getName() + QString(".slice @ ") + slicePosStr);
+									sliceCloud->setEnabled(true);
+									sliceCloud->setVisible(true);
+									sliceCloud->setDisplay(cloud->getDisplay());
 
-										//set meta-data
-										sliceCloud->setMetaData(s_originEntityUUID, cloud->getUniqueID());
-										sliceCloud->setMetaData(s_sliceID, slicePosStr);
-										sliceCloud->setMetaData("slice.origin.dim(0)", cellOrigin.x);
-										sliceCloud->setMetaData("slice.origin.dim(1)", cellOrigin.y);
-										sliceCloud->setMetaData("slice.origin.dim(2)", cellOrigin.z);
+									CCVector3 cellOrigin(	gridOrigin.x + i * cellSizePlusGap.x,
+															gridOrigin.y + j * cellSizePlusGap.y,
+															gridOrigin.z + k * cellSizePlusGap.z);
+									QString slicePosStr = QString("(%1 ; %2 ; %3)").arg(cellOrigin.x).arg(cellOrigin.y).arg(cellOrigin.z);
+									sliceCloud->setName(cloud->getName() + QString(".slice @ ") + slicePosStr);
 
-										//add slice to group
-										outputSlices.push_back(sliceCloud);
-										++subCloudsCount;
+									//set meta-data
+									sliceCloud->setMetaData(s_originEntityUUID, cloud->getUniqueID());
+									sliceCloud->setMetaData(s_sliceID, slicePosStr);
+									sliceCloud->setMetaData("slice.origin.dim(0)", cellOrigin.x);
+									sliceCloud->setMetaData("slice.origin.dim(1)", cellOrigin.y);
+									sliceCloud->setMetaData("slice.origin.dim(2)", cellOrigin.z);
 
-										if (progressDialog)
-										{
-											progressDialog->setValue(static_cast<int>(subCloudsCount));
-										}
-									}
+									//add slice to group
+									outputSlices.push_back(sliceCloud);
+									++subCloudsCount;
 
-									if (progressDialog && progressDialog->wasCanceled())
+									if (progressDialog)
 									{
-										error = true;
-										ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
-										//early stop
-										i = indexMaxs[0];
-										j = indexMaxs[1];
-										k = indexMaxs[2];
-										break;
+										progressDialog->setValue(static_cast<int>(subCloudsCount));
 									}
 								}
+
+								if (progressDialog && progressDialog->wasCanceled())
+								{
+									error = true;
+									ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
+									//early stop
+									break;
+								}
 							}
 						}
 					}
 				} //now create the real clouds
 
-				//release memory
-				{
-					for (size_t i = 0; i < refClouds.size(); ++i)
-						if (refClouds[i])
-							delete refClouds[i];
-					refClouds.clear();
-				}
-
 				cloudSliceCount = outputSlices.size();
 
 			} //extract sections from clouds
@@ -867,13 +1038,7 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				ccBBox localBox;
 				for (ccGenericMesh* mesh : meshes)
 				{
-					ccGenericPointCloud* cloud = mesh->getAssociatedCloud();
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
+					localBox += ComputeLocalBoundingBox(mesh->getAssociatedCloud(), localTrans);
 				}
 
 				int indexMins[3]{ 0, 0, 0 };
@@ -1018,34 +1183,39 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				gridOrigin.u[X] -= levelSetGridStep;
 				gridOrigin.u[Y] -= levelSetGridStep;
 
-				ccRasterGrid grid;
-				if (!grid.init(gridWidth, gridHeight, levelSetGridStep, CCVector3d(0, 0, 0)))
-				{
-					ccLog::Error("Not enough memory!");
-					error = true;
-					break;
-				}
+				//the slices are processed concurrently (each one with its own grid)
+				assert(cloudSliceCount <= outputSlices.size());
+				size_t levelSetInitialSize = levelSet.size();
+				std::vector<std::vector<ccPolyline*>> sliceContours(cloudSliceCount);
+				std::vector<SliceStatus> sliceStatus(cloudSliceCount, SLICE_NOT_PROCESSED);
+				std::atomic<int> processedCount(0);
+				std::atomic<bool> canceled(false);
 
 				//process all the slices originating from point clouds
-				assert(cloudSliceCount <= outputSlices.size());
-				for (size_t i = 0; i < cloudSliceCount; ++i)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+				for (int i = 0; i < static_cast<int>(cloudSliceCount); ++i)
 				{
+					if (canceled)
+					{
+						continue;
+					}
+
 					ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
 					assert(sliceCloud);
 
-					double sliceZ = sliceCloud->getMetaData(QString("slice.origin.dim(%1)").arg(Z)).toDouble();
-					sliceZ += gridSize.u[Z] / 2;
-
-					//grid.reset();
-					for (ccRasterGrid::Row& row : grid.rows)
+					ccRasterGrid grid;
+					if (!grid.init(gridWidth, gridHeight, levelSetGridStep, CCVector3d(0, 0, 0)))
 					{
-						for (ccRasterCell& cell : row)
-						{
-							cell.h = 0.0;
-							cell.nbPoints = 0;
-						}
+						sliceStatus[i] = SLICE_NOT_ENOUGH_MEMORY;
+						canceled = true;
+						continue;
 					}
 
+					double sliceZ = sliceCloud->getMetaData(QString("slice.origin.dim(%1)").arg(Z)).toDouble();
+					sliceZ += gridSize.u[Z] / 2;
+
 					//project the slice in 2D
 					for (unsigned pi = 0; pi != sliceCloud->size(); ++pi)
 					{
@@ -1053,19 +1223,19 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 						localTrans.apply(relativePos);
 						relativePos -= gridOrigin;
 
-						int i = static_cast<int>(relativePos.u[X] / levelSetGridStep + 0.5);
-						int j = static_cast<int>(relativePos.u[Y] / levelSetGridStep + 0.5);
+						int x = static_cast<int>(relativePos.u[X] / levelSetGridStep + 0.5);
+						int y = static_cast<int>(relativePos.u[Y] / levelSetGridStep + 0.5);
 
 						//we skip points that fall outside of the grid!
-						if (	i < 0 || i >= static_cast<int>(gridWidth)
-							||	j < 0 || j >= static_cast<int>(gridHeight))
+						if (	x < 0 || x >= static_cast<int>(gridWidth)
+							||	y < 0 || y >= static_cast<int>(gridHeight))
 						{
 							//there shouldn't be any actually
 							assert(false);
 							continue;
 						}
 
-						ccRasterCell& cell = grid.rows[j][i];
+						ccRasterCell& cell = grid.rows[y][x];
 						cell.h = 1.0;
 						++cell.nbPoints;
 					}
@@ -1078,12 +1248,12 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					ccContourLinesGenerator::Parameters params;
 					params.emptyCellsValue = std::numeric_limits<double>::quiet_NaN();
 					params.minVertexCount = levelSetMinVertCount;
-					params.parentWidget = progressDialog->parentWidget();
+					params.showProgress = false; //we are (potentially) in a worker thread
 					params.startAltitude = 0.0;
 					params.maxAltitude = 1.0;
 					params.step = 1.0;
 
-					std::vector<ccPolyline*> contours;
+					std::vector<ccPolyline*>& contours = sliceContours[i];
 					if (ccContourLinesGenerator::GenerateContourLines(&grid, CCVector2d(gridOrigin.u[X], gridOrigin.u[Y]), params, contours))
 					{
 						for (size_t k = 0; k < contours.size(); ++k)
@@ -1101,7 +1271,7 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 								*const_cast<CCVector3*>(Pconst) = globalTrans * P;
 							}
 
-							static char s_dimNames[3] = { 'X', 'Y', 'Z' };
+							static const char s_dimNames[3] = { 'X', 'Y', 'Z' };
 							poly->setName(QString("Contour line %1=%2 (#%3)").arg(s_dimNames[Z]).arg(sliceZ).arg(k + 1));
 							poly->copyGlobalShiftAndScale(*sliceCloud);
 							poly->setMetaData(ccPolyline::MetaKeyConstAltitude(), QVariant(sliceZ)); //replace the 'altitude' meta-data by the right value
@@ -1112,25 +1282,63 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 							poly->setMetaData("slice.origin.dim(0)", sliceCloud->getMetaData("slice.origin.dim(0)"));
 							poly->setMetaData("slice.origin.dim(1)", sliceCloud->getMetaData("slice.origin.dim(1)"));
 							poly->setMetaData("slice.origin.dim(2)", sliceCloud->getMetaData("slice.origin.dim(2)"));
-
-							levelSet.push_back(poly);
 						}
+						sliceStatus[i] = SLICE_OK;
 					}
 					else
 					{
-						ccLog::Warning(tr("Failed to generate contour lines for cloud #%1").arg(i + 1));
+						sliceStatus[i] = SLICE_FAILED;
 					}
 
-					if (progressDialog)
+					int processed = ++processedCount;
+					if (progressDialog && IsMasterThread())
 					{
+						//the dialog can only be updated by the main thread
+						progressDialog->setValue(processed);
+						QApplication::processEvents();
 						if (progressDialog->wasCanceled())
 						{
-							error = true;
-							ccLog::Warning(tr("[ExtractSlicesAndContours] Process canceled by user"));
-							break;
+							canceled = true;
+						}
+					}
+				}
+
+				//gather the results (in the slices order)
+				for (size_t i = 0; i < cloudSliceCount; ++i)
+				{
+					switch (sliceStatus[i])
+					{
+					case SLICE_OK:
+						levelSet.insert(levelSet.end(), sliceContours[i].begin(), sliceContours[i].end());
+						break;
+					case SLICE_FAILED:
+						ccLog::Warning(tr("Failed to generate contour lines for cloud #%1").arg(i + 1));
+						break;
+					case SLICE_NOT_ENOUGH_MEMORY:
+						ccLog::Error(tr("Not enough memory!"));
+						error = true;
+						break;
+					default:
+						break;
+					}
+				}
+
+				if (canceled && !error)
+				{
+					error = true;
+					ccLog::Warning(tr("[ExtractSlicesAndContours] Process canceled by user"));
+				}
+
+				if (error)
+				{
+					for (std::vector<ccPolyline*>& contours : sliceContours)
+					{
+						for (ccPolyline* poly : contours)
+						{
+							delete poly;
 						}
-						progressDialog->setValue(static_cast<int>(i) + 1);
 					}
+					levelSet.resize(levelSetInitialSize);
 				}
 			}
 		}
@@ -1153,13 +1361,13 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			//preferred dimension?
 			PointCoordinateType* preferredNormDir = nullptr;
 			PointCoordinateType* preferredUpDir = nullptr;
+			ccGLMatrix invLocalTrans = localTrans.inverse();
 			if (repeatDimensionsSum == 1)
 			{
 				for (int i = 0; i < 3; ++i)
 				{
 					if (repeatDimensions[i])
 					{
-						ccGLMatrix invLocalTrans = localTrans.inverse();
 						if (!projectOnBestFitPlane) //otherwise the normal will be automatically computed
 							preferredNormDir = invLocalTrans.getColumn(i);
 						preferredUpDir = invLocalTrans.getColumn(i < 2 ? 2 : 0);
@@ -1170,13 +1378,27 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 
 			assert(cloudSliceCount <= outputSlices.size());
 
+			//the slices are processed concurrently (except in visual debug mode, as it relies on dialogs)
+			std::vector<std::vector<ccPolyline*>> slicePolys(cloudSliceCount);
+			std::vector<SliceStatus> sliceStatus(cloudSliceCount, SLICE_NOT_PROCESSED);
+			std::atomic<int> processedCount(0);
+			std::atomic<bool> canceled(false);
+
 			//process all the slices originating from point clouds
-			for (size_t i = 0; i < cloudSliceCount; ++i)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic) if (!visualDebugMode)
+#endif
+			for (int i = 0; i < static_cast<int>(cloudSliceCount); ++i)
 			{
+				if (canceled)
+				{
+					continue;
+				}
+
 				ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
 				assert(sliceCloud);
 
-				std::vector<ccPolyline*> polys;
+				std::vector<ccPolyline*>& polys = slicePolys[i];
 				if (ccEnvelopeExtractor::ExtractFlatEnvelope(sliceCloud,
 					multiPass,
 					maxEdgeLength,
@@ -1187,58 +1409,75 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					preferredUpDir,
 					visualDebugMode))
 				{
-					if (!polys.empty())
+					for (size_t p = 0; p < polys.size(); ++p)
 					{
-						for (size_t p = 0; p < polys.size(); ++p)
+						ccPolyline* poly = polys[p];
+						poly->setColor(ccColor::green);
+						poly->showColors(true);
+						poly->setGlobalScale(sliceCloud->getGlobalScale());
+						poly->setGlobalShift(sliceCloud->getGlobalShift());
+						QString envelopeName = sliceCloud->getName();
+						envelopeName.replace("slice", "envelope");
+						if (polys.size() > 1)
 						{
-							ccPolyline* poly = polys[p];
-							poly->setColor(ccColor::green);
-							poly->showColors(true);
-							poly->setGlobalScale(sliceCloud->getGlobalScale());
-							poly->setGlobalShift(sliceCloud->getGlobalShift());
-							QString envelopeName = sliceCloud->getName();
-							envelopeName.replace("slice", "envelope");
-							if (polys.size() > 1)
-							{
-								envelopeName += QString(" (part %1)").arg(p + 1);
-							}
-							poly->setName(envelopeName);
-
-							//set meta-data
-							poly->setMetaData(s_originEntityUUID, sliceCloud->getMetaData(s_originEntityUUID));
-							poly->setMetaData(s_sliceID, sliceCloud->getMetaData(s_sliceID));
-							poly->setMetaData("slice.origin.dim(0)", sliceCloud->getMetaData("slice.origin.dim(0)"));
-							poly->setMetaData("slice.origin.dim(1)", sliceCloud->getMetaData("slice.origin.dim(1)"));
-							poly->setMetaData("slice.origin.dim(2)", sliceCloud->getMetaData("slice.origin.dim(2)"));
-
-							outputEnvelopes.push_back(poly);
+							envelopeName += QString(" (part %1)").arg(p + 1);
 						}
+						poly->setName(envelopeName);
+
+						//set meta-data
+						poly->setMetaData(s_originEntityUUID, sliceCloud->getMetaData(s_originEntityUUID));
+						poly->setMetaData(s_sliceID, sliceCloud->getMetaData(s_sliceID));
+						poly->setMetaData("slice.origin.dim(0)", sliceCloud->getMetaData("slice.origin.dim(0)"));
+						poly->setMetaData("slice.origin.dim(1)", sliceCloud->getMetaData("slice.origin.dim(1)"));
+						poly->setMetaData("slice.origin.dim(2)", sliceCloud->getMetaData("slice.origin.dim(2)"));
 					}
-					else
-					{
-						ccLog::Warning(tr("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
-						warningsIssued = true;
-					}
+					sliceStatus[i] = (polys.empty() ? SLICE_EMPTY : SLICE_OK);
 				}
 				else
 				{
-					ccLog::Warning(tr("%1: envelope extraction failed!").arg(sliceCloud->getName()));
-					warningsIssued = true;
+					sliceStatus[i] = SLICE_FAILED;
 				}
 
-				if (progressDialog && !visualDebugMode)
+				int processed = ++processedCount;
+				if (progressDialog && !visualDebugMode && IsMasterThread())
 				{
+					//the dialog can only be updated by the main thread
+					progressDialog->setValue(processed);
+					QApplication::processEvents();
 					if (progressDialog->wasCanceled())
 					{
-						error = true;
-						ccLog::Warning(tr("[ExtractSlicesAndContours] Process canceled by user"));
-						//early stop
-						break;
+						canceled = true;
 					}
-					progressDialog->setValue(static_cast<int>(i));
 				}
 			}
 
+			//gather the results (in the slices order)
+			for (size_t i = 0; i < cloudSliceCount; ++i)
+			{
+				switch (sliceStatus[i])
+				{
+				case SLICE_OK:
+					outputEnvelopes.insert(outputEnvelopes.end(), slicePolys[i].begin(), slicePolys[i].end());
+					break;
+				case SLICE_EMPTY:
+					ccLog::Warning(tr("%1: points are too far from each other! Increase the max edge length").arg(outputSlices[i]->getName()));
+					warningsIssued = true;
+					break;
+				case SLICE_FAILED:
+					ccLog::Warning(tr("%1: envelope extraction failed!").arg(outputSlices[i]->getName()));
+					warningsIssued = true;
+					break;
+				default:
+					break;
+				}
+			}
+
+			if (canceled)
+			{
+				error = true;
+				ccLog::Warning(tr("[ExtractSlicesAndContours] Process canceled by user"));
+			}
+
 		} //extract envelope polylines
 
 		//release memory
@@ -1709,6 +1948,7 @@ void ccClippingBoxTool::extractSlicesAndContours(bool singleSliceMode)
 	removeLastContourToolButton->setEnabled(!s_lastContourUniqueIDs.empty());
 
 	//now take care of the 'output' groups
+	MainWindow::TheInstance()->beginDBBatch();
 	{
 		if (sliceGroup)
 		{
@@ -1755,6 +1995,7 @@ void ccClippingBoxTool::extractSlicesAndContours(bool singleSliceMode)
 			}
 		}
 	}
+	MainWindow::TheInstance()->endDBBatch();
 
 	if (m_associatedWin)
 	{
@@ -12,9 +12,11 @@
 #include <ccHObjectCaster.h>
 #include <ccNormalVectors.h>
 #include <ccPlane.h>
+#include <ccPolygonClassifier.h>
 #include <ccPolyline.h>
 #include <ccProgressDialog.h>
 #include <ccScalarField.h>
+#include <ccSoftwareRenderer.h>
 #include <ccVolumeCalcTool.h>
 #include <ccSubMesh.h>
 #include <ccPointCloudInterpolator.h>
@@ -39,6 +41,9 @@
 //Local
 #include "ccEntityAction.h"
 
+//qCC_glWindow
+#include <ccGLUtils.h>
+
 #include <QDateTime>
 #include <QFileInfo>
 
@@ -97,9 +102,16 @@ constexpr char COMMAND_NOISE_FILTER_RIP[]				= "RIP";
 constexpr char COMMAND_REMOVE_DUPLICATE_POINTS[]		= "RDP";
 constexpr char COMMAND_SAMPLE_MESH[]					= "SAMPLE_MESH";
 constexpr char COMMAND_COMPRESS_FWF[]					= "COMPRESS_FWF";
+constexpr char COMMAND_FWF_FEATURES[]					= "FWF_FEATURES";
+constexpr char COMMAND_FWF_FEATURES_PEAK[]				= "PEAK";
+constexpr char COMMAND_FWF_FEATURES_WIDTH[]				= "WIDTH";
+constexpr char COMMAND_FWF_FEATURES_INTEGRAL[]			= "INTEGRAL";
 constexpr char COMMAND_CROP[]							= "CROP";
 constexpr char COMMAND_CROP_OUTSIDE[]					= "OUTSIDE";
 constexpr char COMMAND_CROP_2D[]						= "CROP2D";
+constexpr char COMMAND_CROP_2D_POLYGONS[]				= "CROP2D_POLYGONS";	//+ ortho dim + polygons file (e.g. SHP)
+constexpr char COMMAND_CROP_2D_POLYGONS_SPLIT[]			= "SPLIT";
+constexpr char COMMAND_CROP_2D_POLYGONS_LABEL[]			= "LABEL";
 constexpr char COMMAND_COLOR_BANDING[]					= "CBANDING";
 constexpr char COMMAND_COLOR_LEVELS[]					= "CLEVELS";
 constexpr char COMMAND_C2M_DIST[]						= "C2M_DIST";
@@ -178,6 +190,14 @@ constexpr char COMMAND_FLIP_TRIANGLES[]					= "FLIP_TRI";
 constexpr char COMMAND_DEBUG[]							= "DEBUG";
 constexpr char COMMAND_VERBOSITY[]						= "VERBOSITY";
 constexpr char COMMAND_FILTER[]							= "FILTER";
+constexpr char COMMAND_RENDER[]							= "RENDER";
+constexpr char COMMAND_RENDER_SIZE[]					= "SIZE";			//+ width + height
+constexpr char COMMAND_RENDER_VIEW[]					= "VIEW";			//+ TOP, BOTTOM, FRONT, BACK, LEFT, RIGHT, ISO1 or ISO2
+constexpr char COMMAND_RENDER_PERSPECTIVE[]				= "PERSPECTIVE";
+constexpr char COMMAND_RENDER_POINT_SIZE[]				= "POINT_SIZE";		//+ size (in pixels)
+constexpr char COMMAND_RENDER_NO_EDL[]					= "NO_EDL";
+constexpr char COMMAND_RENDER_EDL_STRENGTH[]			= "EDL_STRENGTH";	//+ strength
+constexpr char COMMAND_RENDER_ORTHOPHOTO[]				= "ORTHOPHOTO";		//+ pixel size
 
 //options / modifiers
 constexpr char COMMAND_MAX_THREAD_COUNT[]				= "MAX_TCOUNT";
@@ -1927,22 +1947,88 @@ bool CommandExtractCCs::process(ccCommandLineInterface& cmd)
 	return true;
 }
 
-CommandCurvature::CommandCurvature()
-	: ccCommandLineInterface::Command(QObject::tr("Curvature"), COMMAND_CURVATURE)
-{}
+//! Geometric characteristic(s) requested by a -FEATURE, -CURV or -ROUGH command
+struct GeomCharacteristicRequest
+{
+	const char* command = nullptr;
+	QStringList typeStrs;
+	ccLibAlgorithms::GeomCharacteristicSet characteristics;
+	PointCoordinateType kernelSize = 0;
+	bool hasUpDir = false;
+	CCVector3 upDir;
+};
 
-bool CommandCurvature::process(ccCommandLineInterface& cmd)
+static bool ReadFeatureType(const QString& featureTypeStr, CCCoreLib::Neighbourhood::GeomFeature& featureType)
 {
-	if (cmd.arguments().empty())
+	if (featureTypeStr == "SUM_OF_EIGENVALUES")
 	{
-		return cmd.error(QObject::tr("Missing parameter: curvature type after \"-%1\"").arg(COMMAND_CURVATURE));
+		featureType = CCCoreLib::Neighbourhood::EigenValuesSum;
 	}
-	
-	QString curvTypeStr = cmd.arguments().takeFirst().toUpper();
-	CCCoreLib::Neighbourhood::CurvatureType curvType = CCCoreLib::Neighbourhood::MEAN_CURV;
+	else if (featureTypeStr == "OMNIVARIANCE")
+	{
+		featureType = CCCoreLib::Neighbourhood::Omnivariance;
+	}
+	else if (featureTypeStr == "EIGENTROPY")
+	{
+		featureType = CCCoreLib::Neighbourhood::EigenEntropy;
+	}
+	else if (featureTypeStr == "ANISOTROPY")
+	{
+		featureType = CCCoreLib::Neighbourhood::Anisotropy;
+	}
+	else if (featureTypeStr == "PLANARITY")
+	{
+		featureType = CCCoreLib::Neighbourhood::Planarity;
+	}
+	else if (featureTypeStr == "LINEARITY")
+	{
+		featureType = CCCoreLib::Neighbourhood::Linearity;
+	}
+	else if (featureTypeStr == "PCA1")
+	{
+		featureType = CCCoreLib::Neighbourhood::PCA1;
+	}
+	else if (featureTypeStr == "PCA2")
+	{
+		featureType = CCCoreLib::Neighbourhood::PCA2;
+	}
+	else if (featureTypeStr == "SURFACE_VARIATION")
+	{
+		featureType = CCCoreLib::Neighbourhood::SurfaceVariation;
+	}
+	else if (featureTypeStr == "SPHERICITY")
+	{
+		featureType = CCCoreLib::Neighbourhood::Sphericity;
+	}
+	else if (featureTypeStr == "VERTICALITY")
+	{
+		featureType = CCCoreLib::Neighbourhood::Verticality;
+	}
+	else if (featureTypeStr == "EIGENVALUE1")
+	{
+		featureType = CCCoreLib::Neighbourhood::EigenValue1;
+	}
+	else if (featureTypeStr == "EIGENVALUE2")
+	{
+		featureType = CCCoreLib::Neighbourhood::EigenValue2;
+	}
+	else if (featureTypeStr == "EIGENVALUE3")
+	{
+		featureType = CCCoreLib::Neighbourhood::EigenValue3;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+static bool ReadCurvatureType(const QString& curvTypeStr, CCCoreLib::Neighbourhood::CurvatureType& curvType)
+{
 	if (curvTypeStr == "MEAN")
 	{
-		//curvType = CCCoreLib::Neighbourhood::MEAN_CURV;
+		curvType = CCCoreLib::Neighbourhood::MEAN_CURV;
 	}
 	else if (curvTypeStr == "GAUSS")
 	{
@@ -1954,47 +2040,278 @@ bool CommandCurvature::process(ccCommandLineInterface& cmd)
 	}
 	else
 	{
-		return cmd.error(QObject::tr("Invalid curvature type after \"-%1\". Got '%2' instead of MEAN or GAUSS.").arg(COMMAND_CURVATURE, curvTypeStr));
+		return false;
 	}
-	
-	if (cmd.arguments().empty())
+
+	return true;
+}
+
+//! Reads the parameters of a -FEATURE, -CURV or -ROUGH command (the command keyword must have been removed from 'arguments')
+/** \return an error message (empty on success)
+**/
+static QString ReadGeomCharacteristicRequest(const char* command, QStringList& arguments, GeomCharacteristicRequest& request)
+{
+	request.command = command;
+
+	QString kernelSizeContext;
+	if (command == COMMAND_FEATURE || command == COMMAND_CURVATURE)
+	{
+		bool isFeature = (command == COMMAND_FEATURE);
+		if (arguments.empty())
+		{
+			return QObject::tr("Missing parameter: %1 type after \"-%2\"").arg(isFeature ? "feature" : "curvature", command);
+		}
+
+		//several types can be separated by commas (they will be computed in a single pass)
+		request.typeStrs = arguments.takeFirst().toUpper().split(',', QString::SkipEmptyParts);
+		if (request.typeStrs.empty())
+		{
+			return QObject::tr("Missing parameter: %1 type after \"-%2\"").arg(isFeature ? "feature" : "curvature", command);
+		}
+		for (const QString& typeStr : request.typeStrs)
+		{
+			if (isFeature)
+			{
+				CCCoreLib::Neighbourhood::GeomFeature featureType;
+				if (!ReadFeatureType(typeStr, featureType))
+				{
+					return QObject::tr("Invalid feature type after \"-%1\". Got '%2' instead of:\n\
+- SUM_OF_EIGENVALUES\n\
+- OMNIVARIANCE\n\
+- EIGENTROPY\n\
+- ANISOTROPY\n\
+- PLANARITY\n\
+- LINEARITY\n\
+- PCA1\n\
+- PCA2\n\
+- SURFACE_VARIATION\n\
+- SPHERICITY\n\
+- VERTICALITY\n\
+- EIGENVALUE1\n\
+- EIGENVALUE2\n\
+- EIGENVALUE3").arg(COMMAND_FEATURE, typeStr);
+				}
+				request.characteristics.emplace_back(CCCoreLib::GeometricalAnalysisTools::Feature, featureType);
+			}
+			else
+			{
+				CCCoreLib::Neighbourhood::CurvatureType curvType;
+				if (!ReadCurvatureType(typeStr, curvType))
+				{
+					return QObject::tr("Invalid curvature type after \"-%1\". Got '%2' instead of MEAN, GAUSS or NORMAL_CHANGE.").arg(COMMAND_CURVATURE, typeStr);
+				}
+				request.characteristics.emplace_back(CCCoreLib::GeometricalAnalysisTools::Curvature, curvType);
+			}
+		}
+
+		if (arguments.empty())
+		{
+			return QObject::tr("Missing parameter: kernel size after %1 type").arg(isFeature ? "feature" : "curvature");
+		}
+		kernelSizeContext = QObject::tr("after %1 type").arg(isFeature ? "feature" : "curvature");
+	}
+	else if (command == COMMAND_ROUGHNESS)
+	{
+		if (arguments.empty())
+		{
+			return QObject::tr("Missing parameter: kernel size after \"-%1\"").arg(COMMAND_ROUGHNESS);
+		}
+		request.characteristics.emplace_back(CCCoreLib::GeometricalAnalysisTools::Roughness, 0);
+		kernelSizeContext = QObject::tr("after \"-%1\"").arg(COMMAND_ROUGHNESS);
+	}
+	else
 	{
-		return cmd.error(QObject::tr("Missing parameter: kernel size after curvature type"));
+		assert(false);
+		return QObject::tr("Internal error: unhandled command");
 	}
-	
+
 	bool paramOk = false;
-	QString kernelStr = cmd.arguments().takeFirst();
-	PointCoordinateType kernelSize = static_cast<PointCoordinateType>(kernelStr.toDouble(&paramOk));
+	QString kernelStr = arguments.takeFirst();
+	request.kernelSize = static_cast<PointCoordinateType>(kernelStr.toDouble(&paramOk));
 	if (!paramOk)
 	{
-		return cmd.error(QObject::tr("Failed to read a numerical parameter: kernel size (after curvature type). Got '%1' instead.").arg(kernelStr));
+		return QObject::tr("Failed to read a numerical parameter: kernel size (%1). Got '%2' instead.").arg(kernelSizeContext, kernelStr);
+	}
+
+	// optional argument
+	if (command == COMMAND_ROUGHNESS && arguments.size() >= 4)
+	{
+		if (ccCommandLineInterface::IsCommand(arguments.first(), COMMAND_ROUGHNESS_UP_DIR))
+		{
+			// option confirmed
+			arguments.takeFirst();
+			QString xStr = arguments.takeFirst();
+			QString yStr = arguments.takeFirst();
+			QString zStr = arguments.takeFirst();
+			bool okX = false, okY = false, okZ = false;
+			request.upDir.x = static_cast<PointCoordinateType>(xStr.toDouble(&okX));
+			request.upDir.y = static_cast<PointCoordinateType>(yStr.toDouble(&okY));
+			request.upDir.z = static_cast<PointCoordinateType>(zStr.toDouble(&okZ));
+			if (!okX || !okY || !okZ)
+			{
+				return QObject::tr("Invalid 'up direction' vector after option -%1 (3 coordinates expected)").arg(COMMAND_ROUGHNESS_UP_DIR);
+			}
+			request.hasUpDir = true;
+		}
 	}
+
+	return QString();
+}
+
+//! Computes the geometric characteristics requested by a -FEATURE, -CURV or -ROUGH command
+/** If auto-save is disabled, the following -FEATURE, -CURV and -ROUGH commands with the
+	same kernel size are consumed as well, so that all the characteristics are computed
+	in a single pass (see ccLibAlgorithms::ComputeGeomCharacteristics). Each command is
+	then applied in turn (cloud renaming, etc.) as if it had been processed on its own.
+**/
+static bool ProcessGeomCharacteristicRequests(ccCommandLineInterface& cmd, const char* command)
+{
+	std::vector<GeomCharacteristicRequest> requests(1);
+	{
+		QString errorMessage = ReadGeomCharacteristicRequest(command, cmd.arguments(), requests.front());
+		if (!errorMessage.isEmpty())
+		{
+			return cmd.error(errorMessage);
+		}
+	}
+	const PointCoordinateType kernelSize = requests.front().kernelSize;
 	cmd.print(QObject::tr("\tKernel size: %1").arg(kernelSize));
-	
+
 	if (cmd.clouds().empty())
 	{
-		return cmd.error(QObject::tr("No point cloud on which to compute curvature! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_CURVATURE));
+		QString what = (command == COMMAND_FEATURE ? "feature" : command == COMMAND_CURVATURE ? "curvature" : "roughness");
+		return cmd.error(QObject::tr("No point cloud on which to compute %1! (be sure to open one with \"-%2 [cloud filename]\" before \"-%3\")").arg(what, COMMAND_OPEN, command));
 	}
-	
-	//Call MainWindow generic method
+
+	bool hasRoughness = (command == COMMAND_ROUGHNESS);
+
+	if (!cmd.autoSaveMode())
+	{
+		//look for the next commands that can be computed in the same pass
+		while (!cmd.arguments().empty())
+		{
+			const QString& nextArg = cmd.arguments().front();
+			const char* nextCommand = nullptr;
+			if (ccCommandLineInterface::IsCommand(nextArg, COMMAND_FEATURE))
+				nextCommand = COMMAND_FEATURE;
+			else if (ccCommandLineInterface::IsCommand(nextArg, COMMAND_CURVATURE))
+				nextCommand = COMMAND_CURVATURE;
+			else if (ccCommandLineInterface::IsCommand(nextArg, COMMAND_ROUGHNESS))
+				nextCommand = COMMAND_ROUGHNESS;
+			else
+				break;
+
+			//parse the command on a copy of the arguments (invalid commands will be reported when processed normally)
+			QStringList arguments = cmd.arguments().mid(1);
+			GeomCharacteristicRequest nextRequest;
+			if (!ReadGeomCharacteristicRequest(nextCommand, arguments, nextRequest).isEmpty())
+			{
+				break;
+			}
+			if (nextRequest.kernelSize != kernelSize)
+			{
+				break;
+			}
+			if (nextCommand == COMMAND_ROUGHNESS)
+			{
+				//only one roughness computation per pass
+				if (hasRoughness)
+				{
+					break;
+				}
+				hasRoughness = true;
+			}
+
+			cmd.print(QObject::tr("[%1] Command \"-%2\" will be computed in the same pass").arg(command, nextCommand));
+			cmd.arguments() = arguments;
+			requests.push_back(nextRequest);
+		}
+	}
+
+	ccLibAlgorithms::GeomCharacteristicSet characteristics;
+	const CCVector3* roughnessUpDir = nullptr;
+	bool hasFeature = false;
+	for (const GeomCharacteristicRequest& request : requests)
+	{
+		characteristics.insert(characteristics.end(), request.characteristics.begin(), request.characteristics.end());
+		if (request.command == COMMAND_FEATURE)
+		{
+			hasFeature = true;
+		}
+		if (request.command == COMMAND_ROUGHNESS && request.hasUpDir)
+		{
+			roughnessUpDir = &request.upDir;
+		}
+	}
+
+	//Call MainWindow generic method on all available clouds
 	ccHObject::Container entities;
 	entities.resize(cmd.clouds().size());
 	for (size_t i = 0; i < cmd.clouds().size(); ++i)
 	{
 		entities[i] = cmd.clouds()[i].pc;
 	}
-	
-	if (ccLibAlgorithms::ComputeGeomCharacteristic(CCCoreLib::GeometricalAnalysisTools::Curvature, curvType, kernelSize, entities, nullptr, cmd.widgetParent()))
+
+	if (!ccLibAlgorithms::ComputeGeomCharacteristics(characteristics, kernelSize, entities, roughnessUpDir, cmd.widgetParent()))
 	{
-		//save output
-		if (cmd.autoSaveMode() && !cmd.saveClouds(QObject::tr("%1_CURVATURE_KERNEL_%2").arg(curvTypeStr).arg(kernelSize)))
+		if (hasFeature)
+		{
+			return cmd.error(QObject::tr("The computation of some geometric features failed."));
+		}
+		return true;
+	}
+
+	for (const GeomCharacteristicRequest& request : requests)
+	{
+		if (request.command == COMMAND_FEATURE)
+		{
+			// on success, update the cloud names
+			QString fileNameExt = QObject::tr("%1_FEATURE_KERNEL_%2").arg(request.typeStrs.join('_')).arg(request.kernelSize);
+			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			{
+				CLCloudDesc& desc = cmd.clouds()[i];
+				desc.basename += "_" + fileNameExt;
+				desc.pc->setName(entities[i]->getName() + QObject::tr(".%1_feature(%2)").arg(request.typeStrs.join('_').toLower()).arg(request.kernelSize));
+			}
+		}
+	}
+
+	//save output
+	if (cmd.autoSaveMode())
+	{
+		assert(requests.size() == 1);
+		const GeomCharacteristicRequest& request = requests.front();
+		bool saved = true;
+		if (command == COMMAND_FEATURE)
+		{
+			saved = cmd.saveClouds();
+		}
+		else if (command == COMMAND_CURVATURE)
+		{
+			saved = cmd.saveClouds(QObject::tr("%1_CURVATURE_KERNEL_%2").arg(request.typeStrs.join('_')).arg(kernelSize));
+		}
+		else
+		{
+			saved = cmd.saveClouds(QObject::tr("ROUGHNESS_KERNEL_%2").arg(kernelSize));
+		}
+		if (!saved)
 		{
 			return false;
 		}
 	}
+
 	return true;
 }
 
+CommandCurvature::CommandCurvature()
+	: ccCommandLineInterface::Command(QObject::tr("Curvature"), COMMAND_CURVATURE)
+{}
+
+bool CommandCurvature::process(ccCommandLineInterface& cmd)
+{
+	return ProcessGeomCharacteristicRequests(cmd, COMMAND_CURVATURE);
+}
+
 static bool ReadDensityType(ccCommandLineInterface& cmd, CCCoreLib::GeometricalAnalysisTools::Density& density)
 {
 	if (cmd.arguments().empty())
@@ -2217,68 +2534,7 @@ CommandRoughness::CommandRoughness()
 
 bool CommandRoughness::process(ccCommandLineInterface& cmd)
 {
-	if (cmd.arguments().empty())
-	{
-		return cmd.error(QObject::tr("Missing parameter: kernel size after \"-%1\"").arg(COMMAND_ROUGHNESS));
-	}
-	
-	bool paramOk = false;
-	QString kernelStr = cmd.arguments().takeFirst();
-	PointCoordinateType kernelSize = static_cast<PointCoordinateType>(kernelStr.toDouble(&paramOk));
-	if (!paramOk)
-	{
-		return cmd.error(QObject::tr("Failed to read a numerical parameter: kernel size (after \"-%1\"). Got '%2' instead.").arg(COMMAND_ROUGHNESS, kernelStr));
-	}
-	cmd.print(QObject::tr("\tKernel size: %1").arg(kernelSize));
-
-	// optional argument
-	CCVector3 roughnessUpDir;
-	CCVector3* _roughnessUpDir = nullptr;
-	if (cmd.arguments().size() >= 4)
-	{
-		QString nextArg = cmd.arguments().first();
-		if (nextArg.startsWith('-') && nextArg.mid(1).toUpper() == COMMAND_ROUGHNESS_UP_DIR)
-		{
-			// option confirmed
-			cmd.arguments().takeFirst();
-			QString xStr = cmd.arguments().takeFirst();
-			QString yStr = cmd.arguments().takeFirst();
-			QString zStr = cmd.arguments().takeFirst();
-			bool okX = false, okY = false, okZ = false;
-			roughnessUpDir.x = static_cast<PointCoordinateType>(xStr.toDouble(&okX));
-			roughnessUpDir.y = static_cast<PointCoordinateType>(yStr.toDouble(&okY));
-			roughnessUpDir.z = static_cast<PointCoordinateType>(zStr.toDouble(&okZ));
-			if (!okX || !okY || !okZ)
-			{
-				return cmd.error(QObject::tr("Invalid 'up direction' vector after option -%1 (3 coordinates expected)").arg(COMMAND_ROUGHNESS_UP_DIR));
-			}
-			_roughnessUpDir = &roughnessUpDir;
-		}
-	}
-	
-	if (cmd.clouds().empty())
-	{
-		return cmd.error(QObject::tr("No point cloud on which to compute roughness! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_ROUGHNESS));
-	}
-	
-	//Call MainWindow generic method
-	ccHObject::Container entities;
-	entities.resize(cmd.clouds().size());
-	for (size_t i = 0; i < cmd.clouds().size(); ++i)
-	{
-		entities[i] = cmd.clouds()[i].pc;
-	}
-	
-	if (ccLibAlgorithms::ComputeGeomCharacteristic(CCCoreLib::GeometricalAnalysisTools::Roughness, 0, kernelSize, entities, _roughnessUpDir, cmd.widgetParent()))
-	{
-		//save output
-		if (cmd.autoSaveMode() && !cmd.saveClouds(QObject::tr("ROUGHNESS_KERNEL_%2").arg(kernelSize)))
-		{
-			return false;
-		}
-	}
-	
-	return true;
+	return ProcessGeomCharacteristicRequests(cmd, COMMAND_ROUGHNESS);
 }
 
 CommandApplyTransformation::CommandApplyTransformation()
@@ -4483,6 +4739,90 @@ bool CommandCompressFWF::process(ccCommandLineInterface& cmd)
 	return true;
 }
 
+CommandFWFFeatures::CommandFWFFeatures()
+	: ccCommandLineInterface::Command(QObject::tr("FWF features"), COMMAND_FWF_FEATURES)
+{}
+
+bool CommandFWFFeatures::process(ccCommandLineInterface& cmd)
+{
+	//look for the (optional) features
+	unsigned features = 0;
+	while (!cmd.arguments().empty())
+	{
+		QString argument = cmd.arguments().front();
+		if (ccCommandLineInterface::IsCommand(argument, COMMAND_FWF_FEATURES_PEAK))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			features |= ccPointCloud::FWF_PEAK_AMPLITUDE;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_FWF_FEATURES_WIDTH))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			features |= ccPointCloud::FWF_ECHO_WIDTH;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_FWF_FEATURES_INTEGRAL))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			features |= ccPointCloud::FWF_INTEGRAL;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (features == 0)
+	{
+		//by default, we compute all the features
+		features = ccPointCloud::FWF_PEAK_AMPLITUDE | ccPointCloud::FWF_ECHO_WIDTH | ccPointCloud::FWF_INTEGRAL;
+	}
+
+	if (cmd.clouds().empty())
+	{
+		return cmd.error(QObject::tr("No point cloud available. Be sure to open or generate one first!"));
+	}
+
+	QScopedPointer<ccProgressDialog> progressDialog(nullptr);
+	if (!cmd.silentMode())
+	{
+		progressDialog.reset(new ccProgressDialog(false, cmd.widgetParent()));
+		progressDialog->setAutoClose(false);
+	}
+
+	for (CLCloudDesc& desc : cmd.clouds())
+	{
+		if (!desc.pc->hasFWF())
+		{
+			cmd.warning(QObject::tr("Cloud '%1' has no associated waveform data (it will be ignored)").arg(desc.pc->getName()));
+			continue;
+		}
+
+		if (desc.pc->computeFWFFeatures(features, progressDialog.data()) == 0)
+		{
+			return cmd.error(QObject::tr("Failed to compute the waveform features of cloud '%1'").arg(desc.pc->getName()));
+		}
+
+		if (cmd.autoSaveMode())
+		{
+			QString errorStr = cmd.exportEntity(desc, "FWF_FEATURES");
+			if (!errorStr.isEmpty())
+			{
+				return cmd.error(errorStr);
+			}
+		}
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->close();
+		QCoreApplication::processEvents();
+	}
+
+	return true;
+}
+
 CommandCrop::CommandCrop()
 	: ccCommandLineInterface::Command(QObject::tr("Crop"), COMMAND_CROP)
 {}
@@ -4942,10 +5282,247 @@ bool CommandCrop2D::process(ccCommandLineInterface& cmd)
 		}
 		else
 		{
-			return cmd.error(QObject::tr("Crop process failed! (not enough memory)"));
+			return cmd.error(QObject::tr("Crop process failed! (not enough memory)"));
+		}
+	}
+	
+	return true;
+}
+
+CommandCrop2DPolygons::CommandCrop2DPolygons()
+	: ccCommandLineInterface::Command(QObject::tr("Crop 2D with polygons"), COMMAND_CROP_2D_POLYGONS)
+{}
+
+bool CommandCrop2DPolygons::process(ccCommandLineInterface& cmd)
+{
+	if (cmd.arguments().size() < 2)
+	{
+		return cmd.error(QObject::tr("Missing parameter(s) after \"-%1\" (ORTHO_DIM POLYGONS_FILE)").arg(COMMAND_CROP_2D_POLYGONS));
+	}
+	if (cmd.clouds().empty())
+	{
+		return cmd.error(QObject::tr("No point cloud available. Be sure to open or generate one first!"));
+	}
+
+	//orthogonal dimension
+	unsigned char orthoDim = 2;
+	{
+		QString orthoDimStr = cmd.arguments().takeFirst().toUpper();
+		if (orthoDimStr == "X")
+		{
+			orthoDim = 0;
+		}
+		else if (orthoDimStr == "Y")
+		{
+			orthoDim = 1;
+		}
+		else if (orthoDimStr == "Z")
+		{
+			orthoDim = 2;
+		}
+		else
+		{
+			return cmd.error(QObject::tr("Invalid parameter: orthogonal dimension after \"-%1\" (expected: X, Y or Z)").arg(COMMAND_CROP_2D_POLYGONS));
+		}
+	}
+
+	//load the polygons (e.g. a shapefile)
+	ccPolygonClassifier classifier(orthoDim);
+	{
+		QString filename = cmd.arguments().takeFirst();
+		cmd.print(QObject::tr("Loading polygons from '%1'").arg(filename));
+
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccHObject> container(FileIOFilter::LoadFromFile(filename, cmd.fileLoadingParams(), result));
+		if (!container)
+		{
+			return cmd.error(QObject::tr("Failed to load the polygons file '%1'").arg(filename));
+		}
+
+		ccHObject::Container polylines;
+		if (container->isA(CC_TYPES::POLY_LINE))
+		{
+			polylines.push_back(container.data());
+		}
+		container->filterChildren(polylines, true, CC_TYPES::POLY_LINE);
+
+		for (ccHObject* polyline : polylines)
+		{
+			if (!classifier.addPolygon(static_cast<ccPolyline*>(polyline)))
+			{
+				cmd.warning(QObject::tr("Polyline '%1' is invalid (or not enough memory): ignored").arg(polyline->getName()));
+			}
+		}
+		if (classifier.polygonCount() == 0)
+		{
+			return cmd.error(QObject::tr("No valid polygon found in file '%1'").arg(filename));
+		}
+		if (!classifier.buildIndex())
+		{
+			return cmd.error(QObject::tr("Not enough memory!"));
+		}
+		cmd.print(QObject::tr("%1 polygon(s) loaded").arg(classifier.polygonCount()));
+	}
+
+	//optional parameters
+	bool inside = true;
+	bool split = false;
+	bool label = false;
+	while (!cmd.arguments().empty())
+	{
+		QString argument = cmd.arguments().front();
+		if (ccCommandLineInterface::IsCommand(argument, COMMAND_CROP_OUTSIDE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			inside = false;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CROP_2D_POLYGONS_SPLIT))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			split = true;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_CROP_2D_POLYGONS_LABEL))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			label = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (split && label)
+	{
+		return cmd.error(QObject::tr("Options -%1 and -%2 can't be used together").arg(COMMAND_CROP_2D_POLYGONS_SPLIT, COMMAND_CROP_2D_POLYGONS_LABEL));
+	}
+
+	//now we can process the loaded cloud(s)
+	std::vector<CLCloudDesc> outputClouds;
+	for (CLCloudDesc& desc : cmd.clouds())
+	{
+		std::vector<int> polygonIndexes;
+		if (!classifier.classify(desc.pc, polygonIndexes))
+		{
+			return cmd.error(QObject::tr("Failed to classify cloud '%1' (not enough memory?)").arg(desc.pc->getName()));
+		}
+
+		if (label)
+		{
+			//polygon index scalar field
+			int sfIdx = desc.pc->getScalarFieldIndexByName(CC_POLYGON_INDEX_SF_NAME);
+			if (sfIdx < 0)
+			{
+				sfIdx = desc.pc->addScalarField(CC_POLYGON_INDEX_SF_NAME);
+			}
+			if (sfIdx < 0)
+			{
+				return cmd.error(QObject::tr("Not enough memory to add a scalar field to cloud '%1'!").arg(desc.pc->getName()));
+			}
+			CCCoreLib::ScalarField* sf = desc.pc->getScalarField(sfIdx);
+			for (size_t i = 0; i < polygonIndexes.size(); ++i)
+			{
+				sf->setValue(i, polygonIndexes[i] >= 0 ? static_cast<ScalarType>(polygonIndexes[i]) : CCCoreLib::NAN_VALUE);
+			}
+			sf->computeMinAndMax();
+			desc.pc->setCurrentDisplayedScalarField(sfIdx);
+			desc.pc->showSF(true);
+
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(desc, "POLYGON_INDEX");
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+			continue;
+		}
+
+		//partition the cloud
+		unsigned partCount = 1;
+		if (split)
+		{
+			//one part per polygon (+ one for the points outside all the polygons)
+			partCount = static_cast<unsigned>(classifier.polygonCount()) + (inside ? 0 : 1);
+			for (int& index : polygonIndexes)
+			{
+				if (index < 0)
+				{
+					index = (inside ? -1 : static_cast<int>(partCount) - 1);
+				}
+			}
+		}
+		else
+		{
+			for (int& index : polygonIndexes)
+			{
+				index = ((index >= 0) == inside ? 0 : -1);
+			}
+		}
+
+		std::vector<ccPointCloud*> parts;
+		if (!desc.pc->partition(polygonIndexes, partCount, parts))
+		{
+			return cmd.error(QObject::tr("Not enough memory to crop cloud '%1'!").arg(desc.pc->getName()));
+		}
+
+		if (std::find_if(parts.begin(), parts.end(), [](ccPointCloud* pc) { return pc != nullptr; }) == parts.end())
+		{
+			cmd.warning(QObject::tr("No point of cloud '%1' falls inside the input polygons!").arg(desc.pc->getName()));
+			outputClouds.push_back(desc);
+			continue;
+		}
+
+		for (unsigned p = 0; p < partCount; ++p)
+		{
+			ccPointCloud* part = parts[p];
+			if (!part)
+			{
+				continue;
+			}
+
+			QString suffix;
+			if (!split)
+			{
+				part->setName(desc.pc->getName() + QObject::tr(".cropped"));
+				suffix = "_CROPPED";
+			}
+			else if (p < classifier.polygonCount())
+			{
+				part->setName(desc.pc->getName() + QObject::tr(".polygon_%1").arg(p));
+				suffix = QObject::tr("_POLYGON_%1").arg(p);
+			}
+			else
+			{
+				part->setName(desc.pc->getName() + QObject::tr(".outside"));
+				suffix = "_OUTSIDE";
+			}
+
+			CLCloudDesc partDesc(part, desc.basename + suffix, desc.path, split ? -1 : desc.indexInFile);
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(partDesc, QString(), nullptr, split ? ccCommandLineInterface::ExportOption::ForceNoTimestamp : ccCommandLineInterface::ExportOption::NoOptions);
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+			outputClouds.push_back(partDesc);
 		}
+
+		delete desc.pc;
+		desc.pc = nullptr;
 	}
-	
+
+	if (!label)
+	{
+		//replace the input clouds by the output ones
+		cmd.clouds() = outputClouds;
+	}
+
 	return true;
 }
 
@@ -7769,139 +8346,7 @@ CommandFeature::CommandFeature()
 
 bool CommandFeature::process(ccCommandLineInterface& cmd)
 {
-	if (cmd.arguments().empty())
-	{
-		return cmd.error(QObject::tr("Missing parameter: feature type after \"-%1\"").arg(COMMAND_FEATURE));
-	}
-
-	QString featureTypeStr = cmd.arguments().takeFirst().toUpper();
-	CCCoreLib::Neighbourhood::GeomFeature featureType;
-
-	if (featureTypeStr == "SUM_OF_EIGENVALUES")
-	{
-		featureType = CCCoreLib::Neighbourhood::EigenValuesSum;
-	}
-	else if (featureTypeStr == "OMNIVARIANCE")
-	{
-		featureType = CCCoreLib::Neighbourhood::Omnivariance;
-	}
-	else if (featureTypeStr == "EIGENTROPY")
-	{
-		featureType = CCCoreLib::Neighbourhood::EigenEntropy;
-	}
-	else if (featureTypeStr == "ANISOTROPY")
-	{
-		featureType = CCCoreLib::Neighbourhood::Anisotropy;
-	}
-	else if (featureTypeStr == "PLANARITY")
-	{
-		featureType = CCCoreLib::Neighbourhood::Planarity;
-	}
-	else if (featureTypeStr == "LINEARITY")
-	{
-		featureType = CCCoreLib::Neighbourhood::Linearity;
-	}
-	else if (featureTypeStr == "PCA1")
-	{
-		featureType = CCCoreLib::Neighbourhood::PCA1;
-	}
-	else if (featureTypeStr == "PCA2")
-	{
-		featureType = CCCoreLib::Neighbourhood::PCA2;
-	}
-	else if (featureTypeStr == "SURFACE_VARIATION")
-	{
-		featureType = CCCoreLib::Neighbourhood::SurfaceVariation;
-	}
-	else if (featureTypeStr == "SPHERICITY")
-	{
-		featureType = CCCoreLib::Neighbourhood::Sphericity;
-	}
-	else if (featureTypeStr == "VERTICALITY")
-	{
-		featureType = CCCoreLib::Neighbourhood::Verticality;
-	}
-	else if (featureTypeStr == "EIGENVALUE1")
-	{
-		featureType = CCCoreLib::Neighbourhood::EigenValue1;
-	}
-	else if (featureTypeStr == "EIGENVALUE2")
-	{
-		featureType = CCCoreLib::Neighbourhood::EigenValue2;
-	}
-	else if (featureTypeStr == "EIGENVALUE3")
-	{
-		featureType = CCCoreLib::Neighbourhood::EigenValue3;
-	}
-	else
-	{
-		return cmd.error(QObject::tr("Invalid feature type after \"-%1\". Got '%2' instead of:\n\
-- SUM_OF_EIGENVALUES\n\
-- OMNIVARIANCE\n\
-- EIGENTROPY\n\
-- ANISOTROPY\n\
-- PLANARITY\n\
-- LINEARITY\n\
-- PCA1\n\
-- PCA2\n\
-- SURFACE_VARIATION\n\
-- SPHERICITY\n\
-- VERTICALITY\n\
-- EIGENVALUE1\n\
-- EIGENVALUE2\n\
-- EIGENVALUE3").arg(COMMAND_FEATURE, featureTypeStr));
-	}
-
-	if (cmd.arguments().empty())
-	{
-		return cmd.error(QObject::tr("Missing parameter: kernel size after feature type"));
-	}
-
-	bool paramOk = false;
-	QString kernelStr = cmd.arguments().takeFirst();
-	PointCoordinateType kernelSize = static_cast<PointCoordinateType>(kernelStr.toDouble(&paramOk));
-	if (!paramOk)
-	{
-		return cmd.error(QObject::tr("Failed to read a numerical parameter: kernel size. Got '%1' instead.").arg(kernelStr));
-	}
-	cmd.print(QObject::tr("\tKernel size: %1").arg(kernelSize));
-
-	if (cmd.clouds().empty())
-	{
-		return cmd.error(QObject::tr("No point cloud on which to compute feature! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_FEATURE));
-	}
-
-	//Call MainWindow generic method on all available clouds
-	ccHObject::Container entities;
-	{
-		entities.resize(cmd.clouds().size());
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-		{
-			entities[i] = cmd.clouds()[i].pc;
-		}
-	}
-
-	if (!ccLibAlgorithms::ComputeGeomCharacteristic(CCCoreLib::GeometricalAnalysisTools::Feature, featureType, kernelSize, entities, nullptr, cmd.widgetParent()))
-	{
-		return cmd.error(QObject::tr("The computation of some geometric features failed."));
-	}
-
-	// on success, update the cloud names
-	QString fileNameExt = QObject::tr("%1_FEATURE_KERNEL_%2").arg(featureTypeStr).arg(kernelSize);
-	for (size_t i = 0; i < cmd.clouds().size(); ++i)
-	{
-		CLCloudDesc& desc = cmd.clouds()[i];
-		desc.basename += "_" + fileNameExt;
-		desc.pc->setName(entities[i]->getName() + QObject::tr(".%1_feature(%2)").arg(featureTypeStr.toLower()).arg(kernelSize));
-	}
-
-	//save output
-	if (cmd.autoSaveMode() && !cmd.saveClouds())
-	{
-		return false;
-	}
-
-	return true;
+	return ProcessGeomCharacteristicRequests(cmd, COMMAND_FEATURE);
 }
 
 CommandDebugCmdLine::CommandDebugCmdLine()
@@ -7968,3 +8413,200 @@ bool CommandSetVerbosity::process(ccCommandLineInterface& cmd)
 
 	return true;
 }
+
+CommandRender::CommandRender()
+	: ccCommandLineInterface::Command(QObject::tr("Render"), COMMAND_RENDER)
+{}
+
+bool CommandRender::process(ccCommandLineInterface& cmd)
+{
+	cmd.print(QObject::tr("[RENDER]"));
+
+	if (cmd.clouds().empty() && cmd.meshes().empty())
+	{
+		return cmd.error(QObject::tr("No entity available. Be sure to open or generate one first!"));
+	}
+
+	ccSoftwareRenderer::Parameters params;
+	params.viewport.viewMat = ccGLUtils::GenerateViewMat(CC_TOP_VIEW);
+	double orthophotoPixelSize = 0.0;
+	bool customSize = false;
+
+	//optional parameters
+	while (!cmd.arguments().empty())
+	{
+		QString argument = cmd.arguments().front();
+		if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_SIZE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			if (cmd.arguments().size() < 2)
+			{
+				return cmd.error(QObject::tr("Missing parameter(s): width and height after '%1'").arg(COMMAND_RENDER_SIZE));
+			}
+			bool okW = false;
+			bool okH = false;
+			params.width = cmd.arguments().takeFirst().toInt(&okW);
+			params.height = cmd.arguments().takeFirst().toInt(&okH);
+			if (!okW || !okH || params.width <= 0 || params.height <= 0)
+			{
+				return cmd.error(QObject::tr("Invalid image size after '%1'").arg(COMMAND_RENDER_SIZE));
+			}
+			customSize = true;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_VIEW))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			if (cmd.arguments().empty())
+			{
+				return cmd.error(QObject::tr("Missing parameter: view orientation after '%1'").arg(COMMAND_RENDER_VIEW));
+			}
+			QString viewStr = cmd.arguments().takeFirst().toUpper();
+			CC_VIEW_ORIENTATION orientation = CC_TOP_VIEW;
+			if (viewStr == "TOP")
+				orientation = CC_TOP_VIEW;
+			else if (viewStr == "BOTTOM")
+				orientation = CC_BOTTOM_VIEW;
+			else if (viewStr == "FRONT")
+				orientation = CC_FRONT_VIEW;
+			else if (viewStr == "BACK")
+				orientation = CC_BACK_VIEW;
+			else if (viewStr == "LEFT")
+				orientation = CC_LEFT_VIEW;
+			else if (viewStr == "RIGHT")
+				orientation = CC_RIGHT_VIEW;
+			else if (viewStr == "ISO1")
+				orientation = CC_ISO_VIEW_1;
+			else if (viewStr == "ISO2")
+				orientation = CC_ISO_VIEW_2;
+			else
+			{
+				return cmd.error(QObject::tr("Invalid view orientation '%1' (expected: TOP, BOTTOM, FRONT, BACK, LEFT, RIGHT, ISO1 or ISO2)").arg(viewStr));
+			}
+			params.viewport.viewMat = ccGLUtils::GenerateViewMat(orientation);
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_PERSPECTIVE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			params.viewport.perspectiveView = true;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_POINT_SIZE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			bool ok = false;
+			params.pointSize = (cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toInt(&ok));
+			if (!ok || params.pointSize <= 0)
+			{
+				return cmd.error(QObject::tr("Invalid or missing point size after '%1'").arg(COMMAND_RENDER_POINT_SIZE));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_NO_EDL))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			params.edl = false;
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_EDL_STRENGTH))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			bool ok = false;
+			params.edlStrength = (cmd.arguments().empty() ? 0.0f : cmd.arguments().takeFirst().toFloat(&ok));
+			if (!ok || params.edlStrength <= 0.0f)
+			{
+				return cmd.error(QObject::tr("Invalid or missing EDL strength after '%1'").arg(COMMAND_RENDER_EDL_STRENGTH));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_ORTHOPHOTO))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			bool ok = false;
+			orthophotoPixelSize = (cmd.arguments().empty() ? 0.0 : cmd.arguments().takeFirst().toDouble(&ok));
+			if (!ok || orthophotoPixelSize <= 0.0)
+			{
+				return cmd.error(QObject::tr("Invalid or missing pixel size after '%1'").arg(COMMAND_RENDER_ORTHOPHOTO));
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	//gather the loaded entities (without taking their ownership)
+	ccHObject scene("Scene");
+	for (const CLCloudDesc& desc : cmd.clouds())
+	{
+		scene.addChild(desc.pc, ccHObject::DP_NONE);
+	}
+	for (const CLMeshDesc& desc : cmd.meshes())
+	{
+		scene.addChild(desc.mesh, ccHObject::DP_NONE);
+	}
+
+	ccBBox box = ccSoftwareRenderer::ComputeVisibleBB(&scene);
+	if (!box.isValid())
+	{
+		return cmd.error(QObject::tr("Nothing to render (no visible entity)"));
+	}
+
+	if (orthophotoPixelSize > 0.0)
+	{
+		//top view, one pixel = one cell of the requested size
+		CCVector3 diag = box.getDiagVec();
+		double width = std::max(1.0, std::ceil(diag.x / orthophotoPixelSize));
+		double height = std::max(1.0, std::ceil(diag.y / orthophotoPixelSize));
+		if (width * height > 1.0e9)
+		{
+			return cmd.error(QObject::tr("Orthophoto too large (%1 x %2 pixels)").arg(width).arg(height));
+		}
+		params.width = static_cast<int>(width);
+		params.height = static_cast<int>(height);
+		if (customSize)
+		{
+			cmd.warning(QObject::tr("Image size is determined by the orthophoto pixel size (%1 x %2)").arg(params.width).arg(params.height));
+		}
+
+		params.viewport.viewMat = ccGLUtils::GenerateViewMat(CC_TOP_VIEW);
+		params.viewport.perspectiveView = false;
+		params.viewport.objectCenteredView = true;
+		CCVector3d center = box.getCenter();
+		double focalDistance = (width * orthophotoPixelSize / 2) / params.viewport.computeDistanceToHalfWidthRatio();
+		params.viewport.setPivotPoint(center, false);
+		params.viewport.setCameraCenter(center + CCVector3d(0, 0, focalDistance), false);
+		params.viewport.setFocalDistance(focalDistance);
+	}
+	else
+	{
+		ccSoftwareRenderer::FitViewport(params.viewport, box, params.width, params.height);
+	}
+
+	QImage image;
+	bool success = ccSoftwareRenderer::Render(&scene, params, image);
+
+	//release the entities before the (temporary) scene is destroyed
+	scene.detachAllChildren();
+
+	if (!success)
+	{
+		return cmd.error(QObject::tr("Rendering failed (not enough memory?)"));
+	}
+
+	const CLEntityDesc& desc = (!cmd.clouds().empty() ? static_cast<const CLEntityDesc&>(cmd.clouds().front()) : static_cast<const CLEntityDesc&>(cmd.meshes().front()));
+	QString outputFilename = cmd.getExportFilename(desc, "png", orthophotoPixelSize > 0.0 ? "ORTHOPHOTO" : "RENDER", nullptr, !cmd.addTimestamp());
+	if (outputFilename.isEmpty())
+	{
+		outputFilename = "render.png";
+	}
+	if (!image.save(outputFilename))
+	{
+		return cmd.error(QObject::tr("Failed to save the image to '%1'").arg(outputFilename));
+	}
+	cmd.print(QObject::tr("Image (%1 x %2) saved to '%3'").arg(params.width).arg(params.height).arg(outputFilename));
+
+	return true;
+}
@@ -330,6 +330,13 @@ struct CommandCompressFWF : public ccCommandLineInterface::Command
 	bool process(ccCommandLineInterface& cmd) override;
 };
 
+struct CommandFWFFeatures : public ccCommandLineInterface::Command
+{
+	CommandFWFFeatures();
+
+	bool process(ccCommandLineInterface& cmd) override;
+};
+
 struct CommandCrop : public ccCommandLineInterface::Command
 {
 	CommandCrop();
@@ -358,6 +365,13 @@ struct CommandCrop2D : public ccCommandLineInterface::Command
 	bool process(ccCommandLineInterface& cmd) override;
 };
 
+struct CommandCrop2DPolygons : public ccCommandLineInterface::Command
+{
+	CommandCrop2DPolygons();
+
+	bool process(ccCommandLineInterface& cmd) override;
+};
+
 struct CommandColorBanding : public ccCommandLineInterface::Command
 {
 	CommandColorBanding();
@@ -617,4 +631,11 @@ struct CommandSetVerbosity : public ccCommandLineInterface::Command
 	bool process(ccCommandLineInterface& cmd) override;
 };
 
+struct CommandRender : public ccCommandLineInterface::Command
+{
+	CommandRender();
+
+	bool process(ccCommandLineInterface& cmd) override;
+};
+
 #endif //COMMAND_LINE_COMMANDS_HEADER
@@ -886,10 +886,12 @@ void ccCommandLineParser::registerBuiltInCommands()
 	registerCommand(Command::Shared(new CommandRemoveDuplicatePoints));
 	registerCommand(Command::Shared(new CommandSampleMesh));
 	registerCommand(Command::Shared(new CommandCompressFWF));
+	registerCommand(Command::Shared(new CommandFWFFeatures));
 	registerCommand(Command::Shared(new CommandExtractVertices));
 	registerCommand(Command::Shared(new CommandCrossSection));
 	registerCommand(Command::Shared(new CommandCrop));
 	registerCommand(Command::Shared(new CommandCrop2D));
+	registerCommand(Command::Shared(new CommandCrop2DPolygons));
 	registerCommand(Command::Shared(new CommandCoordToSF));
 	registerCommand(Command::Shared(new CommandSFToCoord));
 	registerCommand(Command::Shared(new CommandColorBanding));
@@ -905,6 +907,7 @@ void ccCommandLineParser::registerBuiltInCommands()
     registerCommand(Command::Shared(new CommandSFInterpolation));
 	registerCommand(Command::Shared(new CommandColorInterpolation));
 	registerCommand(Command::Shared(new CommandFilter));
+	registerCommand(Command::Shared(new CommandRender));
 	registerCommand(Command::Shared(new CommandRenameEntities));
 	registerCommand(Command::Shared(new CommandSFRename));
 	registerCommand(Command::Shared(new CommandSFAddConst));
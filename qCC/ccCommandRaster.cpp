@@ -43,6 +43,7 @@ constexpr char COMMAND_RASTER_PROJ_AVG[]				= "AVG";
 constexpr char COMMAND_RASTER_PROJ_MED[]				= "MED";
 constexpr char COMMAND_RASTER_PROJ_INVERSE_VAR[]		= "INV_VAR";
 constexpr char COMMAND_RASTER_RESAMPLE[]				= "RESAMPLE";
+constexpr char COMMAND_RASTER_COG[]						= "COG";
 
 //2.5D Volume calculation specific commands
 constexpr char COMMAND_VOLUME[] = "VOLUME";
@@ -142,6 +143,8 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 	bool outputRasterRGB = false;
 	bool outputMesh = false;
 	bool resample = false;
+	bool tiledExport = false;
+	ccRasterizeTool::TiledExportParams tiledExportParams;
 	double customHeight = std::numeric_limits<double>::quiet_NaN();
 	int vertDir = 2;
 	ccRasterGrid::ProjectionType projectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
@@ -303,6 +306,30 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 
 			resample = true;
 		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_COG))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			tiledExport = true;
+			tiledExportParams.cog = true;
+
+			//optional tile size
+			if (!cmd.arguments().empty())
+			{
+				bool ok = false;
+				int tileSize = cmd.arguments().front().toInt(&ok);
+				if (ok)
+				{
+					cmd.arguments().pop_front();
+					if (tileSize < 16)
+					{
+						return cmd.error(QString("Invalid tile size! (after %1)").arg(COMMAND_RASTER_COG));
+					}
+					tiledExportParams.tileSize = static_cast<unsigned>(tileSize);
+				}
+			}
+		}
 		else
 		{
 			break;
@@ -353,6 +380,23 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 		cmd.warning("[Rasterize] The 'resample' option is set while the raster won't be exported as a cloud nor as a mesh");
 	}
 
+	if (tiledExport)
+	{
+		if (!outputRasterZ && !outputRasterRGB)
+		{
+			cmd.warning(QString("[Rasterize] The '%1' option is set while the grid won't be exported as a raster").arg(COMMAND_RASTER_COG));
+			tiledExport = false;
+		}
+		else if (emptyCellFillStrategy == ccRasterGrid::INTERPOLATE_DELAUNAY || emptyCellFillStrategy == ccRasterGrid::KRIGING)
+		{
+			cmd.warning(QString("[Rasterize] Empty cells interpolation is not compatible with the '%1' option (the raster will be computed in memory)").arg(COMMAND_RASTER_COG));
+			tiledExport = false;
+		}
+	}
+
+	//the full grid is only required by the cloud/mesh outputs and the standard raster export
+	bool computeFullGrid = (outputCloud || outputMesh || !tiledExport);
+
 	//we'll get the first two clouds
 	for (CLCloudDesc& cloudDesc : cmd.clouds())
 	{
@@ -395,7 +439,7 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 
 		cmd.print(QString("Grid size: %1 x %2").arg(gridWidth).arg(gridHeight));
 
-		if (gridWidth * gridHeight > (1 << 26)) //64 million of cells
+		if (computeFullGrid && gridWidth * gridHeight > (1 << 26)) //64 million of cells
 		{
 			if (cmd.silentMode())
 			{
@@ -413,6 +457,7 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 		}
 
 		ccRasterGrid grid;
+		if (computeFullGrid)
 		{
 			//memory allocation
 			CCVector3d minCorner = gridBBox.minCorner();
@@ -602,7 +647,23 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 				exportFilename = "rasterZ.tif";
 			}
 
-			ccRasterizeTool::ExportGeoTiff(exportFilename, bands, emptyCellFillStrategy, grid, gridBBox, vertDir, customHeight, cloudDesc.pc);
+			if (tiledExport)
+			{
+				QScopedPointer<ccProgressDialog> pDlg(nullptr);
+				if (!cmd.silentMode())
+				{
+					pDlg.reset(new ccProgressDialog(true, cmd.widgetParent()));
+				}
+
+				if (!ccRasterizeTool::ExportTiledGeoTiff(exportFilename, bands, cloudDesc.pc, gridBBox, gridStep, vertDir, projectionType, sfProjectionType, emptyCellFillStrategy, customHeight, tiledExportParams, invVarProjSFIndex, -1, pDlg.data()))
+				{
+					return cmd.error("Tiled raster export failed");
+				}
+			}
+			else
+			{
+				ccRasterizeTool::ExportGeoTiff(exportFilename, bands, emptyCellFillStrategy, grid, gridBBox, vertDir, customHeight, cloudDesc.pc);
+			}
 		}
 
 		if (outputRasterRGB)
@@ -619,7 +680,23 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 				exportFilename = "rasterRGB.tif";
 			}
 
-			ccRasterizeTool::ExportGeoTiff(exportFilename, bands, emptyCellFillStrategy, grid, gridBBox, vertDir, customHeight, cloudDesc.pc);
+			if (tiledExport)
+			{
+				QScopedPointer<ccProgressDialog> pDlg(nullptr);
+				if (!cmd.silentMode())
+				{
+					pDlg.reset(new ccProgressDialog(true, cmd.widgetParent()));
+				}
+
+				if (!ccRasterizeTool::ExportTiledGeoTiff(exportFilename, bands, cloudDesc.pc, gridBBox, gridStep, vertDir, projectionType, sfProjectionType, emptyCellFillStrategy, customHeight, tiledExportParams, invVarProjSFIndex, -1, pDlg.data()))
+				{
+					return cmd.error("Tiled raster export failed");
+				}
+			}
+			else
+			{
+				ccRasterizeTool::ExportGeoTiff(exportFilename, bands, emptyCellFillStrategy, grid, gridBBox, vertDir, customHeight, cloudDesc.pc);
+			}
 		}
 	}
 
@@ -50,5 +50,6 @@
 #define CC_DEFAULT_MESH_VERT_FLAGS_SF_NAME "Vertex type"
 #define CC_DEFAULT_ID_SF_NAME "Id"
 #define CC_ORIGINAL_CLOUD_INDEX_SF_NAME "Original cloud index"
+#define CC_POLYGON_INDEX_SF_NAME "Polygon index"
 
 #endif
@@ -34,8 +34,10 @@
 #include <QTextStream>
 #include <QThread>
 #include <QTime>
+#include <QWaitCondition>
 
 //system
+#include <algorithm>
 #include <cassert>
 #ifdef QT_DEBUG
 #include <iostream>
@@ -51,6 +53,87 @@ static ccSingleton<ccConsole> s_console;
 bool ccConsole::s_showQtMessagesInConsole = false;
 bool ccConsole::s_redirectToStdOut = false;
 static int s_refreshCycle_ms = 1000;
+static std::atomic<int> s_coalescingWindow_ms(1000);
+
+//! Maximum time the writer thread sleeps when there's no message
+static const unsigned long s_writerIdleCycle_ms = 250;
+
+/*** ccConsoleWriter ***/
+
+//! Asynchronous writer thread (consumes the messages logged by all the other threads)
+class ccConsoleWriter : public QThread
+{
+public:
+
+	//! Default constructor
+	explicit ccConsoleWriter(ccConsole& console)
+		: QThread()
+		, m_console(console)
+		, m_stop(false)
+		, m_sleeping(false)
+	{
+	}
+
+	//! Destructor
+	~ccConsoleWriter() override
+	{
+		stop();
+	}
+
+	//! Stops the thread (once all the pending messages have been processed)
+	void stop()
+	{
+		m_stop = true;
+		m_sleeping = true; //to be sure to wake it up
+		wake();
+		wait();
+	}
+
+	//! Wakes the thread up (if it is waiting for messages)
+	inline void wake()
+	{
+		if (m_sleeping.exchange(false))
+		{
+			QMutexLocker locker(&m_wakeMutex);
+			m_wakeCondition.wakeOne();
+		}
+	}
+
+protected:
+
+	//inherited from QThread
+	void run() override
+	{
+		while (!m_stop)
+		{
+			if (m_console.processIncomingMessages() == 0)
+			{
+				QMutexLocker locker(&m_wakeMutex);
+				m_sleeping = true;
+				if (!m_stop && m_console.m_ringBuffer.empty())
+				{
+					m_wakeCondition.wait(&m_wakeMutex, s_writerIdleCycle_ms);
+				}
+				m_sleeping = false;
+			}
+		}
+
+		//last messages
+		m_console.processIncomingMessages();
+		m_console.flushRepeatedMessages(true);
+	}
+
+	//! Associated console
+	ccConsole& m_console;
+	//! Whether the thread should stop
+	std::atomic<bool> m_stop;
+	//! Whether the thread is waiting for messages
+	std::atomic<bool> m_sleeping;
+	//! Mutex associated to the wake condition
+	QMutex m_wakeMutex;
+	//! Wake condition
+	QWaitCondition m_wakeCondition;
+};
 
 /*** ccCustomQListWidget ***/
 
@@ -105,11 +188,17 @@ void ccConsole::SetRefreshCycle(int cycle_ms/*=1000*/)
 	}
 }
 
+void ccConsole::SetCoalescingWindow(int window_ms/*=1000*/)
+{
+	s_coalescingWindow_ms = std::max(window_ms, 0);
+}
+
 ccConsole* ccConsole::TheInstance(bool autoInit/*=true*/)
 {
 	if (!s_console.instance && autoInit)
 	{
 		s_console.instance = new ccConsole;
+		s_console.instance->startWriter();
 		ccLog::RegisterInstance(s_console.instance);
 	}
 
@@ -121,6 +210,7 @@ void ccConsole::ReleaseInstance(bool flush/*=true*/)
 	if (flush && s_console.instance)
 	{
 		//DGM: just in case some messages are still in the queue
+		s_console.instance->flush();
 		s_console.instance->refresh();
 	}
 	ccLog::RegisterInstance(nullptr);
@@ -131,12 +221,19 @@ ccConsole::ccConsole()
 	: m_textDisplay(nullptr)
 	, m_parentWidget(nullptr)
 	, m_parentWindow(nullptr)
+	, m_pushedCount(0)
+	, m_processedCount(0)
+	, m_droppedCount(0)
+	, m_repeatCount(0)
 	, m_logStream(nullptr)
 {
 }
 
 ccConsole::~ccConsole()
 {
+	//process the remaining messages
+	m_writer.reset();
+
 	setLogFile(QString()); //to close/delete any active stream
 }
 
@@ -249,6 +346,7 @@ void ccConsole::Init(	QListWidget* textDisplay/*=nullptr*/,
 
 		s_console.instance->setAutoRefresh(true);
 	}
+	s_console.instance->startWriter();
 	ccLog::RegisterInstance(s_console.instance);
 }
 
@@ -273,90 +371,216 @@ void ccConsole::setAutoRefresh(bool state)
 
 void ccConsole::refresh()
 {
+	//grab the messages formatted by the writer thread
+	QVector<ConsoleItemType> messages;
 	m_mutex.lock();
-	
-	if (!m_queue.isEmpty())
+	messages.swap(m_queue);
+	m_mutex.unlock();
+
+	if (messages.isEmpty() || !m_textDisplay)
+	{
+		return;
+	}
+
+	for (const ConsoleItemType& messagePair : messages)
 	{
-		if (m_textDisplay || m_logStream)
+		//messagePair.first = message text
+		QListWidgetItem* item = new QListWidgetItem(messagePair.first);
+
+		//set color based on the message severity
+		if ((messagePair.second & LOG_ERROR) == LOG_ERROR) // Error
+		{
+			item->setForeground(Qt::red);
+		}
+		else if ((messagePair.second & LOG_WARNING) == LOG_WARNING) // Warning
 		{
-			for (auto messagePair : m_queue)
+			item->setForeground(Qt::darkRed);
+			//we also force the console visibility if a warning message arrives!
+			if (m_parentWindow)
 			{
-				//destination: log file
-				if (m_logStream)
-				{
-					*m_logStream << messagePair.first << endl;
-				}
-
-				//destination: console widget
-				if (m_textDisplay)
-				{
-					//messagePair.first = message text
-					QListWidgetItem* item = new QListWidgetItem(messagePair.first);
-
-					//set color based on the message severity
-					if ((messagePair.second & LOG_ERROR) == LOG_ERROR) // Error
-					{
-						item->setForeground(Qt::red);
-					}
-					else if ((messagePair.second & LOG_WARNING) == LOG_WARNING) // Warning
-					{
-						item->setForeground(Qt::darkRed);
-						//we also force the console visibility if a warning message arrives!
-						if (m_parentWindow)
-						{
-							m_parentWindow->forceConsoleDisplay();
-						}
-					}
+				m_parentWindow->forceConsoleDisplay();
+			}
+		}
 #ifdef QT_DEBUG
-					else if (messagePair.second & DEBUG_FLAG) // Debug
-					{
-						item->setForeground(Qt::blue);
-					}
+		else if (messagePair.second & DEBUG_FLAG) // Debug
+		{
+			item->setForeground(Qt::blue);
+		}
 #endif
 
-					m_textDisplay->addItem(item);
-				}
-			}
+		m_textDisplay->addItem(item);
+	}
 
-			if (m_logStream)
-			{
-				m_logFile.flush();
-			}
+	m_textDisplay->scrollToBottom();
+}
 
-			if (m_textDisplay)
-			{
-				m_textDisplay->scrollToBottom();
-			}
+bool ccConsole::flush(int timeout_ms/*=5000*/)
+{
+	if (!m_writer || !m_writer->isRunning())
+	{
+		return m_ringBuffer.empty();
+	}
+
+	quint64 pushedCount = m_pushedCount;
+	QElapsedTimer timer;
+	timer.start();
+	while (m_processedCount < pushedCount)
+	{
+		if (timer.elapsed() > timeout_ms)
+		{
+			return false;
 		}
+		m_writer->wake();
+		QThread::msleep(1);
+	}
 
-		m_queue.clear();
+	return true;
+}
+
+void ccConsole::startWriter()
+{
+	if (!m_writer)
+	{
+		m_writer.reset(new ccConsoleWriter(*this));
+	}
+	if (!m_writer->isRunning())
+	{
+		m_writer->start(QThread::LowPriority);
 	}
+}
 
-	m_mutex.unlock();
+unsigned ccConsole::processIncomingMessages()
+{
+	unsigned count = 0;
+
+	ccLogRingBuffer::Message message;
+	while (m_ringBuffer.pop(message))
+	{
+		if (	s_coalescingWindow_ms > 0
+			&&	message.level == m_lastMessage.level
+			&&	message.text == m_lastMessage.text
+			&&	!message.text.isEmpty() )
+		{
+			//same message as the previous one
+			++m_repeatCount;
+			m_lastMessage.time = message.time;
+			flushRepeatedMessages(false); //rate-limited
+		}
+		else
+		{
+			flushRepeatedMessages(true);
+			writeMessage(message.text, message.level, message.time);
+			m_lastMessage = message;
+			m_repeatTimer.start();
+		}
+
+		++count;
+		++m_processedCount;
+	}
+
+	//don't keep the repeated messages count for too long
+	flushRepeatedMessages(false);
+
+	unsigned droppedCount = m_droppedCount.exchange(0);
+	if (droppedCount != 0)
+	{
+		writeMessage(QString("[Console] %1 message(s) dropped (too many messages)").arg(droppedCount), LOG_WARNING, QTime::currentTime());
+	}
+
+	if (count != 0 || droppedCount != 0)
+	{
+		QMutexLocker locker(&m_mutex);
+		if (m_logStream)
+		{
+			m_logStream->flush();
+		}
+	}
+
+	return count;
 }
 
-void ccConsole::logMessage(const QString& message, int level)
+void ccConsole::flushRepeatedMessages(bool force)
 {
-	//skip messages below the current 'verbosity' level
-	if ((level & 7) < ccLog::VerbosityLevel())
+	if (m_repeatCount == 0)
+	{
+		return;
+	}
+
+	if (!force && m_repeatTimer.isValid() && m_repeatTimer.elapsed() < s_coalescingWindow_ms)
 	{
 		return;
 	}
 
-	QString formatedMessage = QStringLiteral("[") + QTime::currentTime().toString() + QStringLiteral("] ") + message;
+	writeMessage(QString("(last message repeated %1 times)").arg(m_repeatCount), m_lastMessage.level, m_lastMessage.time);
+	m_repeatCount = 0;
+	m_repeatTimer.start();
+}
+
+void ccConsole::writeMessage(const QString& message, int level, const QTime& time)
+{
+	QString formatedMessage = QStringLiteral("[") + time.toString() + QStringLiteral("] ") + message;
+
+	//destination: system console
 	if (s_redirectToStdOut)
 	{
 		printf("%s\n", qPrintable(formatedMessage));
 	}
-	if (m_textDisplay || m_logStream)
+
+	QMutexLocker locker(&m_mutex);
+
+	//destination: log file
+	if (m_logStream)
+	{
+		*m_logStream << formatedMessage << '\n';
+	}
+
+	//destination: console widget (see refresh)
+	if (m_textDisplay)
 	{
-		m_mutex.lock();
 		m_queue.push_back(ConsoleItemType(formatedMessage, level));
-		m_mutex.unlock();
+	}
+}
+
+void ccConsole::logMessage(const QString& message, int level)
+{
+	//skip messages below the current 'verbosity' level
+	if ((level & 7) < ccLog::VerbosityLevel())
+	{
+		return;
+	}
+
+	if (m_textDisplay || m_logStream || s_redirectToStdOut)
+	{
+		QTime time = QTime::currentTime();
+		bool pushed = m_ringBuffer.push(message, level, time);
+		if (!pushed && (level & 7) >= LOG_WARNING && m_writer && QThread::currentThread() != m_writer.data())
+		{
+			//warnings and errors are never dropped: we wait for the writer to make some room
+			while (!pushed && m_writer->isRunning())
+			{
+				m_writer->wake();
+				QThread::yieldCurrentThread();
+				pushed = m_ringBuffer.push(message, level, time);
+			}
+		}
+
+		if (pushed)
+		{
+			++m_pushedCount;
+			if (m_writer)
+			{
+				m_writer->wake();
+			}
+		}
+		else
+		{
+			++m_droppedCount;
+		}
 	}
 #ifdef QT_DEBUG
 	else if (!s_redirectToStdOut)
 	{
+		QString formatedMessage = QStringLiteral("[") + QTime::currentTime().toString() + QStringLiteral("] ") + message;
 		//Error
 		if (level & LOG_ERROR)
 		{
@@ -401,6 +625,8 @@ bool ccConsole::setLogFile(const QString& filename)
 	//close previous stream (if any)
 	if (m_logStream)
 	{
+		flush();
+
 		m_mutex.lock();
 		delete m_logStream;
 		m_logStream = nullptr;
@@ -423,7 +649,7 @@ bool ccConsole::setLogFile(const QString& filename)
 		m_mutex.lock();
 		m_logStream = new QTextStream(&m_logFile);
 		m_mutex.unlock();
-		setAutoRefresh(true);
+		startWriter();
 	}
 
 	return true;
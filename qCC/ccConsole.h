@@ -19,13 +19,20 @@
 
 //qCC_db
 #include <ccLog.h>
+#include <ccLogRingBuffer.h>
 
 //Qt
+#include <QElapsedTimer>
 #include <QFile>
 #include <QListWidget>
 #include <QMutex>
+#include <QScopedPointer>
 #include <QTimer>
 
+//system
+#include <atomic>
+
+class ccConsoleWriter;
 class MainWindow;
 class QTextStream;
 
@@ -42,10 +49,17 @@ protected:
 };
 
 //! Console
+/** Messages can be logged from any thread without locking: they are pushed in a lock-free
+	ring buffer, and an asynchronous writer thread outputs them to the log file and/or the
+	system console (std::out), and queues them for the console widget (refreshed by the GUI
+	thread with a timer). Repeated messages are coalesced by the writer thread.
+**/
 class ccConsole : public QObject, public ccLog
 {
 	Q_OBJECT
 
+	friend class ccConsoleWriter;
+
 public:
 
 	//! Destructor
@@ -97,11 +111,22 @@ public:
 	//! Returns the parent widget (if any)
 	inline QWidget* parentWidget() { return m_parentWidget; }
 
+	//! Sets the time window during which repeated messages are coalesced
+	/** \param window_ms time window (ms) - 0 to disable the coalescing
+	**/
+	static void SetCoalescingWindow(int window_ms = 1000);
+
 public:
 
 	//! Refreshes console (display all messages still in queue)
 	void refresh();
 
+	//! Waits for the writer thread to process all the messages logged so far
+	/** \param timeout_ms maximum waiting time (ms)
+		\return whether all the messages have been processed
+	**/
+	bool flush(int timeout_ms = 5000);
+
 protected:
 
 	//! Default constructor
@@ -112,6 +137,22 @@ protected:
 	//inherited from ccLog
 	void logMessage(const QString& message, int level) override;
 
+	//! Starts the writer thread
+	void startWriter();
+
+	//! Processes the messages waiting in the ring buffer (writer thread only)
+	/** \return the number of processed messages
+	**/
+	unsigned processIncomingMessages();
+
+	//! Outputs the repeated messages count (writer thread only)
+	/** \param force whether to output it even if the coalescing time window has not elapsed yet
+	**/
+	void flushRepeatedMessages(bool force);
+
+	//! Outputs a message (writer thread only)
+	void writeMessage(const QString& message, int level, const QTime& time);
+
 	//! Associated text display widget
 	QListWidget* m_textDisplay;
 
@@ -121,15 +162,34 @@ protected:
 	//! Parent window (if any)
 	MainWindow* m_parentWindow;
 
-	//! Mutex for concurrent thread access to console
+	//! Mutex for concurrent thread access to the display queue and the log stream
 	QMutex m_mutex;
 
 	//! Queue element type (message + color)
 	using ConsoleItemType = QPair<QString, int>;
 
-	//! Queue for incoming messages
+	//! Queue of formatted messages waiting to be displayed
 	QVector<ConsoleItemType> m_queue;
 
+	//! Lock-free buffer of incoming messages
+	ccLogRingBuffer m_ringBuffer;
+	//! Number of messages pushed in the ring buffer
+	std::atomic<quint64> m_pushedCount;
+	//! Number of messages processed by the writer thread
+	std::atomic<quint64> m_processedCount;
+	//! Number of messages dropped because the ring buffer was full
+	std::atomic<unsigned> m_droppedCount;
+
+	//! Writer thread
+	QScopedPointer<ccConsoleWriter> m_writer;
+
+	//! Last message (for coalescing - writer thread only)
+	ccLogRingBuffer::Message m_lastMessage;
+	//! Number of times the last message has been repeated (writer thread only)
+	unsigned m_repeatCount;
+	//! Timer since the last message has been output (writer thread only)
+	QElapsedTimer m_repeatTimer;
+
 	//! Timer for auto-refresh
 	QTimer m_timer;
 
@@ -48,6 +48,7 @@ static QString GetPolylineName(double value, unsigned mainIndex, unsigned partNu
 
 //Qt
 #include <QCoreApplication>
+#include <QScopedPointer>
 
 #else
 
@@ -402,13 +403,17 @@ bool ccContourLinesGenerator::GenerateContourLines(	ccRasterGrid* rasterGrid,
 				iso.createOnePixelBorder(grid.data(), params.startAltitude - 1.0);
 			}
 
-			ccProgressDialog pDlg(true, params.parentWidget);
-			pDlg.setMethodTitle(QObject::tr("Contour plot"));
-			pDlg.setInfo(QObject::tr("Levels: %1\nCells: %2 x %3").arg(levelCount).arg(rasterGrid->width).arg(rasterGrid->height));
-			pDlg.start();
-			pDlg.show();
-			QCoreApplication::processEvents();
-			CCCoreLib::NormalizedProgress nProgress(&pDlg, levelCount);
+			QScopedPointer<ccProgressDialog> pDlg;
+			if (params.showProgress)
+			{
+				pDlg.reset(new ccProgressDialog(true, params.parentWidget));
+				pDlg->setMethodTitle(QObject::tr("Contour plot"));
+				pDlg->setInfo(QObject::tr("Levels: %1\nCells: %2 x %3").arg(levelCount).arg(rasterGrid->width).arg(rasterGrid->height));
+				pDlg->start();
+				pDlg->show();
+				QCoreApplication::processEvents();
+			}
+			CCCoreLib::NormalizedProgress nProgress(pDlg.data(), levelCount);
 
 			for (double v = params.startAltitude; v <= params.maxAltitude; v += params.step)
 			{
@@ -22,6 +22,9 @@
 #include <QMessageBox>
 #include <QPushButton>
 
+//system
+#include <map>
+
 //CCCoreLib
 #include <NormalDistribution.h>
 #include <ScalarFieldTools.h>
@@ -1419,12 +1422,26 @@ namespace ccEntityAction
 				return false;
 			}
 
-            // count integer values
-            size_t N = sf->size();
-            std::set<int> classes;
-            for (size_t i = 0; i < sf->size(); ++i)
+            // count integer values (NaN values are ignored)
+            unsigned pointCount = cloud->size();
+            std::map<int, int> classes; // class value --> part index
+            std::vector<int> keys;
+            try
+            {
+                keys.resize(pointCount, -1);
+                for (unsigned i = 0; i < pointCount; ++i)
+                {
+                    ScalarType value = sf->getValue(i);
+                    if (CCCoreLib::ScalarField::ValidValue(value))
+                    {
+                        classes.emplace(static_cast<int>(value), 0);
+                    }
+                }
+            }
+            catch (const std::bad_alloc&)
             {
-				classes.insert(static_cast<int>(sf->getValue(i)));
+                ccLog::Error(QT_TR_NOOP("Not enough memory"));
+                return false;
             }
             ccLog::Print("[sfSplitCloud] " + QString::number(classes.size()) + " classe(s) found in the current scalar field");
 
@@ -1445,50 +1462,47 @@ namespace ccEntityAction
 				tooManyCloudsQuestionAsked = true;
 			}
 
+			// assign a part to each class (in increasing order), then a key to each point
+			std::vector<int> classValues;
+			classValues.reserve(classes.size());
+			for (auto& c : classes)
+			{
+				c.second = static_cast<int>(classValues.size());
+				classValues.push_back(c.first);
+			}
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				ScalarType value = sf->getValue(i);
+				if (CCCoreLib::ScalarField::ValidValue(value))
+				{
+					keys[i] = classes[static_cast<int>(value)];
+				}
+			}
+
+			// create as many clouds as the number of classes (in a single pass)
+			std::vector<ccPointCloud*> parts;
+			if (!cloud->partition(keys, static_cast<unsigned>(classValues.size()), parts))
+			{
+				ccLog::Warning("[sfSplitCloud] Failed to create clouds");
+				return false;
+			}
+
 			ccHObject* destObject = new ccHObject(cloud->getName() + " classes");
 			if (cloud->getParent())
 			{
 				cloud->getParent()->addChild(destObject);
 			}
-            
-			// create as many clouds as the number of classes
-			for (int pointClass : classes)
-            {
-                ccLog::Print("[sfSplitCloud] build cloud corresponding to class #" + QString::number(pointClass));
-                
-				try
-				{
-					// create the reference cloud
-					CCCoreLib::ReferenceCloud referenceCloud(cloud);
-					
-					// populate the cloud with the points which have the selected class
-					for (unsigned index = 0; index < static_cast<unsigned>(cloud->size()); index++)
-					{
-						if (static_cast<int>(sf->getValue(index)) == pointClass)
-						{
-							referenceCloud.addPointIndex(index);
-						}
-					}
-					ccPointCloud* pc = cloud->partialClone(&referenceCloud);
-					if (pc)
-					{
-						pc->setName("class #" + QString::number(pointClass));
-						destObject->addChild(pc);
-					}
-					else
-					{
-						ccLog::Warning("[sfSplitCloud] Failed to create cloud");
-					}
-				}
-				catch (const std::bad_alloc&)
+
+			for (size_t c = 0; c < parts.size(); ++c)
+			{
+				ccPointCloud* pc = parts[c];
+				if (pc)
 				{
-					delete destObject;
-					destObject = nullptr;
-					ccLog::Error(QT_TR_NOOP("Not enough memory"));
-					return false;
+					pc->setName("class #" + QString::number(classValues[c]));
+					destObject->addChild(pc);
 				}
 			}
-		
+
 			// add to database
 			app->addToDB(destObject);
 
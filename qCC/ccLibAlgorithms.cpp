@@ -18,6 +18,10 @@
 #include "ccLibAlgorithms.h"
 
 //CCCoreLib
+#include <DgmOctreeReferenceCloud.h>
+#include <DistanceComputationTools.h>
+#include <Jacobi.h>
+#include <Neighbourhood.h>
 #include <ScalarFieldTools.h>
 
 //qCC_db
@@ -115,70 +119,11 @@ namespace ccLibAlgorithms
 		return sigma;
 	}
 
-	bool ComputeGeomCharacteristics(const GeomCharacteristicSet& characteristics,
-									PointCoordinateType radius,
-									ccHObject::Container& entities,
-									const CCVector3* roughnessUpDir/*=nullptr*/,
-									QWidget* parent/*=nullptr*/)
+	//! Returns the name of the scalar field associated to a geometric characteristic
+	/** \return an empty string if the characteristic (or its sub-option) is invalid
+	**/
+	static QString GetGeomCharacteristicSFName(CCCoreLib::GeometricalAnalysisTools::GeomCharacteristic c, int subOption, PointCoordinateType radius)
 	{
-		//no feature case
-		if (characteristics.empty())
-		{
-			//nothing to do
-			assert(false);
-			return true;
-		}
-		
-		//single features case
-		if (characteristics.size() == 1)
-		{
-			return ComputeGeomCharacteristic(	characteristics.front().charac,
-												characteristics.front().subOption,
-												radius,
-												entities,
-												roughnessUpDir,
-												parent);
-		}
-
-		//multiple features case
-		QScopedPointer<ccProgressDialog> pDlg;
-		if (parent)
-		{
-			pDlg.reset(new ccProgressDialog(true, parent));
-			pDlg->setAutoClose(false);
-		}
-		
-		for (const GeomCharacteristic& g : characteristics)
-		{
-			if (!ComputeGeomCharacteristic(	g.charac,
-											g.subOption,
-											radius,
-											entities,
-											roughnessUpDir,
-											parent,
-											pDlg.data()))
-			{
-				return false;
-			}
-		}
-
-		return true;
-	}
-
-
-	bool ComputeGeomCharacteristic(	CCCoreLib::GeometricalAnalysisTools::GeomCharacteristic c,
-									int subOption,
-									PointCoordinateType radius,
-									ccHObject::Container& entities,
-									const CCVector3* roughnessUpDir/*=nullptr*/,
-									QWidget* parent/*= nullptr*/,
-									ccProgressDialog* progressDialog/*=nullptr*/)
-	{
-		size_t selNum = entities.size();
-		if (selNum < 1)
-			return false;
-
-		//generate the right SF name
 		QString sfName;
 
 		switch (c)
@@ -232,7 +177,7 @@ namespace ccLibAlgorithms
 			default:
 				assert(false);
 				ccLog::Error("Internal error: invalid sub option for Feature computation");
-				return false;
+				return QString();
 			}
 
 			sfName += QString(" (%1)").arg(radius);
@@ -255,7 +200,7 @@ namespace ccLibAlgorithms
 			default:
 				assert(false);
 				ccLog::Error("Internal error: invalid sub option for Curvature computation");
-				return false;
+				return QString();
 			}
 			sfName += QString(" (%1)").arg(radius);
 		}
@@ -279,6 +224,505 @@ namespace ccLibAlgorithms
 
 		default:
 			assert(false);
+			break;
+		}
+
+		return sfName;
+	}
+
+	//! Returns whether a geometric characteristic can be computed by the fused engine (see ComputeFusedGeomCharacteristics)
+	static bool CanBeFused(CCCoreLib::GeometricalAnalysisTools::GeomCharacteristic c)
+	{
+		switch (c)
+		{
+		case CCCoreLib::GeometricalAnalysisTools::Feature:
+		case CCCoreLib::GeometricalAnalysisTools::Curvature:
+		case CCCoreLib::GeometricalAnalysisTools::LocalDensity:
+		case CCCoreLib::GeometricalAnalysisTools::Roughness:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//! Output of the fused engine
+	struct FusedOutput
+	{
+		GeomCharacteristic characteristic;
+		int sfIdx = -1;
+		CCCoreLib::ScalarField* sf = nullptr;
+	};
+
+	//! Parameters of the fused engine
+	struct FusedParameters
+	{
+		PointCoordinateType radius = 0;
+		const CCVector3* roughnessUpDir = nullptr;
+		std::vector<FusedOutput> outputs;
+		bool needEigenValues = false;
+	};
+
+	//! Computes an eigen-feature from the (sorted) eigenvalues of the covariance matrix
+	/** Same formulas as CCCoreLib::Neighbourhood::computeFeature, but the eigen decomposition is shared.
+	**/
+	static double ComputeEigenFeature(CCCoreLib::Neighbourhood::GeomFeature feature, double l1, double l2, double l3, const CCVector3d& e3)
+	{
+		static const double Epsilon = std::numeric_limits<double>::epsilon();
+		double sum = l1 + l2 + l3;
+
+		switch (feature)
+		{
+		case CCCoreLib::Neighbourhood::EigenValuesSum:
+			return sum;
+		case CCCoreLib::Neighbourhood::Omnivariance:
+			return pow(l1 * l2 * l3, 1.0 / 3.0);
+		case CCCoreLib::Neighbourhood::EigenEntropy:
+			return -(l1 * log(l1) + l2 * log(l2) + l3 * log(l3));
+		case CCCoreLib::Neighbourhood::Anisotropy:
+			return std::abs(l1) > Epsilon ? (l1 - l3) / l1 : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::Planarity:
+			return std::abs(l1) > Epsilon ? (l2 - l3) / l1 : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::Linearity:
+			return std::abs(l1) > Epsilon ? (l1 - l2) / l1 : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::PCA1:
+			return std::abs(sum) > Epsilon ? l1 / sum : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::PCA2:
+			return std::abs(sum) > Epsilon ? l2 / sum : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::SurfaceVariation:
+			return std::abs(sum) > Epsilon ? l3 / sum : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::Sphericity:
+			return std::abs(l1) > Epsilon ? l3 / l1 : std::numeric_limits<double>::quiet_NaN();
+		case CCCoreLib::Neighbourhood::Verticality:
+			return 1.0 - std::abs(e3.z);
+		case CCCoreLib::Neighbourhood::EigenValue1:
+			return l1;
+		case CCCoreLib::Neighbourhood::EigenValue2:
+			return l2;
+		case CCCoreLib::Neighbourhood::EigenValue3:
+			return l3;
+		default:
+			assert(false);
+			break;
+		}
+
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	//! Computes all the requested characteristics for the points of an octree cell (single neighbourhood extraction per point)
+	static bool ComputeCellFusedCharacteristics(const CCCoreLib::DgmOctree::octreeCell& cell,
+												void** additionalParameters,
+												CCCoreLib::NormalizedProgress* nProgress = nullptr)
+	{
+		const FusedParameters& params = *static_cast<const FusedParameters*>(additionalParameters[0]);
+
+		CCCoreLib::DgmOctree::NearestNeighboursSearchStruct nNSS;
+		nNSS.level = cell.level;
+		cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
+		cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
+
+		//we already know which points are lying in the current cell
+		unsigned pointCount = cell.points->size();
+		try
+		{
+			nNSS.pointsInNeighbourhood.resize(pointCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+		CCCoreLib::DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
+		for (unsigned j = 0; j < pointCount; ++j, ++it)
+		{
+			it->point = cell.points->getPointPersistentPtr(j);
+			it->pointIndex = cell.points->getPointGlobalIndex(j);
+		}
+		nNSS.alreadyVisitedNeighbourhoodSize = 1;
+
+		const double sphereVolume = 4.0 * M_PI / 3.0 * pow(static_cast<double>(params.radius), 3.0);
+		const double circleArea = M_PI * pow(static_cast<double>(params.radius), 2.0);
+
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+			cell.points->getPoint(i, nNSS.queryPoint);
+
+			//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (k)!
+			unsigned k = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS, params.radius, false);
+
+			CCCoreLib::DgmOctreeReferenceCloud neighbours(&nNSS.pointsInNeighbourhood, k);
+			CCCoreLib::Neighbourhood Z(&neighbours);
+
+			//covariance matrix and eigen decomposition (once for all the eigen-features)
+			bool eigenValid = false;
+			double l1 = 0.0;
+			double l2 = 0.0;
+			double l3 = 0.0;
+			CCVector3d e3(0, 0, 1);
+			if (params.needEigenValues && k >= 3)
+			{
+				CCCoreLib::SquareMatrixd covMat = Z.computeCovarianceMatrix();
+				CCCoreLib::SquareMatrixd eigVectors;
+				std::vector<double> eigValues;
+				if (covMat.isValid() && CCCoreLib::Jacobi<double>::ComputeEigenValuesAndVectors(covMat, eigVectors, eigValues, true))
+				{
+					CCCoreLib::Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //decreasing order
+					l1 = eigValues[0];
+					l2 = eigValues[1];
+					l3 = eigValues[2];
+					CCCoreLib::Jacobi<double>::GetEigenVector(eigVectors, 2, e3.u);
+					e3.normalize();
+					eigenValid = true;
+				}
+			}
+
+			bool hasRoughness = false;
+			for (const FusedOutput& output : params.outputs)
+			{
+				ScalarType value = CCCoreLib::NAN_VALUE;
+				int subOption = output.characteristic.subOption;
+
+				switch (output.characteristic.charac)
+				{
+				case CCCoreLib::GeometricalAnalysisTools::Feature:
+					if (eigenValid)
+					{
+						value = static_cast<ScalarType>(ComputeEigenFeature(static_cast<CCCoreLib::Neighbourhood::GeomFeature>(subOption), l1, l2, l3, e3));
+					}
+					break;
+
+				case CCCoreLib::GeometricalAnalysisTools::Curvature:
+					if (k >= 5)
+					{
+						value = Z.computeCurvature(nNSS.queryPoint, static_cast<CCCoreLib::Neighbourhood::CurvatureType>(subOption));
+					}
+					break;
+
+				case CCCoreLib::GeometricalAnalysisTools::LocalDensity:
+					switch (subOption)
+					{
+					case CCCoreLib::GeometricalAnalysisTools::DENSITY_KNN:
+						value = static_cast<ScalarType>(k);
+						break;
+					case CCCoreLib::GeometricalAnalysisTools::DENSITY_2D:
+						value = static_cast<ScalarType>(k / circleArea);
+						break;
+					case CCCoreLib::GeometricalAnalysisTools::DENSITY_3D:
+						value = static_cast<ScalarType>(k / sphereVolume);
+						break;
+					default:
+						assert(false);
+						break;
+					}
+					break;
+
+				case CCCoreLib::GeometricalAnalysisTools::Roughness:
+					//the query point must be excluded from the neighbourhood (see below)
+					hasRoughness = true;
+					continue;
+
+				default:
+					assert(false);
+					break;
+				}
+
+				output.sf->setValue(globalIndex, value);
+			}
+
+			//roughness (last, as we need to reorder the neighbours)
+			if (hasRoughness)
+			{
+				ScalarType value = CCCoreLib::NAN_VALUE;
+				if (k >= 4)
+				{
+					//find the query point in the nearest neighbors set and place it at the end
+					unsigned localIndex = 0;
+					while (localIndex < k && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
+					{
+						++localIndex;
+					}
+					assert(localIndex < k);
+					if (localIndex + 1 < k)
+					{
+						std::swap(nNSS.pointsInNeighbourhood[localIndex], nNSS.pointsInNeighbourhood[k - 1]);
+					}
+
+					CCCoreLib::DgmOctreeReferenceCloud neighboursWithoutQueryPoint(&nNSS.pointsInNeighbourhood, k - 1);
+					CCCoreLib::Neighbourhood Zr(&neighboursWithoutQueryPoint);
+					const PointCoordinateType* lsPlane = Zr.getLSPlane();
+					if (lsPlane)
+					{
+						value = CCCoreLib::DistanceComputationTools::computePoint2PlaneDistance(&nNSS.queryPoint, lsPlane);
+						if (params.roughnessUpDir)
+						{
+							//signed roughness (positive above the plane, with respect to the 'up' direction)
+							if (CCVector3::fromArray(lsPlane).dot(*params.roughnessUpDir) < 0)
+							{
+								value = -value;
+							}
+						}
+						else
+						{
+							value = std::abs(value);
+						}
+					}
+				}
+
+				for (const FusedOutput& output : params.outputs)
+				{
+					if (output.characteristic.charac == CCCoreLib::GeometricalAnalysisTools::Roughness)
+					{
+						output.sf->setValue(globalIndex, value);
+					}
+				}
+			}
+
+			if (nProgress && !nProgress->oneStep())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//! Computes several geometric characteristics with the same radius in a single pass
+	/** Each neighbourhood is extracted once, and the covariance matrix and its eigen decomposition
+		are computed once for all the eigen-features.
+	**/
+	static bool ComputeFusedGeomCharacteristics(const GeomCharacteristicSet& characteristics,
+												PointCoordinateType radius,
+												ccHObject::Container& entities,
+												const CCVector3* roughnessUpDir,
+												QWidget* parent,
+												ccProgressDialog* progressDialog)
+	{
+		for (ccHObject* entity : entities)
+		{
+			if (!entity->isKindOf(CC_TYPES::POINT_CLOUD))
+			{
+				continue;
+			}
+
+			if (!entity->isA(CC_TYPES::POINT_CLOUD))
+			{
+				//we need real scalar fields: we use the standard method
+				ccHObject::Container singleEntity{ entity };
+				for (const GeomCharacteristic& g : characteristics)
+				{
+					if (!ComputeGeomCharacteristic(g.charac, g.subOption, radius, singleEntity, roughnessUpDir, parent, progressDialog))
+					{
+						return false;
+					}
+				}
+				continue;
+			}
+
+			ccPointCloud* pc = static_cast<ccPointCloud*>(entity);
+
+			FusedParameters params;
+			params.radius = radius;
+			params.roughnessUpDir = roughnessUpDir;
+
+			//create the scalar fields
+			for (const GeomCharacteristic& g : characteristics)
+			{
+				QString sfName = GetGeomCharacteristicSFName(g.charac, g.subOption, radius);
+				if (sfName.isEmpty())
+				{
+					return false;
+				}
+
+				FusedOutput output{ g };
+				output.sfIdx = pc->getScalarFieldIndexByName(sfName.toStdString());
+				if (output.sfIdx < 0)
+				{
+					output.sfIdx = pc->addScalarField(sfName.toStdString());
+				}
+				if (output.sfIdx < 0)
+				{
+					ccConsole::Error(QString("Failed to create scalar field on cloud '%1' (not enough memory?)").arg(pc->getName()));
+					return false;
+				}
+				output.sf = pc->getScalarField(output.sfIdx);
+				output.sf->fill(CCCoreLib::NAN_VALUE);
+				params.outputs.push_back(output);
+
+				if (g.charac == CCCoreLib::GeometricalAnalysisTools::Feature)
+				{
+					params.needEigenValues = true;
+				}
+			}
+
+			ccOctree::Shared octree = pc->getOctree();
+			if (!octree)
+			{
+				if (progressDialog)
+				{
+					progressDialog->show();
+				}
+				octree = pc->computeOctree(progressDialog);
+				if (!octree)
+				{
+					ccConsole::Error(QString("Couldn't compute octree for cloud '%1'!").arg(pc->getName()));
+					return false;
+				}
+			}
+
+			unsigned char level = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(radius);
+
+			void* additionalParameters[] { reinterpret_cast<void*>(&params) };
+
+			QElapsedTimer eTimer;
+			eTimer.start();
+
+			if (octree->executeFunctionForAllCellsAtLevel(	level,
+															ComputeCellFusedCharacteristics,
+															additionalParameters,
+															true,
+															progressDialog,
+															"Geometric features computation") == 0)
+			{
+				ccConsole::Warning(QString("Failed to apply processing to cloud '%1'").arg(pc->getName()));
+				if (progressDialog && progressDialog->wasCanceled())
+				{
+					ccConsole::Warning("Process cancelled by user");
+				}
+
+				//remove the (incomplete) scalar fields (by name, as indexes may change after each deletion)
+				for (const GeomCharacteristic& g : characteristics)
+				{
+					int sfIdx = pc->getScalarFieldIndexByName(GetGeomCharacteristicSFName(g.charac, g.subOption, radius).toStdString());
+					if (sfIdx >= 0)
+					{
+						pc->deleteScalarField(sfIdx);
+					}
+				}
+				return false;
+			}
+
+			ccConsole::Print(QString("[Geometric features] %1 feature(s) computed in a single pass on cloud '%2' (%3 s.)").arg(params.outputs.size()).arg(pc->getName()).arg(eTimer.elapsed() / 1000.0));
+
+			for (const FusedOutput& output : params.outputs)
+			{
+				output.sf->computeMinAndMax();
+				if (output.characteristic.charac == CCCoreLib::GeometricalAnalysisTools::Roughness && roughnessUpDir != nullptr)
+				{
+					// signed roughness should be displayed with a symmetrical color scale
+					ccScalarField* sf = dynamic_cast<ccScalarField*>(output.sf);
+					if (sf)
+					{
+						sf->setSymmetricalScale(true);
+					}
+				}
+			}
+			pc->setCurrentDisplayedScalarField(params.outputs.back().sfIdx);
+			pc->showSF(true);
+			pc->prepareDisplayForRefresh();
+		}
+
+		return true;
+	}
+
+	bool ComputeGeomCharacteristics(const GeomCharacteristicSet& characteristics,
+									PointCoordinateType radius,
+									ccHObject::Container& entities,
+									const CCVector3* roughnessUpDir/*=nullptr*/,
+									QWidget* parent/*=nullptr*/)
+	{
+		//no feature case
+		if (characteristics.empty())
+		{
+			//nothing to do
+			assert(false);
+			return true;
+		}
+		
+		//single features case
+		if (characteristics.size() == 1)
+		{
+			return ComputeGeomCharacteristic(	characteristics.front().charac,
+												characteristics.front().subOption,
+												radius,
+												entities,
+												roughnessUpDir,
+												parent);
+		}
+
+		//multiple features case
+		QScopedPointer<ccProgressDialog> pDlg;
+		if (parent)
+		{
+			pDlg.reset(new ccProgressDialog(true, parent));
+			pDlg->setAutoClose(false);
+		}
+		
+		//the characteristics that rely on the same neighbourhood extraction are computed in a single pass
+		GeomCharacteristicSet fusedCharacteristics;
+		GeomCharacteristicSet otherCharacteristics;
+		for (const GeomCharacteristic& g : characteristics)
+		{
+			if (CanBeFused(g.charac))
+			{
+				fusedCharacteristics.push_back(g);
+			}
+			else
+			{
+				otherCharacteristics.push_back(g);
+			}
+		}
+		if (fusedCharacteristics.size() == 1)
+		{
+			otherCharacteristics.insert(otherCharacteristics.begin(), fusedCharacteristics.front());
+			fusedCharacteristics.clear();
+		}
+
+		if (!fusedCharacteristics.empty())
+		{
+			if (!ComputeFusedGeomCharacteristics(	fusedCharacteristics,
+													radius,
+													entities,
+													roughnessUpDir,
+													parent,
+													pDlg.data()))
+			{
+				return false;
+			}
+		}
+
+		for (const GeomCharacteristic& g : otherCharacteristics)
+		{
+			if (!ComputeGeomCharacteristic(	g.charac,
+											g.subOption,
+											radius,
+											entities,
+											roughnessUpDir,
+											parent,
+											pDlg.data()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	bool ComputeGeomCharacteristic(	CCCoreLib::GeometricalAnalysisTools::GeomCharacteristic c,
+									int subOption,
+									PointCoordinateType radius,
+									ccHObject::Container& entities,
+									const CCVector3* roughnessUpDir/*=nullptr*/,
+									QWidget* parent/*= nullptr*/,
+									ccProgressDialog* progressDialog/*=nullptr*/)
+	{
+		size_t selNum = entities.size();
+		if (selNum < 1)
+			return false;
+
+		//generate the right SF name
+		QString sfName = GetGeomCharacteristicSFName(c, subOption, radius);
+		if (sfName.isEmpty())
+		{
 			return false;
 		}
 
@@ -52,6 +52,10 @@ namespace ccLibAlgorithms
 	typedef std::vector<GeomCharacteristic> GeomCharacteristicSet;
 
 	//! Computes geometrical characteristics (see GeometricalAnalysisTools::GeomCharacteristic) on a set of entities
+	/** Features, curvatures, roughness and (exact) local densities are computed in a single pass:
+		each neighbourhood is extracted only once, and the covariance matrix and its eigen decomposition
+		are shared by all the requested features.
+	**/
 	bool ComputeGeomCharacteristics(const GeomCharacteristicSet& characteristics,
 									PointCoordinateType radius,
 									ccHObject::Container& entities,
@@ -42,6 +42,8 @@
 #include <ImageFileFilter.h>
 
 //Qt
+#include <QCoreApplication>
+#include <QFile>
 #include <QFileDialog>
 #include <QMap>
 #include <QMessageBox>
@@ -1622,6 +1624,500 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 #endif
 }
 
+bool ccRasterizeTool::ExportTiledGeoTiff(	const QString& outputFilename,
+											const ExportBands& exportBands,
+											ccPointCloud* cloud,
+											const ccBBox& gridBBox,
+											double gridStep,
+											unsigned char Z,
+											ccRasterGrid::ProjectionType projectionType,
+											ccRasterGrid::ProjectionType sfProjectionType,
+											ccRasterGrid::EmptyCellFillOption fillEmptyCellsStrategy,
+											double customHeightForEmptyCells,
+											const TiledExportParams& tiledParams,
+											int zStdDevSfIndex/*=-1*/,
+											int visibleSfIndex/*=-1*/,
+											ccProgressDialog* progressDialog/*=nullptr*/)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (!cloud || (exportBands.visibleSF && visibleSfIndex < 0))
+	{
+		assert(false);
+		return false;
+	}
+
+	if (	fillEmptyCellsStrategy == ccRasterGrid::INTERPOLATE_DELAUNAY
+		||	fillEmptyCellsStrategy == ccRasterGrid::KRIGING)
+	{
+		ccLog::Error("[Rasterize] Empty cells interpolation is not supported by the tiled export");
+		return false;
+	}
+
+	//tile size (GDAL requires a multiple of 16)
+	unsigned tileSize = std::max(16u, (tiledParams.tileSize / 16) * 16);
+
+	//vertical dimension
+	assert(Z <= 2);
+	const unsigned char X = (Z == 2 ? 0 : Z + 1);
+	const unsigned char Y = (X == 2 ? 0 : X + 1);
+
+	unsigned gridWidth = 0;
+	unsigned gridHeight = 0;
+	if (!ccRasterGrid::ComputeGridSize(Z, gridBBox, gridStep, gridWidth, gridHeight))
+	{
+		return false;
+	}
+	if (gridWidth > static_cast<unsigned>(std::numeric_limits<int>::max()) || gridHeight > static_cast<unsigned>(std::numeric_limits<int>::max()))
+	{
+		ccLog::Error("[Rasterize] Grid is too big");
+		return false;
+	}
+
+	double stepX = gridStep;
+	double stepY = gridStep;
+
+	//global shift (same conventions as ExportGeoTiff)
+	double shiftX = gridBBox.minCorner().u[X] - stepX / 2; //we will declare the raster grid as 'Pixel-is-area'!
+	double shiftY = gridBBox.maxCorner().u[Y] + stepY / 2; //we will declare the raster grid as 'Pixel-is-area'!
+	double shiftZ = 0.0;
+	{
+		const CCVector3d& shift = cloud->getGlobalShift();
+		shiftX -= shift.u[X];
+		shiftY -= shift.u[Y];
+		shiftZ -= shift.u[Z];
+
+		double scale = cloud->getGlobalScale();
+		assert(scale != 0);
+		stepX /= scale;
+		stepY /= scale;
+	}
+
+	//the SF bands must be known before the grid is computed
+	std::vector<unsigned> sfBands;
+	if (sfProjectionType != ccRasterGrid::INVALID_PROJECTION_TYPE)
+	{
+		for (unsigned k = 0; k < cloud->getNumberOfScalarFields(); ++k)
+		{
+			if (exportBands.allSFs || (exportBands.visibleSF && visibleSfIndex == static_cast<int>(k)))
+			{
+				sfBands.push_back(k);
+			}
+		}
+	}
+
+	//we can't know in advance whether there will be empty cells or not
+	bool rgbaMode = (exportBands.rgb && fillEmptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY);
+	int totalBands = (exportBands.rgb ? (rgbaMode ? 4 : 3) : 0)
+					+ (exportBands.height ? 1 : 0)
+					+ (exportBands.density ? 1 : 0)
+					+ static_cast<int>(sfBands.size());
+	bool onlyRGBA = (exportBands.rgb && !exportBands.height && !exportBands.density && sfBands.empty());
+
+	if (totalBands == 0)
+	{
+		ccLog::Error("Can't output a raster with no band! (check export parameters)");
+		return false;
+	}
+
+	//sort the points by tile
+	ccRasterGridTiling tiling;
+	if (!tiling.init(cloud, Z, gridWidth, gridHeight, gridStep, gridBBox.minCorner(), tileSize))
+	{
+		ccLog::Error("[Rasterize] Not enough memory");
+		return false;
+	}
+
+	GDALAllRegister();
+
+	GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	if (!poDriver)
+	{
+		ccLog::Error("[GDAL] Driver GTiff is not supported");
+		return false;
+	}
+
+	//with the COG mode, the tiles are first written in a temporary file
+	QString tiledFilename = (tiledParams.cog ? outputFilename + ".tmp" : outputFilename);
+
+	char** papszOptions = nullptr;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "BLOCKXSIZE", qPrintable(QString::number(tileSize)));
+	papszOptions = CSLSetNameValue(papszOptions, "BLOCKYSIZE", qPrintable(QString::number(tileSize)));
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+	if (!tiledParams.cog)
+	{
+		papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "DEFLATE");
+	}
+
+	GDALDataset* poDstDS = poDriver->Create(qUtf8Printable(tiledFilename),
+											static_cast<int>(gridWidth),
+											static_cast<int>(gridHeight),
+											totalBands,
+											onlyRGBA ? GDT_Byte : GDT_Float64,
+											papszOptions);
+	CSLDestroy(papszOptions);
+	papszOptions = nullptr;
+
+	if (!poDstDS)
+	{
+		ccLog::Error("[GDAL] Failed to create output raster");
+		return false;
+	}
+
+	poDstDS->SetMetadataItem("AREA_OR_POINT", "AREA");
+
+	double adfGeoTransform[6] {	shiftX,		//top left x
+								stepX,		//w-e pixel resolution (can be negative)
+								0,			//0
+								shiftY,		//top left y
+								0,			//0
+								-stepY		//n-s pixel resolution (can be negative)
+	};
+	poDstDS->SetGeoTransform(adfGeoTransform);
+
+	//bands setup (same order as ExportGeoTiff)
+	int currentBand = 0;
+	int rgbBandIndex = 0;
+	int heightBandIndex = 0;
+	int densityBandIndex = 0;
+	int firstSFBandIndex = 0;
+	if (exportBands.rgb)
+	{
+		rgbBandIndex = currentBand + 1;
+		poDstDS->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_RedBand);
+		poDstDS->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_GreenBand);
+		poDstDS->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_BlueBand);
+		if (rgbaMode)
+		{
+			poDstDS->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_AlphaBand);
+		}
+	}
+	if (exportBands.height)
+	{
+		heightBandIndex = ++currentBand;
+		GDALRasterBand* poBand = poDstDS->GetRasterBand(heightBandIndex);
+		poBand->SetColorInterpretation(GCI_Undefined);
+		if (fillEmptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY && CE_None != poBand->SetNoDataValue(std::numeric_limits<double>::quiet_NaN()))
+		{
+			ccLog::Warning("[GDAL] Failed to set the No Data value");
+		}
+	}
+	if (exportBands.density)
+	{
+		densityBandIndex = ++currentBand;
+		poDstDS->GetRasterBand(densityBandIndex)->SetColorInterpretation(GCI_Undefined);
+	}
+	if (!sfBands.empty())
+	{
+		firstSFBandIndex = currentBand + 1;
+		for (size_t k = 0; k < sfBands.size(); ++k)
+		{
+			GDALRasterBand* poBand = poDstDS->GetRasterBand(++currentBand);
+			poBand->SetNoDataValue(std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN()); //should be transparent!
+			poBand->SetColorInterpretation(GCI_Undefined);
+		}
+	}
+	assert(currentBand == totalBands);
+
+	//the empty cells will be filled at the end if the global statistics are required
+	bool deferredFill = (	fillEmptyCellsStrategy == ccRasterGrid::FILL_MINIMUM_HEIGHT
+						||	fillEmptyCellsStrategy == ccRasterGrid::FILL_MAXIMUM_HEIGHT
+						||	fillEmptyCellsStrategy == ccRasterGrid::FILL_AVERAGE_HEIGHT);
+	double minHeight = 0.0;
+	double maxHeight = 0.0;
+	double sumHeight = 0.0;
+	size_t validCellCount = 0;
+
+	std::vector<double> buffer;
+	std::vector<unsigned char> cBuffer;
+	try
+	{
+		size_t tileCellCount = static_cast<size_t>(tileSize) * tileSize;
+		buffer.resize(tileCellCount);
+		if (exportBands.rgb)
+		{
+			cBuffer.resize(tileCellCount);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[GDAL] Not enough memory");
+		GDALClose(poDstDS);
+		return false;
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Tiled raster export"));
+		progressDialog->setInfo(QObject::tr("Cells: %L1 x %L2\nTiles: %L3").arg(gridWidth).arg(gridHeight).arg(tiling.tileCount()));
+		progressDialog->start();
+		QCoreApplication::processEvents();
+	}
+	CCCoreLib::NormalizedProgress nProgress(progressDialog, tiling.tileCount());
+
+	bool error = false;
+	ccRasterGrid tile;
+	for (unsigned t = 0; t < tiling.tileCount() && !error; ++t)
+	{
+		if (!tiling.fillTile(t, tile, projectionType, sfProjectionType, zStdDevSfIndex))
+		{
+			ccLog::Error("[Rasterize] Failed to compute a tile (not enough memory?)");
+			error = true;
+			break;
+		}
+
+		if (fillEmptyCellsStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT)
+		{
+			tile.fillEmptyCells(fillEmptyCellsStrategy, customHeightForEmptyCells);
+		}
+		else if (deferredFill && tile.validCellCount != 0)
+		{
+			if (validCellCount == 0)
+			{
+				minHeight = tile.minHeight;
+				maxHeight = tile.maxHeight;
+			}
+			else
+			{
+				minHeight = std::min(minHeight, tile.minHeight);
+				maxHeight = std::max(maxHeight, tile.maxHeight);
+			}
+			sumHeight += tile.meanHeight * tile.validCellCount;
+			validCellCount += tile.validCellCount;
+		}
+
+		//window in the output raster (the first row is the northest one, i.e. Ymax)
+		unsigned i0 = 0;
+		unsigned j0 = 0;
+		unsigned w = 0;
+		unsigned h = 0;
+		tiling.getTileExtents(t, i0, j0, w, h);
+		int xOff = static_cast<int>(i0);
+		int yOff = static_cast<int>(gridHeight - j0 - h);
+
+		auto writeWindow = [&](int bandIndex, void* data, GDALDataType dataType) -> bool
+		{
+			return poDstDS->GetRasterBand(bandIndex)->RasterIO(GF_Write, xOff, yOff, static_cast<int>(w), static_cast<int>(h), data, static_cast<int>(w), static_cast<int>(h), dataType, 0, 0) == CE_None;
+		};
+
+		if (exportBands.rgb)
+		{
+			for (unsigned k = 0; k < 3 && !error; ++k)
+			{
+				for (unsigned j = 0; j < h; ++j)
+				{
+					const ccRasterGrid::Row& row = tile.rows[h - 1 - j];
+					unsigned char* cLine = cBuffer.data() + static_cast<size_t>(j) * w;
+					for (unsigned i = 0; i < w; ++i)
+					{
+						cLine[i] = (std::isfinite(row[i].h) ? static_cast<unsigned char>(std::max(0.0, std::min(255.0, row[i].color.u[k]))) : 0);
+					}
+				}
+				error = !writeWindow(rgbBandIndex + static_cast<int>(k), cBuffer.data(), GDT_Byte);
+			}
+
+			if (!error && rgbaMode)
+			{
+				for (unsigned j = 0; j < h; ++j)
+				{
+					const ccRasterGrid::Row& row = tile.rows[h - 1 - j];
+					unsigned char* cLine = cBuffer.data() + static_cast<size_t>(j) * w;
+					for (unsigned i = 0; i < w; ++i)
+					{
+						cLine[i] = (std::isfinite(row[i].h) ? 255 : 0);
+					}
+				}
+				error = !writeWindow(rgbBandIndex + 3, cBuffer.data(), GDT_Byte);
+			}
+		}
+
+		if (!error && exportBands.height)
+		{
+			for (unsigned j = 0; j < h; ++j)
+			{
+				const ccRasterGrid::Row& row = tile.rows[h - 1 - j];
+				double* line = buffer.data() + static_cast<size_t>(j) * w;
+				for (unsigned i = 0; i < w; ++i)
+				{
+					line[i] = row[i].h + shiftZ; //NaN for empty cells
+				}
+			}
+			error = !writeWindow(heightBandIndex, buffer.data(), GDT_Float64);
+		}
+
+		if (!error && exportBands.density)
+		{
+			for (unsigned j = 0; j < h; ++j)
+			{
+				const ccRasterGrid::Row& row = tile.rows[h - 1 - j];
+				double* line = buffer.data() + static_cast<size_t>(j) * w;
+				for (unsigned i = 0; i < w; ++i)
+				{
+					line[i] = row[i].nbPoints;
+				}
+			}
+			error = !writeWindow(densityBandIndex, buffer.data(), GDT_Float64);
+		}
+
+		for (size_t k = 0; k < sfBands.size() && !error; ++k)
+		{
+			double sfNanValue = std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN();
+			const double* sfGrid = (sfBands[k] < tile.scalarFields.size() ? tile.scalarFields[sfBands[k]].data() : nullptr);
+			for (unsigned j = 0; j < h; ++j)
+			{
+				double* line = buffer.data() + static_cast<size_t>(j) * w;
+				const double* sfRow = (sfGrid ? sfGrid + static_cast<size_t>(h - 1 - j) * w : nullptr);
+				for (unsigned i = 0; i < w; ++i)
+				{
+					line[i] = (sfRow && std::isfinite(sfRow[i]) ? sfRow[i] : sfNanValue);
+				}
+			}
+			error = !writeWindow(firstSFBandIndex + static_cast<int>(k), buffer.data(), GDT_Float64);
+		}
+
+		if (error)
+		{
+			ccLog::Error("[GDAL] An error occurred while writing a tile!");
+		}
+		else if (!nProgress.oneStep())
+		{
+			ccLog::Warning("[Rasterize] Process cancelled by the user");
+			error = true;
+		}
+	}
+	tile.clear();
+
+	//fill the empty cells with the global statistics
+	if (!error && deferredFill && exportBands.height)
+	{
+		double emptyCellHeight = 0.0;
+		if (validCellCount != 0)
+		{
+			switch (fillEmptyCellsStrategy)
+			{
+			case ccRasterGrid::FILL_MINIMUM_HEIGHT:
+				emptyCellHeight = minHeight;
+				break;
+			case ccRasterGrid::FILL_MAXIMUM_HEIGHT:
+				emptyCellHeight = maxHeight;
+				break;
+			default:
+				emptyCellHeight = sumHeight / validCellCount;
+				break;
+			}
+		}
+		emptyCellHeight += shiftZ;
+
+		GDALRasterBand* poBand = poDstDS->GetRasterBand(heightBandIndex);
+		for (unsigned t = 0; t < tiling.tileCount() && !error; ++t)
+		{
+			unsigned i0 = 0;
+			unsigned j0 = 0;
+			unsigned w = 0;
+			unsigned h = 0;
+			tiling.getTileExtents(t, i0, j0, w, h);
+			int xOff = static_cast<int>(i0);
+			int yOff = static_cast<int>(gridHeight - j0 - h);
+
+			if (poBand->RasterIO(GF_Read, xOff, yOff, static_cast<int>(w), static_cast<int>(h), buffer.data(), static_cast<int>(w), static_cast<int>(h), GDT_Float64, 0, 0) != CE_None)
+			{
+				error = true;
+				break;
+			}
+			size_t cellCount = static_cast<size_t>(w) * h;
+			for (size_t n = 0; n < cellCount; ++n)
+			{
+				if (!std::isfinite(buffer[n]))
+				{
+					buffer[n] = emptyCellHeight;
+				}
+			}
+			error = (poBand->RasterIO(GF_Write, xOff, yOff, static_cast<int>(w), static_cast<int>(h), buffer.data(), static_cast<int>(w), static_cast<int>(h), GDT_Float64, 0, 0) != CE_None);
+		}
+
+		if (error)
+		{
+			ccLog::Error("[GDAL] An error occurred while filling the empty cells!");
+		}
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->stop();
+	}
+
+	if (error || !tiledParams.cog)
+	{
+		GDALClose(poDstDS);
+		if (error)
+		{
+			QFile::remove(tiledFilename);
+			return false;
+		}
+
+		ccLog::Print(QString("[Rasterize] Raster '%1' successfully saved").arg(outputFilename));
+		return true;
+	}
+
+	//convert the tiled file to a Cloud Optimized GeoTIFF (the overviews are computed with all threads)
+	GDALDataset* poCogDS = nullptr;
+	GDALDriver* poCogDriver = GetGDALDriverManager()->GetDriverByName("COG");
+	if (poCogDriver)
+	{
+		papszOptions = CSLSetNameValue(papszOptions, "BLOCKSIZE", qPrintable(QString::number(tileSize)));
+		papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "DEFLATE");
+		papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+		papszOptions = CSLSetNameValue(papszOptions, "NUM_THREADS", "ALL_CPUS");
+		papszOptions = CSLSetNameValue(papszOptions, "OVERVIEW_RESAMPLING", "AVERAGE");
+		poCogDS = poCogDriver->CreateCopy(qUtf8Printable(outputFilename), poDstDS, FALSE, papszOptions, nullptr, nullptr);
+	}
+	else
+	{
+		//older GDAL versions: internal overviews + COPY_SRC_OVERVIEWS
+		std::vector<int> overviewLevels;
+		for (unsigned level = 2; std::max(gridWidth, gridHeight) / (level / 2) > tileSize; level *= 2)
+		{
+			overviewLevels.push_back(static_cast<int>(level));
+		}
+
+		CPLSetConfigOption("GDAL_NUM_THREADS", "ALL_CPUS");
+		if (!overviewLevels.empty() && poDstDS->BuildOverviews("AVERAGE", static_cast<int>(overviewLevels.size()), overviewLevels.data(), 0, nullptr, nullptr, nullptr) != CE_None)
+		{
+			ccLog::Warning("[GDAL] Failed to build the overviews");
+		}
+		CPLSetConfigOption("GDAL_NUM_THREADS", nullptr);
+
+		papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+		papszOptions = CSLSetNameValue(papszOptions, "BLOCKXSIZE", qPrintable(QString::number(tileSize)));
+		papszOptions = CSLSetNameValue(papszOptions, "BLOCKYSIZE", qPrintable(QString::number(tileSize)));
+		papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", "DEFLATE");
+		papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+		papszOptions = CSLSetNameValue(papszOptions, "COPY_SRC_OVERVIEWS", "YES");
+		poCogDS = poDriver->CreateCopy(qUtf8Printable(outputFilename), poDstDS, FALSE, papszOptions, nullptr, nullptr);
+	}
+	CSLDestroy(papszOptions);
+
+	GDALClose(poDstDS);
+	QFile::remove(tiledFilename);
+
+	if (!poCogDS)
+	{
+		ccLog::Error("[GDAL] Failed to create the Cloud Optimized GeoTIFF file");
+		return false;
+	}
+	GDALClose(poCogDS);
+
+	ccLog::Print(QString("[Rasterize] Raster '%1' successfully saved (Cloud Optimized GeoTIFF)").arg(outputFilename));
+	return true;
+
+#else
+	assert(false);
+	ccLog::Error("[Rasterize] GDAL not supported by this version! Can't generate a raster...");
+	return false;
+#endif
+}
+
 //See http://edndoc.esri.com/arcobjects/9.2/net/shared/geoprocessing/spatial_analyst_tools/how_hillshade_works.htm
 void ccRasterizeTool::generateHillshade()
 {
@@ -68,6 +68,34 @@ public: //raster export
 								ccGenericPointCloud* originCloud = nullptr,
 								int visibleSfIndex = -1);
 
+	//! Tiled export parameters
+	struct TiledExportParams
+	{
+		unsigned tileSize = 512;	//!< Tile size (in cells, should be a multiple of 16)
+		bool cog = true;			//!< Whether to produce a Cloud Optimized GeoTIFF (with overviews) or a simple tiled GeoTIFF
+	};
+
+	//! Rasterizes a cloud and exports the result as a tiled geotiff file (Cloud Optimized or not)
+	/** Contrarily to ExportGeoTiff, the full grid is never held in memory: it is computed and
+		written tile by tile (see ccRasterGridTiling). Overviews are computed by GDAL afterwards,
+		with all the available threads.
+		\warning Interpolation of the empty cells (Delaunay, Kriging) is not supported in this mode.
+	**/
+	static bool ExportTiledGeoTiff(	const QString& outputFilename,
+									const ExportBands& exportBands,
+									ccPointCloud* cloud,
+									const ccBBox& gridBBox,
+									double gridStep,
+									unsigned char Z,
+									ccRasterGrid::ProjectionType projectionType,
+									ccRasterGrid::ProjectionType sfProjectionType,
+									ccRasterGrid::EmptyCellFillOption fillEmptyCellsStrategy,
+									double customHeightForEmptyCells,
+									const TiledExportParams& tiledParams,
+									int zStdDevSfIndex = -1,
+									int visibleSfIndex = -1,
+									ccProgressDialog* progressDialog = nullptr);
+
 private:
 
 	//! Exports the grid as a cloud
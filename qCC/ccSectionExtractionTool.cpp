@@ -1258,6 +1258,7 @@ void ccSectionExtractionTool::exportSections()
 	MainWindow* mainWin = MainWindow::TheInstance();
 
 	//export entites
+	mainWin->beginDBBatch();
 	for (auto & section : m_sections)
 	{
 		if (section.entity && !section.isInDB)
@@ -1270,6 +1271,7 @@ void ccSectionExtractionTool::exportSections()
 			mainWin->addToDB(section.entity, false, false);
 		}
 	}
+	mainWin->endDBBatch();
 
 	ccLog::Print(QString("[ccSectionExtractionTool] %1 sections exported").arg(exportCount));
 
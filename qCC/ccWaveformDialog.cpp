@@ -145,8 +145,10 @@ void ccWaveWidget::init(ccPointCloud* cloud, unsigned pointIndex, bool logScale,
 		return;
 	}
 
+	std::vector<float> samples;
 	try
 	{
+		samples.resize(w.numberOfSamples(), 0);
 		m_curveValues.resize(w.numberOfSamples(), 0);
 	}
 	catch (const std::bad_alloc&)
@@ -155,10 +157,11 @@ void ccWaveWidget::init(ccPointCloud* cloud, unsigned pointIndex, bool logScale,
 		ccLog::Error("Not enough memory");
 		return;
 	}
+	w.decodeSamples(samples.data());
 
 	for (uint32_t i = 0; i < w.numberOfSamples(); ++i)
 	{
-		double c = w.getSample(i);
+		double c = samples[i];
 		if (logScale)
 		{
 			c = AbsLog(c);
@@ -61,6 +61,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <unordered_map>
 
 //Minimum width of the left column of the properties tree view
 static const int c_propViewLeftColumnWidth = 115;
@@ -88,6 +89,33 @@ static bool CanDetachCloud(const ccHObject* obj)
 	return !blocked;
 }
 
+//Removes the duplicates and the objects that are descendants of other objects of the set
+static void RemoveNestedObjects(ccHObject::Container& objects)
+{
+	std::unordered_set<const ccHObject*> objectSet(objects.begin(), objects.end());
+	std::unordered_set<const ccHObject*> keptObjects;
+
+	size_t keptCount = 0;
+	for (ccHObject* object : objects)
+	{
+		bool isNested = false;
+		for (const ccHObject* parent = object->getParent(); parent; parent = parent->getParent())
+		{
+			if (objectSet.count(parent))
+			{
+				isNested = true;
+				break;
+			}
+		}
+
+		if (!isNested && keptObjects.insert(object).second)
+		{
+			objects[keptCount++] = object;
+		}
+	}
+	objects.resize(keptCount);
+}
+
 class DBRootIcons
 {
 public:
@@ -240,7 +268,10 @@ private:
 Q_GLOBAL_STATIC( DBRootIcons, gDBRootIcons )
 
 
-ccDBRoot::ccDBRoot(ccCustomQTreeView* dbTreeWidget, QTreeView* propertiesTreeWidget, QObject* parent) : QAbstractItemModel(parent)
+ccDBRoot::ccDBRoot(ccCustomQTreeView* dbTreeWidget, QTreeView* propertiesTreeWidget, QObject* parent)
+	: QAbstractItemModel(parent)
+	, m_batchDepth(0)
+	, m_pendingPropertiesUpdate(false)
 {
 	m_treeRoot = new ccHObject("DB Tree");
 
@@ -336,16 +367,22 @@ void ccDBRoot::unloadAll()
 		return;
 	}
 
-	while (m_treeRoot->getChildrenNumber() > 0)
-	{
-		int i = static_cast<int>(m_treeRoot->getChildrenNumber()) - 1;
-		ccHObject* object = m_treeRoot->getChild(i);
-		assert(object);
+	flushPendingInsertions();
 
-		object->prepareDisplayForRefresh_recursive();
+	int childCount = static_cast<int>(m_treeRoot->getChildrenNumber());
+	if (childCount > 0)
+	{
+		for (int i = 0; i < childCount; ++i)
+		{
+			m_treeRoot->getChild(i)->prepareDisplayForRefresh_recursive();
+		}
 
-		beginRemoveRows(index(object).parent(), i, i);
-		m_treeRoot->removeChild(i);
+		//single row removal operation
+		beginRemoveRows(QModelIndex(), 0, childCount - 1);
+		for (int i = childCount - 1; i >= 0; --i)
+		{
+			m_treeRoot->removeChild(i);
+		}
 		endRemoveRows();
 	}
 
@@ -396,6 +433,13 @@ void ccDBRoot::addElement(ccHObject* object, bool autoExpand/*=true*/)
 		//	return;
 	}
 
+	if (m_batchDepth > 0)
+	{
+		//the tree view will be notified at the end of the batch
+		m_pendingInsertions.emplace_back(object, autoExpand);
+		return;
+	}
+
 	//look for insert node index in tree
 	QModelIndex insertNodeIndex = index(parentObject);
 	int childPos = parentObject->getChildIndex(object);
@@ -434,6 +478,221 @@ void ccDBRoot::expandElement(ccHObject* object, bool state)
 	m_dbTreeWidget->setExpanded(index(object), state);
 }
 
+void ccDBRoot::beginBatch()
+{
+	++m_batchDepth;
+}
+
+void ccDBRoot::endBatch()
+{
+	if (m_batchDepth <= 0)
+	{
+		assert(false);
+		return;
+	}
+	if (--m_batchDepth > 0)
+	{
+		//nested batch
+		return;
+	}
+
+	flushPendingInsertions();
+
+	//postponed updates of the elements
+	if (!m_pendingUpdates.empty())
+	{
+		//single traversal of the tree
+		std::vector<ccHObject*> toVisit{ m_treeRoot };
+		while (!toVisit.empty() && !m_pendingUpdates.empty())
+		{
+			ccHObject* parent = toVisit.back();
+			toVisit.pop_back();
+
+			for (unsigned i = 0; i < parent->getChildrenNumber(); ++i)
+			{
+				ccHObject* child = parent->getChild(i);
+				if (m_pendingUpdates.erase(child->getUniqueID()))
+				{
+					QModelIndex idx = createIndex(static_cast<int>(i), 0, child);
+					Q_EMIT dataChanged(idx, idx);
+				}
+				if (child->getChildrenNumber() != 0)
+				{
+					toVisit.push_back(child);
+				}
+			}
+		}
+		//the remaining elements are not in the tree anymore
+		m_pendingUpdates.clear();
+	}
+
+	if (m_pendingPropertiesUpdate)
+	{
+		m_pendingPropertiesUpdate = false;
+		updatePropertiesView();
+	}
+}
+
+void ccDBRoot::flushPendingInsertions()
+{
+	if (m_pendingInsertions.empty())
+	{
+		return;
+	}
+
+	std::vector< std::pair<ccHObject*, bool> > pendingInsertions;
+	std::swap(pendingInsertions, m_pendingInsertions);
+
+	ccHObject::Container objects;
+	objects.reserve(pendingInsertions.size());
+	std::unordered_set<const ccHObject*> autoExpandedObjects;
+	for (const auto& insertion : pendingInsertions)
+	{
+		objects.push_back(insertion.first);
+		if (insertion.second)
+		{
+			autoExpandedObjects.insert(insertion.first);
+		}
+	}
+
+	//the descendants of other added objects are inserted with them
+	RemoveNestedObjects(objects);
+
+	//group the objects by parent (in order of appearance)
+	std::vector<ccHObject*> parents;
+	std::unordered_map<ccHObject*, std::unordered_set<const ccHObject*>> objectsByParent;
+	for (ccHObject* object : objects)
+	{
+		ccHObject* parent = object->getParent();
+		if (!parent)
+		{
+			//the object has been detached in the meantime
+			continue;
+		}
+		auto it = objectsByParent.find(parent);
+		if (it == objectsByParent.end())
+		{
+			parents.push_back(parent);
+			it = objectsByParent.emplace(parent, std::unordered_set<const ccHObject*>()).first;
+		}
+		it->second.insert(object);
+	}
+
+	size_t rootInsertionCount = (objectsByParent.count(m_treeRoot) ? objectsByParent[m_treeRoot].size() : 0);
+	bool wasEmpty = (rootInsertionCount != 0 && rootInsertionCount == m_treeRoot->getChildrenNumber());
+
+	for (ccHObject* parent : parents)
+	{
+		const std::unordered_set<const ccHObject*>& children = objectsByParent[parent];
+		QModelIndex parentIndex = index(parent);
+
+		//look for the ranges of consecutive inserted children
+		std::vector<int> positions;
+		positions.reserve(children.size());
+		int childCount = static_cast<int>(parent->getChildrenNumber());
+		for (int i = 0; i < childCount; ++i)
+		{
+			if (children.count(parent->getChild(i)))
+			{
+				positions.push_back(i);
+			}
+		}
+
+		for (size_t i = 0; i < positions.size(); )
+		{
+			size_t j = i + 1;
+			while (j < positions.size() && positions[j] == positions[j - 1] + 1)
+			{
+				++j;
+			}
+
+			//single row insertion operation
+			beginInsertRows(parentIndex, positions[i], positions[j - 1]);
+			endInsertRows();
+
+			i = j;
+		}
+
+		//expand the parent (just in case)
+		m_dbTreeWidget->expand(parentIndex);
+		//and the children
+		if (!autoExpandedObjects.empty())
+		{
+			for (int pos : positions)
+			{
+				ccHObject* child = parent->getChild(pos);
+				if (autoExpandedObjects.count(child))
+				{
+					m_dbTreeWidget->expand(createIndex(pos, 0, child));
+				}
+			}
+		}
+	}
+
+	if (wasEmpty)
+	{
+		Q_EMIT dbIsNotEmptyAnymore();
+	}
+}
+
+void ccDBRoot::removeChildren(const ccHObject::Container& objects)
+{
+	//group the objects by parent (in order of appearance)
+	std::vector<ccHObject*> parents;
+	std::unordered_map<ccHObject*, std::unordered_set<const ccHObject*>> objectsByParent;
+	for (ccHObject* object : objects)
+	{
+		ccHObject* parent = object->getParent();
+		assert(parent);
+		auto it = objectsByParent.find(parent);
+		if (it == objectsByParent.end())
+		{
+			parents.push_back(parent);
+			it = objectsByParent.emplace(parent, std::unordered_set<const ccHObject*>()).first;
+		}
+		it->second.insert(object);
+	}
+
+	for (ccHObject* parent : parents)
+	{
+		const std::unordered_set<const ccHObject*>& children = objectsByParent[parent];
+
+		//look for the ranges of consecutive removed children
+		std::vector<int> positions;
+		positions.reserve(children.size());
+		int childCount = static_cast<int>(parent->getChildrenNumber());
+		for (int i = 0; i < childCount; ++i)
+		{
+			if (children.count(parent->getChild(i)))
+			{
+				positions.push_back(i);
+			}
+		}
+
+		QModelIndex parentIndex = index(parent);
+
+		//we start by the last ones, so that the positions of the others remain valid
+		for (size_t j = positions.size(); j > 0; )
+		{
+			size_t i = j - 1;
+			while (i > 0 && positions[i - 1] == positions[i] - 1)
+			{
+				--i;
+			}
+
+			//single row removal operation
+			beginRemoveRows(parentIndex, positions[i], positions[j - 1]);
+			for (size_t k = j; k > i; --k)
+			{
+				parent->removeChild(positions[k - 1]);
+			}
+			endRemoveRows();
+
+			j = i;
+		}
+	}
+}
+
 void ccDBRoot::removeElements(ccHObject::Container& objects)
 {
 	if (objects.empty())
@@ -445,11 +704,15 @@ void ccDBRoot::removeElements(ccHObject::Container& objects)
 	//we hide properties view in case this is the deleted object that is currently selected
 	hidePropertiesView();
 
+	//the elements added during the current batch must be known by the tree view before being removed
+	flushPendingInsertions();
+
 	//every object in tree must have a parent!
+	ccHObject::Container validObjects;
+	validObjects.reserve(objects.size());
 	for (ccHObject* object : objects)
 	{
-		ccHObject* parent = object->getParent();
-		if (!parent)
+		if (!object->getParent())
 		{
 			ccLog::Warning(QString("[ccDBRoot::removeElements] Internal error: object '%1' has no parent").arg(object->getName()));
 			continue;
@@ -458,18 +721,14 @@ void ccDBRoot::removeElements(ccHObject::Container& objects)
 		//just in case
 		object->prepareDisplayForRefresh();
 
-		int childPos = parent->getChildIndex(object);
-		assert(childPos >= 0);
-		{
-			//row removal operation (start)
-			beginRemoveRows(index(parent), childPos, childPos);
+		validObjects.push_back(object);
+	}
+	objects.clear();
 
-			parent->removeChild(childPos);
+	//the descendants of other objects will be removed with them
+	RemoveNestedObjects(validObjects);
 
-			//row removal operation (end)
-			endRemoveRows();
-		}
-	}
+	removeChildren(validObjects);
 
 	//we restore properties view
 	updatePropertiesView();
@@ -499,6 +758,9 @@ void ccDBRoot::removeElement(ccHObject* object)
 		return;
 	}
 
+	//the elements added during the current batch must be known by the tree view before being removed
+	flushPendingInsertions();
+
 	//just in case
 	object->prepareDisplayForRefresh();
 
@@ -536,13 +798,25 @@ void ccDBRoot::deleteSelectedEntities()
 	hidePropertiesView();
 	bool verticesWarningIssued = false;
 
+	//the elements added during the current batch must be known by the tree view before being removed
+	flushPendingInsertions();
+
+	ccHObject::Container selectedObjects;
+	selectedObjects.reserve(selCount);
+	for (unsigned i = 0; i < selCount; ++i)
+	{
+		selectedObjects.push_back(static_cast<ccHObject*>(selectedIndexes[i].internalPointer()));
+	}
+
 	//we remove all objects that are children of other deleted ones!
 	//(otherwise we may delete the parent before the child!)
 	//TODO DGM: not sure this is still necessary with the new dependency mechanism
-	std::vector<ccHObject*> toBeDeleted;
-	for (unsigned i = 0; i < selCount; ++i)
+	RemoveNestedObjects(selectedObjects);
+
+	ccHObject::Container toBeDeleted;
+	toBeDeleted.reserve(selectedObjects.size());
+	for (ccHObject* obj : selectedObjects)
 	{
-		ccHObject* obj = static_cast<ccHObject*>(selectedIndexes[i].internalPointer());
 		//we don't take care of parent-less objects (i.e. the tree root)
 		if (!obj->getParent() || obj->isLocked())
 		{
@@ -550,46 +824,25 @@ void ccDBRoot::deleteSelectedEntities()
 			continue;
 		}
 
-		//we don't consider objects that are 'descendent' of others in the selection
-		bool isDescendent = false;
-		for (unsigned j = 0; j < selCount; ++j)
+		//last check: mesh vertices
+		if (obj->isKindOf(CC_TYPES::POINT_CLOUD) && !CanDetachCloud(obj))
 		{
-			if (i != j)
+			if (!verticesWarningIssued)
 			{
-				ccHObject* otherObj = static_cast<ccHObject*>(selectedIndexes[j].internalPointer());
-				if (otherObj->isAncestorOf(obj))
-				{
-					isDescendent = true;
-					break;
-				}
+				ccLog::Warning("Vertices can't be deleted without their parent mesh");
+				verticesWarningIssued = true;
 			}
+			continue;
 		}
 
-		if (!isDescendent)
-		{
-			//last check: mesh vertices
-			if (obj->isKindOf(CC_TYPES::POINT_CLOUD) && !CanDetachCloud(obj))
-			{
-				if (!verticesWarningIssued)
-				{
-					ccLog::Warning("Vertices can't be deleted without their parent mesh");
-					verticesWarningIssued = true;
-				}
-				continue;
-			}
-
-			toBeDeleted.push_back(obj);
-		}
+		toBeDeleted.push_back(obj);
 	}
 
 	qism->clear();
 
-	while (!toBeDeleted.empty())
+	for (ccHObject* object : toBeDeleted)
 	{
-		ccHObject* object = toBeDeleted.back();
 		assert(object);
-		toBeDeleted.pop_back();
-
 		object->prepareDisplayForRefresh_recursive();
 
 		if (object->isKindOf(CC_TYPES::MESH))
@@ -601,16 +854,10 @@ void ccDBRoot::deleteSelectedEntities()
 				object->getParent()->setVisible(true);
 			}
 		}
-
-		ccHObject* parent = object->getParent();
-		int childPos = parent->getChildIndex(object);
-		assert(childPos >= 0);
-
-		beginRemoveRows(index(object).parent(), childPos, childPos);
-		parent->removeChild(childPos);
-		endRemoveRows();
 	}
 
+	removeChildren(toBeDeleted);
+
 	updatePropertiesView();
 
 	if (m_treeRoot->getChildrenNumber() == 0)
@@ -920,6 +1167,9 @@ void ccDBRoot::selectEntity(ccHObject* obj, bool forceAdditiveSelection/*=false*
 {
 	bool additiveSelection = forceAdditiveSelection || (QApplication::keyboardModifiers() & Qt::ControlModifier);
 
+	//the elements added during the current batch must be known by the tree view before being selected
+	flushPendingInsertions();
+
 	QItemSelectionModel* selectionModel = m_dbTreeWidget->selectionModel();
 	assert(selectionModel);
 
@@ -1001,6 +1251,9 @@ void ccDBRoot::selectEntities(std::unordered_set<int> entIDs)
 
 void ccDBRoot::selectEntities(const ccHObject::Container& entities, bool incremental/*=false*/)
 {
+	//the elements added during the current batch must be known by the tree view before being selected
+	flushPendingInsertions();
+
 	//selection model
 	QItemSelectionModel* selectionModel = m_dbTreeWidget->selectionModel();
 	assert(selectionModel);
@@ -1051,7 +1304,8 @@ void ccDBRoot::selectEntities(const ccHObject::Container& entities, bool increme
 			
 			if (selectedIndex.isValid())
 			{
-				newSelection.merge(QItemSelection(selectedIndex,selectedIndex),QItemSelectionModel::Select);
+				//'merge' is quadratic with the number of entities (and they are distinct anyway)
+				newSelection.select(selectedIndex, selectedIndex);
 			}
 		}
 	}
@@ -1093,6 +1347,13 @@ void ccDBRoot::reflectObjectPropChange(ccHObject* obj)
 
 void ccDBRoot::updatePropertiesView()
 {
+	if (m_batchDepth > 0)
+	{
+		//postponed until the end of the batch
+		m_pendingPropertiesUpdate = true;
+		return;
+	}
+
 	assert(m_dbTreeWidget);
 	QItemSelectionModel* qism = m_dbTreeWidget->selectionModel();
 	QModelIndexList selectedIndexes = qism->selectedIndexes();
@@ -1115,6 +1376,13 @@ void ccDBRoot::updateCCObject(ccHObject* object)
 {
 	assert(object);
 
+	if (m_batchDepth > 0)
+	{
+		//postponed until the end of the batch
+		m_pendingUpdates.insert(object->getUniqueID());
+		return;
+	}
+
 	QModelIndex idx = index(object);
 
 	if (idx.isValid())
@@ -28,6 +28,8 @@
 
 //System
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 class QAction;
 class QStandardItemModel;
@@ -108,12 +110,32 @@ public:
 	void removeElement(ccHObject* object);
 
 	//! Removes several elements at once from the DB tree
-	/** Faster than multiple calls to removeElement.
+	/** Faster than multiple calls to removeElement (the tree view is only
+		notified once per range of consecutive children). The elements that
+		are descendants of other elements of the set are removed with them.
 		Automatically calls prepareDisplayForRefresh on the objects.
 		\warning The input container will be cleared.
 	**/
 	void removeElements(ccHObject::Container& objects);
 
+	//! Starts a batch of modifications of the DB tree
+	/** Until the batch is ended (see endBatch):
+		- the elements added with addElement are inserted in the tree view all
+		at once (with one notification per range of consecutive children)
+		- the updates of the elements (see updateCCObject) and of the properties
+		view are postponed
+		Batches can be nested (only the outermost one is effective).
+		\warning The elements added during a batch must not be deleted (or detached
+		from their parent) otherwise than with removeElement(s) before the batch ends.
+	**/
+	void beginBatch();
+
+	//! Ends a batch of modifications of the DB tree (see beginBatch)
+	void endBatch();
+
+	//! Returns whether a batch of modifications is in progress
+	inline bool isInBatch() const { return m_batchDepth > 0; }
+
 	//! Finds an element in DB
 	ccHObject* find(int uniqueID) const;
 
@@ -238,6 +260,14 @@ protected:
 	//! Expands or collapses hovered item
 	void expandOrCollapseHoveredBranch(bool expand);
 
+	//! Notifies the insertion of the elements added during the current batch
+	void flushPendingInsertions();
+
+	//! Removes several elements (none of them being a descendant of another one)
+	/** The tree view is notified once per range of consecutive children.
+	**/
+	void removeChildren(const ccHObject::Container& objects);
+
 	//! Selects objects by type and/or name
     void selectChildrenByTypeAndName(CC_CLASS_ENUM type,
                                      bool typeIsExclusive = true,
@@ -301,6 +331,15 @@ protected:
 
 	//! Last context menu pos
 	QPoint m_contextMenuPos;
+
+	//! Depth of the current batch of modifications (0 if none)
+	int m_batchDepth;
+	//! Elements added during the current batch (and whether they should be expanded)
+	std::vector< std::pair<ccHObject*, bool> > m_pendingInsertions;
+	//! Unique IDs of the elements updated during the current batch
+	std::unordered_set<unsigned> m_pendingUpdates;
+	//! Whether the properties view should be updated at the end of the current batch
+	bool m_pendingPropertiesUpdate;
 };
 
 #endif
@@ -619,8 +619,13 @@ void ccPropertiesTreeDelegate::fillWithPointCloud(ccGenericPointCloud* _obj)
 			appendRow(ITEM( tr( "Waves" ) ), ITEM(QString::number(cloud->waveforms().size()))); //DGM: in fact some of them might be null/invalid!
 			appendRow(ITEM( tr("Descriptors" ) ), ITEM(QString::number(cloud->fwfDescriptors().size())));
 
-			double dataSize_mb = (cloud->fwfData() ? cloud->fwfData()->size() : 0) / static_cast<double>(1 << 20);
+			double dataSize_mb = cloud->fwfDataSize() / static_cast<double>(1 << 20);
 			appendRow(ITEM( tr( "Data size" ) ), ITEM(QStringLiteral("%1 Mb").arg(dataSize_mb, 0, 'f', 2)));
+			if (cloud->fwfDataIsPaged())
+			{
+				double cacheSize_mb = cloud->fwfPager()->cachedBytes() / static_cast<double>(1 << 20);
+				appendRow(ITEM( tr( "Data paged (cache)" ) ), ITEM(QStringLiteral("%1 Mb").arg(cacheSize_mb, 0, 'f', 2)));
+			}
 		}
 
 		//normals
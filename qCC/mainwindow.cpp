@@ -635,6 +635,7 @@ void MainWindow::connectActions()
 	//"Edit > Waveform" menu
 	connect(m_UI->actionShowWaveDialog,				&QAction::triggered, this, &MainWindow::doActionShowWaveDialog);
 	connect(m_UI->actionCompressFWFData,			&QAction::triggered, this, &MainWindow::doActionCompressFWFData);
+	connect(m_UI->actionComputeFWFFeatures,			&QAction::triggered, this, &MainWindow::doActionComputeFWFFeatures);
 	//"Edit" menu
 	connect(m_UI->actionClone,						&QAction::triggered, this, &MainWindow::doActionClone);
 	connect(m_UI->actionMerge,						&QAction::triggered, this, &MainWindow::doActionMerge);
@@ -4305,6 +4306,8 @@ void MainWindow::createComponentsClouds(ccGenericPointCloud* cloud,
 
 		//we create a new group to store all CCs
 		ccHObject* ccGroup = new ccHObject(cloud->getName() + QString(" [CCs]"));
+		//the components are selected all at once (once added to the DB)
+		ccHObject::Container toBeSelected;
 
 		//for each component
 		for (size_t i = 0; i < components.size(); ++i)
@@ -4338,8 +4341,8 @@ void MainWindow::createComponentsClouds(ccGenericPointCloud* cloud,
 					//we add new CC to group
 					ccGroup->addChild(compCloud);
 
-					if (selectComponents && m_ccRoot)
-						m_ccRoot->selectEntity(compCloud, true);
+					if (selectComponents)
+						toBeSelected.push_back(compCloud);
 				}
 				else
 				{
@@ -4364,6 +4367,9 @@ void MainWindow::createComponentsClouds(ccGenericPointCloud* cloud,
 			ccGroup->setDisplay(cloud->getDisplay());
 			addToDB(ccGroup);
 
+			if (!toBeSelected.empty() && m_ccRoot)
+				m_ccRoot->selectEntities(toBeSelected, true);
+
 			ccConsole::Print(tr("[CreateComponentsClouds] %1 component(s) were created from cloud '%2'").arg(ccGroup->getChildrenNumber()).arg(cloud->getName()));
 		}
 
@@ -10059,16 +10065,28 @@ void MainWindow::createPointCloudFromClipboard()
 		}
 	}
 
+	// the global shift dialog is modal: it must be handled before the
+	// DB tree insertions are deferred
+	for (ccHObject* cloud : clouds)
+	{
+		if (cloud)
+		{
+			checkEntityDimensions(cloud);
+		}
+	}
+
 	// eventually, we can add the clouds to the DB tree
+	beginDBBatch();
 	for (size_t i = 0; i < clouds.size(); ++i)
 	{
 		ccHObject* cloud = clouds[i];
 		if (cloud)
 		{
 			bool lastCloud = (i + 1 == clouds.size());
-			addToDB(cloud, lastCloud, lastCloud, true, lastCloud);
+			addToDB(cloud, lastCloud, lastCloud, false, lastCloud);
 		}
 	}
+	endDBBatch();
 
 	QMainWindow::statusBar()->showMessage(tr("%1 cloud(s) loaded from the clipboard").arg(clouds.size()), 2000);
 }
@@ -10176,6 +10194,18 @@ void MainWindow::removeFromDB(ccHObject* obj, bool autoDelete/*=true*/)
 		m_ccRoot->removeElement(obj);
 }
 
+void MainWindow::beginDBBatch()
+{
+	if (m_ccRoot)
+		m_ccRoot->beginBatch();
+}
+
+void MainWindow::endDBBatch()
+{
+	if (m_ccRoot)
+		m_ccRoot->endBatch();
+}
+
 void MainWindow::setSelectedInDB(ccHObject* obj, bool selected)
 {
 	if (obj && m_ccRoot)
@@ -10187,74 +10217,80 @@ void MainWindow::setSelectedInDB(ccHObject* obj, bool selected)
 	}
 }
 
+void MainWindow::checkEntityDimensions(ccHObject* obj)
+{
+	//let's check that the new entity is not too big nor too far from scene center!
+
+	//get entity bounding box
+	ccBBox bBox = obj->getBB_recursive();
+
+	CCVector3 center = bBox.getCenter();
+	PointCoordinateType diag = bBox.getDiagNorm();
+
+	CCVector3d P = center;
+	CCVector3d Pshift(0, 0, 0);
+	double scale = 1.0;
+	bool preserveCoordinateShift = true;
+	//here we must test that coordinates are not too big whatever the case because OpenGL
+	//really doesn't like big ones (even if we work with GLdoubles :( ).
+	if (ccGlobalShiftManager::Handle(	P,
+										diag,
+										ccGlobalShiftManager::DIALOG_IF_NECESSARY,
+										false,
+										Pshift,
+										&preserveCoordinateShift,
+										&scale)
+		)
+	{
+		bool needRescale = (scale != 1.0);
+		bool needShift = (Pshift.norm2() > 0);
+
+		if (needRescale || needShift)
+		{
+			ccGLMatrix mat;
+			mat.toIdentity();
+			mat.data()[0] = mat.data()[5] = mat.data()[10] = static_cast<float>(scale);
+			mat.setTranslation(Pshift);
+			obj->applyGLTransformation_recursive(&mat);
+			ccConsole::Warning(tr("Entity '%1' has been translated: (%2,%3,%4) and rescaled of a factor %5 [original position will be restored when saving]").arg(obj->getName()).arg(Pshift.x,0,'f',2).arg(Pshift.y,0,'f',2).arg(Pshift.z,0,'f',2).arg(scale,0,'f',6));
+		}
+
+		//update 'global shift' and 'global scale' for ALL clouds recursively
+		if (preserveCoordinateShift)
+		{
+			//FIXME: why don't we do that all the time by the way?!
+			ccHObject::Container children;
+			children.push_back(obj);
+			while (!children.empty())
+			{
+				ccHObject* child = children.back();
+				children.pop_back();
+
+				if (child->isKindOf(CC_TYPES::POINT_CLOUD))
+				{
+					ccGenericPointCloud* pc = ccHObjectCaster::ToGenericPointCloud(child);
+					pc->setGlobalShift(pc->getGlobalShift() + Pshift);
+					pc->setGlobalScale(pc->getGlobalScale() * scale);
+				}
+
+				for (unsigned i = 0; i < child->getChildrenNumber(); ++i)
+				{
+					children.push_back(child->getChild(i));
+				}
+			}
+		}
+	}
+}
+
 void MainWindow::addToDB(	ccHObject* obj,
 							bool updateZoom/*=true*/,
 							bool autoExpandDBTree/*=true*/,
 							bool checkDimensions/*=true*/,
 							bool autoRedraw/*=true*/)
 {
-	//let's check that the new entity is not too big nor too far from scene center!
 	if (checkDimensions)
 	{
-		//get entity bounding box
-		ccBBox bBox = obj->getBB_recursive();
-
-		CCVector3 center = bBox.getCenter();
-		PointCoordinateType diag = bBox.getDiagNorm();
-
-		CCVector3d P = center;
-		CCVector3d Pshift(0, 0, 0);
-		double scale = 1.0;
-		bool preserveCoordinateShift = true;
-		//here we must test that coordinates are not too big whatever the case because OpenGL
-		//really doesn't like big ones (even if we work with GLdoubles :( ).
-		if (ccGlobalShiftManager::Handle(	P,
-											diag,
-											ccGlobalShiftManager::DIALOG_IF_NECESSARY,
-											false,
-											Pshift,
-											&preserveCoordinateShift,
-											&scale)
-			)
-		{
-			bool needRescale = (scale != 1.0);
-			bool needShift = (Pshift.norm2() > 0);
-
-			if (needRescale || needShift)
-			{
-				ccGLMatrix mat;
-				mat.toIdentity();
-				mat.data()[0] = mat.data()[5] = mat.data()[10] = static_cast<float>(scale);
-				mat.setTranslation(Pshift);
-				obj->applyGLTransformation_recursive(&mat);
-				ccConsole::Warning(tr("Entity '%1' has been translated: (%2,%3,%4) and rescaled of a factor %5 [original position will be restored when saving]").arg(obj->getName()).arg(Pshift.x,0,'f',2).arg(Pshift.y,0,'f',2).arg(Pshift.z,0,'f',2).arg(scale,0,'f',6));
-			}
-
-			//update 'global shift' and 'global scale' for ALL clouds recursively
-			if (preserveCoordinateShift)
-			{
-				//FIXME: why don't we do that all the time by the way?!
-				ccHObject::Container children;
-				children.push_back(obj);
-				while (!children.empty())
-				{
-					ccHObject* child = children.back();
-					children.pop_back();
-
-					if (child->isKindOf(CC_TYPES::POINT_CLOUD))
-					{
-						ccGenericPointCloud* pc = ccHObjectCaster::ToGenericPointCloud(child);
-						pc->setGlobalShift(pc->getGlobalShift() + Pshift);
-						pc->setGlobalScale(pc->getGlobalScale() * scale);
-					}
-
-					for (unsigned i = 0; i < child->getChildrenNumber(); ++i)
-					{
-						children.push_back(child->getChild(i));
-					}
-				}
-			}
-		}
+		checkEntityDimensions(obj);
 	}
 
 	//add object to DB root
@@ -11351,6 +11387,7 @@ void MainWindow::enableUIItems(dbTreeSelectionInfo& selInfo)
 	m_UI->actionSetSFsAsNormal->setEnabled(exactlyOneCloud || exactlyOneMesh);
 	m_UI->actionShowWaveDialog->setEnabled(exactlyOneCloud);
 	m_UI->actionCompressFWFData->setEnabled(atLeastOneCloud);
+	m_UI->actionComputeFWFFeatures->setEnabled(atLeastOneCloud);
 
 	m_UI->actionKMeans->setEnabled(/*TODO: exactlyOneEntity && exactlyOneSF*/false);
 	m_UI->actionFrontPropagation->setEnabled(/*TODO: exactlyOneEntity && exactlyOneSF*/false);
@@ -11716,6 +11753,36 @@ void MainWindow::doActionCompressFWFData()
 	}
 }
 
+void MainWindow::doActionComputeFWFFeatures()
+{
+	ccProgressDialog pDlg(true, this);
+
+	for ( ccHObject *entity : getSelectedEntities() )
+	{
+		if (!entity || !entity->isKindOf(CC_TYPES::POINT_CLOUD))
+		{
+			continue;
+		}
+
+		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
+		if (!cloud->hasFWF())
+		{
+			ccConsole::Warning(tr("Cloud '%1' has no associated waveform information").arg(cloud->getName()));
+			continue;
+		}
+
+		if (cloud->computeFWFFeatures(ccPointCloud::FWF_PEAK_AMPLITUDE | ccPointCloud::FWF_ECHO_WIDTH | ccPointCloud::FWF_INTEGRAL, &pDlg) == 0)
+		{
+			ccConsole::Error(tr("Failed to compute the waveform features of cloud '%1'").arg(cloud->getName()));
+			break;
+		}
+		cloud->prepareDisplayForRefresh();
+	}
+
+	refreshAll();
+	updateUI();
+}
+
 void MainWindow::doActionShowWaveDialog()
 {
 	if (!haveSelection())
@@ -133,6 +133,8 @@ public:
 	void unregisterOverlayDialog(ccOverlayDialog* dlg) override;
 	void updateOverlayDialogsPlacement() override;
 	void removeFromDB(ccHObject* obj, bool autoDelete = true) override;
+	void beginDBBatch() override;
+	void endDBBatch() override;
 	void setSelectedInDB(ccHObject* obj, bool selected) override;
 	void dispToConsole(QString message, ConsoleMessageLevel level = STD_CONSOLE_MESSAGE) override;
 	void forceConsoleDisplay() override;
@@ -357,6 +359,7 @@ private:
 	void doActionComputeCPS();
 	void doActionShowWaveDialog();
 	void doActionCompressFWFData();
+	void doActionComputeFWFFeatures();
 	void doActionKMeans();
 	void doActionFrontPropagation();
 	void doActionApplyScale();
@@ -532,6 +535,11 @@ private:
 	**/
 	void doActionComputeMesh(CCCoreLib::TRIANGULATION_TYPES type);
 
+	//! Checks that an entity is not too big nor too far from the scene center
+	/** May ask the user (modal dialog) to apply a global shift/scale.
+	**/
+	void checkEntityDimensions(ccHObject* obj);
+
 	//! Computes the orientation of an entity
 	/** Either fit a plane or a 'facet' (2D polygon)
 	**/